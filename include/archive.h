@@ -0,0 +1,63 @@
+#ifndef _ARCHIVE_H_
+#define _ARCHIVE_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "elf_parse.h"
+#include "file.h"
+
+
+/* struct for a member of an ar archive */
+typedef struct archive_member_tag {
+    long int hdr_off;   /* offset of the member header */
+    long int data_off;  /* offset of the member contents */
+    long int size;      /* size of the member contents */
+    char name[VIEW_NAME_SIZE];
+} archive_member_t;
+
+
+/*
+ * Opens the ar archive (GNU, SysV or BSD format) read through r, which must outlive the archive
+ * r must read the whole file, member offsets are absolute
+ * Only the symbol index and long name table headers are read, members are indexed lazily
+ * If r contains an archive returns 0, else 1
+ */
+unsigned char archive_open(const elf_reader_t *r);
+
+/* Frees data allocated by archive_open() */
+void archive_close(void);
+
+/* If an archive is open returns 1, else 0 */
+unsigned char is_archive(void);
+
+/*
+ * Gets the first member of the archive
+ * If successful returns 0, else 1
+ */
+unsigned char archive_first_member(archive_member_t *m);
+
+/*
+ * Gets the member following cur
+ * If successful returns 0, else 1 (also if cur is the last member)
+ */
+unsigned char archive_next_member(const archive_member_t *cur, archive_member_t *m);
+
+/*
+ * Gets the member preceding cur, indexing the archive up to cur if needed
+ * If successful returns 0, else 1 (also if cur is the first member)
+ */
+unsigned char archive_prev_member(const archive_member_t *cur, archive_member_t *m);
+
+/*
+ * Finds member called name, or else the member defining symbol name (through the symbol index)
+ * If successful returns 0, else 1
+ */
+unsigned char archive_find_member(const char *name, archive_member_t *m);
+
+/* Sets v so that it is the window of member m inside parent (the view the archive was opened from) */
+void archive_member_view(const view_t *parent, const archive_member_t *m, view_t *v);
+
+
+#endif
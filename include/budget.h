@@ -0,0 +1,63 @@
+#ifndef _BUDGET_H_
+#define _BUDGET_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+
+/* accounts charged against the memory budget */
+#define BUDGET_WINDOW      0  /* mapped window around the view */
+#define BUDGET_EXTENTS     1  /* data extents of opened files */
+#define BUDGET_OVERLAY     2  /* edited pages and undo/redo history */
+#define BUDGET_ARCHIVE     3  /* lazy index of archive members */
+#define BUDGET_CORE_NOTES  4  /* threads, notes and mappings of core dumps */
+#define BUDGET_EXPORT      5  /* string tables held while exporting */
+#define BUDGET_HASHES      6  /* cached hash tables of sections and segments */
+#define BUDGET_DWARF       7  /* compilation unit index and decoded line tables */
+#define BUDGET_DISASM      8  /* known instruction starts of executable sections */
+#define BUDGET_ZSECTION    9  /* decompressed chunks and seek points of compressed sections */
+#define BUDGET_N_ACCOUNTS  10
+
+#define BUDGET_SIZE_STR_SIZE  16
+
+
+/* Sets the memory cap in bytes (0 = no cap), must be called before anything is charged */
+void budget_set_cap(const size_t cap);
+
+/* Returns the memory cap in bytes (0 = no cap) */
+size_t budget_cap(void);
+
+/*
+ * Charges bytes to account
+ * If they fit inside the cap returns 0, else 1 (and nothing is charged: the caller must not allocate them)
+ */
+unsigned char budget_reserve(const unsigned int account, const size_t bytes);
+
+/* Gives back bytes previously charged to account */
+void budget_release(const unsigned int account, const size_t bytes);
+
+/*
+ * Makes room for one more element inside *arr (which contains n elements of elem_size bytes, its capacity being the
+ * next power of two), charging the bytes added to account and adding them to *charged
+ * If successful returns 0, else 1 (also when the memory budget is exhausted)
+ */
+unsigned char budget_grow(const unsigned int account, size_t *charged, void **arr, const size_t n, const size_t elem_size);
+
+/* Returns bytes charged to account */
+size_t budget_account_used(const unsigned int account);
+
+/* Returns bytes charged to every account */
+size_t budget_used(void);
+
+/*
+ * Parses a size like "512K", "64M" or "2G" (plain numbers are bytes)
+ * If successful returns 0 and sets *bytes, else 1
+ */
+unsigned char budget_parse_size(const char *s, size_t *bytes);
+
+/* Writes bytes as a short human readable size (like "8.0M") into buf (at least BUDGET_SIZE_STR_SIZE bytes) */
+void budget_format_size(char *buf, const size_t bytes);
+
+
+#endif
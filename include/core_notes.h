@@ -0,0 +1,29 @@
+#ifndef _CORE_NOTES_H_
+#define _CORE_NOTES_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "elf_parse.h"
+
+
+/*
+ * Parses PT_LOAD segments and PT_NOTE entries (NT_PRSTATUS, NT_FILE) of a core dump
+ * Does nothing if r does not contain an ELF core file
+ * If successful returns 0, else 1
+ */
+unsigned char core_notes_load(const elf_reader_t *r);
+
+/* Frees data allocated by core_notes_load() */
+void core_notes_free(void);
+
+/*
+ * Writes into buf (at most size bytes, NUL terminated) a label describing offset off
+ * (thread register, note, or mapped file backing the address)
+ * If a label was written returns 0, else 1
+ */
+unsigned char core_notes_label(const long int off, char *buf, const size_t size);
+
+
+#endif
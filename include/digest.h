@@ -0,0 +1,39 @@
+#ifndef _DIGEST_H_
+#define _DIGEST_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+
+#define DIGEST_SHA256_SIZE  32
+
+
+/* struct for a SHA-256 computation (words are kept in unsigned long int, masked to 32 bits) */
+typedef struct digest_sha256_tag {
+    unsigned long int state[8];
+    unsigned long int len_lo;  /* bytes hashed so far (low and high 32 bits) */
+    unsigned long int len_hi;
+    unsigned char block[64];  /* partial block */
+    size_t n;
+} digest_sha256_t;
+
+
+/*
+ * Continues the CRC-32 (polynomial 0x04c11db7 reflected, as zlib and .gnu_debuglink) crc with len bytes of buf
+ * Start with crc = 0, calls can be chained over consecutive chunks
+ * Returns the updated CRC-32
+ */
+unsigned long int digest_crc32(const unsigned long int crc, const void *buf, const size_t len);
+
+/* Starts a new SHA-256 computation in ctx */
+void digest_sha256_init(digest_sha256_t *ctx);
+
+/* Hashes len bytes of buf */
+void digest_sha256_update(digest_sha256_t *ctx, const void *buf, size_t len);
+
+/* Ends the computation of ctx, writing the DIGEST_SHA256_SIZE bytes of the hash into out */
+void digest_sha256_final(digest_sha256_t *ctx, unsigned char *out);
+
+
+#endif
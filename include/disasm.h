@@ -0,0 +1,42 @@
+#ifndef _DISASM_H_
+#define _DISASM_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "abuf.h"
+#include "file.h"
+
+
+/*
+ * Makes v the view shown by the disassembly rows, dropping the instruction index built before
+ * Nothing is read until the first row is needed
+ */
+void disasm_set_view(const view_t *v);
+
+/*
+ * Appends to ab the row starting at position pos of v (at most len columns): one instruction inside x86 executable
+ * sections, else up to 16 bytes of data
+ * Returns the number of bytes of v the row shows (0 at the end of v or on error)
+ */
+size_t disasm_append_row(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
+
+/*
+ * Returns start of the row containing position pos (the instruction containing it inside code)
+ * Instruction starts are found by decoding from the closest known one: symbols seed them, and decoding records a new
+ * one every few hundred bytes, so moving around stays proportional to the rows shown
+ */
+long int disasm_align(const long int pos);
+
+/* Returns start of the row rows rows after (or before, if negative) the row starting at pos, stopping at the first/last row */
+long int disasm_scroll(const long int pos, const long int rows);
+
+/* Returns start of the first executable section after position pos (pos if there's none) */
+long int disasm_next_code(const long int pos);
+
+/* Frees the instruction index */
+void disasm_free(void);
+
+
+#endif
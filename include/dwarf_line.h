@@ -0,0 +1,29 @@
+#ifndef _DWARF_LINE_H_
+#define _DWARF_LINE_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "file.h"
+
+
+/*
+ * Makes v the view whose DWARF line tables are looked up by dwarf_line_label(), dropping what was decoded before
+ * Nothing is read until the first lookup
+ */
+void dwarf_line_set_view(const view_t *v);
+
+/*
+ * Writes into buf (at most size bytes, NUL terminated) "file:line" of the code at position pos of the view
+ * The first call indexes compilation units by address (.debug_aranges, or their DIEs), then every line program
+ * is decoded on first use and kept in a bounded cache
+ * If a label was written returns 0, else 1 (pos is not inside executable code, or there's no line information)
+ */
+unsigned char dwarf_line_label(const long int pos, char *buf, const size_t size);
+
+/* Frees the index and every decoded line table */
+void dwarf_line_free(void);
+
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef _ELF_PARSE_H_
+#define _ELF_PARSE_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+
+#define ELF_READER_INIT  {NULL, NULL, 0}
+
+#define ELF_SYM32_SIZE  16
+#define ELF_SYM64_SIZE  24
+#define ELF_STRTAB_BLOCK_SIZE   (16 * 1024)
+#define ELF_STRTAB_N_BLOCKS     8
+#define ELF_STRTAB_WHOLE_SIZE   (8 * 1024 * 1024)  /* suggested max_whole of elf_strtab_init() */
+
+
+/*
+ * struct describing where ELF structures are read from
+ * read() must copy len bytes at offset off into buf and return the number of bytes copied
+ */
+typedef struct elf_reader_tag {
+    size_t (*read)(void *ctx, void *buf, const size_t len, const long int off);
+    void *ctx;
+    long int len;
+} elf_reader_t;
+
+/* ELF header, decoded independently from class and endianness */
+typedef struct elf_ehdr_tag {
+    unsigned char is_64;
+    unsigned char is_big;
+    unsigned char osabi;
+    unsigned char abiversion;
+    unsigned int type;
+    unsigned int machine;
+    unsigned long int entry;
+    long int phoff;
+    long int shoff;
+    unsigned long int flags;
+    unsigned int phentsize;
+    unsigned int phnum;
+    unsigned int shentsize;
+    unsigned int shnum;
+    unsigned int shstrndx;
+} elf_ehdr_t;
+
+/* program header, decoded independently from class and endianness */
+typedef struct elf_phdr_tag {
+    unsigned long int type;
+    unsigned long int flags;
+    long int offset;
+    unsigned long int vaddr;
+    unsigned long int paddr;
+    unsigned long int filesz;
+    unsigned long int memsz;
+    unsigned long int align;
+} elf_phdr_t;
+
+/* section header, decoded independently from class and endianness */
+typedef struct elf_shdr_tag {
+    unsigned long int name;
+    unsigned long int type;
+    unsigned long int flags;
+    unsigned long int addr;
+    long int offset;
+    unsigned long int size;
+    unsigned long int link;
+    unsigned long int info;
+    unsigned long int addralign;
+    unsigned long int entsize;
+} elf_shdr_t;
+
+/* note entry; name_off and desc_off are absolute offsets inside the reader */
+typedef struct elf_note_tag {
+    unsigned long int namesz;
+    unsigned long int descsz;
+    unsigned long int type;
+    long int name_off;
+    long int desc_off;
+} elf_note_t;
+
+
+/* symbol table entry, decoded independently from class and endianness */
+typedef struct elf_sym_tag {
+    unsigned long int name;
+    unsigned char info;
+    unsigned char other;
+    unsigned int shndx;
+    unsigned long int value;
+    unsigned long int size;
+} elf_sym_t;
+
+/*
+ * string table read whole if small enough, else through a few cached aligned blocks (so that memory use does not depend
+ * on its size), so that lookups in any order (like those of symbol tables) don't read the same bytes again and again
+ */
+typedef struct elf_strtab_tag {
+    const elf_reader_t *r;
+    long int off;
+    unsigned long int size;
+    char *whole;                                      /* the whole table (terminated), or NULL if read through blocks */
+    char *blocks;                                     /* n_blocks blocks, then a buffer for strings crossing blocks */
+    unsigned int n_blocks;                            /* fewer than ELF_STRTAB_N_BLOCKS if the whole table fits */
+    unsigned long int block[ELF_STRTAB_N_BLOCKS];     /* index of the block of the table held by each cached block */
+    size_t block_len[ELF_STRTAB_N_BLOCKS];            /* 0 if unused */
+    unsigned long int last_use[ELF_STRTAB_N_BLOCKS];
+    unsigned long int clock;
+} elf_strtab_t;
+
+
+/*
+ * Reads and decodes the ELF header
+ * If successful returns 0, else 1 (also if the reader does not contain an ELF file)
+ */
+unsigned char elf_read_ehdr(const elf_reader_t *r, elf_ehdr_t *eh);
+
+/*
+ * Reads and decodes the i-th program header
+ * If successful returns 0, else 1
+ */
+unsigned char elf_read_phdr(const elf_reader_t *r, const elf_ehdr_t *eh, const unsigned int i, elf_phdr_t *ph);
+
+/*
+ * Reads and decodes the i-th section header
+ * If successful returns 0, else 1
+ */
+unsigned char elf_read_shdr(const elf_reader_t *r, const elf_ehdr_t *eh, const unsigned int i, elf_shdr_t *sh);
+
+/*
+ * Reads the note starting at off, which must be before end
+ * If successful returns the offset of the next note, else -1
+ */
+long int elf_read_note(const elf_reader_t *r, const elf_ehdr_t *eh, const long int off, const long int end, elf_note_t *note);
+
+/*
+ * Copies at most size - 1 bytes of the NUL terminated string at off into buf (always terminated)
+ * If successful returns 0, else 1
+ */
+unsigned char elf_read_str(const elf_reader_t *r, const long int off, char *buf, const size_t size);
+
+/* Decodes the symbol table entry at raw (ELF_SYM32_SIZE or ELF_SYM64_SIZE bytes, depending on class) */
+void elf_decode_sym(const elf_ehdr_t *eh, const unsigned char *raw, elf_sym_t *sym);
+
+/*
+ * Initializes st to read the string table described by sh, reading it whole if it's at most max_whole bytes
+ * If successful returns 0, else 1
+ */
+unsigned char elf_strtab_init(elf_strtab_t *st, const elf_reader_t *r, const elf_shdr_t *sh, const size_t max_whole);
+
+/* Returns bytes elf_strtab_init() allocates for the string table described by sh (to charge them before) */
+size_t elf_strtab_mem_size(const elf_shdr_t *sh, const size_t max_whole);
+
+/*
+ * Returns the string at index idx of st (valid until the next call), truncated to ELF_STRTAB_BLOCK_SIZE bytes if
+ * st isn't read whole
+ * If idx is out of the table (or can't be read) returns ""
+ */
+const char *elf_strtab_get(elf_strtab_t *st, const unsigned long int idx);
+
+/* Frees data allocated by elf_strtab_init() */
+void elf_strtab_free(elf_strtab_t *st);
+
+/* Decodes an unsigned integer of size bytes (1, 2, 4 or 8) stored with the endianness of eh */
+unsigned long int elf_get(const elf_ehdr_t *eh, const unsigned char *p, const unsigned int size);
+
+/* Returns name of e_type, or NULL if unknown */
+const char *elf_type_name(const unsigned int type);
+
+/* Returns name of e_machine, or NULL if unknown */
+const char *elf_machine_name(const unsigned int machine);
+
+/* Returns name of EI_OSABI, or NULL if unknown */
+const char *elf_osabi_name(const unsigned char osabi);
+
+/* Returns name of p_type, or NULL if unknown */
+const char *elf_phdr_type_name(const unsigned long int type);
+
+/* Returns name of sh_type, or NULL if unknown */
+const char *elf_shdr_type_name(const unsigned long int type);
+
+/* Returns name of d_tag, or NULL if unknown */
+const char *elf_dyn_tag_name(const unsigned long int tag);
+
+/* Returns name of the type (ELF_ST_TYPE) of st_info, or NULL if unknown */
+const char *elf_sym_type_name(const unsigned char info);
+
+/* Returns name of the binding (ELF_ST_BIND) of st_info, or NULL if unknown */
+const char *elf_sym_bind_name(const unsigned char info);
+
+/* Returns name of the relocation type type of machine e_machine (x86_64 and i386 only), or NULL if unknown */
+const char *elf_rel_type_name(const unsigned int machine, const unsigned long int type);
+
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _ENTRIES_H_
+#define _ENTRIES_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "file.h"
+
+
+/*
+ * Opens the table (relocation, dynamic or symbol section) of v containing position pos, or else the first one after it
+ * (wrapping around to the first one of v)
+ * Only section headers are read: rows are decoded when they're shown
+ * If successful returns 0, else 1 (and the table opened before stays open)
+ */
+unsigned char entries_open(const view_t *v, const long int pos);
+
+/*
+ * Opens the table following the open one (wrapping around to the first one)
+ * If successful returns 0, else 1
+ */
+unsigned char entries_next(void);
+
+/* Returns number of lines of the open table (a header, then one line per entry), 0 if there's none */
+size_t entries_n_lines(void);
+
+/*
+ * Writes line i of the open table to buf (at most size bytes, terminated)
+ * Entries are read one at a time from their position, so any line costs the same, and symbol names are resolved
+ * through a small cache of the names used last
+ */
+void entries_line(const size_t i, char *buf, const size_t size);
+
+/* Forgets the cached names (to be called when the bytes they were read from may have changed, like after an edit) */
+void entries_forget_names(void);
+
+/* Writes a summary of the open table (its section and number of entries) to buf (at most size bytes, terminated) */
+void entries_summary(char *buf, const size_t size);
+
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+
+/* C89 standard */
+#include <stdio.h>
+
+#include "elf_parse.h"
+
+
+/*
+ * Writes ELF header, program headers, section headers, symbols, dynamic entries and notes
+ * of the ELF file read through r to f, as one JSON object
+ * Every table is written while it is decoded (one element per line), nothing is kept in memory
+ * If successful returns 0, else 1
+ */
+unsigned char export_json(const elf_reader_t *r, FILE *f);
+
+
+#endif
@@ -6,42 +6,152 @@
 #include <stddef.h>
 
 #include "abuf.h"
+#include "elf_parse.h"
+#include "overlay.h"
+
+
+#define VIEW_NAME_SIZE  256
+
+#define VIEW_INIT  {NULL, NULL, 0, 0, "", NULL, NULL}
+
+#define FILE_WINDOW_INIT  {NULL, NULL, 0, 0, 0}
 
 
 /* 
- * Opens specified file with specified mode and sets is_file_open
- * If successful returns 0, else 1
+ * Handle of an opened file (see file.c)
+ * Every read is position-independent (pread), so any number of threads can read the same handle concurrently
+ * The overlay of the file must only be edited while no other thread is reading it
  */
-unsigned char file_open(const char *__filename, const char *__modes);
+typedef struct file_tag file_t;
 
 /* 
- * Closes opened file
+ * struct for a mapped window of an opened file, which slides to follow reads
+ * Only [start, end) can be resident, the rest of the mapping is released with madvise(MADV_DONTNEED)
+ * A window must be used by one thread at a time (each thread can have its own)
+ */
+typedef struct file_window_tag {
+    const file_t *file;
+    unsigned char *map;  /* the whole file, mapped read only (NULL if mapping failed: reads use pread) */
+    long int start;  /* page aligned */
+    long int end;
+    size_t size;  /* maximum end - start, charged to the memory budget */
+} file_window_t;
+
+/* struct identifying the contents of a file on disk (any of them changes when the file is replaced or written) */
+typedef struct file_id_tag {
+    unsigned long int dev;
+    unsigned long int ino;
+    long int size;
+    long int mtime_sec;
+    long int mtime_nsec;
+} file_id_t;
+
+/* 
+ * struct for a window [base, base + len) of an opened file (e.g. a member of an archive)
+ * Virtual views (e.g. a decompressed section) set read instead: their bytes aren't stored inside the file
+ */
+typedef struct view_tag {
+    file_t *file;
+    file_window_t *window;  /* if not NULL reads go through it, so only the thread owning it can read v */
+    long int base;
+    long int len;
+    char name[VIEW_NAME_SIZE];
+    size_t (*read)(void *ctx, void *buf, const size_t len, const long int pos);  /* NULL unless v is virtual */
+    void *ctx;
+} view_t;
+
+
+/* 
+ * Opens file at path for reading, and discovers its data extents
+ * If successful returns 0 and sets *f, else 1
+ */
+unsigned char file_open(file_t **f, const char *path);
+
+/* 
+ * Closes f and frees it (together with its overlay)
  * If successful returns 0, else 1
  */
-unsigned char file_close(void);
+unsigned char file_close(file_t *f);
 
-/* If file is open returns 1, else 0 */
-unsigned char is_file_open(void);
+/* Returns apparent length of the whole file */
+long int file_size(const file_t *f);
+
+/* Returns path of the file */
+const char *file_path(const file_t *f);
+
+/* Returns the overlay holding the edits of the file */
+overlay_t *file_overlay(file_t *f);
 
 /* 
- * Closes opened file
+ * Sets id to the identity of f on disk (the overlay is not part of it)
  * If successful returns 0, else 1
  */
-size_t file_append_bytes(abuf_t *ab, const size_t len);
+unsigned char file_get_id(const file_t *f, file_id_t *id);
+
+/* Sets v so that it is the window of the whole file */
+void file_root_view(file_t *f, view_t *v);
+
+/* Sets r so that ELF structures are read from view v (which must outlive r) */
+void file_get_reader(elf_reader_t *r, const view_t *v);
+
+/* 
+ * Copies at most len bytes at absolute offset off into buf
+ * Bytes inside holes are zero-filled without reading them, edited bytes come from the overlay
+ * Returns the number of bytes copied
+ */
+size_t file_read_at(const file_t *f, void *buf, const size_t len, const long int off);
 
-size_t file_append_hexs(abuf_t *ab, const size_t len);
+/* 
+ * Maps f for reading through w, keeping at most size bytes resident (size is charged to the memory budget)
+ * If successful returns 0, else 1 (nothing is mapped and w reads through pread)
+ */
+unsigned char file_window_open(file_window_t *w, const file_t *f, const size_t size);
 
-size_t file_append_formatted_chars(abuf_t *ab, const size_t len);
+/* 
+ * Copies at most len bytes at absolute offset off of the file of w into buf (like file_read_at())
+ * If off is outside the resident window, the window slides there and releases the pages it leaves
+ * Returns the number of bytes copied
+ */
+size_t file_window_read(file_window_t *w, void *buf, const size_t len, const long int off);
 
-size_t file_append_chars(abuf_t *ab, const size_t len);
+/* Unmaps w and gives its size back to the memory budget */
+void file_window_close(file_window_t *w);
 
-unsigned char file_move(const long int bytes);
+/* 
+ * Asks the kernel to read ahead [off, off + len) of f (posix_fadvise), then reads it so that it's surely cached
+ * Holes are skipped, the overlay is never touched (so it can run on any thread)
+ * Returns the number of bytes warmed
+ */
+size_t file_warm(const file_t *f, const long int off, const size_t len);
 
-unsigned char file_will_be_end(const long int bytes);
+/* 
+ * Copies at most len bytes at position pos of view v into buf (never past the end of v)
+ * Virtual views are read through their read function, the others from the file
+ * Returns the number of bytes copied
+ */
+size_t view_read(const view_t *v, void *buf, const size_t len, const long int pos);
+
+/* 
+ * Append at most len bytes at position pos of view v to ab (raw, as hex digits, as "formatted" or plain chars)
+ * Returns the number of bytes of v appended (0 at the end of v or on error)
+ */
+size_t file_append_bytes(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
+
+size_t file_append_hexs(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
 
-long int file_tell(void);
+size_t file_append_formatted_chars(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
+
+size_t file_append_chars(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
+
+/* 
+ * Finds the first data extent of view v that ends after pos, clipped to [pos, end of view)
+ * Passes over the whole file should iterate with this to skip holes (virtual views have none)
+ * If found returns 0 and sets [start, end), else 1
+ */
+unsigned char file_next_extent(const view_t *v, const long int pos, long int *start, long int *end);
 
-unsigned char file_seek_set(const long bytes);
+/* Returns number of data extents discovered when f was opened */
+size_t file_n_extents(const file_t *f);
 
 /*unsigned char generate_elf_table(const char *__filename, const char *__modes);*/
 
@@ -0,0 +1,40 @@
+#ifndef _HASHES_H_
+#define _HASHES_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "file.h"
+
+
+/* Handle of the hash table of a view (see hashes.c) */
+typedef struct hashes_table_tag hashes_table_t;
+
+
+/*
+ * Hashes (CRC-32 and SHA-256) view v as a whole, its segments, its sections and its separate debug file
+ * (found through the build-id or .gnu_debuglink), one task per row on the worker pool (started on first use)
+ * Then checks the build-id and the CRC-32 of .gnu_debuglink against the debug file
+ * Tables are cached per file identity (and edits), so asking again for an unchanged view reads nothing
+ * If successful returns 0 and sets *t (valid until the next call or hashes_free()), else 1
+ */
+unsigned char hashes_compute(const view_t *v, const hashes_table_t **t);
+
+/* Returns number of text lines of t (checks, then one line per row) */
+size_t hashes_n_lines(const hashes_table_t *t);
+
+/* Writes line i of t into buf (at most size - 1 characters, always terminated) */
+void hashes_line(const hashes_table_t *t, const size_t i, char *buf, const size_t size);
+
+/* Writes how much was hashed, in how long and on how many workers into buf (like hashes_line()) */
+void hashes_summary(const hashes_table_t *t, char *buf, const size_t size);
+
+/* If the build-id or .gnu_debuglink don't match the debug file returns 1, else 0 */
+unsigned char hashes_has_mismatch(const hashes_table_t *t);
+
+/* Frees every cached table, and stops the worker pool if hashes_compute() started it */
+void hashes_free(void);
+
+
+#endif
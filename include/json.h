@@ -0,0 +1,26 @@
+#ifndef _JSON_H_
+#define _JSON_H_
+
+
+/* C89 standard */
+#include <stdio.h>
+
+#include "abuf.h"
+
+
+/* 
+ * Appends s to ab as a JSON string (quoted, with control characters, quotes and backslashes escaped,
+ * and bytes that aren't valid UTF-8 replaced by U+FFFD)
+ * If successful returns 0, else 1
+ */
+unsigned char json_append_str(abuf_t *ab, const char *s);
+
+/* 
+ * Writes s to f as a JSON string (quoted, with control characters, quotes and backslashes escaped,
+ * and bytes that aren't valid UTF-8 replaced by U+FFFD)
+ * If successful returns 0, else 1
+ */
+unsigned char json_write_str(FILE *f, const char *s);
+
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _OVERLAY_H_
+#define _OVERLAY_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "elf_parse.h"
+
+
+#define OVERLAY_PAGE_SIZE  4096
+
+
+/* Handle of the edits made to a file (see overlay.c) */
+typedef struct overlay_tag overlay_t;
+
+
+/* 
+ * Creates an empty overlay over the bytes read through original (whose ctx must outlive the overlay)
+ * If successful returns 0 and sets *o, else 1
+ */
+unsigned char overlay_new(overlay_t **o, const elf_reader_t *original);
+
+/*
+ * Overwrites byte at absolute offset off (only inside the overlay, the file is untouched)
+ * The page containing off is copied on first write, the edit is recorded for undo (and clears redo)
+ * If successful returns 0, else 1
+ */
+unsigned char overlay_set(overlay_t *o, const long int off, const unsigned char byte);
+
+/*
+ * Undoes the last edit
+ * If an edit was undone returns 0 and sets *off to its offset, else 1
+ */
+unsigned char overlay_undo(overlay_t *o, long int *off);
+
+/*
+ * Redoes the last undone edit
+ * If an edit was redone returns 0 and sets *off to its offset, else 1
+ */
+unsigned char overlay_redo(overlay_t *o, long int *off);
+
+/* Patches buf, which contains len original bytes starting at absolute offset off, with edited pages */
+void overlay_apply(const overlay_t *o, void *buf, const size_t len, const long int off);
+
+/* If there are edits not yet saved returns 1, else 0 */
+unsigned char overlay_is_modified(const overlay_t *o);
+
+/* Returns number of pages copied into the overlay */
+size_t overlay_n_pages(const overlay_t *o);
+
+/* Returns a number that changes after every edit, undo and redo (to tell whether bytes derived from o are stale) */
+unsigned long int overlay_generation(const overlay_t *o);
+
+/*
+ * Writes edited pages (and only them) into the file at path, which must be the original file
+ * If successful returns 0, else 1
+ */
+unsigned char overlay_save(overlay_t *o, const char *path);
+
+/*
+ * Writes the original bytes with all edits into a new file at path, streaming it a chunk at a time
+ * If successful returns 0, else 1
+ */
+unsigned char overlay_save_as(const overlay_t *o, const char *path);
+
+/* Frees o with every page and edit */
+void overlay_free(overlay_t *o);
+
+
+#endif
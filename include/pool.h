@@ -0,0 +1,33 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+
+/* function executed by a worker of the pool */
+typedef void (*pool_func_t)(void *arg);
+
+
+/*
+ * Starts n_workers worker threads (0 = one per online CPU), each with its own task deque
+ * Idle workers steal tasks from the deques of the others
+ * If successful returns 0, else 1
+ */
+unsigned char pool_start(unsigned int n_workers);
+
+/*
+ * Schedules func(arg): tasks submitted by a worker go to its own deque, the others are spread round-robin
+ * Blocks non worker callers while too many tasks are pending
+ * If successful returns 0, else 1
+ */
+unsigned char pool_submit(pool_func_t func, void *arg);
+
+/* Waits until every submitted task has been executed */
+void pool_wait(void);
+
+/* Waits pending tasks, then stops and joins workers */
+void pool_stop(void);
+
+/* Returns number of workers, 0 if the pool is not started */
+unsigned int pool_n_workers(void);
+
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _PREFETCH_H_
+#define _PREFETCH_H_
+
+
+#include "file.h"
+
+
+/* struct for prefetch statistics */
+typedef struct prefetch_stats_tag {
+    unsigned long int hits;    /* prefetched blocks that were then shown */
+    unsigned long int wasted;  /* prefetched blocks dropped without being shown */
+} prefetch_stats_t;
+
+
+/*
+ * Starts the helper thread warming the blocks ahead of the scrolling direction
+ * If successful returns 0, else 1
+ */
+unsigned char prefetch_start(void);
+
+/* Stops and joins the helper thread (must be called before closing the prefetched file) */
+void prefetch_stop(void);
+
+/*
+ * Tells that bytes [pos, pos + screen_len) of v are shown
+ * Direction and speed of scrolling are derived from the previous calls, and the helper thread is
+ * asked to warm the next screens in that direction (more screens while the user keeps scrolling)
+ */
+void prefetch_hint(const view_t *v, const long int pos, const long int screen_len);
+
+/* Copies current statistics into stats */
+void prefetch_get_stats(prefetch_stats_t *stats);
+
+
+#endif
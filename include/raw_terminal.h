@@ -2,6 +2,9 @@
 #define _RAW_TERMINAL_H_
 
 
+#include "file.h"
+
+
 /* 
  * Initialize terminal data, assigns SIGWINCH signal handler and enables raw mode
  * If successful returns 0, else:
@@ -22,6 +25,21 @@ unsigned char disable_term_raw_mode(void);
 /* If terminal is in raw mode returns 1, else 0 */
 unsigned char is_term_raw_mode(void);
 
+/* 
+ * Makes root (the whole opened file, which must stay open) the view shown by the terminal
+ * The file is read through a mapped window, sized to fit inside the memory budget
+ */
+void term_set_file(const view_t *root);
+
+/* Closes the decompressed section shown (if any) and unmaps the window of the file shown by the terminal (before closing it) */
+void term_close_file(void);
+
+/* 
+ * Makes member name (or the member defining symbol name) of the opened archive the active view
+ * If successful returns 0, else 1
+ */
+unsigned char term_select_member(const char *name);
+
 /* 
  * Enters in terminal loop
  * If "quit input" was received returns 0, else if error returns 1 
@@ -0,0 +1,18 @@
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+
+#define SCAN_FORMAT_JSON  0
+#define SCAN_FORMAT_CSV   1
+
+
+/*
+ * Walks the tree rooted at root (without following symbolic links), identifies ELF files by magic,
+ * and parses them on n_jobs workers (0 = one per online CPU)
+ * Streams one record per ELF file to stdout, as NDJSON or CSV depending on format
+ * If successful returns 0, else 1
+ */
+unsigned char scan_tree(const char *root, const unsigned char format, const unsigned int n_jobs);
+
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+
+/*
+ * Starts recording keys and resizes of the interactive session into the file at path
+ * Every line is "K <ms> <hex bytes>" (a key, escape sequences are one key) or "R <ms> <rows> <cols>"
+ * If successful returns 0, else 1
+ */
+unsigned char session_record_open(const char *path);
+
+/* Records byte c read from the keyboard (does nothing if not recording) */
+void session_record_key(const char c);
+
+/* Records that the terminal is now rows x cols (does nothing if not recording) */
+void session_record_resize(const unsigned int rows, const unsigned int cols);
+
+/* Writes pending events and closes the recording (does nothing if not recording) */
+void session_record_close(void);
+
+/*
+ * Replays the session recorded at path against "elf-visualizer args[0] ... args[n_args - 1]" running inside
+ * a pseudo-terminal, with the recorded timing
+ * Reports to stdout the number of events, bytes written to the terminal and the distribution of the latency
+ * between every key and the last byte written because of it
+ * The final screen (before quitting) is compared with the one inside expect_path (if not NULL) and saved
+ * into save_path (if not NULL)
+ * If successful (and screens match) returns 0, else 1
+ */
+unsigned char session_replay(const char *path, char *const args[], const int n_args, const char *expect_path, const char *save_path);
+
+
+#endif
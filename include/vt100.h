@@ -0,0 +1,53 @@
+#ifndef _VT100_H_
+#define _VT100_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+
+#define VT100_INIT  {NULL, 0, 0, 0, 0, 0, 0, {0}, 0}
+
+#define VT100_MAX_PARAMS  8
+
+
+/* struct for an emulated screen (only what elf-visualizer writes: text, CR/LF, cursor moves, erases) */
+typedef struct vt100_tag {
+    char *cells;  /* rows * cols characters */
+    unsigned int rows;
+    unsigned int cols;
+    unsigned int row;  /* cursor */
+    unsigned int col;
+    unsigned char wrap_pending;  /* 1 if the last column was written (wrap happens on the next character) */
+    unsigned char state;  /* parser state */
+    unsigned int params[VT100_MAX_PARAMS];
+    unsigned int n_params;
+} vt100_t;
+
+
+/*
+ * Makes s an empty screen of rows x cols
+ * If successful returns 0, else 1
+ */
+unsigned char vt100_init(vt100_t *s, const unsigned int rows, const unsigned int cols);
+
+/*
+ * Resizes s, keeping what fits
+ * If successful returns 0, else 1
+ */
+unsigned char vt100_resize(vt100_t *s, const unsigned int rows, const unsigned int cols);
+
+/* Interprets len bytes of output written to the terminal */
+void vt100_feed(vt100_t *s, const char *buf, const size_t len);
+
+/*
+ * Returns the screen as text (one line per row, trailing spaces removed), which must be freed
+ * If there's no memory returns NULL
+ */
+char *vt100_text(const vt100_t *s);
+
+/* Frees s */
+void vt100_free(vt100_t *s);
+
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _X86_H_
+#define _X86_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+
+#define X86_MAX_INSN_LEN  15
+#define X86_TEXT_SIZE     128
+
+
+/* struct for a decoded instruction */
+typedef struct x86_insn_tag {
+    unsigned int len;  /* bytes of the instruction (1 if it's invalid) */
+    unsigned char is_valid;
+    char text[X86_TEXT_SIZE];  /* Intel syntax, branch targets and RIP-relative addresses made absolute */
+} x86_insn_t;
+
+
+/*
+ * Decodes the instruction at the start of buf (len bytes available), placed at address addr, in 64-bit mode if is_64 is 1
+ * (else 32-bit mode)
+ * Bytes that can't be decoded (invalid opcode, or buf ends first) make a 1 byte invalid instruction
+ */
+void x86_decode(const unsigned char *buf, const size_t len, const unsigned long int addr, const unsigned char is_64, x86_insn_t *insn);
+
+/* Returns length of the instruction at the start of buf, like x86_decode() but without writing its text */
+unsigned int x86_insn_len(const unsigned char *buf, const size_t len, const unsigned char is_64);
+
+
+#endif
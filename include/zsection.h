@@ -0,0 +1,61 @@
+#ifndef _ZSECTION_H_
+#define _ZSECTION_H_
+
+
+/* C89 standard */
+#include <stddef.h>
+
+#include "elf_parse.h"
+#include "file.h"
+
+
+/* return values of zsection_open() and zsection_open_at() */
+#define ZSECTION_OK           0
+#define ZSECTION_ERROR        1
+#define ZSECTION_UNSUPPORTED  2  /* compressed with something else than zlib (e.g. zstd) */
+
+
+/*
+ * Handle of an opened compressed section (see zsection.c)
+ * Decompressed bytes are produced a chunk at a time when read, and kept inside a small cache of chunks
+ * A handle must be used by one thread at a time
+ */
+typedef struct zsection_tag zsection_t;
+
+
+/* Returns 1 if section sh (named name) is compressed (SHF_COMPRESSED, or an old style .zdebug section), else 0 */
+unsigned char zsection_is_compressed(const elf_shdr_t *sh, const char *name);
+
+/*
+ * Opens compressed section sh (named name) of the ELF file eh inside view v (which must outlive *z)
+ * Nothing is decompressed until the first read
+ * Returns one of ZSECTION_OK (and sets *z), ZSECTION_ERROR or ZSECTION_UNSUPPORTED
+ */
+unsigned char zsection_open(zsection_t **z, const view_t *v, const elf_ehdr_t *eh, const elf_shdr_t *sh, const char *name);
+
+/*
+ * Opens the compressed section of view v containing position pos, or else the first one after it (wrapping around to
+ * the first one of v)
+ * Returns the same values as zsection_open()
+ */
+unsigned char zsection_open_at(zsection_t **z, const view_t *v, const long int pos);
+
+/* Returns decompressed size of z */
+long int zsection_len(const zsection_t *z);
+
+/*
+ * Copies at most len decompressed bytes at position pos of z (passed as void *, to be the read function of a view) into buf
+ * Decompression restarts from the closest seek point before pos (one is recorded every megabyte decompressed), not from
+ * the beginning
+ * Returns the number of bytes copied
+ */
+size_t zsection_read(void *z, void *buf, const size_t len, const long int pos);
+
+/* Sets v so that it is the view of the decompressed bytes of z (valid until z is closed) */
+void zsection_view(zsection_t *z, view_t *v);
+
+/* Closes z and frees it (giving its memory back to the budget) */
+void zsection_close(zsection_t *z);
+
+
+#endif
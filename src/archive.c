@@ -0,0 +1,473 @@
+/* C89 standard */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <ar.h>
+
+#include "budget.h"
+#include "elf_parse.h"
+#include "file.h"
+
+#include "archive.h"
+
+
+#define AR_HDR_SIZE       60
+#define AR_NAME_SIZE      16
+#define AR_SIZE_OFF       48
+#define AR_SIZE_SIZE      10
+#define AR_FMAG_OFF       58
+
+#define AR_KIND_MEMBER     0
+#define AR_KIND_SYMTAB     1
+#define AR_KIND_SYMTAB64   2
+#define AR_KIND_SYMDEF     3
+#define AR_KIND_LONGNAMES  4
+
+#define BSD_NAME_PREFIX   "#1/"
+#define BSD_SYMDEF        "__.SYMDEF"
+
+#define INDEX_INITIAL_SIZE  64
+#define SYMTAB_CHUNK_SIZE   4096  /* bytes of the symbol index read at once */
+#define NAME_CHUNK_SIZE     64    /* bytes of a BSD symbol name read at once */
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a decoded member header */
+typedef struct ar_hdr_tag {
+    unsigned char kind;
+    long int data_off;
+    long int size;
+    long int next_off;  /* offset of the following header */
+    char name[VIEW_NAME_SIZE];
+} ar_hdr_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing archive data */
+static struct archive_tag {
+    unsigned char is_open;
+    const elf_reader_t *r;
+    long int symtab_off;     /* header offset of the symbol index, -1 if none */
+    long int longnames_off;  /* data offset of the GNU long name table, -1 if none */
+    long int longnames_size;
+    long int *index;         /* header offsets of the members indexed so far */
+    size_t n_index;
+    size_t index_size;
+    long int next_unindexed; /* header offset following the last indexed member */
+    unsigned char is_indexed; /* 1 if every member is inside index (or it can't grow inside the memory budget) */
+} archive;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Reads and decodes the header at off (name is resolved only if resolve_name is 1)
+ * If successful returns 0, else 1
+ */
+static unsigned char read_hdr(const long int off, ar_hdr_t *h, const unsigned char resolve_name);
+
+/*
+ * Reads the first non special header at or after off
+ * If successful returns 0, else 1
+ */
+static unsigned char read_member_from(const long int off, archive_member_t *m);
+
+/*
+ * Indexes members until the one with header at hdr_off (or the whole archive if hdr_off is -1)
+ * If successful returns 0, else 1
+ */
+static unsigned char index_until(const long int hdr_off);
+
+/* Returns position of hdr_off inside archive.index, or archive.n_index if not indexed */
+static size_t index_find(const long int hdr_off);
+
+/*
+ * Looks up symbol inside the symbol index and sets *hdr_off to the header of the member defining it
+ * If successful returns 0, else 1
+ */
+static unsigned char symtab_lookup(const char *symbol, long int *hdr_off);
+
+/* Returns 1 if the NUL terminated name at off (before end) is symbol, else 0 (it's read only until it differs) */
+static unsigned char name_equals(const long int off, const long int end, const char *symbol);
+
+/* Decodes an unsigned integer of size bytes */
+static unsigned long int get_uint(const unsigned char *p, const unsigned int size, const unsigned char is_big);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char archive_open(const elf_reader_t *r) {
+    char magic[SARMAG];
+    ar_hdr_t h;
+    long int off;
+    unsigned int i;
+
+    archive_close();
+    if (r->len < SARMAG || r->read(r->ctx, magic, SARMAG, 0) != SARMAG || memcmp(magic, ARMAG, SARMAG) != 0)
+        return 1;
+
+    archive.r = r;
+    archive.symtab_off = -1;
+    archive.longnames_off = -1;
+    archive.longnames_size = 0;
+    archive.next_unindexed = SARMAG;
+    archive.is_indexed = 0;
+
+    /* Special members always come first: at most the symbol index(es) and the long name table */
+    off = SARMAG;
+    for (i = 0; i < 3 && off < r->len; i++) {
+        if (read_hdr(off, &h, 0) == 1)
+            break;
+        if (h.kind == AR_KIND_MEMBER)
+            break;
+        if (h.kind == AR_KIND_LONGNAMES) {
+            archive.longnames_off = h.data_off;
+            archive.longnames_size = h.size;
+        } else if (archive.symtab_off == -1) {
+            archive.symtab_off = off;
+        }
+        off = h.next_off;
+    }
+
+    archive.is_open = 1;
+    return 0;
+}
+
+void archive_close(void) {
+    budget_release(BUDGET_ARCHIVE, archive.index_size * sizeof(*archive.index));
+    free(archive.index);
+    archive.index = NULL;
+    archive.n_index = 0;
+    archive.index_size = 0;
+    archive.is_open = 0;
+}
+
+unsigned char is_archive(void) {
+    return archive.is_open;
+}
+
+unsigned char archive_first_member(archive_member_t *m) {
+    return read_member_from(SARMAG, m);
+}
+
+unsigned char archive_next_member(const archive_member_t *cur, archive_member_t *m) {
+    return read_member_from(cur->data_off + cur->size + (cur->size & 1), m);
+}
+
+unsigned char archive_prev_member(const archive_member_t *cur, archive_member_t *m) {
+    size_t i;
+
+    if (index_until(cur->hdr_off) == 1)
+        return 1;
+    if ((i = index_find(cur->hdr_off)) == 0 || i >= archive.n_index)
+        return 1;
+    return read_member_from(archive.index[i - 1], m);
+}
+
+unsigned char archive_find_member(const char *name, archive_member_t *m) {
+    long int hdr_off;
+
+    /* Member names */
+    if (read_member_from(SARMAG, m) == 0) {
+        do {
+            if (strcmp(m->name, name) == 0)
+                return 0;
+        } while (archive_next_member(m, m) == 0);
+    }
+
+    /* Symbol names */
+    if (symtab_lookup(name, &hdr_off) == 1)
+        return 1;
+    return read_member_from(hdr_off, m);
+}
+
+void archive_member_view(const view_t *parent, const archive_member_t *m, view_t *v) {
+    v->file = parent->file;
+    v->window = parent->window;
+    v->base = parent->base + m->data_off;
+    v->len = m->size;
+    strcpy(v->name, m->name);
+    v->read = NULL;
+    v->ctx = NULL;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* HEADERS */
+
+static unsigned char read_hdr(const long int off, ar_hdr_t *h, const unsigned char resolve_name) {
+    char raw[AR_HDR_SIZE + 1];
+    char *end;
+    long int name_off, name_len;
+    size_t n;
+
+    if (off + AR_HDR_SIZE > archive.r->len)
+        return 1;
+    if (archive.r->read(archive.r->ctx, raw, AR_HDR_SIZE, off) != AR_HDR_SIZE)
+        return 1;
+    if (memcmp(&raw[AR_FMAG_OFF], ARFMAG, 2) != 0)
+        return 1;
+
+    raw[AR_SIZE_OFF + AR_SIZE_SIZE] = '\0';
+    h->size = strtol(&raw[AR_SIZE_OFF], &end, 10);
+    if (end == &raw[AR_SIZE_OFF] || h->size < 0)
+        return 1;
+    h->data_off = off + AR_HDR_SIZE;
+    h->next_off = h->data_off + h->size + (h->size & 1);
+    if (h->data_off + h->size > archive.r->len)
+        return 1;
+
+    /* Kind */
+    h->kind = AR_KIND_MEMBER;
+    if (memcmp(raw, "/ ", 2) == 0)
+        h->kind = AR_KIND_SYMTAB;
+    else if (memcmp(raw, "/SYM64/ ", 8) == 0)
+        h->kind = AR_KIND_SYMTAB64;
+    else if (memcmp(raw, "// ", 3) == 0)
+        h->kind = AR_KIND_LONGNAMES;
+    else if (memcmp(raw, BSD_SYMDEF, sizeof(BSD_SYMDEF) - 1) == 0)
+        h->kind = AR_KIND_SYMDEF;
+
+    /* BSD long names are stored at the beginning of the contents */
+    name_len = 0;
+    if (memcmp(raw, BSD_NAME_PREFIX, sizeof(BSD_NAME_PREFIX) - 1) == 0) {
+        raw[AR_NAME_SIZE] = '\0';
+        name_len = strtol(&raw[sizeof(BSD_NAME_PREFIX) - 1], NULL, 10);
+        if (name_len <= 0 || name_len > h->size)
+            return 1;
+        h->data_off += name_len;
+        h->size -= name_len;
+        n = name_len < VIEW_NAME_SIZE ? (size_t)name_len : VIEW_NAME_SIZE - 1;
+        if (archive.r->read(archive.r->ctx, h->name, n, off + AR_HDR_SIZE) != n)
+            return 1;
+        h->name[n] = '\0';
+        if (strncmp(h->name, BSD_SYMDEF, sizeof(BSD_SYMDEF) - 1) == 0)
+            h->kind = AR_KIND_SYMDEF;
+        return 0;
+    }
+
+    if (resolve_name == 0 || h->kind != AR_KIND_MEMBER) {
+        h->name[0] = '\0';
+        return 0;
+    }
+
+    /* GNU long names: "/offset" inside the long name table, terminated by "/\n" */
+    if (raw[0] == '/' && archive.longnames_off != -1) {
+        raw[AR_NAME_SIZE] = '\0';
+        name_off = strtol(&raw[1], NULL, 10);
+        if (name_off < 0 || name_off >= archive.longnames_size)
+            return 1;
+        n = (size_t)(archive.longnames_size - name_off) < VIEW_NAME_SIZE ? (size_t)(archive.longnames_size - name_off) : VIEW_NAME_SIZE - 1;
+        n = archive.r->read(archive.r->ctx, h->name, n, archive.longnames_off + name_off);
+        h->name[n] = '\0';
+        if ((end = strchr(h->name, '\n')) != NULL)
+            *end = '\0';
+        n = strlen(h->name);
+        if (n > 0 && h->name[n - 1] == '/')
+            h->name[n - 1] = '\0';
+        return 0;
+    }
+
+    /* Short names: GNU terminates them with '/', BSD pads them with spaces */
+    memcpy(h->name, raw, AR_NAME_SIZE);
+    h->name[AR_NAME_SIZE] = '\0';
+    for (n = AR_NAME_SIZE; n > 0 && h->name[n - 1] == ' '; n--)
+        h->name[n - 1] = '\0';
+    if (n > 0 && h->name[n - 1] == '/')
+        h->name[n - 1] = '\0';
+    return 0;
+}
+
+static unsigned char read_member_from(const long int off, archive_member_t *m) {
+    ar_hdr_t h;
+    long int pos;
+    long int *new_index;
+    size_t new_size;
+
+    for (pos = off; pos < archive.r->len; pos = h.next_off) {
+        if (read_hdr(pos, &h, 1) == 1)
+            return 1;
+        if (h.kind == AR_KIND_MEMBER)
+            break;
+    }
+    if (pos >= archive.r->len)
+        return 1;
+
+    m->hdr_off = pos;
+    m->data_off = h.data_off;
+    m->size = h.size;
+    strcpy(m->name, h.name);
+
+    /* Extend the lazy index for free when walking sequentially past its end */
+    if (archive.is_indexed == 0 && off <= archive.next_unindexed && pos >= archive.next_unindexed) {
+        if (archive.n_index == archive.index_size) {
+            new_size = archive.index_size == 0 ? INDEX_INITIAL_SIZE : archive.index_size * 2;
+            if (budget_reserve(BUDGET_ARCHIVE, (new_size - archive.index_size) * sizeof(*new_index)) == 1) {
+                /* Over the memory budget: stop indexing ('[' can't go back before the indexed members) */
+                archive.is_indexed = 1;
+                return 0;
+            }
+            if ((new_index = realloc(archive.index, new_size * sizeof(*new_index))) == NULL) {
+                budget_release(BUDGET_ARCHIVE, (new_size - archive.index_size) * sizeof(*new_index));
+                return 1;
+            }
+            archive.index = new_index;
+            archive.index_size = new_size;
+        }
+        archive.index[archive.n_index++] = pos;
+        archive.next_unindexed = h.next_off;
+        if (archive.next_unindexed >= archive.r->len)
+            archive.is_indexed = 1;
+    }
+    return 0;
+}
+
+/* INDEX */
+
+static unsigned char index_until(const long int hdr_off) {
+    archive_member_t m;
+
+    while (archive.is_indexed == 0 && (hdr_off == -1 || archive.next_unindexed <= hdr_off)) {
+        if (read_member_from(archive.next_unindexed, &m) == 1) {
+            archive.is_indexed = 1;
+            break;
+        }
+    }
+    return 0;
+}
+
+static size_t index_find(const long int hdr_off) {
+    size_t lo, hi, mid;
+
+    lo = 0;
+    hi = archive.n_index;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (archive.index[mid] == hdr_off)
+            return mid;
+        if (archive.index[mid] < hdr_off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return archive.n_index;
+}
+
+/* SYMBOL INDEX */
+
+static unsigned char symtab_lookup(const char *symbol, long int *hdr_off) {
+    unsigned char buf[SYMTAB_CHUNK_SIZE];
+    ar_hdr_t h;
+    unsigned long int count, i, strtab_size, strx;
+    long int end, entries, names, pos;
+    size_t word, n, j, matched;
+    unsigned char is_mismatch;
+
+    /* The index is read a chunk at a time, so memory use doesn't depend on its size */
+    if (archive.symtab_off == -1 || read_hdr(archive.symtab_off, &h, 0) == 1)
+        return 1;
+    end = h.data_off + h.size;
+
+    if (h.kind == AR_KIND_SYMDEF) {
+        /* BSD: ranlib array size, {strx, off} entries, string table size, string table */
+        if (h.size < 8 || archive.r->read(archive.r->ctx, buf, 4, h.data_off) != 4)
+            return 1;
+        count = get_uint(buf, 4, 0) / 8;
+        if (count > (unsigned long int)(h.size - 8) / 8)
+            return 1;
+        entries = h.data_off + 4;
+        names = entries + (long int)(count * 8) + 4;
+        if (archive.r->read(archive.r->ctx, buf, 4, names - 4) != 4)
+            return 1;
+        strtab_size = get_uint(buf, 4, 0);
+        for (i = 0; i < count; i += n / 8) {
+            n = (count - i) * 8 < sizeof(buf) ? (size_t)((count - i) * 8) : sizeof(buf);
+            if (archive.r->read(archive.r->ctx, buf, n, entries + (long int)(i * 8)) != n)
+                return 1;
+            for (j = 0; j < n; j += 8) {
+                strx = get_uint(&buf[j], 4, 0);
+                if (strx < strtab_size && names + (long int)strx < end && name_equals(names + (long int)strx, end, symbol) == 1) {
+                    *hdr_off = (long int)get_uint(&buf[j + 4], 4, 0);
+                    return 0;
+                }
+            }
+        }
+        return 1;
+    }
+
+    /* GNU: big endian count, count offsets, count NUL terminated names (matched against symbol while streaming) */
+    word = h.kind == AR_KIND_SYMTAB64 ? 8 : 4;
+    if ((size_t)h.size < word || archive.r->read(archive.r->ctx, buf, word, h.data_off) != word)
+        return 1;
+    count = get_uint(buf, (unsigned int)word, 1);
+    if (count > ((size_t)h.size - word) / word)
+        return 1;
+    i = 0;
+    matched = 0;
+    is_mismatch = 0;
+    for (pos = h.data_off + (long int)(word + count * word); i < count && pos < end; pos += (long int)n) {
+        n = end - pos < (long int)sizeof(buf) ? (size_t)(end - pos) : sizeof(buf);
+        if (archive.r->read(archive.r->ctx, buf, n, pos) != n)
+            return 1;
+        for (j = 0; j < n && i < count; j++) {
+            if (buf[j] != '\0') {
+                if (is_mismatch == 0 && symbol[matched] == (char)buf[j])
+                    matched++;
+                else
+                    is_mismatch = 1;
+                continue;
+            }
+            if (is_mismatch == 0 && symbol[matched] == '\0') {
+                if (archive.r->read(archive.r->ctx, buf, word, h.data_off + (long int)(word + i * word)) != word)
+                    return 1;
+                *hdr_off = (long int)get_uint(buf, (unsigned int)word, 1);
+                return 0;
+            }
+            i++;
+            matched = 0;
+            is_mismatch = 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned char name_equals(const long int off, const long int end, const char *symbol) {
+    unsigned char buf[NAME_CHUNK_SIZE];
+    long int pos;
+    size_t n, i, matched;
+
+    matched = 0;
+    for (pos = off; pos < end; pos += (long int)n) {
+        n = end - pos < (long int)sizeof(buf) ? (size_t)(end - pos) : sizeof(buf);
+        if (archive.r->read(archive.r->ctx, buf, n, pos) != n)
+            return 0;
+        for (i = 0; i < n; i++, matched++) {
+            if (buf[i] == '\0')
+                return symbol[matched] == '\0';
+            if (symbol[matched] != (char)buf[i])
+                return 0;
+        }
+    }
+    return 0;
+}
+
+/* DECODING */
+
+static unsigned long int get_uint(const unsigned char *p, const unsigned int size, const unsigned char is_big) {
+    unsigned long int v;
+    unsigned int i;
+
+    v = 0;
+    for (i = 0; i < size; i++) {
+        if (is_big)
+            v = (v << 8) | p[i];
+        else
+            v |= (unsigned long int)p[i] << (8 * i);
+    }
+    return v;
+}
@@ -0,0 +1,158 @@
+#define _XOPEN_SOURCE 700  /* for pthread */
+
+/* C89 standard */
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* POSIX standard */
+#include <pthread.h>
+
+#include "budget.h"
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing budget data (charged by every thread, so it's protected by lock) */
+static struct budget_tag {
+    pthread_mutex_t lock;
+    size_t cap;
+    size_t used;
+    size_t accounts[BUDGET_N_ACCOUNTS];
+} budget = {PTHREAD_MUTEX_INITIALIZER, 0, 0, {0, 0, 0, 0, 0}};
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+/* CAP */
+
+void budget_set_cap(const size_t cap) {
+    pthread_mutex_lock(&budget.lock);
+    budget.cap = cap;
+    pthread_mutex_unlock(&budget.lock);
+}
+
+size_t budget_cap(void) {
+    size_t cap;
+
+    pthread_mutex_lock(&budget.lock);
+    cap = budget.cap;
+    pthread_mutex_unlock(&budget.lock);
+    return cap;
+}
+
+/* ACCOUNTS */
+
+unsigned char budget_reserve(const unsigned int account, const size_t bytes) {
+    unsigned char status;
+
+    pthread_mutex_lock(&budget.lock);
+    status = budget.cap != 0 && bytes > budget.cap - budget.used;
+    if (status == 0) {
+        budget.used += bytes;
+        budget.accounts[account] += bytes;
+    }
+    pthread_mutex_unlock(&budget.lock);
+    return status;
+}
+
+void budget_release(const unsigned int account, const size_t bytes) {
+    pthread_mutex_lock(&budget.lock);
+    budget.used -= bytes;
+    budget.accounts[account] -= bytes;
+    pthread_mutex_unlock(&budget.lock);
+}
+
+unsigned char budget_grow(const unsigned int account, size_t *charged, void **arr, const size_t n, const size_t elem_size) {
+    void *new_arr;
+
+    /* Capacity is always the next power of two */
+    if (n != 0 && (n & (n - 1)) != 0)
+        return 0;
+    if (budget_reserve(account, (n == 0 ? 1 : n) * elem_size) == 1)
+        return 1;
+    if ((new_arr = realloc(*arr, (n == 0 ? 1 : n * 2) * elem_size)) == NULL) {
+        budget_release(account, (n == 0 ? 1 : n) * elem_size);
+        return 1;
+    }
+    *charged += (n == 0 ? 1 : n) * elem_size;
+    *arr = new_arr;
+    return 0;
+}
+
+size_t budget_account_used(const unsigned int account) {
+    size_t used;
+
+    pthread_mutex_lock(&budget.lock);
+    used = budget.accounts[account];
+    pthread_mutex_unlock(&budget.lock);
+    return used;
+}
+
+size_t budget_used(void) {
+    size_t used;
+
+    pthread_mutex_lock(&budget.lock);
+    used = budget.used;
+    pthread_mutex_unlock(&budget.lock);
+    return used;
+}
+
+/* SIZES */
+
+unsigned char budget_parse_size(const char *s, size_t *bytes) {
+    unsigned long int n;
+    unsigned int units;
+    char *end;
+
+    /* strtoul() would also take spaces and signs ("-1" being ULONG_MAX) */
+    if (*s < '0' || *s > '9')
+        return 1;
+    errno = 0;
+    n = strtoul(s, &end, 10);
+    if (errno == ERANGE)
+        return 1;
+
+    units = 0;
+    switch (*end) {
+        case 'G':
+        case 'g':
+            units++;
+            /* fall through */
+        case 'M':
+        case 'm':
+            units++;
+            /* fall through */
+        case 'K':
+        case 'k':
+            units++;
+            end++;
+            break;
+    }
+    if (*end != '\0')
+        return 1;
+    for (; units > 0; units--) {
+        if (n > ULONG_MAX / 1024)
+            return 1;
+        n *= 1024;
+    }
+    *bytes = (size_t)n;
+    return 0;
+}
+
+void budget_format_size(char *buf, const size_t bytes) {
+    static const char UNITS[] = "KMGT";
+    unsigned long int tenths;
+    unsigned int i;
+
+    if (bytes < 1024) {
+        sprintf(buf, "%luB", (unsigned long int)bytes);
+        return;
+    }
+    tenths = (unsigned long int)bytes * 10 / 1024;
+    for (i = 0; tenths >= 10240 && i < sizeof(UNITS) - 2; i++)
+        tenths /= 1024;
+    sprintf(buf, "%lu.%lu%c", tenths / 10, tenths % 10, UNITS[i]);
+}
@@ -0,0 +1,337 @@
+#define _XOPEN_SOURCE 700  /* for snprintf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+#include "budget.h"
+#include "elf_parse.h"
+
+#include "core_notes.h"
+
+
+#define PRSTATUS64_PID_OFF  32
+#define PRSTATUS64_REG_OFF  112
+#define PRSTATUS32_PID_OFF  24
+#define PRSTATUS32_REG_OFF  72
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a PT_LOAD segment (maps file offsets to virtual addresses) */
+typedef struct core_load_tag {
+    long int offset;
+    unsigned long int filesz;
+    unsigned long int vaddr;
+} core_load_t;
+
+/* struct for a NT_PRSTATUS note (one per thread) */
+typedef struct core_thread_tag {
+    long int desc_off;
+    unsigned long int descsz;
+    long int reg_off;
+    long int pid;
+} core_thread_t;
+
+/* struct for a NT_FILE entry (file mapped at [start, end)) */
+typedef struct core_file_tag {
+    unsigned long int start;
+    unsigned long int end;
+    unsigned long int file_off;
+    char *name;
+} core_file_t;
+
+/* struct for any other note */
+typedef struct core_note_tag {
+    long int off;
+    long int end;
+    unsigned long int type;
+} core_note_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* register names inside elf_prstatus.pr_reg */
+static const char *const REGS_X86_64[] = {"r15", "r14", "r13", "r12", "rbp", "rbx", "r11", "r10", "r9",
+                                          "r8", "rax", "rcx", "rdx", "rsi", "rdi", "orig_rax", "rip",
+                                          "cs", "eflags", "rsp", "ss", "fs_base", "gs_base", "ds", "es",
+                                          "fs", "gs"};
+static const char *const REGS_AARCH64[] = {"x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8", "x9",
+                                           "x10", "x11", "x12", "x13", "x14", "x15", "x16", "x17", "x18",
+                                           "x19", "x20", "x21", "x22", "x23", "x24", "x25", "x26", "x27",
+                                           "x28", "x29", "x30", "sp", "pc", "pstate"};
+
+/* struct containing parsed core data */
+static struct core_tag {
+    unsigned char is_core;
+    elf_ehdr_t eh;
+    core_load_t *loads;
+    size_t n_loads;
+    core_thread_t *threads;
+    size_t n_threads;
+    core_file_t *files;
+    size_t n_files;
+    core_note_t *notes;
+    size_t n_notes;
+    const elf_reader_t *r;
+    size_t charged;  /* bytes charged to the memory budget */
+} core;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Parses all notes inside [off, end)
+ * If successful returns 0, else 1
+ */
+static unsigned char parse_notes(const long int off, const long int end);
+
+/*
+ * Parses the NT_FILE note descriptor
+ * If successful returns 0, else 1
+ */
+static unsigned char parse_nt_file(const elf_note_t *note);
+
+/* Returns names of registers inside pr_reg for the machine of the core, and sets *n_regs */
+static const char *const *get_reg_names(size_t *n_regs);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char core_notes_load(const elf_reader_t *r) {
+    elf_phdr_t ph;
+    unsigned int i;
+
+    core_notes_free();
+    if (elf_read_ehdr(r, &core.eh) == 1 || core.eh.type != ET_CORE)
+        return 0;
+    core.r = r;
+
+    for (i = 0; i < core.eh.phnum; i++) {
+        if (elf_read_phdr(r, &core.eh, i, &ph) == 1)
+            return 1;
+
+        if (ph.type == PT_LOAD && ph.filesz > 0) {
+            if (budget_grow(BUDGET_CORE_NOTES, &core.charged, (void **)&core.loads, core.n_loads, sizeof(*core.loads)) == 1)
+                return 1;
+            core.loads[core.n_loads].offset = ph.offset;
+            core.loads[core.n_loads].filesz = ph.filesz;
+            core.loads[core.n_loads].vaddr = ph.vaddr;
+            core.n_loads++;
+        } else if (ph.type == PT_NOTE) {
+            if (parse_notes(ph.offset, ph.offset + (long int)ph.filesz) == 1)
+                return 1;
+        }
+    }
+
+    core.is_core = 1;
+    return 0;
+}
+
+void core_notes_free(void) {
+    size_t i;
+
+    for (i = 0; i < core.n_files; i++)
+        free(core.files[i].name);
+    free(core.loads);
+    free(core.threads);
+    free(core.files);
+    free(core.notes);
+    budget_release(BUDGET_CORE_NOTES, core.charged);
+
+    core.is_core = 0;
+    core.charged = 0;
+    core.loads = NULL;
+    core.n_loads = 0;
+    core.threads = NULL;
+    core.n_threads = 0;
+    core.files = NULL;
+    core.n_files = 0;
+    core.notes = NULL;
+    core.n_notes = 0;
+}
+
+unsigned char core_notes_label(const long int off, char *buf, const size_t size) {
+    const char *const *regs;
+    unsigned char raw[8];
+    unsigned long int vaddr;
+    size_t i, j, n_regs, reg, reg_size;
+
+    if (core.is_core == 0 || size == 0)
+        return 1;
+
+    /* Thread registers */
+    for (i = 0; i < core.n_threads; i++) {
+        if (off < core.threads[i].desc_off || off >= core.threads[i].desc_off + (long int)core.threads[i].descsz)
+            continue;
+
+        regs = get_reg_names(&n_regs);
+        reg_size = core.eh.is_64 ? 8 : 4;
+        if (regs != NULL && off >= core.threads[i].reg_off) {
+            reg = (size_t)(off - core.threads[i].reg_off) / reg_size;
+            if (reg < n_regs && core.r->read(core.r->ctx, raw, reg_size, core.threads[i].reg_off + (long int)(reg * reg_size)) == reg_size) {
+                snprintf(buf, size, "thread %ld %s=0x%lx", core.threads[i].pid, regs[reg], elf_get(&core.eh, raw, (unsigned int)reg_size));
+                return 0;
+            }
+        }
+        snprintf(buf, size, "thread %ld NT_PRSTATUS", core.threads[i].pid);
+        return 0;
+    }
+
+    /* Other notes */
+    for (i = 0; i < core.n_notes; i++) {
+        if (off >= core.notes[i].off && off < core.notes[i].end) {
+            if (core.notes[i].type == NT_FILE)
+                snprintf(buf, size, "NT_FILE (%lu mapped files)", (unsigned long int)core.n_files);
+            else
+                snprintf(buf, size, "note type 0x%lx", core.notes[i].type);
+            return 0;
+        }
+    }
+
+    /* Memory: map offset to virtual address, and virtual address to the file mapped there */
+    for (i = 0; i < core.n_loads; i++) {
+        if (off < core.loads[i].offset || off >= core.loads[i].offset + (long int)core.loads[i].filesz)
+            continue;
+
+        vaddr = core.loads[i].vaddr + (unsigned long int)(off - core.loads[i].offset);
+        for (j = 0; j < core.n_files; j++) {
+            if (vaddr >= core.files[j].start && vaddr < core.files[j].end) {
+                snprintf(buf, size, "0x%lx %s+0x%lx", vaddr, core.files[j].name, core.files[j].file_off + (vaddr - core.files[j].start));
+                return 0;
+            }
+        }
+        snprintf(buf, size, "0x%lx", vaddr);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+static unsigned char parse_notes(const long int off, const long int end) {
+    elf_note_t note;
+    char name[8];
+    unsigned char raw[4];
+    unsigned char status;
+    long int pos, next;
+
+    for (pos = off; pos < end; pos = next) {
+        if ((next = elf_read_note(core.r, &core.eh, pos, end, &note)) == -1)
+            break;  /* truncated notes are common in partially written cores */
+
+        memset(name, 0, sizeof(name));
+        if (note.namesz < sizeof(name))  /* keeps name terminated */
+            core.r->read(core.r->ctx, name, note.namesz, note.name_off);
+
+        if (strcmp(name, "CORE") == 0 && note.type == NT_PRSTATUS) {
+            if (budget_grow(BUDGET_CORE_NOTES, &core.charged, (void **)&core.threads, core.n_threads,
+                            sizeof(*core.threads)) == 1)
+                return 1;
+            core.threads[core.n_threads].desc_off = note.desc_off;
+            core.threads[core.n_threads].descsz = note.descsz;
+            core.threads[core.n_threads].reg_off = note.desc_off + (core.eh.is_64 ? PRSTATUS64_REG_OFF : PRSTATUS32_REG_OFF);
+            core.threads[core.n_threads].pid = -1;
+            if (core.r->read(core.r->ctx, raw, 4, note.desc_off + (core.eh.is_64 ? PRSTATUS64_PID_OFF : PRSTATUS32_PID_OFF)) == 4)
+                core.threads[core.n_threads].pid = (long int)elf_get(&core.eh, raw, 4);
+            core.n_threads++;
+            continue;
+        }
+
+        if (strcmp(name, "CORE") == 0 && note.type == NT_FILE) {
+            /* The descriptor is only held while parsing, but it still has to fit inside the budget */
+            if (budget_reserve(BUDGET_CORE_NOTES, note.descsz + 1) == 1)
+                return 1;
+            status = parse_nt_file(&note);
+            budget_release(BUDGET_CORE_NOTES, note.descsz + 1);
+            if (status == 1)
+                return 1;
+        }
+
+        if (budget_grow(BUDGET_CORE_NOTES, &core.charged, (void **)&core.notes, core.n_notes, sizeof(*core.notes)) == 1)
+            return 1;
+        core.notes[core.n_notes].off = pos;
+        core.notes[core.n_notes].end = next;
+        core.notes[core.n_notes].type = note.type;
+        core.n_notes++;
+    }
+    return 0;
+}
+
+static unsigned char parse_nt_file(const elf_note_t *note) {
+    unsigned char *desc;
+    unsigned long int count, page_size, i;
+    size_t word, name_pos, name_len;
+
+    if ((desc = malloc(note->descsz + 1)) == NULL)
+        return 1;
+    if (core.r->read(core.r->ctx, desc, note->descsz, note->desc_off) != note->descsz) {
+        free(desc);
+        return 0;
+    }
+    desc[note->descsz] = '\0';
+
+    /* Layout: count, page_size, count * {start, end, file_ofs}, count * NUL terminated names */
+    word = core.eh.is_64 ? 8 : 4;
+    if (note->descsz < 2 * word) {
+        free(desc);
+        return 0;
+    }
+    count = elf_get(&core.eh, desc, (unsigned int)word);
+    page_size = elf_get(&core.eh, desc + word, (unsigned int)word);
+    if (count > (note->descsz - 2 * word) / (3 * word)) {
+        free(desc);
+        return 0;
+    }
+
+    name_pos = (2 + 3 * count) * word;
+    for (i = 0; i < count && name_pos < note->descsz; i++) {
+        if (budget_grow(BUDGET_CORE_NOTES, &core.charged, (void **)&core.files, core.n_files, sizeof(*core.files)) == 1) {
+            free(desc);
+            return 1;
+        }
+        name_len = strlen((char *)desc + name_pos);
+        if (budget_reserve(BUDGET_CORE_NOTES, name_len + 1) == 1) {
+            free(desc);
+            return 1;
+        }
+        core.charged += name_len + 1;
+        if ((core.files[core.n_files].name = malloc(name_len + 1)) == NULL) {
+            free(desc);
+            return 1;
+        }
+        memcpy(core.files[core.n_files].name, desc + name_pos, name_len + 1);
+        core.files[core.n_files].start = elf_get(&core.eh, desc + (2 + 3 * i) * word, (unsigned int)word);
+        core.files[core.n_files].end = elf_get(&core.eh, desc + (3 + 3 * i) * word, (unsigned int)word);
+        core.files[core.n_files].file_off = elf_get(&core.eh, desc + (4 + 3 * i) * word, (unsigned int)word) * page_size;
+        core.n_files++;
+        name_pos += name_len + 1;
+    }
+
+    free(desc);
+    return 0;
+}
+
+static const char *const *get_reg_names(size_t *n_regs) {
+    if (core.eh.is_64 == 0)
+        return NULL;
+    switch (core.eh.machine) {
+        case EM_X86_64:
+            *n_regs = sizeof(REGS_X86_64) / sizeof(REGS_X86_64[0]);
+            return REGS_X86_64;
+
+        case EM_AARCH64:
+            *n_regs = sizeof(REGS_AARCH64) / sizeof(REGS_AARCH64[0]);
+            return REGS_AARCH64;
+
+        default:
+            return NULL;
+    }
+}
@@ -0,0 +1,231 @@
+#define _XOPEN_SOURCE 700  /* for pthread_once */
+
+/* C89 standard */
+#include <stddef.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <pthread.h>
+
+#include "digest.h"
+
+
+#define CRC32_POLY  0xedb88320UL  /* 0x04c11db7 reflected */
+
+#define MASK32(x)  ((x) & 0xffffffffUL)
+#define ROTR(x, n)  MASK32(((x) >> (n)) | ((x) << (32 - (n))))
+
+#define GET_BE32(p)  (((unsigned long int)(p)[0] << 24) | ((unsigned long int)(p)[1] << 16) | \
+                      ((unsigned long int)(p)[2] << 8) | (unsigned long int)(p)[3])
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/*
+ * Slicing-by-8 tables: crc_tables[0] is the classic byte-at-a-time table, crc_tables[k] advances a byte
+ * through k more zero bytes, so that 8 bytes are folded with 8 independent lookups
+ */
+static unsigned long int crc_tables[8][256];
+
+/* makes sure tables are built once, even if the first CRCs are computed by several threads at the same time */
+static pthread_once_t crc_tables_once = PTHREAD_ONCE_INIT;
+
+/* SHA-256 round constants */
+static const unsigned long int SHA256_K[64] = {
+    0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+    0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+    0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+    0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+    0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+    0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+    0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+    0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Fills crc_tables (through pthread_once()) */
+static void build_crc_tables(void);
+
+/* Hashes n_blocks blocks of 64 bytes at p into ctx->state */
+static void sha256_blocks(digest_sha256_t *ctx, const unsigned char *p, size_t n_blocks);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+/* CRC-32 */
+
+unsigned long int digest_crc32(const unsigned long int crc, const void *buf, const size_t len) {
+    const unsigned char *p;
+    unsigned long int c;
+    size_t n;
+
+    pthread_once(&crc_tables_once, build_crc_tables);
+
+    p = (const unsigned char *)buf;
+    n = len;
+    c = MASK32(~crc);
+
+    /* Bytes are loaded one by one, so the result does not depend on alignment or host endianness */
+    for (; n >= 8; n -= 8, p += 8) {
+        c ^= (unsigned long int)p[0] | ((unsigned long int)p[1] << 8) | ((unsigned long int)p[2] << 16) |
+             ((unsigned long int)p[3] << 24);
+        c = crc_tables[7][c & 0xff] ^ crc_tables[6][(c >> 8) & 0xff] ^ crc_tables[5][(c >> 16) & 0xff] ^
+            crc_tables[4][c >> 24] ^ crc_tables[3][p[4]] ^ crc_tables[2][p[5]] ^ crc_tables[1][p[6]] ^
+            crc_tables[0][p[7]];
+    }
+    for (; n > 0; n--, p++)
+        c = crc_tables[0][(c ^ *p) & 0xff] ^ (c >> 8);
+
+    return MASK32(~c);
+}
+
+/* SHA-256 */
+
+void digest_sha256_init(digest_sha256_t *ctx) {
+    ctx->state[0] = 0x6a09e667UL;
+    ctx->state[1] = 0xbb67ae85UL;
+    ctx->state[2] = 0x3c6ef372UL;
+    ctx->state[3] = 0xa54ff53aUL;
+    ctx->state[4] = 0x510e527fUL;
+    ctx->state[5] = 0x9b05688cUL;
+    ctx->state[6] = 0x1f83d9abUL;
+    ctx->state[7] = 0x5be0cd19UL;
+    ctx->len_lo = 0;
+    ctx->len_hi = 0;
+    ctx->n = 0;
+}
+
+void digest_sha256_update(digest_sha256_t *ctx, const void *buf, size_t len) {
+    const unsigned char *p;
+    size_t n;
+
+    p = (const unsigned char *)buf;
+    ctx->len_lo = MASK32(ctx->len_lo + (unsigned long int)len);
+    if (ctx->len_lo < MASK32((unsigned long int)len))
+        ctx->len_hi++;
+    ctx->len_hi = MASK32(ctx->len_hi + (unsigned long int)((len >> 16) >> 16));
+
+    /* Complete the partial block first */
+    if (ctx->n > 0) {
+        n = 64 - ctx->n < len ? 64 - ctx->n : len;
+        memcpy(ctx->block + ctx->n, p, n);
+        ctx->n += n;
+        p += n;
+        len -= n;
+        if (ctx->n < 64)
+            return;
+        sha256_blocks(ctx, ctx->block, 1);
+        ctx->n = 0;
+    }
+
+    /* Whole blocks are hashed straight from buf */
+    sha256_blocks(ctx, p, len / 64);
+    p += len - len % 64;
+    len %= 64;
+
+    memcpy(ctx->block, p, len);
+    ctx->n = len;
+}
+
+void digest_sha256_final(digest_sha256_t *ctx, unsigned char *out) {
+    unsigned long int bits_hi, bits_lo;
+    unsigned int i;
+
+    bits_hi = MASK32((ctx->len_hi << 3) | (ctx->len_lo >> 29));
+    bits_lo = MASK32(ctx->len_lo << 3);
+
+    /* Padding: 0x80, zeros up to 56 bytes of the last block, length in bits (big endian) */
+    ctx->block[ctx->n++] = 0x80;
+    if (ctx->n > 56) {
+        memset(ctx->block + ctx->n, 0, 64 - ctx->n);
+        sha256_blocks(ctx, ctx->block, 1);
+        ctx->n = 0;
+    }
+    memset(ctx->block + ctx->n, 0, 56 - ctx->n);
+    for (i = 0; i < 4; i++) {
+        ctx->block[56 + i] = (unsigned char)((bits_hi >> (24 - 8 * i)) & 0xff);
+        ctx->block[60 + i] = (unsigned char)((bits_lo >> (24 - 8 * i)) & 0xff);
+    }
+    sha256_blocks(ctx, ctx->block, 1);
+
+    for (i = 0; i < 8; i++) {
+        out[4 * i] = (unsigned char)((ctx->state[i] >> 24) & 0xff);
+        out[4 * i + 1] = (unsigned char)((ctx->state[i] >> 16) & 0xff);
+        out[4 * i + 2] = (unsigned char)((ctx->state[i] >> 8) & 0xff);
+        out[4 * i + 3] = (unsigned char)(ctx->state[i] & 0xff);
+    }
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* CRC-32 */
+
+static void build_crc_tables(void) {
+    unsigned long int c;
+    unsigned int n, k;
+
+    for (n = 0; n < 256; n++) {
+        c = n;
+        for (k = 0; k < 8; k++)
+            c = (c & 1) ? CRC32_POLY ^ (c >> 1) : c >> 1;
+        crc_tables[0][n] = c;
+    }
+    for (n = 0; n < 256; n++) {
+        c = crc_tables[0][n];
+        for (k = 1; k < 8; k++) {
+            c = crc_tables[0][c & 0xff] ^ (c >> 8);
+            crc_tables[k][n] = c;
+        }
+    }
+}
+
+/* SHA-256 */
+
+static void sha256_blocks(digest_sha256_t *ctx, const unsigned char *p, size_t n_blocks) {
+    unsigned long int w[64];
+    unsigned long int a, b, c, d, e, f, g, h, t1, t2;
+    unsigned int i;
+
+    for (; n_blocks > 0; n_blocks--, p += 64) {
+        for (i = 0; i < 16; i++)
+            w[i] = GET_BE32(p + 4 * i);
+        for (i = 16; i < 64; i++) {
+            t1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            t2 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            w[i] = MASK32(t1 + w[i - 7] + t2 + w[i - 16]);
+        }
+
+        a = ctx->state[0];
+        b = ctx->state[1];
+        c = ctx->state[2];
+        d = ctx->state[3];
+        e = ctx->state[4];
+        f = ctx->state[5];
+        g = ctx->state[6];
+        h = ctx->state[7];
+        for (i = 0; i < 64; i++) {
+            t1 = MASK32(h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i]);
+            t2 = MASK32((ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)));
+            h = g;
+            g = f;
+            f = e;
+            e = MASK32(d + t1);
+            d = c;
+            c = b;
+            b = a;
+            a = MASK32(t1 + t2);
+        }
+
+        ctx->state[0] = MASK32(ctx->state[0] + a);
+        ctx->state[1] = MASK32(ctx->state[1] + b);
+        ctx->state[2] = MASK32(ctx->state[2] + c);
+        ctx->state[3] = MASK32(ctx->state[3] + d);
+        ctx->state[4] = MASK32(ctx->state[4] + e);
+        ctx->state[5] = MASK32(ctx->state[5] + f);
+        ctx->state[6] = MASK32(ctx->state[6] + g);
+        ctx->state[7] = MASK32(ctx->state[7] + h);
+    }
+}
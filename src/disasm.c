@@ -0,0 +1,477 @@
+#define _XOPEN_SOURCE 700  /* for snprintf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+#include "abuf.h"
+#include "budget.h"
+#include "elf_parse.h"
+#include "file.h"
+#include "x86.h"
+
+#include "disasm.h"
+
+
+#define CHECKPOINT_GAP   256  /* bytes decoded past a known instruction start before recording a new one */
+#define READ_BUF_SIZE    4096
+#define SYMS_PER_CHUNK   256
+#define DATA_ROW_LEN     16
+#define ROW_BYTES_SHOWN  8  /* bytes of an instruction shown before its text */
+#define ROW_SIZE         (X86_TEXT_SIZE + 64)
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for an executable section */
+typedef struct disasm_section_tag {
+    long int off;  /* relative to the view */
+    unsigned long int size;
+    unsigned long int addr;
+    unsigned int index;  /* inside the section header table */
+    unsigned long int *checkpoints;  /* sorted known instruction starts (relative to the section), 0 always included */
+    size_t n_checkpoints;
+} disasm_section_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing disassembly data */
+static struct disasm_tag {
+    view_t view;
+    elf_reader_t r;
+    unsigned char is_set;
+    unsigned char is_indexed;
+    unsigned char is_64;
+    disasm_section_t *sections;  /* sorted by offset, not overlapping */
+    size_t n_sections;
+    size_t charged;  /* bytes charged to the memory budget */
+    unsigned char buf[READ_BUF_SIZE];  /* bytes of the view read last */
+    long int buf_pos;
+    size_t buf_len;
+} disasm;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Indexes the view once (index_sections()), a failed or partial index is not retried */
+static void build_index(void);
+
+/* Finds x86 executable sections, and seeds their instruction starts from function symbols */
+static void index_sections(void);
+
+/* Adds the start of every function symbol of the symbol table sh to its section */
+static void seed_from_symbols(const elf_ehdr_t *eh, const elf_shdr_t *sh);
+
+/*
+ * Returns the section containing position pos of the view
+ * If there's one returns 0 and sets *sec, else 1
+ */
+static unsigned char find_section(const long int pos, disasm_section_t **sec);
+
+/* Returns start of the instruction containing offset off of sec, decoding from the closest known start before it */
+static unsigned long int find_insn_start(disasm_section_t *sec, const unsigned long int off);
+
+/* Returns start of the row containing position pos (disasm_align() without its checks) */
+static long int align(const long int pos);
+
+/* Returns index of the last checkpoint of sec at or before offset off */
+static size_t find_checkpoint(const disasm_section_t *sec, const unsigned long int off);
+
+/* Returns end of the row starting at position pos (the instruction, cut at the next known start, or the data row) */
+static long int row_end(const long int pos);
+
+/* Returns length of the instruction at offset off of sec, cut at limit */
+static unsigned long int insn_len(disasm_section_t *sec, const unsigned long int off, const unsigned long int limit);
+
+/*
+ * Inserts off into the checkpoints of sec (at index i, keeping them sorted)
+ * If successful returns 0, else 1
+ */
+static unsigned char insert_checkpoint(disasm_section_t *sec, const size_t i, const unsigned long int off);
+
+/* Copies at most len bytes at position pos of the view into out, returns the number of bytes copied */
+static size_t read_bytes(const long int pos, unsigned char *out, const size_t len);
+
+/* Comparison functions for qsort() */
+static int compare_sections(const void *a, const void *b);
+static int compare_offsets(const void *a, const void *b);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+void disasm_set_view(const view_t *v) {
+    disasm_free();
+    disasm.view = *v;
+    file_get_reader(&disasm.r, &disasm.view);
+    disasm.is_set = 1;
+}
+
+size_t disasm_append_row(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
+    unsigned char bytes[X86_MAX_INSN_LEN > DATA_ROW_LEN ? X86_MAX_INSN_LEN : DATA_ROW_LEN];
+    char row[ROW_SIZE];
+    char hexs[DATA_ROW_LEN * 3 + 1];
+    disasm_section_t *sec;
+    x86_insn_t insn;
+    size_t n, i, shown, row_len;
+    long int end;
+
+    if (disasm.is_set == 0 || pos < 0 || pos >= v->len)
+        return 0;
+    if (disasm.is_indexed == 0)
+        build_index();
+    end = row_end(pos);
+    if ((n = view_read(v, bytes, (size_t)(end - pos), pos)) == 0)
+        return 0;
+
+    /* The row length comes from row_end(), like scrolling does: an instruction cut by a known start is shown as bad */
+    if (find_section(pos, &sec) == 0) {
+        x86_decode(bytes, n, sec->addr + (unsigned long int)(pos - sec->off), disasm.is_64, &insn);
+        if (insn.len != n)
+            strcpy(insn.text, "(bad)");
+
+        /* Long instructions show their first bytes only */
+        shown = n > ROW_BYTES_SHOWN ? ROW_BYTES_SHOWN - 1 : n;
+        for (i = 0; i < shown; i++)
+            sprintf(hexs + i * 3, "%02X ", bytes[i]);
+        hexs[shown * 3] = '\0';
+        if (shown < n)
+            strcat(hexs, "..");
+        snprintf(row, sizeof(row), "%8lx:  %-*s %s", sec->addr + (unsigned long int)(pos - sec->off), ROW_BYTES_SHOWN * 3,
+                 hexs, insn.text);
+    } else {
+        for (i = 0; i < n; i++)
+            sprintf(hexs + i * 3, "%02X ", bytes[i]);
+        hexs[n * 3] = '\0';
+        snprintf(row, sizeof(row), "%8s   %s", "", hexs);
+    }
+
+    row_len = strlen(row);
+    if (row_len > len)
+        row_len = len;
+    if (ab_append(ab, row, row_len) == 1)
+        return 0;
+    return n;
+}
+
+long int disasm_align(const long int pos) {
+    if (disasm.is_set == 0 || pos <= 0)
+        return pos < 0 ? 0 : pos;
+    if (disasm.is_indexed == 0)
+        build_index();
+
+    /* Bytes read before may have been edited since */
+    disasm.buf_len = 0;
+    return align(pos < disasm.view.len ? pos : disasm.view.len - 1);
+}
+
+long int disasm_scroll(const long int pos, const long int rows) {
+    long int i, new_pos, end;
+
+    if (disasm.is_set == 0)
+        return pos;
+    if (disasm.is_indexed == 0)
+        build_index();
+    disasm.buf_len = 0;
+
+    new_pos = pos;
+    for (i = 0; i < rows; i++) {
+        if ((end = row_end(new_pos)) >= disasm.view.len)
+            break;
+        new_pos = end;
+    }
+    for (i = 0; i > rows && new_pos > 0; i--)
+        new_pos = align(new_pos - 1);
+    return new_pos;
+}
+
+long int disasm_next_code(const long int pos) {
+    size_t i;
+
+    if (disasm.is_set == 0)
+        return pos;
+    if (disasm.is_indexed == 0)
+        build_index();
+    for (i = 0; i < disasm.n_sections; i++) {
+        if (disasm.sections[i].off > pos)
+            return disasm.sections[i].off;
+    }
+    return pos;
+}
+
+void disasm_free(void) {
+    size_t i;
+
+    for (i = 0; i < disasm.n_sections; i++)
+        free(disasm.sections[i].checkpoints);
+    free(disasm.sections);
+    budget_release(BUDGET_DISASM, disasm.charged);
+    memset(&disasm, 0, sizeof(disasm));
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* INDEX */
+
+static void build_index(void) {
+    index_sections();
+    disasm.is_indexed = 1;
+}
+
+static void index_sections(void) {
+    elf_ehdr_t eh;
+    elf_shdr_t sh;
+    disasm_section_t *sec;
+    size_t i, j, k;
+
+    if (elf_read_ehdr(&disasm.r, &eh) == 1 || (eh.machine != EM_X86_64 && eh.machine != EM_386))
+        return;
+    disasm.is_64 = eh.machine == EM_X86_64;
+
+    for (i = 0; i < eh.shnum; i++) {
+        if (elf_read_shdr(&disasm.r, &eh, (unsigned int)i, &sh) == 1)
+            return;
+        if (sh.type == SHT_NOBITS || sh.size == 0 || (sh.flags & SHF_ALLOC) == 0 || (sh.flags & SHF_EXECINSTR) == 0)
+            continue;
+        if (sh.offset < 0 || sh.offset >= disasm.view.len)
+            continue;
+        if (budget_grow(BUDGET_DISASM, &disasm.charged, (void **)&disasm.sections, disasm.n_sections,
+                        sizeof(*disasm.sections)) == 1)
+            break;
+        sec = &disasm.sections[disasm.n_sections++];
+        memset(sec, 0, sizeof(*sec));
+        sec->off = sh.offset;
+        sec->size = (unsigned long int)(disasm.view.len - sh.offset) < sh.size ? (unsigned long int)(disasm.view.len - sh.offset) : sh.size;
+        sec->addr = sh.addr;
+        sec->index = (unsigned int)i;
+    }
+
+    /* Overlapping sections (broken files) would make rows ambiguous, the later ones are dropped */
+    qsort(disasm.sections, disasm.n_sections, sizeof(*disasm.sections), compare_sections);
+    for (i = 0, j = 0; i < disasm.n_sections; i++) {
+        if (j > 0 && disasm.sections[i].off < disasm.sections[j - 1].off + (long int)disasm.sections[j - 1].size)
+            continue;
+        disasm.sections[j++] = disasm.sections[i];
+    }
+    disasm.n_sections = j;
+
+    /* Every section starts with an instruction, and so does every function */
+    for (i = 0; i < disasm.n_sections; i++) {
+        if (insert_checkpoint(&disasm.sections[i], 0, 0) == 1)
+            return;
+    }
+    for (i = 0; i < eh.shnum; i++) {
+        if (elf_read_shdr(&disasm.r, &eh, (unsigned int)i, &sh) == 1)
+            break;
+        if (sh.type == SHT_SYMTAB || sh.type == SHT_DYNSYM)
+            seed_from_symbols(&eh, &sh);
+    }
+    for (i = 0; i < disasm.n_sections; i++) {
+        sec = &disasm.sections[i];
+        qsort(sec->checkpoints, sec->n_checkpoints, sizeof(*sec->checkpoints), compare_offsets);
+        for (j = 0, k = 0; j < sec->n_checkpoints; j++) {
+            if (k == 0 || sec->checkpoints[j] != sec->checkpoints[k - 1])
+                sec->checkpoints[k++] = sec->checkpoints[j];
+        }
+        sec->n_checkpoints = k;
+    }
+}
+
+static void seed_from_symbols(const elf_ehdr_t *eh, const elf_shdr_t *sh) {
+    unsigned char *chunk;
+    disasm_section_t *sec;
+    elf_sym_t sym;
+    unsigned long int n_syms, i, j, n, off;
+    size_t sym_size, s;
+
+    sym_size = eh->is_64 ? ELF_SYM64_SIZE : ELF_SYM32_SIZE;
+    if ((chunk = malloc(SYMS_PER_CHUNK * sym_size)) == NULL)
+        return;
+
+    /* Entries are decoded a chunk at a time, appended unsorted (index_sections() sorts them once) */
+    n_syms = sh->size / sym_size;
+    for (i = 0; i < n_syms; i += n) {
+        n = n_syms - i < SYMS_PER_CHUNK ? n_syms - i : SYMS_PER_CHUNK;
+        if (disasm.r.read(disasm.r.ctx, chunk, n * sym_size, sh->offset + (long int)(i * sym_size)) != n * sym_size)
+            break;
+        for (j = 0; j < n; j++) {
+            elf_decode_sym(eh, &chunk[j * sym_size], &sym);
+            if (ELF64_ST_TYPE(sym.info) != STT_FUNC || sym.shndx == SHN_UNDEF || sym.shndx >= SHN_LORESERVE)
+                continue;
+            for (s = 0; s < disasm.n_sections && disasm.sections[s].index != sym.shndx; s++)
+                ;
+            if (s == disasm.n_sections)
+                continue;
+
+            /* Values are offsets inside the section for relocatable files, else addresses */
+            sec = &disasm.sections[s];
+            off = eh->type == ET_REL ? sym.value : sym.value - sec->addr;
+            if ((eh->type != ET_REL && sym.value < sec->addr) || off >= sec->size)
+                continue;
+            if (insert_checkpoint(sec, sec->n_checkpoints, off) == 1)
+                break;
+        }
+    }
+    free(chunk);
+}
+
+/* LOOKUP */
+
+static unsigned char find_section(const long int pos, disasm_section_t **sec) {
+    size_t lo, hi, mid;
+
+    /* Last section starting at or before pos */
+    lo = 0;
+    hi = disasm.n_sections;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (disasm.sections[mid].off <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0 || (unsigned long int)(pos - disasm.sections[lo - 1].off) >= disasm.sections[lo - 1].size)
+        return 1;
+    *sec = &disasm.sections[lo - 1];
+    return 0;
+}
+
+static unsigned long int find_insn_start(disasm_section_t *sec, const unsigned long int off) {
+    unsigned long int cur, next, last, len;
+    size_t i;
+
+    i = find_checkpoint(sec, off);
+    cur = sec->checkpoints[i];
+    last = cur;
+    for (;;) {
+        next = i + 1 < sec->n_checkpoints ? sec->checkpoints[i + 1] : sec->size;
+        len = insn_len(sec, cur, next);
+        if (off < cur + len)
+            return cur;
+        cur += len;
+
+        /* Known starts win over what decoding found (data inside code can make it go astray) */
+        if (cur == next) {
+            i++;
+            last = cur;
+        } else if (cur - last >= CHECKPOINT_GAP) {
+            /* Without budget the index just stays sparser */
+            if (insert_checkpoint(sec, i + 1, cur) == 0)
+                i++;
+            last = cur;
+        }
+    }
+}
+
+static long int align(const long int pos) {
+    disasm_section_t *sec;
+    long int start;
+    size_t i;
+
+    if (find_section(pos, &sec) == 0)
+        return sec->off + (long int)find_insn_start(sec, (unsigned long int)(pos - sec->off));
+
+    /* Data rows are aligned to 16 bytes, and begin again where code ends */
+    start = pos - pos % DATA_ROW_LEN;
+    for (i = 0; i < disasm.n_sections && disasm.sections[i].off <= pos; i++) {
+        if (disasm.sections[i].off + (long int)disasm.sections[i].size > start)
+            start = disasm.sections[i].off + (long int)disasm.sections[i].size;
+    }
+    return start;
+}
+
+static size_t find_checkpoint(const disasm_section_t *sec, const unsigned long int off) {
+    size_t lo, hi, mid;
+
+    lo = 0;
+    hi = sec->n_checkpoints;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (sec->checkpoints[mid] <= off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo == 0 ? 0 : lo - 1;
+}
+
+static long int row_end(const long int pos) {
+    disasm_section_t *sec;
+    unsigned long int off, next;
+    long int end;
+    size_t i;
+
+    if (find_section(pos, &sec) == 0) {
+        off = (unsigned long int)(pos - sec->off);
+        i = find_checkpoint(sec, off);
+        next = i + 1 < sec->n_checkpoints ? sec->checkpoints[i + 1] : sec->size;
+        return pos + (long int)insn_len(sec, off, next);
+    }
+
+    /* Data rows stop where code begins */
+    end = pos - pos % DATA_ROW_LEN + DATA_ROW_LEN;
+    for (i = 0; i < disasm.n_sections; i++) {
+        if (disasm.sections[i].off > pos && disasm.sections[i].off < end)
+            end = disasm.sections[i].off;
+    }
+    return end < disasm.view.len ? end : disasm.view.len;
+}
+
+static unsigned long int insn_len(disasm_section_t *sec, const unsigned long int off, const unsigned long int limit) {
+    unsigned char bytes[X86_MAX_INSN_LEN];
+    unsigned long int len;
+    size_t n;
+
+    n = limit - off < X86_MAX_INSN_LEN ? (size_t)(limit - off) : X86_MAX_INSN_LEN;
+    if ((n = read_bytes(sec->off + (long int)off, bytes, n)) == 0)
+        return limit - off;
+    len = x86_insn_len(bytes, n, disasm.is_64);
+    return len < limit - off ? len : limit - off;
+}
+
+/* UTILS */
+
+static unsigned char insert_checkpoint(disasm_section_t *sec, const size_t i, const unsigned long int off) {
+    if (budget_grow(BUDGET_DISASM, &disasm.charged, (void **)&sec->checkpoints, sec->n_checkpoints,
+                    sizeof(*sec->checkpoints)) == 1)
+        return 1;
+    memmove(&sec->checkpoints[i + 1], &sec->checkpoints[i], (sec->n_checkpoints - i) * sizeof(*sec->checkpoints));
+    sec->checkpoints[i] = off;
+    sec->n_checkpoints++;
+    return 0;
+}
+
+static size_t read_bytes(const long int pos, unsigned char *out, const size_t len) {
+    size_t n;
+
+    if (pos < disasm.buf_pos || pos + (long int)len > disasm.buf_pos + (long int)disasm.buf_len) {
+        disasm.buf_pos = pos;
+        disasm.buf_len = view_read(&disasm.view, disasm.buf, READ_BUF_SIZE, pos);
+    }
+    n = (size_t)(disasm.buf_pos + (long int)disasm.buf_len - pos);
+    n = n < len ? n : len;
+    memcpy(out, disasm.buf + (pos - disasm.buf_pos), n);
+    return n;
+}
+
+static int compare_sections(const void *a, const void *b) {
+    const disasm_section_t *x = a, *y = b;
+
+    if (x->off != y->off)
+        return x->off < y->off ? -1 : 1;
+    return 0;
+}
+
+static int compare_offsets(const void *a, const void *b) {
+    const unsigned long int *x = a, *y = b;
+
+    if (*x != *y)
+        return *x < *y ? -1 : 1;
+    return 0;
+}
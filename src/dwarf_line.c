@@ -0,0 +1,1373 @@
+#define _XOPEN_SOURCE 700  /* for snprintf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+#include "budget.h"
+#include "elf_parse.h"
+#include "file.h"
+#include "zsection.h"
+
+#include "dwarf_line.h"
+
+
+#define DWARF_CACHE_SIZE    (4 * 1024 * 1024)  /* decoded rows and file names kept at most (a bigger unit is kept alone) */
+#define UNIT_CHUNK_SIZE     4096  /* bytes read at once for a unit header and its first DIE, an abbreviation, range lists or aranges */
+#define ARANGES_HEADER_SIZE 24  /* bytes of the biggest .debug_aranges set header (64-bit DWARF) */
+#define SECTION_NAME_SIZE   32
+#define PENDING_PER_LOOKUP  16  /* compilation units of unknown range decoded by a lookup at most */
+#define ROWS_INITIAL_SIZE   256
+
+#define SEC_INFO      0
+#define SEC_ABBREV    1
+#define SEC_ARANGES   2
+#define SEC_LINE      3
+#define SEC_LINE_STR  4
+#define SEC_STR       5
+#define SEC_RANGES    6
+#define SEC_RNGLISTS  7
+#define N_SECTIONS    8
+
+#define LINE_UNKNOWN  -1  /* line program offset not read yet */
+#define LINE_NONE     -2  /* no line program (or a broken one, or one too big to keep) */
+
+/* DWARF constants (not inside elf.h) */
+#define DW_UT_compile        0x01
+#define DW_UT_type           0x02
+#define DW_UT_partial        0x03
+#define DW_UT_skeleton       0x04
+#define DW_UT_split_compile  0x05
+#define DW_UT_split_type     0x06
+
+#define DW_AT_stmt_list  0x10
+#define DW_AT_low_pc     0x11
+#define DW_AT_high_pc    0x12
+#define DW_AT_ranges     0x55
+
+#define DW_FORM_addr            0x01
+#define DW_FORM_block2          0x03
+#define DW_FORM_block4          0x04
+#define DW_FORM_data2           0x05
+#define DW_FORM_data4           0x06
+#define DW_FORM_data8           0x07
+#define DW_FORM_string          0x08
+#define DW_FORM_block           0x09
+#define DW_FORM_block1          0x0a
+#define DW_FORM_data1           0x0b
+#define DW_FORM_flag            0x0c
+#define DW_FORM_sdata           0x0d
+#define DW_FORM_strp            0x0e
+#define DW_FORM_udata           0x0f
+#define DW_FORM_ref_addr        0x10
+#define DW_FORM_ref1            0x11
+#define DW_FORM_ref2            0x12
+#define DW_FORM_ref4            0x13
+#define DW_FORM_ref8            0x14
+#define DW_FORM_ref_udata       0x15
+#define DW_FORM_indirect        0x16
+#define DW_FORM_sec_offset      0x17
+#define DW_FORM_exprloc         0x18
+#define DW_FORM_flag_present    0x19
+#define DW_FORM_strx            0x1a
+#define DW_FORM_addrx           0x1b
+#define DW_FORM_ref_sup4        0x1c
+#define DW_FORM_strp_sup        0x1d
+#define DW_FORM_data16          0x1e
+#define DW_FORM_line_strp       0x1f
+#define DW_FORM_ref_sig8        0x20
+#define DW_FORM_implicit_const  0x21
+#define DW_FORM_loclistx        0x22
+#define DW_FORM_rnglistx        0x23
+#define DW_FORM_ref_sup8        0x24
+#define DW_FORM_strx1           0x25
+#define DW_FORM_strx2           0x26
+#define DW_FORM_strx3           0x27
+#define DW_FORM_strx4           0x28
+#define DW_FORM_addrx1          0x29
+#define DW_FORM_addrx2          0x2a
+#define DW_FORM_addrx3          0x2b
+#define DW_FORM_addrx4          0x2c
+#define DW_FORM_GNU_addr_index  0x1f01
+#define DW_FORM_GNU_str_index   0x1f02
+#define DW_FORM_GNU_ref_alt     0x1f20
+#define DW_FORM_GNU_strp_alt    0x1f21
+
+#define DW_LNS_copy                1
+#define DW_LNS_advance_pc          2
+#define DW_LNS_advance_line        3
+#define DW_LNS_set_file            4
+#define DW_LNS_const_add_pc        8
+#define DW_LNS_fixed_advance_pc    9
+
+#define DW_LNE_end_sequence  1
+#define DW_LNE_set_address   2
+#define DW_LNE_define_file   3
+
+#define DW_LNCT_path  1
+
+#define DW_RLE_end_of_list    0
+#define DW_RLE_offset_pair    4
+#define DW_RLE_base_address   5
+#define DW_RLE_start_end      6
+#define DW_RLE_start_length   7
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a debug section (size is 0 if missing) */
+typedef struct dwarf_section_tag {
+    long int off;
+    unsigned long int size;  /* decompressed size for compressed sections */
+    zsection_t *z;  /* NULL unless the section is compressed */
+} dwarf_section_t;
+
+/* struct for an executable section, to translate offsets into addresses */
+typedef struct dwarf_code_tag {
+    long int off;
+    unsigned long int size;
+    unsigned long int addr;
+} dwarf_code_t;
+
+/* struct for a row of a line table: code from addr up to the next row comes from line (0 = no source, end of sequence) */
+typedef struct dwarf_row_tag {
+    unsigned long int addr;
+    unsigned int file;
+    unsigned int line;
+} dwarf_row_t;
+
+/* struct for a compilation unit */
+typedef struct dwarf_cu_tag {
+    long int info_off;  /* relative to .debug_info */
+    long int line_off;  /* relative to .debug_line, LINE_UNKNOWN or LINE_NONE */
+    unsigned char has_range;  /* 1 if its address ranges are inside the index (else it's decoded to learn them) */
+    dwarf_row_t *rows;  /* NULL until decoded (or after eviction), sorted by address */
+    size_t n_rows;
+    unsigned int *files;  /* offsets of file names inside names */
+    size_t n_files;
+    char *names;
+    size_t charged;  /* bytes of rows, files and names charged to the memory budget */
+    unsigned long int last_use;
+} dwarf_cu_t;
+
+/* struct for an address range [lo, hi) of a compilation unit */
+typedef struct dwarf_range_tag {
+    unsigned long int lo;
+    unsigned long int hi;
+    unsigned long int max_hi;  /* maximum hi of this and previous ranges (ranges may nest) */
+    size_t cu;
+} dwarf_range_t;
+
+/* struct for fields of a unit header */
+typedef struct dwarf_unit_tag {
+    unsigned int version;
+    unsigned int offset_size;  /* 4 (32-bit DWARF) or 8 (64-bit DWARF) */
+    unsigned int addr_size;
+} dwarf_unit_t;
+
+/* struct for what the first DIE of a compilation unit tells */
+typedef struct dwarf_cu_die_tag {
+    unsigned long int next;  /* offset of the next unit */
+    unsigned char is_compile;  /* 0 for type units and unknown versions */
+    dwarf_unit_t u;
+    long int line_off;
+    unsigned char has_low;
+    unsigned char has_high;
+    unsigned char is_high_offset;  /* 1 if high is relative to low */
+    unsigned char has_ranges;
+    unsigned long int ranges_form;
+    unsigned long int low;
+    unsigned long int high;
+    unsigned long int ranges;
+} dwarf_cu_die_t;
+
+/* struct for bytes being decoded */
+typedef struct dwarf_cursor_tag {
+    const unsigned char *p;
+    const unsigned char *end;
+    unsigned char is_bad;  /* 1 if a read went past end */
+} dwarf_cursor_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* names of the sections inside dwarf.sections */
+static const char *const SECTION_NAMES[N_SECTIONS] = {".debug_info", ".debug_abbrev", ".debug_aranges", ".debug_line",
+                                                      ".debug_line_str", ".debug_str", ".debug_ranges", ".debug_rnglists"};
+
+/* struct containing DWARF data */
+static struct dwarf_tag {
+    view_t view;  /* without window: line tables are read far from what's shown */
+    elf_reader_t r;
+    elf_ehdr_t eh;
+    unsigned char is_set;
+    unsigned char is_indexed;
+    dwarf_section_t sections[N_SECTIONS];
+    dwarf_code_t *code;
+    size_t n_code;
+    dwarf_cu_t *cus;
+    size_t n_cus;
+    dwarf_range_t *ranges;
+    size_t n_ranges;
+    size_t charged;  /* bytes of the index charged to the memory budget */
+    size_t cached;  /* bytes of decoded compilation units */
+    unsigned long int clock;
+} dwarf;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Finds debug and executable sections, then indexes compilation units by address */
+static void build_index(void);
+
+/* Adds compilation units and their ranges listed inside .debug_aranges */
+static void read_aranges(void);
+
+/* Adds every compilation unit of .debug_info, with the ranges of its first DIE */
+static void scan_cus(void);
+
+/*
+ * Reads the header and the first DIE of the unit at off (relative to .debug_info) into die
+ * If successful returns 0, else 1
+ */
+static unsigned char read_cu_die(const unsigned long int off, dwarf_cu_die_t *die);
+
+/*
+ * Adds to the index the ranges of DW_AT_ranges of die (compilation unit cu)
+ * If the list can't be read (e.g. indexed forms) returns 1, else 0
+ */
+static unsigned char read_range_list(const dwarf_cu_die_t *die, const size_t cu);
+
+/*
+ * Decodes the line program of cu, if it's not cached
+ * If successful returns 0, else 1
+ */
+static unsigned char decode_cu(dwarf_cu_t *cu);
+
+/*
+ * Decodes the line program at off (relative to .debug_line) into cu, adding the ranges of its sequences to the index
+ * if cu->has_range is 0 (tables are not charged to the cache yet)
+ * If successful returns 0, else 1
+ */
+static unsigned char decode_line_program(dwarf_cu_t *cu, const unsigned long int off);
+
+/*
+ * Reads the file name table of a DWARF 5 line program header into cu
+ * If successful returns 0, else 1
+ */
+static unsigned char read_v5_files(dwarf_cursor_t *c, const dwarf_unit_t *u, dwarf_cu_t *cu, size_t *names_size);
+
+/*
+ * Appends name to the file names of cu
+ * If successful returns 0, else 1
+ */
+static unsigned char add_file(dwarf_cu_t *cu, const char *name, size_t *names_size);
+
+/*
+ * Appends a row to cu (replacing the last one if it's at the same address of the same sequence)
+ * If successful returns 0, else 1
+ */
+static unsigned char add_row(dwarf_cu_t *cu, size_t *rows_size, const size_t seq_start, const unsigned long int addr,
+                             const unsigned int file, const unsigned int line);
+
+/*
+ * Charges the decoded tables of cu, evicting least recently used ones to stay inside the cache (all of them if cu is bigger)
+ * If successful returns 0, else 1
+ */
+static unsigned char cache_charge(dwarf_cu_t *cu);
+
+/* Frees the decoded tables of cu */
+static void cache_evict(dwarf_cu_t *cu);
+
+/*
+ * Finds the row of cu covering addr
+ * If found returns 0 and sets *row, else 1
+ */
+static unsigned char find_row(const dwarf_cu_t *cu, const unsigned long int addr, const dwarf_row_t **row);
+
+/*
+ * Finds the compilation unit whose ranges contain addr
+ * If found returns 0 and sets *cu, else 1
+ */
+static unsigned char find_cu(const unsigned long int addr, size_t *cu);
+
+/*
+ * Appends a compilation unit to the index
+ * If successful returns 0, else 1
+ */
+static unsigned char add_cu(const long int info_off, const long int line_off);
+
+/*
+ * Appends range [lo, hi) of compilation unit cu to the index (which must be sorted again)
+ * If successful returns 0, else 1
+ */
+static unsigned char add_range(const unsigned long int lo, const unsigned long int hi, const size_t cu);
+
+/* Sorts ranges and computes their max_hi */
+static void sort_ranges(void);
+
+/* Copies at most len bytes at offset off of section sec into buf, returns the number of bytes copied */
+static size_t read_section(const unsigned int sec, void *buf, const size_t len, const unsigned long int off);
+
+/* Comparison functions for qsort() */
+static int compare_ranges(const void *a, const void *b);
+static int compare_rows(const void *a, const void *b);
+
+/* CURSOR */
+static unsigned long int get_u(dwarf_cursor_t *c, const unsigned int size);
+static unsigned long int get_uleb(dwarf_cursor_t *c);
+static long int get_sleb(dwarf_cursor_t *c);
+static const char *get_str(dwarf_cursor_t *c);
+static void skip(dwarf_cursor_t *c, const unsigned long int n);
+
+/* Reads an initial length, setting *offset_size to 4 or 8 */
+static unsigned long int get_length(dwarf_cursor_t *c, unsigned int *offset_size);
+
+/* Reads (or skips) an attribute value of form, returning it if it's a constant, an offset or an address */
+static unsigned long int get_form(dwarf_cursor_t *c, const unsigned long int form, const dwarf_unit_t *u, const long int implicit);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+void dwarf_line_set_view(const view_t *v) {
+    dwarf_line_free();
+    dwarf.view = *v;
+    dwarf.view.window = NULL;
+    file_get_reader(&dwarf.r, &dwarf.view);
+    dwarf.is_set = 1;
+}
+
+unsigned char dwarf_line_label(const long int pos, char *buf, const size_t size) {
+    const dwarf_row_t *row;
+    dwarf_cu_t *cu;
+    unsigned long int addr;
+    size_t i, n_decoded;
+    unsigned char status;
+
+    if (dwarf.is_set == 0)
+        return 1;
+    if (dwarf.is_indexed == 0)
+        build_index();
+
+    /* Offset -> address, only inside executable sections */
+    for (i = 0; i < dwarf.n_code; i++) {
+        if (pos >= dwarf.code[i].off && (unsigned long int)(pos - dwarf.code[i].off) < dwarf.code[i].size)
+            break;
+    }
+    if (i == dwarf.n_code)
+        return 1;
+    addr = dwarf.code[i].addr + (unsigned long int)(pos - dwarf.code[i].off);
+
+    status = 1;
+    row = NULL;
+    cu = NULL;
+    if (find_cu(addr, &i) == 0) {
+        cu = &dwarf.cus[i];
+        if (decode_cu(cu) == 0)
+            status = find_row(cu, addr, &row);
+    }
+
+    /* Units of unknown range are decoded a few at a time (each one learns its ranges), until one covers addr */
+    for (i = 0, n_decoded = 0; status == 1 && i < dwarf.n_cus && n_decoded < PENDING_PER_LOOKUP; i++) {
+        cu = &dwarf.cus[i];
+        if (cu->has_range == 1)
+            continue;
+        n_decoded++;
+        if (decode_cu(cu) == 0)
+            status = find_row(cu, addr, &row);
+    }
+
+    if (status == 0)
+        snprintf(buf, size, "%s:%u", row->file < cu->n_files ? cu->names + cu->files[row->file] : "?", row->line);
+    return status;
+}
+
+void dwarf_line_free(void) {
+    size_t i;
+
+    for (i = 0; i < dwarf.n_cus; i++)
+        cache_evict(&dwarf.cus[i]);
+    for (i = 0; i < N_SECTIONS; i++) {
+        if (dwarf.sections[i].z != NULL)
+            zsection_close(dwarf.sections[i].z);
+    }
+    free(dwarf.code);
+    free(dwarf.cus);
+    free(dwarf.ranges);
+    budget_release(BUDGET_DWARF, dwarf.charged);
+    memset(&dwarf, 0, sizeof(dwarf));
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* INDEX */
+
+static void build_index(void) {
+    elf_shdr_t sh, strtab;
+    char name[SECTION_NAME_SIZE];
+    const char *debug_name;
+    zsection_t *z;
+    unsigned int i, j;
+
+    dwarf.is_indexed = 1;
+    if (elf_read_ehdr(&dwarf.r, &dwarf.eh) == 1 || dwarf.eh.shstrndx >= dwarf.eh.shnum)
+        return;
+    if (elf_read_shdr(&dwarf.r, &dwarf.eh, dwarf.eh.shstrndx, &strtab) == 1)
+        return;
+
+    for (i = 0; i < dwarf.eh.shnum; i++) {
+        if (elf_read_shdr(&dwarf.r, &dwarf.eh, i, &sh) == 1)
+            return;
+        if (sh.type == SHT_NOBITS || sh.size == 0)
+            continue;
+
+        if ((sh.flags & SHF_ALLOC) && (sh.flags & SHF_EXECINSTR)) {
+            if (budget_grow(BUDGET_DWARF, &dwarf.charged, (void **)&dwarf.code, dwarf.n_code, sizeof(*dwarf.code)) == 1)
+                return;
+            dwarf.code[dwarf.n_code].off = sh.offset;
+            dwarf.code[dwarf.n_code].size = sh.size;
+            dwarf.code[dwarf.n_code].addr = sh.addr;
+            dwarf.n_code++;
+            continue;
+        }
+
+        if (elf_read_str(&dwarf.r, strtab.offset + (long int)sh.name, name, sizeof(name)) == 1 || name[0] != '.')
+            continue;
+        /* Old style compressed sections are named .zdebug_* instead of .debug_* */
+        debug_name = strncmp(name, ".zdebug", 7) == 0 ? name + 2 : name + 1;
+        for (j = 0; j < N_SECTIONS; j++) {
+            if (strcmp(debug_name, SECTION_NAMES[j] + 1) != 0 || dwarf.sections[j].size != 0)
+                continue;
+            /* Compressed sections are read through their decompressed bytes (zstd ones are left out) */
+            if (zsection_is_compressed(&sh, name) == 1) {
+                if (zsection_open(&z, &dwarf.view, &dwarf.eh, &sh, name) != ZSECTION_OK)
+                    continue;
+                dwarf.sections[j].z = z;
+                dwarf.sections[j].size = (unsigned long int)zsection_len(z);
+            } else {
+                dwarf.sections[j].off = sh.offset;
+                dwarf.sections[j].size = sh.size;
+            }
+        }
+    }
+    if (dwarf.n_code == 0 || dwarf.sections[SEC_LINE].size == 0)
+        return;
+
+    /* .debug_aranges maps ranges to units without touching .debug_info, else the first DIE of every unit does */
+    read_aranges();
+    if (dwarf.n_cus == 0)
+        scan_cus();
+    sort_ranges();
+}
+
+static void read_aranges(void) {
+    unsigned char buf[UNIT_CHUNK_SIZE];
+    dwarf_cursor_t c;
+    dwarf_unit_t u;
+    unsigned long int off, end, pos, len, info_off, addr, size, header, tuple;
+    unsigned char is_done;
+    size_t n;
+
+    /* Sets are read one at a time and their ranges a chunk at a time, so memory use doesn't depend on the section size */
+    for (off = 0; off < dwarf.sections[SEC_ARANGES].size; off = end) {
+        /* Header: length, version, .debug_info offset, address size, segment size, padding to 2 * address size */
+        c.p = buf;
+        c.end = buf + read_section(SEC_ARANGES, buf, ARANGES_HEADER_SIZE, off);
+        c.is_bad = 0;
+        len = get_length(&c, &u.offset_size);
+        header = (u.offset_size == 8 ? 12 : 4);
+        if (c.is_bad || len > dwarf.sections[SEC_ARANGES].size - off - header)
+            return;
+        end = off + header + len;
+        u.version = (unsigned int)get_u(&c, 2);
+        info_off = get_u(&c, u.offset_size);
+        u.addr_size = (unsigned int)get_u(&c, 1);
+        if (get_u(&c, 1) != 0 || c.is_bad || (u.addr_size != 4 && u.addr_size != 8))
+            continue;
+        header += 2 + u.offset_size + 2;
+        header += (2 * u.addr_size - header % (2 * u.addr_size)) % (2 * u.addr_size);
+
+        if (add_cu((long int)info_off, LINE_UNKNOWN) == 1)
+            return;
+        dwarf.cus[dwarf.n_cus - 1].has_range = 1;
+        tuple = 2 * u.addr_size;
+        is_done = 0;
+        for (pos = off + header; is_done == 0 && pos + tuple <= end; pos += n) {
+            n = (size_t)((end - pos) / tuple * tuple);
+            if (n > sizeof(buf))
+                n = (size_t)(sizeof(buf) / tuple * tuple);
+            if (read_section(SEC_ARANGES, buf, n, pos) != n)
+                return;
+            c.p = buf;
+            c.end = buf + n;
+            while (is_done == 0 && c.p < c.end) {
+                addr = get_u(&c, u.addr_size);
+                size = get_u(&c, u.addr_size);
+                if (addr == 0 && size == 0)
+                    is_done = 1;
+                else if (size > 0 && add_range(addr, addr + size, dwarf.n_cus - 1) == 1)
+                    return;
+            }
+        }
+    }
+}
+
+static void scan_cus(void) {
+    dwarf_cu_die_t die;
+    unsigned long int off, hi;
+    dwarf_cu_t *cu;
+
+    for (off = 0; off < dwarf.sections[SEC_INFO].size; off = die.next) {
+        if (read_cu_die(off, &die) == 1)
+            return;
+        if (die.is_compile == 0 || die.line_off == LINE_NONE)
+            continue;
+        if (add_cu((long int)off, die.line_off) == 1)
+            return;
+        cu = &dwarf.cus[dwarf.n_cus - 1];
+
+        /* Units whose ranges can't be told from the DIE learn them when they are decoded */
+        if (die.has_low && die.has_high) {
+            hi = die.is_high_offset ? die.low + die.high : die.high;
+            if (hi > die.low && add_range(die.low, hi, dwarf.n_cus - 1) == 1)
+                return;
+            cu->has_range = 1;
+        } else if (die.has_ranges && read_range_list(&die, dwarf.n_cus - 1) == 0)
+            cu->has_range = 1;
+    }
+}
+
+static unsigned char read_cu_die(const unsigned long int off, dwarf_cu_die_t *die) {
+    unsigned char buf[UNIT_CHUNK_SIZE];
+    unsigned char abbrev_buf[UNIT_CHUNK_SIZE];
+    dwarf_cursor_t c, a;
+    unsigned long int len, abbrev_off, code, attr, form, value;
+    unsigned int unit_type;
+    long int implicit;
+    size_t n;
+
+    memset(die, 0, sizeof(*die));
+    die->line_off = LINE_NONE;
+    if ((n = read_section(SEC_INFO, buf, sizeof(buf), off)) == 0)
+        return 1;
+    c.p = buf;
+    c.end = buf + n;
+    c.is_bad = 0;
+
+    len = get_length(&c, &die->u.offset_size);
+    if (c.is_bad)
+        return 1;
+    die->next = off + (die->u.offset_size == 8 ? 12 : 4) + len;
+    if (die->next <= off)
+        return 1;
+
+    /* Header */
+    die->u.version = (unsigned int)get_u(&c, 2);
+    if (die->u.version < 2 || die->u.version > 5)
+        return 0;
+    unit_type = DW_UT_compile;
+    if (die->u.version == 5) {
+        unit_type = (unsigned int)get_u(&c, 1);
+        die->u.addr_size = (unsigned int)get_u(&c, 1);
+        abbrev_off = get_u(&c, die->u.offset_size);
+        if (unit_type == DW_UT_skeleton || unit_type == DW_UT_split_compile)
+            skip(&c, 8);
+    } else {
+        abbrev_off = get_u(&c, die->u.offset_size);
+        die->u.addr_size = (unsigned int)get_u(&c, 1);
+    }
+    if (unit_type == DW_UT_type || unit_type == DW_UT_split_type || c.is_bad)
+        return 0;
+    die->is_compile = 1;
+
+    /* Abbreviation of the first DIE (usually the first of the unit's table) */
+    if ((code = get_uleb(&c)) == 0 || c.is_bad)
+        return 0;
+    if ((n = read_section(SEC_ABBREV, abbrev_buf, sizeof(abbrev_buf), abbrev_off)) == 0)
+        return 0;
+    a.p = abbrev_buf;
+    a.end = abbrev_buf + n;
+    a.is_bad = 0;
+    for (;;) {
+        if (get_uleb(&a) == code)
+            break;
+        get_uleb(&a);
+        skip(&a, 1);
+        do {
+            attr = get_uleb(&a);
+            form = get_uleb(&a);
+            if (form == DW_FORM_implicit_const)
+                get_sleb(&a);
+        } while ((attr != 0 || form != 0) && a.is_bad == 0);
+        if (a.is_bad)
+            return 0;
+    }
+    get_uleb(&a);
+    skip(&a, 1);
+
+    /* Attributes */
+    for (;;) {
+        attr = get_uleb(&a);
+        form = get_uleb(&a);
+        implicit = form == DW_FORM_implicit_const ? get_sleb(&a) : 0;
+        if ((attr == 0 && form == 0) || a.is_bad)
+            break;
+        value = get_form(&c, form, &die->u, implicit);
+        if (c.is_bad)
+            break;
+        switch (attr) {
+            case DW_AT_stmt_list:
+                die->line_off = (long int)value;
+                break;
+
+            case DW_AT_low_pc:
+                /* Indexed addresses would need .debug_addr */
+                die->has_low = form == DW_FORM_addr;
+                die->low = value;
+                break;
+
+            case DW_AT_high_pc:
+                die->has_high = form != DW_FORM_addrx && form != DW_FORM_addrx1 && form != DW_FORM_addrx2 &&
+                                form != DW_FORM_addrx3 && form != DW_FORM_addrx4 && form != DW_FORM_GNU_addr_index;
+                die->is_high_offset = form != DW_FORM_addr;
+                die->high = value;
+                break;
+
+            case DW_AT_ranges:
+                die->has_ranges = 1;
+                die->ranges_form = form;
+                die->ranges = value;
+                break;
+        }
+    }
+    return 0;
+}
+
+static unsigned char read_range_list(const dwarf_cu_die_t *die, const size_t cu) {
+    unsigned char buf[UNIT_CHUNK_SIZE];
+    dwarf_cursor_t c;
+    unsigned long int base, start, end, max_addr;
+    unsigned int kind;
+    size_t n;
+
+    base = die->has_low ? die->low : 0;
+    max_addr = die->u.addr_size == 8 ? ~0UL : 0xffffffffUL;
+    if (die->u.addr_size != 4 && die->u.addr_size != 8)
+        return 1;
+
+    /* DWARF 5 lists are inside .debug_rnglists, indexed ones (DW_FORM_rnglistx) would need DW_AT_rnglists_base */
+    if (die->u.version == 5) {
+        if (die->ranges_form != DW_FORM_sec_offset || (n = read_section(SEC_RNGLISTS, buf, sizeof(buf), die->ranges)) == 0)
+            return 1;
+    } else if ((n = read_section(SEC_RANGES, buf, sizeof(buf), die->ranges)) == 0)
+        return 1;
+    c.p = buf;
+    c.end = buf + n;
+    c.is_bad = 0;
+
+    for (;;) {
+        if (die->u.version < 5) {
+            start = get_u(&c, die->u.addr_size);
+            end = get_u(&c, die->u.addr_size);
+            if (c.is_bad)
+                return 1;
+            if (start == 0 && end == 0)
+                return 0;
+            if (start == max_addr) {
+                base = end;
+                continue;
+            }
+            start += base;
+            end += base;
+        } else {
+            kind = (unsigned int)get_u(&c, 1);
+            switch (kind) {
+                case DW_RLE_end_of_list:
+                    return c.is_bad;
+
+                case DW_RLE_offset_pair:
+                    start = base + get_uleb(&c);
+                    end = base + get_uleb(&c);
+                    break;
+
+                case DW_RLE_base_address:
+                    base = get_u(&c, die->u.addr_size);
+                    continue;
+
+                case DW_RLE_start_end:
+                    start = get_u(&c, die->u.addr_size);
+                    end = get_u(&c, die->u.addr_size);
+                    break;
+
+                case DW_RLE_start_length:
+                    start = get_u(&c, die->u.addr_size);
+                    end = start + get_uleb(&c);
+                    break;
+
+                default:
+                    /* Indexed entries would need .debug_addr */
+                    return 1;
+            }
+            if (c.is_bad)
+                return 1;
+        }
+        if (end > start && add_range(start, end, cu) == 1)
+            return 1;
+    }
+}
+
+/* LINE PROGRAMS */
+
+static unsigned char decode_cu(dwarf_cu_t *cu) {
+    dwarf_cu_die_t die;
+
+    if (cu->rows != NULL) {
+        cu->last_use = ++dwarf.clock;
+        return 0;
+    }
+
+    /* Units found through .debug_aranges don't know their line program yet */
+    if (cu->line_off == LINE_UNKNOWN) {
+        if (read_cu_die((unsigned long int)cu->info_off, &die) == 1 || die.is_compile == 0)
+            cu->line_off = LINE_NONE;
+        else
+            cu->line_off = die.line_off;
+    }
+
+    /* Units that can't be decoded are never tried again */
+    if (cu->line_off == LINE_NONE || decode_line_program(cu, (unsigned long int)cu->line_off) == 1) {
+        cu->line_off = LINE_NONE;
+        if (cu->has_range == 0) {
+            cu->has_range = 1;
+            sort_ranges();
+        }
+        return 1;
+    }
+
+    /* Tables the memory budget can't hold even alone are dropped, and not decoded again on every redraw */
+    if (cache_charge(cu) == 1) {
+        cu->line_off = LINE_NONE;
+        return 1;
+    }
+    cu->last_use = ++dwarf.clock;
+    return 0;
+}
+
+static unsigned char decode_line_program(dwarf_cu_t *cu, const unsigned long int off) {
+    unsigned char head[12];
+    unsigned char *buf;
+    const unsigned char *std_lengths, *program;
+    dwarf_cursor_t c;
+    dwarf_unit_t u;
+    unsigned long int len, header_len, addr, op_len;
+    unsigned int min_inst, line_range, opcode_base, op, adj, file, line, i;
+    int line_base;
+    size_t total, rows_size, names_size, seq_start, n_ranges;
+    unsigned char status;
+    const char *name;
+
+    /* The whole unit is read at once (charged to the budget while it's held), it's freed as soon as its rows are sorted */
+    c.p = head;
+    c.end = head + read_section(SEC_LINE, head, sizeof(head), off);
+    c.is_bad = 0;
+    len = get_length(&c, &u.offset_size);
+    total = (u.offset_size == 8 ? 12 : 4) + (size_t)len;
+    if (c.is_bad || off + total > dwarf.sections[SEC_LINE].size || budget_reserve(BUDGET_DWARF, total) == 1)
+        return 1;
+    if ((buf = malloc(total)) == NULL) {
+        budget_release(BUDGET_DWARF, total);
+        return 1;
+    }
+    if (read_section(SEC_LINE, buf, total, off) != total) {
+        free(buf);
+        budget_release(BUDGET_DWARF, total);
+        return 1;
+    }
+    c.p = buf + (u.offset_size == 8 ? 12 : 4);
+    c.end = buf + total;
+
+    /* Header */
+    u.version = (unsigned int)get_u(&c, 2);
+    u.addr_size = dwarf.eh.is_64 ? 8 : 4;
+    if (u.version == 5) {
+        u.addr_size = (unsigned int)get_u(&c, 1);
+        skip(&c, 1);
+    }
+    header_len = get_u(&c, u.offset_size);
+    program = c.p + header_len;
+    min_inst = (unsigned int)get_u(&c, 1);
+    if (u.version >= 4)
+        skip(&c, 1);  /* maximum_operations_per_instruction (VLIW only) */
+    skip(&c, 1);  /* default_is_stmt */
+    line_base = (signed char)get_u(&c, 1);
+    line_range = (unsigned int)get_u(&c, 1);
+    opcode_base = (unsigned int)get_u(&c, 1);
+    std_lengths = c.p;
+    skip(&c, opcode_base > 0 ? opcode_base - 1 : 0);
+    if (u.version < 2 || u.version > 5 || line_range == 0 || opcode_base == 0 || c.is_bad || header_len > (unsigned long int)(c.end - c.p)) {
+        free(buf);
+        budget_release(BUDGET_DWARF, total);
+        return 1;
+    }
+
+    /* File names (DWARF < 5 numbers them from 1, and index 0 stays empty) */
+    names_size = 0;
+    status = 0;
+    if (u.version == 5)
+        status = read_v5_files(&c, &u, cu, &names_size);
+    else {
+        while ((name = get_str(&c)) != NULL && name[0] != '\0')
+            ;
+        status = add_file(cu, "", &names_size);
+        while (status == 0 && (name = get_str(&c)) != NULL && name[0] != '\0') {
+            get_uleb(&c);
+            get_uleb(&c);
+            get_uleb(&c);
+            status = add_file(cu, name, &names_size);
+        }
+    }
+    if (status == 1 || c.is_bad) {
+        free(buf);
+        budget_release(BUDGET_DWARF, total);
+        cache_evict(cu);
+        return 1;
+    }
+
+    /* Program */
+    c.p = program;
+    rows_size = 0;
+    seq_start = 0;
+    n_ranges = dwarf.n_ranges;
+    addr = 0;
+    file = 1;
+    line = 1;
+    while (c.p < c.end && c.is_bad == 0 && status == 0) {
+        op = *c.p++;
+        if (op >= opcode_base) {
+            adj = op - opcode_base;
+            addr += (adj / line_range) * min_inst;
+            line = (unsigned int)((int)line + line_base + (int)(adj % line_range));
+            status = add_row(cu, &rows_size, seq_start, addr, file, line);
+            continue;
+        }
+        switch (op) {
+            case 0:
+                op_len = get_uleb(&c);
+                if (op_len == 0 || op_len > (unsigned long int)(c.end - c.p)) {
+                    c.is_bad = 1;
+                    break;
+                }
+                op = *c.p++;
+                if (op == DW_LNE_end_sequence) {
+                    status = add_row(cu, &rows_size, seq_start, addr, file, 0);
+                    /* Sequences at address 0 of linked files belong to discarded code */
+                    if (status == 1)
+                        break;
+                    if (cu->rows[seq_start].addr == 0 && dwarf.eh.type != ET_REL)
+                        cu->n_rows = seq_start;
+                    else if (cu->has_range == 0 && addr > cu->rows[seq_start].addr)
+                        status = add_range(cu->rows[seq_start].addr, addr, (size_t)(cu - dwarf.cus));
+                    seq_start = cu->n_rows;
+                    addr = 0;
+                    file = 1;
+                    line = 1;
+                } else if (op == DW_LNE_set_address) {
+                    addr = get_u(&c, (unsigned int)(op_len - 1));
+                } else if (op == DW_LNE_define_file && u.version < 5) {
+                    if ((name = get_str(&c)) != NULL) {
+                        get_uleb(&c);
+                        get_uleb(&c);
+                        get_uleb(&c);
+                        status = add_file(cu, name, &names_size);
+                    }
+                } else
+                    skip(&c, op_len - 1);
+                break;
+
+            case DW_LNS_copy:
+                status = add_row(cu, &rows_size, seq_start, addr, file, line);
+                break;
+
+            case DW_LNS_advance_pc:
+                addr += get_uleb(&c) * min_inst;
+                break;
+
+            case DW_LNS_advance_line:
+                line = (unsigned int)((long int)line + get_sleb(&c));
+                break;
+
+            case DW_LNS_set_file:
+                file = (unsigned int)get_uleb(&c);
+                break;
+
+            case DW_LNS_const_add_pc:
+                addr += ((255 - opcode_base) / line_range) * min_inst;
+                break;
+
+            case DW_LNS_fixed_advance_pc:
+                addr += get_u(&c, 2);
+                break;
+
+            default:
+                /* Other standard opcodes only change registers that aren't shown, their operands are ULEB128 */
+                for (i = 0; i < std_lengths[op - 1]; i++)
+                    get_uleb(&c);
+                break;
+        }
+    }
+    free(buf);
+    budget_release(BUDGET_DWARF, total);
+
+    /* A truncated sequence is dropped */
+    cu->n_rows = seq_start;
+    if (status == 1 || cu->n_rows == 0) {
+        cache_evict(cu);
+        return 1;
+    }
+
+    qsort(cu->rows, cu->n_rows, sizeof(*cu->rows), compare_rows);
+    if (cu->has_range == 0) {
+        cu->has_range = 1;
+        if (dwarf.n_ranges > n_ranges)
+            sort_ranges();
+    }
+    return 0;
+}
+
+static unsigned char read_v5_files(dwarf_cursor_t *c, const dwarf_unit_t *u, dwarf_cu_t *cu, size_t *names_size) {
+    unsigned long int formats[2 * 16];
+    unsigned long int n_formats, n_entries, i, j, value;
+    char name[VIEW_NAME_SIZE];
+    const char *s;
+    unsigned int table;
+
+    /* Directories, then files: a list of (content type, form) and entries made of values of those forms */
+    for (table = 0; table < 2; table++) {
+        n_formats = get_u(c, 1);
+        if (n_formats > 16)
+            return 1;
+        for (i = 0; i < n_formats; i++) {
+            formats[2 * i] = get_uleb(c);
+            formats[2 * i + 1] = get_uleb(c);
+        }
+        n_entries = get_uleb(c);
+        for (i = 0; i < n_entries && c->is_bad == 0; i++) {
+            name[0] = '\0';
+            for (j = 0; j < n_formats; j++) {
+                if (table == 1 && formats[2 * j] == DW_LNCT_path && formats[2 * j + 1] == DW_FORM_string) {
+                    if ((s = get_str(c)) != NULL)
+                        strncpy(name, s, sizeof(name) - 1);
+                    name[sizeof(name) - 1] = '\0';
+                    continue;
+                }
+                value = get_form(c, formats[2 * j + 1], u, 0);
+                if (table == 1 && formats[2 * j] == DW_LNCT_path &&
+                    (formats[2 * j + 1] == DW_FORM_line_strp || formats[2 * j + 1] == DW_FORM_strp))
+                    name[read_section(formats[2 * j + 1] == DW_FORM_line_strp ? SEC_LINE_STR : SEC_STR, name,
+                                      sizeof(name) - 1, value)] = '\0';
+            }
+            if (table == 1 && add_file(cu, name, names_size) == 1)
+                return 1;
+        }
+    }
+    return c->is_bad;
+}
+
+static unsigned char add_file(dwarf_cu_t *cu, const char *name, size_t *names_size) {
+    unsigned int *new_files;
+    char *new_names;
+    size_t len, used;
+
+    if ((cu->n_files & (cu->n_files + 1)) == 0 || cu->n_files == 0) {
+        if ((new_files = realloc(cu->files, (cu->n_files * 2 + 1) * sizeof(*new_files))) == NULL)
+            return 1;
+        cu->files = new_files;
+    }
+    used = cu->n_files == 0 ? 0 : cu->files[cu->n_files - 1] + strlen(cu->names + cu->files[cu->n_files - 1]) + 1;
+    len = strlen(name) + 1;
+    if (used + len > *names_size) {
+        if ((new_names = realloc(cu->names, (used + len) * 2)) == NULL)
+            return 1;
+        cu->names = new_names;
+        *names_size = (used + len) * 2;
+    }
+    memcpy(cu->names + used, name, len);
+    cu->files[cu->n_files++] = (unsigned int)used;
+    return 0;
+}
+
+static unsigned char add_row(dwarf_cu_t *cu, size_t *rows_size, const size_t seq_start, const unsigned long int addr,
+                             const unsigned int file, const unsigned int line) {
+    dwarf_row_t *new_rows;
+
+    /* Only the last row at an address matters (the others cover no byte) */
+    if (cu->n_rows > seq_start && cu->rows[cu->n_rows - 1].addr == addr) {
+        cu->rows[cu->n_rows - 1].file = file;
+        cu->rows[cu->n_rows - 1].line = line;
+        return 0;
+    }
+    if (cu->n_rows == *rows_size) {
+        *rows_size = *rows_size == 0 ? ROWS_INITIAL_SIZE : *rows_size * 2;
+        if ((new_rows = realloc(cu->rows, *rows_size * sizeof(*new_rows))) == NULL)
+            return 1;
+        cu->rows = new_rows;
+    }
+    cu->rows[cu->n_rows].addr = addr;
+    cu->rows[cu->n_rows].file = file;
+    cu->rows[cu->n_rows].line = line;
+    cu->n_rows++;
+    return 0;
+}
+
+static unsigned char find_row(const dwarf_cu_t *cu, const unsigned long int addr, const dwarf_row_t **row) {
+    size_t lo, hi, mid;
+
+    /* Last row at or before addr */
+    lo = 0;
+    hi = cu->n_rows;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (cu->rows[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0 || cu->rows[lo - 1].line == 0)
+        return 1;
+    *row = &cu->rows[lo - 1];
+    return 0;
+}
+
+/* CACHE */
+
+static unsigned char cache_charge(dwarf_cu_t *cu) {
+    dwarf_row_t *rows;
+    dwarf_cu_t *lru;
+    size_t i, names_len, limit;
+
+    /* Decoding over-allocates, the cache keeps exact sizes */
+    if ((rows = realloc(cu->rows, cu->n_rows * sizeof(*rows))) != NULL)
+        cu->rows = rows;
+    names_len = cu->n_files == 0 ? 0 : cu->files[cu->n_files - 1] + strlen(cu->names + cu->files[cu->n_files - 1]) + 1;
+    cu->charged = cu->n_rows * sizeof(*cu->rows) + cu->n_files * sizeof(*cu->files) + names_len;
+
+    /* A unit bigger than the whole cache is kept as its only entry, else every redraw would decode it again */
+    limit = cu->charged > DWARF_CACHE_SIZE ? cu->charged : DWARF_CACHE_SIZE;
+    for (;;) {
+        if (dwarf.cached + cu->charged <= limit && budget_reserve(BUDGET_DWARF, cu->charged) == 0)
+            break;
+        lru = NULL;
+        for (i = 0; i < dwarf.n_cus; i++) {
+            if (&dwarf.cus[i] != cu && dwarf.cus[i].rows != NULL && (lru == NULL || dwarf.cus[i].last_use < lru->last_use))
+                lru = &dwarf.cus[i];
+        }
+        if (lru == NULL) {
+            cu->charged = 0;
+            cache_evict(cu);
+            return 1;
+        }
+        cache_evict(lru);
+    }
+    dwarf.cached += cu->charged;
+    return 0;
+}
+
+static void cache_evict(dwarf_cu_t *cu) {
+    budget_release(BUDGET_DWARF, cu->charged);
+    dwarf.cached -= cu->charged;
+    free(cu->rows);
+    free(cu->files);
+    free(cu->names);
+    cu->rows = NULL;
+    cu->n_rows = 0;
+    cu->files = NULL;
+    cu->n_files = 0;
+    cu->names = NULL;
+    cu->charged = 0;
+}
+
+/* RANGES */
+
+static unsigned char find_cu(const unsigned long int addr, size_t *cu) {
+    size_t lo, hi, mid;
+
+    /* Last range starting at or before addr, then back while earlier (longer) ranges may still contain it */
+    lo = 0;
+    hi = dwarf.n_ranges;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (dwarf.ranges[mid].lo <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; lo > 0 && dwarf.ranges[lo - 1].max_hi > addr; lo--) {
+        if (dwarf.ranges[lo - 1].hi > addr && dwarf.cus[dwarf.ranges[lo - 1].cu].line_off != LINE_NONE) {
+            *cu = dwarf.ranges[lo - 1].cu;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned char add_cu(const long int info_off, const long int line_off) {
+    if (budget_grow(BUDGET_DWARF, &dwarf.charged, (void **)&dwarf.cus, dwarf.n_cus, sizeof(*dwarf.cus)) == 1)
+        return 1;
+    memset(&dwarf.cus[dwarf.n_cus], 0, sizeof(*dwarf.cus));
+    dwarf.cus[dwarf.n_cus].info_off = info_off;
+    dwarf.cus[dwarf.n_cus].line_off = line_off;
+    dwarf.n_cus++;
+    return 0;
+}
+
+static unsigned char add_range(const unsigned long int lo, const unsigned long int hi, const size_t cu) {
+    if (budget_grow(BUDGET_DWARF, &dwarf.charged, (void **)&dwarf.ranges, dwarf.n_ranges, sizeof(*dwarf.ranges)) == 1)
+        return 1;
+    dwarf.ranges[dwarf.n_ranges].lo = lo;
+    dwarf.ranges[dwarf.n_ranges].hi = hi;
+    dwarf.ranges[dwarf.n_ranges].cu = cu;
+    dwarf.n_ranges++;
+    return 0;
+}
+
+static void sort_ranges(void) {
+    size_t i;
+
+    qsort(dwarf.ranges, dwarf.n_ranges, sizeof(*dwarf.ranges), compare_ranges);
+    for (i = 0; i < dwarf.n_ranges; i++) {
+        dwarf.ranges[i].max_hi = dwarf.ranges[i].hi;
+        if (i > 0 && dwarf.ranges[i - 1].max_hi > dwarf.ranges[i].max_hi)
+            dwarf.ranges[i].max_hi = dwarf.ranges[i - 1].max_hi;
+    }
+}
+
+/* UTILS */
+
+static size_t read_section(const unsigned int sec, void *buf, const size_t len, const unsigned long int off) {
+    size_t n;
+
+    if (off >= dwarf.sections[sec].size)
+        return 0;
+    n = len < dwarf.sections[sec].size - off ? len : (size_t)(dwarf.sections[sec].size - off);
+    if (dwarf.sections[sec].z != NULL)
+        return zsection_read(dwarf.sections[sec].z, buf, n, (long int)off);
+    return dwarf.r.read(dwarf.r.ctx, buf, n, dwarf.sections[sec].off + (long int)off);
+}
+
+static int compare_ranges(const void *a, const void *b) {
+    const dwarf_range_t *ra, *rb;
+
+    ra = (const dwarf_range_t *)a;
+    rb = (const dwarf_range_t *)b;
+    return ra->lo < rb->lo ? -1 : (ra->lo > rb->lo ? 1 : 0);
+}
+
+static int compare_rows(const void *a, const void *b) {
+    const dwarf_row_t *ra, *rb;
+
+    /* At the same address the end of a sequence comes before the start of the next one */
+    ra = (const dwarf_row_t *)a;
+    rb = (const dwarf_row_t *)b;
+    if (ra->addr != rb->addr)
+        return ra->addr < rb->addr ? -1 : 1;
+    return (ra->line != 0) - (rb->line != 0);
+}
+
+/* CURSOR */
+
+static unsigned long int get_u(dwarf_cursor_t *c, const unsigned int size) {
+    unsigned long int value;
+
+    if (c->is_bad || (size_t)(c->end - c->p) < size) {
+        c->is_bad = 1;
+        c->p = c->end;
+        return 0;
+    }
+    value = size == 1 || size == 2 || size == 4 || size == 8 ? elf_get(&dwarf.eh, c->p, size) : 0;
+    c->p += size;
+    return value;
+}
+
+static unsigned long int get_uleb(dwarf_cursor_t *c) {
+    unsigned long int value;
+    unsigned int shift;
+    unsigned char byte;
+
+    value = 0;
+    shift = 0;
+    do {
+        if (c->p >= c->end) {
+            c->is_bad = 1;
+            return 0;
+        }
+        byte = *c->p++;
+        if (shift < sizeof(value) * 8)
+            value |= (unsigned long int)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+static long int get_sleb(dwarf_cursor_t *c) {
+    unsigned long int value;
+    unsigned int shift;
+    unsigned char byte;
+
+    value = 0;
+    shift = 0;
+    do {
+        if (c->p >= c->end) {
+            c->is_bad = 1;
+            return 0;
+        }
+        byte = *c->p++;
+        if (shift < sizeof(value) * 8)
+            value |= (unsigned long int)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    if (shift < sizeof(value) * 8 && (byte & 0x40))
+        value |= ~0UL << shift;
+    return (long int)value;
+}
+
+static const char *get_str(dwarf_cursor_t *c) {
+    const char *s;
+
+    s = (const char *)c->p;
+    while (c->p < c->end && *c->p != '\0')
+        c->p++;
+    if (c->p >= c->end) {
+        c->is_bad = 1;
+        return NULL;
+    }
+    c->p++;
+    return s;
+}
+
+static void skip(dwarf_cursor_t *c, const unsigned long int n) {
+    if (c->is_bad || (unsigned long int)(c->end - c->p) < n) {
+        c->is_bad = 1;
+        c->p = c->end;
+        return;
+    }
+    c->p += n;
+}
+
+static unsigned long int get_length(dwarf_cursor_t *c, unsigned int *offset_size) {
+    unsigned long int len;
+
+    *offset_size = 4;
+    len = get_u(c, 4);
+    if (len == 0xffffffffUL) {
+        *offset_size = 8;
+        len = get_u(c, 8);
+    } else if (len >= 0xfffffff0UL)
+        c->is_bad = 1;
+    return len;
+}
+
+static unsigned long int get_form(dwarf_cursor_t *c, const unsigned long int form, const dwarf_unit_t *u, const long int implicit) {
+    switch (form) {
+        case DW_FORM_addr:
+            return get_u(c, u->addr_size);
+
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+        case DW_FORM_strx1:
+        case DW_FORM_addrx1:
+            return get_u(c, 1);
+
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+        case DW_FORM_strx2:
+        case DW_FORM_addrx2:
+            return get_u(c, 2);
+
+        case DW_FORM_strx3:
+        case DW_FORM_addrx3:
+            skip(c, 3);
+            return 0;
+
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+        case DW_FORM_ref_sup4:
+        case DW_FORM_strx4:
+        case DW_FORM_addrx4:
+            return get_u(c, 4);
+
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+        case DW_FORM_ref_sup8:
+            return get_u(c, 8);
+
+        case DW_FORM_data16:
+            skip(c, 16);
+            return 0;
+
+        case DW_FORM_string:
+            get_str(c);
+            return 0;
+
+        case DW_FORM_block1:
+            skip(c, get_u(c, 1));
+            return 0;
+
+        case DW_FORM_block2:
+            skip(c, get_u(c, 2));
+            return 0;
+
+        case DW_FORM_block4:
+            skip(c, get_u(c, 4));
+            return 0;
+
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+            skip(c, get_uleb(c));
+            return 0;
+
+        case DW_FORM_sdata:
+            return (unsigned long int)get_sleb(c);
+
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+        case DW_FORM_strx:
+        case DW_FORM_addrx:
+        case DW_FORM_loclistx:
+        case DW_FORM_rnglistx:
+        case DW_FORM_GNU_addr_index:
+        case DW_FORM_GNU_str_index:
+            return get_uleb(c);
+
+        case DW_FORM_strp:
+        case DW_FORM_sec_offset:
+        case DW_FORM_strp_sup:
+        case DW_FORM_line_strp:
+        case DW_FORM_GNU_ref_alt:
+        case DW_FORM_GNU_strp_alt:
+            return get_u(c, u->offset_size);
+
+        case DW_FORM_ref_addr:
+            return get_u(c, u->version <= 2 ? u->addr_size : u->offset_size);
+
+        case DW_FORM_flag_present:
+            return 1;
+
+        case DW_FORM_implicit_const:
+            return (unsigned long int)implicit;
+
+        case DW_FORM_indirect:
+            return get_form(c, get_uleb(c), u, implicit);
+
+        default:
+            c->is_bad = 1;
+            return 0;
+    }
+}
@@ -0,0 +1,483 @@
+/* C89 standard */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+#include "elf_parse.h"
+
+
+#define EHDR32_SIZE  52
+#define EHDR64_SIZE  64
+#define PHDR32_SIZE  32
+#define PHDR64_SIZE  56
+#define SHDR32_SIZE  40
+#define SHDR64_SIZE  64
+#define NHDR_SIZE    12
+
+#define ALIGN4(x) (((x) + 3) & ~3L)
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct for the name of a numeric value */
+static const struct elf_name_tag {
+    unsigned long int value;
+    const char *name;
+} MACHINE_NAMES[] = {{EM_386, "i386"}, {EM_68K, "m68k"}, {EM_MIPS, "mips"}, {EM_PPC, "ppc"}, {EM_PPC64, "ppc64"},
+                     {EM_S390, "s390"}, {EM_ARM, "arm"}, {EM_SH, "sh"}, {EM_SPARCV9, "sparcv9"}, {EM_IA_64, "ia64"},
+                     {EM_X86_64, "x86_64"}, {EM_AARCH64, "aarch64"}, {EM_RISCV, "riscv"}, {EM_BPF, "bpf"},
+                     {EM_LOONGARCH, "loongarch"}},
+  OSABI_NAMES[] = {{ELFOSABI_SYSV, "SYSV"}, {ELFOSABI_HPUX, "HPUX"}, {ELFOSABI_NETBSD, "NETBSD"},
+                   {ELFOSABI_GNU, "GNU"}, {ELFOSABI_SOLARIS, "SOLARIS"}, {ELFOSABI_AIX, "AIX"},
+                   {ELFOSABI_IRIX, "IRIX"}, {ELFOSABI_FREEBSD, "FREEBSD"}, {ELFOSABI_TRU64, "TRU64"},
+                   {ELFOSABI_MODESTO, "MODESTO"}, {ELFOSABI_OPENBSD, "OPENBSD"}, {ELFOSABI_ARM_AEABI, "ARM_AEABI"},
+                   {ELFOSABI_ARM, "ARM"}, {ELFOSABI_STANDALONE, "STANDALONE"}},
+  TYPE_NAMES[] = {{ET_NONE, "NONE"}, {ET_REL, "REL"}, {ET_EXEC, "EXEC"}, {ET_DYN, "DYN"}, {ET_CORE, "CORE"}},
+  PHDR_TYPE_NAMES[] = {{PT_NULL, "NULL"}, {PT_LOAD, "LOAD"}, {PT_DYNAMIC, "DYNAMIC"}, {PT_INTERP, "INTERP"},
+                       {PT_NOTE, "NOTE"}, {PT_SHLIB, "SHLIB"}, {PT_PHDR, "PHDR"}, {PT_TLS, "TLS"},
+                       {PT_GNU_EH_FRAME, "GNU_EH_FRAME"}, {PT_GNU_STACK, "GNU_STACK"}, {PT_GNU_RELRO, "GNU_RELRO"},
+                       {PT_GNU_PROPERTY, "GNU_PROPERTY"}},
+  SHDR_TYPE_NAMES[] = {{SHT_NULL, "NULL"}, {SHT_PROGBITS, "PROGBITS"}, {SHT_SYMTAB, "SYMTAB"}, {SHT_STRTAB, "STRTAB"},
+                       {SHT_RELA, "RELA"}, {SHT_HASH, "HASH"}, {SHT_DYNAMIC, "DYNAMIC"}, {SHT_NOTE, "NOTE"},
+                       {SHT_NOBITS, "NOBITS"}, {SHT_REL, "REL"}, {SHT_SHLIB, "SHLIB"}, {SHT_DYNSYM, "DYNSYM"},
+                       {SHT_INIT_ARRAY, "INIT_ARRAY"}, {SHT_FINI_ARRAY, "FINI_ARRAY"},
+                       {SHT_PREINIT_ARRAY, "PREINIT_ARRAY"}, {SHT_GROUP, "GROUP"}, {SHT_SYMTAB_SHNDX, "SYMTAB_SHNDX"},
+                       {SHT_GNU_HASH, "GNU_HASH"}, {SHT_GNU_verdef, "GNU_verdef"}, {SHT_GNU_verneed, "GNU_verneed"},
+                       {SHT_GNU_versym, "GNU_versym"}},
+  DYN_TAG_NAMES[] = {{DT_NULL, "NULL"}, {DT_NEEDED, "NEEDED"}, {DT_PLTRELSZ, "PLTRELSZ"}, {DT_PLTGOT, "PLTGOT"},
+                     {DT_HASH, "HASH"}, {DT_STRTAB, "STRTAB"}, {DT_SYMTAB, "SYMTAB"}, {DT_RELA, "RELA"},
+                     {DT_RELASZ, "RELASZ"}, {DT_RELAENT, "RELAENT"}, {DT_STRSZ, "STRSZ"}, {DT_SYMENT, "SYMENT"},
+                     {DT_INIT, "INIT"}, {DT_FINI, "FINI"}, {DT_SONAME, "SONAME"}, {DT_RPATH, "RPATH"},
+                     {DT_SYMBOLIC, "SYMBOLIC"}, {DT_REL, "REL"}, {DT_RELSZ, "RELSZ"}, {DT_RELENT, "RELENT"},
+                     {DT_PLTREL, "PLTREL"}, {DT_DEBUG, "DEBUG"}, {DT_TEXTREL, "TEXTREL"}, {DT_JMPREL, "JMPREL"},
+                     {DT_BIND_NOW, "BIND_NOW"}, {DT_INIT_ARRAY, "INIT_ARRAY"}, {DT_FINI_ARRAY, "FINI_ARRAY"},
+                     {DT_INIT_ARRAYSZ, "INIT_ARRAYSZ"}, {DT_FINI_ARRAYSZ, "FINI_ARRAYSZ"}, {DT_RUNPATH, "RUNPATH"},
+                     {DT_FLAGS, "FLAGS"}, {DT_PREINIT_ARRAY, "PREINIT_ARRAY"}, {DT_PREINIT_ARRAYSZ, "PREINIT_ARRAYSZ"},
+                     {DT_SYMTAB_SHNDX, "SYMTAB_SHNDX"}, {DT_GNU_HASH, "GNU_HASH"}, {DT_VERSYM, "VERSYM"},
+                     {DT_RELACOUNT, "RELACOUNT"}, {DT_RELCOUNT, "RELCOUNT"}, {DT_FLAGS_1, "FLAGS_1"},
+                     {DT_VERDEF, "VERDEF"}, {DT_VERDEFNUM, "VERDEFNUM"}, {DT_VERNEED, "VERNEED"},
+                     {DT_VERNEEDNUM, "VERNEEDNUM"}},
+  SYM_TYPE_NAMES[] = {{STT_NOTYPE, "NOTYPE"}, {STT_OBJECT, "OBJECT"}, {STT_FUNC, "FUNC"}, {STT_SECTION, "SECTION"},
+                      {STT_FILE, "FILE"}, {STT_COMMON, "COMMON"}, {STT_TLS, "TLS"}, {STT_GNU_IFUNC, "IFUNC"}},
+  SYM_BIND_NAMES[] = {{STB_LOCAL, "LOCAL"}, {STB_GLOBAL, "GLOBAL"}, {STB_WEAK, "WEAK"}, {STB_GNU_UNIQUE, "UNIQUE"}},
+  REL_X86_64_NAMES[] = {{R_X86_64_NONE, "NONE"}, {R_X86_64_64, "64"}, {R_X86_64_PC32, "PC32"}, {R_X86_64_GOT32, "GOT32"},
+                        {R_X86_64_PLT32, "PLT32"}, {R_X86_64_COPY, "COPY"}, {R_X86_64_GLOB_DAT, "GLOB_DAT"},
+                        {R_X86_64_JUMP_SLOT, "JUMP_SLOT"}, {R_X86_64_RELATIVE, "RELATIVE"},
+                        {R_X86_64_GOTPCREL, "GOTPCREL"}, {R_X86_64_32, "32"}, {R_X86_64_32S, "32S"}, {R_X86_64_16, "16"},
+                        {R_X86_64_PC16, "PC16"}, {R_X86_64_8, "8"}, {R_X86_64_PC8, "PC8"}, {R_X86_64_DTPMOD64, "DTPMOD64"},
+                        {R_X86_64_DTPOFF64, "DTPOFF64"}, {R_X86_64_TPOFF64, "TPOFF64"}, {R_X86_64_TLSGD, "TLSGD"},
+                        {R_X86_64_TLSLD, "TLSLD"}, {R_X86_64_DTPOFF32, "DTPOFF32"}, {R_X86_64_GOTTPOFF, "GOTTPOFF"},
+                        {R_X86_64_TPOFF32, "TPOFF32"}, {R_X86_64_PC64, "PC64"}, {R_X86_64_GOTOFF64, "GOTOFF64"},
+                        {R_X86_64_GOTPC32, "GOTPC32"}, {R_X86_64_SIZE32, "SIZE32"}, {R_X86_64_SIZE64, "SIZE64"},
+                        {R_X86_64_TLSDESC, "TLSDESC"}, {R_X86_64_IRELATIVE, "IRELATIVE"},
+                        {R_X86_64_GOTPCRELX, "GOTPCRELX"}, {R_X86_64_REX_GOTPCRELX, "REX_GOTPCRELX"}},
+  REL_386_NAMES[] = {{R_386_NONE, "NONE"}, {R_386_32, "32"}, {R_386_PC32, "PC32"}, {R_386_GOT32, "GOT32"},
+                     {R_386_PLT32, "PLT32"}, {R_386_COPY, "COPY"}, {R_386_GLOB_DAT, "GLOB_DAT"},
+                     {R_386_JMP_SLOT, "JUMP_SLOT"}, {R_386_RELATIVE, "RELATIVE"}, {R_386_GOTOFF, "GOTOFF"},
+                     {R_386_GOTPC, "GOTPC"}, {R_386_TLS_TPOFF, "TLS_TPOFF"}, {R_386_TLS_IE, "TLS_IE"},
+                     {R_386_TLS_GOTIE, "TLS_GOTIE"}, {R_386_TLS_LE, "TLS_LE"}, {R_386_TLS_GD, "TLS_GD"},
+                     {R_386_TLS_LDM, "TLS_LDM"}, {R_386_16, "16"}, {R_386_PC16, "PC16"}, {R_386_8, "8"},
+                     {R_386_PC8, "PC8"}, {R_386_TLS_DTPMOD32, "TLS_DTPMOD32"}, {R_386_TLS_DTPOFF32, "TLS_DTPOFF32"},
+                     {R_386_TLS_TPOFF32, "TLS_TPOFF32"}, {R_386_SIZE32, "SIZE32"}, {R_386_TLS_DESC, "TLS_DESC"},
+                     {R_386_IRELATIVE, "IRELATIVE"}, {R_386_GOT32X, "GOT32X"}};
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Reads exactly len bytes at off
+ * If successful returns 0, else 1
+ */
+static unsigned char read_exact(const elf_reader_t *r, void *buf, const size_t len, const long int off);
+
+/* Returns number of blocks cached for a table of size bytes read through blocks */
+static unsigned int strtab_n_blocks(const unsigned long int size);
+
+/*
+ * Makes block b of st cached (loading it over the block used least recently if needed)
+ * Returns its slot, or ELF_STRTAB_N_BLOCKS if it can't be read
+ */
+static unsigned int strtab_block(elf_strtab_t *st, const unsigned long int b);
+
+/* Returns name of value inside names (which contains n names), or NULL if not found */
+static const char *find_name(const struct elf_name_tag *names, const size_t n, const unsigned long int value);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+/* HEADERS */
+
+unsigned char elf_read_ehdr(const elf_reader_t *r, elf_ehdr_t *eh) {
+    unsigned char buf[EHDR64_SIZE];
+    elf_shdr_t sh0;
+
+    if (read_exact(r, buf, EI_NIDENT, 0) == 1)
+        return 1;
+    if (memcmp(buf, ELFMAG, SELFMAG) != 0)
+        return 1;
+    if (buf[EI_CLASS] != ELFCLASS32 && buf[EI_CLASS] != ELFCLASS64)
+        return 1;
+    if (buf[EI_DATA] != ELFDATA2LSB && buf[EI_DATA] != ELFDATA2MSB)
+        return 1;
+
+    eh->is_64 = (buf[EI_CLASS] == ELFCLASS64);
+    eh->is_big = (buf[EI_DATA] == ELFDATA2MSB);
+    eh->osabi = buf[EI_OSABI];
+    eh->abiversion = buf[EI_ABIVERSION];
+
+    if (read_exact(r, buf, eh->is_64 ? EHDR64_SIZE : EHDR32_SIZE, 0) == 1)
+        return 1;
+
+    eh->type = elf_get(eh, &buf[16], 2);
+    eh->machine = elf_get(eh, &buf[18], 2);
+    if (eh->is_64) {
+        eh->entry = elf_get(eh, &buf[24], 8);
+        eh->phoff = (long int)elf_get(eh, &buf[32], 8);
+        eh->shoff = (long int)elf_get(eh, &buf[40], 8);
+        eh->flags = elf_get(eh, &buf[48], 4);
+        eh->phentsize = elf_get(eh, &buf[54], 2);
+        eh->phnum = elf_get(eh, &buf[56], 2);
+        eh->shentsize = elf_get(eh, &buf[58], 2);
+        eh->shnum = elf_get(eh, &buf[60], 2);
+        eh->shstrndx = elf_get(eh, &buf[62], 2);
+    } else {
+        eh->entry = elf_get(eh, &buf[24], 4);
+        eh->phoff = (long int)elf_get(eh, &buf[28], 4);
+        eh->shoff = (long int)elf_get(eh, &buf[32], 4);
+        eh->flags = elf_get(eh, &buf[36], 4);
+        eh->phentsize = elf_get(eh, &buf[42], 2);
+        eh->phnum = elf_get(eh, &buf[44], 2);
+        eh->shentsize = elf_get(eh, &buf[46], 2);
+        eh->shnum = elf_get(eh, &buf[48], 2);
+        eh->shstrndx = elf_get(eh, &buf[50], 2);
+    }
+
+    if (eh->shoff < 0 || eh->phoff < 0)
+        return 1;
+
+    /* Extended numbering: real values are stored inside section header 0 */
+    if (eh->shoff != 0 && (eh->shnum == 0 || eh->shstrndx == SHN_XINDEX || eh->phnum == PN_XNUM)) {
+        if (elf_read_shdr(r, eh, 0, &sh0) == 1)
+            return 1;
+        if (eh->shnum == 0)
+            eh->shnum = (unsigned int)sh0.size;
+        if (eh->shstrndx == SHN_XINDEX)
+            eh->shstrndx = (unsigned int)sh0.link;
+        if (eh->phnum == PN_XNUM)
+            eh->phnum = (unsigned int)sh0.info;
+    }
+    if (eh->shoff == 0)
+        eh->shnum = 0;
+    if (eh->phoff == 0)
+        eh->phnum = 0;
+
+    return 0;
+}
+
+unsigned char elf_read_phdr(const elf_reader_t *r, const elf_ehdr_t *eh, const unsigned int i, elf_phdr_t *ph) {
+    unsigned char buf[PHDR64_SIZE];
+    long int off;
+
+    /* Entries may be bigger than the structure (later ABI versions can add fields), never smaller */
+    if (eh->phentsize < (unsigned int)(eh->is_64 ? PHDR64_SIZE : PHDR32_SIZE))
+        return 1;
+    off = eh->phoff + (long int)i * (long int)eh->phentsize;
+    if (read_exact(r, buf, eh->is_64 ? PHDR64_SIZE : PHDR32_SIZE, off) == 1)
+        return 1;
+
+    ph->type = elf_get(eh, &buf[0], 4);
+    if (eh->is_64) {
+        ph->flags = elf_get(eh, &buf[4], 4);
+        ph->offset = (long int)elf_get(eh, &buf[8], 8);
+        ph->vaddr = elf_get(eh, &buf[16], 8);
+        ph->paddr = elf_get(eh, &buf[24], 8);
+        ph->filesz = elf_get(eh, &buf[32], 8);
+        ph->memsz = elf_get(eh, &buf[40], 8);
+        ph->align = elf_get(eh, &buf[48], 8);
+    } else {
+        ph->offset = (long int)elf_get(eh, &buf[4], 4);
+        ph->vaddr = elf_get(eh, &buf[8], 4);
+        ph->paddr = elf_get(eh, &buf[12], 4);
+        ph->filesz = elf_get(eh, &buf[16], 4);
+        ph->memsz = elf_get(eh, &buf[20], 4);
+        ph->flags = elf_get(eh, &buf[24], 4);
+        ph->align = elf_get(eh, &buf[28], 4);
+    }
+    return 0;
+}
+
+unsigned char elf_read_shdr(const elf_reader_t *r, const elf_ehdr_t *eh, const unsigned int i, elf_shdr_t *sh) {
+    unsigned char buf[SHDR64_SIZE];
+    long int off;
+
+    if (eh->shentsize < (unsigned int)(eh->is_64 ? SHDR64_SIZE : SHDR32_SIZE))
+        return 1;
+    off = eh->shoff + (long int)i * (long int)eh->shentsize;
+    if (read_exact(r, buf, eh->is_64 ? SHDR64_SIZE : SHDR32_SIZE, off) == 1)
+        return 1;
+
+    sh->name = elf_get(eh, &buf[0], 4);
+    sh->type = elf_get(eh, &buf[4], 4);
+    if (eh->is_64) {
+        sh->flags = elf_get(eh, &buf[8], 8);
+        sh->addr = elf_get(eh, &buf[16], 8);
+        sh->offset = (long int)elf_get(eh, &buf[24], 8);
+        sh->size = elf_get(eh, &buf[32], 8);
+        sh->link = elf_get(eh, &buf[40], 4);
+        sh->info = elf_get(eh, &buf[44], 4);
+        sh->addralign = elf_get(eh, &buf[48], 8);
+        sh->entsize = elf_get(eh, &buf[56], 8);
+    } else {
+        sh->flags = elf_get(eh, &buf[8], 4);
+        sh->addr = elf_get(eh, &buf[12], 4);
+        sh->offset = (long int)elf_get(eh, &buf[16], 4);
+        sh->size = elf_get(eh, &buf[20], 4);
+        sh->link = elf_get(eh, &buf[24], 4);
+        sh->info = elf_get(eh, &buf[28], 4);
+        sh->addralign = elf_get(eh, &buf[32], 4);
+        sh->entsize = elf_get(eh, &buf[36], 4);
+    }
+    return 0;
+}
+
+/* NOTES / STRINGS */
+
+long int elf_read_note(const elf_reader_t *r, const elf_ehdr_t *eh, const long int off, const long int end, elf_note_t *note) {
+    unsigned char buf[NHDR_SIZE];
+    long int next;
+
+    if (off + NHDR_SIZE > end)
+        return -1;
+    if (read_exact(r, buf, NHDR_SIZE, off) == 1)
+        return -1;
+
+    note->namesz = elf_get(eh, &buf[0], 4);
+    note->descsz = elf_get(eh, &buf[4], 4);
+    note->type = elf_get(eh, &buf[8], 4);
+    note->name_off = off + NHDR_SIZE;
+    note->desc_off = note->name_off + ALIGN4((long int)note->namesz);
+
+    next = note->desc_off + ALIGN4((long int)note->descsz);
+    if (next > end || next <= off)
+        return -1;
+    return next;
+}
+
+unsigned char elf_read_str(const elf_reader_t *r, const long int off, char *buf, const size_t size) {
+    size_t n;
+
+    if (size == 0 || off < 0 || off >= r->len)
+        return 1;
+    n = r->read(r->ctx, buf, size - 1, off);
+    buf[n] = '\0';
+    return 0;
+}
+
+/* SYMBOLS / STRING TABLES */
+
+void elf_decode_sym(const elf_ehdr_t *eh, const unsigned char *raw, elf_sym_t *sym) {
+    sym->name = elf_get(eh, &raw[0], 4);
+    if (eh->is_64) {
+        sym->info = raw[4];
+        sym->other = raw[5];
+        sym->shndx = elf_get(eh, &raw[6], 2);
+        sym->value = elf_get(eh, &raw[8], 8);
+        sym->size = elf_get(eh, &raw[16], 8);
+    } else {
+        sym->value = elf_get(eh, &raw[4], 4);
+        sym->size = elf_get(eh, &raw[8], 4);
+        sym->info = raw[12];
+        sym->other = raw[13];
+        sym->shndx = elf_get(eh, &raw[14], 2);
+    }
+}
+
+unsigned char elf_strtab_init(elf_strtab_t *st, const elf_reader_t *r, const elf_shdr_t *sh, const size_t max_whole) {
+    size_t n;
+    unsigned int i;
+
+    st->r = r;
+    st->off = sh->offset;
+    st->size = sh->size;
+    st->whole = NULL;
+    st->blocks = NULL;
+    if (st->size <= max_whole) {
+        if ((st->whole = malloc((size_t)st->size + 1)) == NULL)
+            return 1;
+        /* Bytes that can't be read are left as terminators, so that the allocation keeps its size */
+        n = r->read(r->ctx, st->whole, (size_t)st->size, st->off);
+        memset(&st->whole[n], '\0', (size_t)(st->size - n) + 1);
+        return 0;
+    }
+
+    st->n_blocks = strtab_n_blocks(st->size);
+    for (i = 0; i < ELF_STRTAB_N_BLOCKS; i++) {
+        st->block_len[i] = 0;
+        st->last_use[i] = 0;
+    }
+    st->clock = 0;
+    if ((st->blocks = malloc(elf_strtab_mem_size(sh, max_whole))) == NULL)
+        return 1;
+    return 0;
+}
+
+size_t elf_strtab_mem_size(const elf_shdr_t *sh, const size_t max_whole) {
+    if (sh->size <= max_whole)
+        return (size_t)sh->size + 1;
+    return (size_t)(strtab_n_blocks(sh->size) + 1) * ELF_STRTAB_BLOCK_SIZE + 1;
+}
+
+const char *elf_strtab_get(elf_strtab_t *st, const unsigned long int idx) {
+    unsigned long int b;
+    unsigned int slot;
+    size_t in, len, next_len;
+    char *p, *str;
+
+    if (idx >= st->size)
+        return "";
+    if (st->whole != NULL)
+        return &st->whole[idx];
+    b = idx / ELF_STRTAB_BLOCK_SIZE;
+    in = (size_t)(idx % ELF_STRTAB_BLOCK_SIZE);
+    if ((slot = strtab_block(st, b)) == ELF_STRTAB_N_BLOCKS || in >= st->block_len[slot])
+        return "";
+    p = &st->blocks[slot * ELF_STRTAB_BLOCK_SIZE];
+    len = st->block_len[slot] - in;
+    if (memchr(&p[in], '\0', len) != NULL)
+        return &p[in];
+
+    /* The string goes on inside the next block: it is put together (truncated to a block) after the cached blocks */
+    str = &st->blocks[st->n_blocks * ELF_STRTAB_BLOCK_SIZE];
+    memcpy(str, &p[in], len);
+    if ((slot = strtab_block(st, b + 1)) != ELF_STRTAB_N_BLOCKS) {
+        next_len = st->block_len[slot] < ELF_STRTAB_BLOCK_SIZE - len ? st->block_len[slot] : ELF_STRTAB_BLOCK_SIZE - len;
+        memcpy(&str[len], &st->blocks[slot * ELF_STRTAB_BLOCK_SIZE], next_len);
+        len += next_len;
+    }
+    str[len] = '\0';
+    return str;
+}
+
+void elf_strtab_free(elf_strtab_t *st) {
+    free(st->whole);
+    st->whole = NULL;
+    free(st->blocks);
+    st->blocks = NULL;
+}
+
+/* DECODING */
+
+unsigned long int elf_get(const elf_ehdr_t *eh, const unsigned char *p, const unsigned int size) {
+    unsigned long int v;
+    unsigned int i;
+
+    v = 0;
+    for (i = 0; i < size; i++) {
+        if (eh->is_big)
+            v = (v << 8) | p[i];
+        else
+            v |= (unsigned long int)p[i] << (8 * i);
+    }
+    return v;
+}
+
+/* NAMES */
+
+const char *elf_type_name(const unsigned int type) {
+    return find_name(TYPE_NAMES, sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]), type);
+}
+
+const char *elf_machine_name(const unsigned int machine) {
+    return find_name(MACHINE_NAMES, sizeof(MACHINE_NAMES) / sizeof(MACHINE_NAMES[0]), machine);
+}
+
+const char *elf_osabi_name(const unsigned char osabi) {
+    return find_name(OSABI_NAMES, sizeof(OSABI_NAMES) / sizeof(OSABI_NAMES[0]), osabi);
+}
+
+const char *elf_phdr_type_name(const unsigned long int type) {
+    return find_name(PHDR_TYPE_NAMES, sizeof(PHDR_TYPE_NAMES) / sizeof(PHDR_TYPE_NAMES[0]), type);
+}
+
+const char *elf_shdr_type_name(const unsigned long int type) {
+    return find_name(SHDR_TYPE_NAMES, sizeof(SHDR_TYPE_NAMES) / sizeof(SHDR_TYPE_NAMES[0]), type);
+}
+
+const char *elf_dyn_tag_name(const unsigned long int tag) {
+    return find_name(DYN_TAG_NAMES, sizeof(DYN_TAG_NAMES) / sizeof(DYN_TAG_NAMES[0]), tag);
+}
+
+const char *elf_sym_type_name(const unsigned char info) {
+    return find_name(SYM_TYPE_NAMES, sizeof(SYM_TYPE_NAMES) / sizeof(SYM_TYPE_NAMES[0]), ELF64_ST_TYPE(info));
+}
+
+const char *elf_sym_bind_name(const unsigned char info) {
+    return find_name(SYM_BIND_NAMES, sizeof(SYM_BIND_NAMES) / sizeof(SYM_BIND_NAMES[0]), ELF64_ST_BIND(info));
+}
+
+const char *elf_rel_type_name(const unsigned int machine, const unsigned long int type) {
+    switch (machine) {
+        case EM_X86_64:
+            return find_name(REL_X86_64_NAMES, sizeof(REL_X86_64_NAMES) / sizeof(REL_X86_64_NAMES[0]), type);
+        case EM_386:
+            return find_name(REL_386_NAMES, sizeof(REL_386_NAMES) / sizeof(REL_386_NAMES[0]), type);
+        default:
+            return NULL;
+    }
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+static unsigned char read_exact(const elf_reader_t *r, void *buf, const size_t len, const long int off) {
+    if (off < 0 || off + (long int)len > r->len)
+        return 1;
+    if (r->read(r->ctx, buf, len, off) != len)
+        return 1;
+    return 0;
+}
+
+static unsigned int strtab_n_blocks(const unsigned long int size) {
+    unsigned long int n;
+
+    n = (size + ELF_STRTAB_BLOCK_SIZE - 1) / ELF_STRTAB_BLOCK_SIZE;
+    return n == 0 ? 1 : (n < ELF_STRTAB_N_BLOCKS ? (unsigned int)n : ELF_STRTAB_N_BLOCKS);
+}
+
+static unsigned int strtab_block(elf_strtab_t *st, const unsigned long int b) {
+    unsigned int i, slot;
+    size_t len;
+
+    if (b * ELF_STRTAB_BLOCK_SIZE >= st->size)
+        return ELF_STRTAB_N_BLOCKS;
+    slot = 0;
+    for (i = 0; i < st->n_blocks; i++) {
+        if (st->block_len[i] != 0 && st->block[i] == b) {
+            st->last_use[i] = ++st->clock;
+            return i;
+        }
+        if (st->last_use[i] < st->last_use[slot])
+            slot = i;
+    }
+
+    len = st->size - b * ELF_STRTAB_BLOCK_SIZE < ELF_STRTAB_BLOCK_SIZE ? (size_t)(st->size - b * ELF_STRTAB_BLOCK_SIZE)
+                                                                        : ELF_STRTAB_BLOCK_SIZE;
+    st->block[slot] = b;
+    st->block_len[slot] = st->r->read(st->r->ctx, &st->blocks[slot * ELF_STRTAB_BLOCK_SIZE], len,
+                                      st->off + (long int)(b * ELF_STRTAB_BLOCK_SIZE));
+    st->last_use[slot] = ++st->clock;
+    return st->block_len[slot] == 0 ? ELF_STRTAB_N_BLOCKS : slot;
+}
+
+static const char *find_name(const struct elf_name_tag *names, const size_t n, const unsigned long int value) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if (names[i].value == value)
+            return names[i].name;
+    }
+    return NULL;
+}
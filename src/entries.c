@@ -0,0 +1,471 @@
+#define _XOPEN_SOURCE 700  /* for snprintf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+#include "elf_parse.h"
+#include "file.h"
+
+#include "entries.h"
+
+
+#define NAME_CACHE_SIZE    256  /* names kept (a few screens of rows) */
+#define NAME_SIZE          128
+#define SECTION_NAME_SIZE  64
+#define ENTRY_MAX_SIZE     24  /* bytes of the biggest entry (Elf64_Rela, Elf64_Sym) */
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a cached name: the string at offset key of string table section, or the name of symbol key of symbol table section */
+typedef struct entries_name_tag {
+    unsigned int section;
+    unsigned long int key;
+    unsigned long int last_use;  /* 0 if the slot is free */
+    char name[NAME_SIZE];
+} entries_name_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing data about the open table */
+static struct entries_tag {
+    view_t view;
+    elf_reader_t r;
+    elf_ehdr_t eh;
+    unsigned char is_open;
+    unsigned int index;  /* of the open table inside the section header table */
+    elf_shdr_t sh;
+    char name[SECTION_NAME_SIZE];
+    size_t entry_size;
+    size_t n_entries;
+    unsigned int symtab;  /* symbol table used by relocations (0 if there's none) */
+    elf_shdr_t symtab_sh;
+    unsigned int strtab;  /* string table of the names (0 if there's none) */
+    elf_shdr_t strtab_sh;
+    elf_shdr_t shstrtab_sh;  /* section names (size 0 if there are none) */
+    unsigned long int clock;
+    entries_name_t names[NAME_CACHE_SIZE];
+} entries;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Returns size of the entries of a table of eh with section type type (0 if it isn't a table) */
+static size_t entry_size(const elf_ehdr_t *eh, const unsigned long int type);
+
+/*
+ * Makes section i (with header sh) of v the open table, and finds the sections its names come from
+ * If successful returns 0, else 1
+ */
+static unsigned char open_section(const view_t *v, const elf_ehdr_t *eh, const unsigned int i, const elf_shdr_t *sh);
+
+/*
+ * Finds the section linked by section header sh, if its type is type
+ * If found returns 0 and sets *index and *link, else 1
+ */
+static unsigned char find_link(const elf_shdr_t *sh, const unsigned long int type, unsigned int *index, elf_shdr_t *link);
+
+/* Returns string at offset off of the string table strtab (with header sh), "" if it can't be read */
+static const char *get_string(const unsigned int strtab, const elf_shdr_t *sh, const unsigned long int off);
+
+/* Returns name of symbol sym of the symbol table used by relocations (its section name for sections), "" if it can't be read */
+static const char *get_symbol_name(const unsigned long int sym);
+
+/*
+ * Finds name (section, key) inside the cache, or else the slot used longest ago (which is then given to it)
+ * If found returns 0, else 1, and sets *slot either way
+ */
+static unsigned char find_name(const unsigned int section, const unsigned long int key, entries_name_t **slot);
+
+/* Frees every slot of the name cache */
+static void clear_names(void);
+
+/* Writes the line of relocation entry raw (of a SHT_RELA table if has_addend is 1) number i to buf */
+static void format_rel(const unsigned char *raw, const unsigned char has_addend, const size_t i, char *buf, const size_t size);
+
+/* Writes the line of dynamic entry raw number i to buf */
+static void format_dyn(const unsigned char *raw, const size_t i, char *buf, const size_t size);
+
+/* Writes the line of symbol raw number i to buf */
+static void format_sym(const unsigned char *raw, const size_t i, char *buf, const size_t size);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char entries_open(const view_t *v, const long int pos) {
+    elf_reader_t r;
+    elf_ehdr_t eh;
+    elf_shdr_t sh, first_sh, next_sh;
+    unsigned int i, first, next;
+    unsigned char has_first, has_next;
+
+    file_get_reader(&r, v);
+    if (elf_read_ehdr(&r, &eh) == 1)
+        return 1;
+
+    /* The table containing pos wins, else the closest one after it, else the first one */
+    has_first = has_next = 0;
+    first = next = 0;
+    for (i = 0; i < eh.shnum; i++) {
+        if (elf_read_shdr(&r, &eh, i, &sh) == 1)
+            return 1;
+        if (entry_size(&eh, sh.type) == 0)
+            continue;
+        if (pos >= sh.offset && (unsigned long int)(pos - sh.offset) < sh.size)
+            return open_section(v, &eh, i, &sh);
+        if (has_first == 0) {
+            has_first = 1;
+            first = i;
+            first_sh = sh;
+        }
+        if (sh.offset > pos && (has_next == 0 || sh.offset < next_sh.offset)) {
+            has_next = 1;
+            next = i;
+            next_sh = sh;
+        }
+    }
+    if (has_next == 1)
+        return open_section(v, &eh, next, &next_sh);
+    if (has_first == 1)
+        return open_section(v, &eh, first, &first_sh);
+    return 1;
+}
+
+unsigned char entries_next(void) {
+    elf_shdr_t sh;
+    unsigned int i, n;
+
+    if (entries.is_open == 0)
+        return 1;
+
+    for (n = 1; n < entries.eh.shnum; n++) {
+        i = (entries.index + n) % entries.eh.shnum;
+        if (elf_read_shdr(&entries.r, &entries.eh, i, &sh) == 1)
+            return 1;
+        if (entry_size(&entries.eh, sh.type) != 0)
+            return open_section(&entries.view, &entries.eh, i, &sh);
+    }
+    return 1;
+}
+
+size_t entries_n_lines(void) {
+    if (entries.is_open == 0)
+        return 0;
+    return entries.n_entries + 1;
+}
+
+void entries_line(const size_t i, char *buf, const size_t size) {
+    unsigned char raw[ENTRY_MAX_SIZE];
+    long int off;
+    unsigned int width;
+
+    if (size == 0)
+        return;
+    buf[0] = '\0';
+    if (entries.is_open == 0 || i > entries.n_entries)
+        return;
+
+    width = entries.eh.is_64 ? 16 : 8;
+    if (i == 0) {
+        switch (entries.sh.type) {
+            case SHT_RELA:
+            case SHT_REL:
+                snprintf(buf, size, "     Num  %-*s  %-16s %8s  %s", (int)width, "Offset", "Type", "Sym", "Symbol + Addend");
+                break;
+            case SHT_DYNAMIC:
+                snprintf(buf, size, "     Num  %-20s %s", "Tag", "Value");
+                break;
+            default:
+                snprintf(buf, size, "     Num  %-*s  %8s  %-8s %-8s %-9s %5s  %s", (int)width, "Value", "Size", "Type", "Bind",
+                         "Vis", "Ndx", "Name");
+                break;
+        }
+        return;
+    }
+
+    /* Entries have a fixed size, so entry i is found without reading the ones before it */
+    off = entries.sh.offset + (long int)((i - 1) * entries.entry_size);
+    if (entries.r.read(entries.r.ctx, raw, entries.entry_size, off) != entries.entry_size) {
+        snprintf(buf, size, "%8lu  <unreadable>", (unsigned long int)(i - 1));
+        return;
+    }
+    switch (entries.sh.type) {
+        case SHT_RELA:
+        case SHT_REL:
+            format_rel(raw, entries.sh.type == SHT_RELA, i - 1, buf, size);
+            break;
+        case SHT_DYNAMIC:
+            format_dyn(raw, i - 1, buf, size);
+            break;
+        default:
+            format_sym(raw, i - 1, buf, size);
+            break;
+    }
+}
+
+void entries_forget_names(void) {
+    clear_names();
+}
+
+void entries_summary(char *buf, const size_t size) {
+    if (size == 0)
+        return;
+    buf[0] = '\0';
+    if (entries.is_open == 0)
+        return;
+    snprintf(buf, size, "%s: %lu entries (n: next table)", entries.name, (unsigned long int)entries.n_entries);
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* TABLES */
+
+static size_t entry_size(const elf_ehdr_t *eh, const unsigned long int type) {
+    unsigned char is_64;
+
+    is_64 = eh->is_64;
+    switch (type) {
+        case SHT_RELA:
+            return is_64 ? 24 : 12;
+        case SHT_REL:
+            return is_64 ? 16 : 8;
+        case SHT_DYNAMIC:
+            return is_64 ? 16 : 8;
+        case SHT_SYMTAB:
+        case SHT_DYNSYM:
+            return is_64 ? ELF_SYM64_SIZE : ELF_SYM32_SIZE;
+        default:
+            return 0;
+    }
+}
+
+static unsigned char open_section(const view_t *v, const elf_ehdr_t *eh, const unsigned int i, const elf_shdr_t *sh) {
+    unsigned long int avail;
+
+    /* Names are cached by section index and offset only, which mean something else inside another view */
+    if (v != &entries.view) {
+        entries.view = *v;
+        clear_names();
+    }
+    file_get_reader(&entries.r, &entries.view);
+    entries.eh = *eh;
+    entries.index = i;
+    entries.sh = *sh;
+    entries.entry_size = entry_size(eh, sh->type);
+
+    /* Tables cut by the end of the view (or NOBITS ones) only show the entries that are there */
+    avail = 0;
+    if (sh->offset >= 0 && sh->offset < entries.r.len)
+        avail = (unsigned long int)(entries.r.len - sh->offset);
+    entries.n_entries = (size_t)((sh->size < avail ? sh->size : avail) / entries.entry_size);
+
+    entries.symtab = entries.strtab = 0;
+    if (sh->type == SHT_RELA || sh->type == SHT_REL) {
+        if (find_link(sh, SHT_SYMTAB, &entries.symtab, &entries.symtab_sh) == 0 ||
+            find_link(sh, SHT_DYNSYM, &entries.symtab, &entries.symtab_sh) == 0)
+            find_link(&entries.symtab_sh, SHT_STRTAB, &entries.strtab, &entries.strtab_sh);
+        else
+            entries.symtab = 0;
+    } else
+        find_link(sh, SHT_STRTAB, &entries.strtab, &entries.strtab_sh);
+
+    memset(&entries.shstrtab_sh, 0, sizeof(entries.shstrtab_sh));
+    if (eh->shstrndx < eh->shnum && elf_read_shdr(&entries.r, eh, eh->shstrndx, &entries.shstrtab_sh) == 1)
+        memset(&entries.shstrtab_sh, 0, sizeof(entries.shstrtab_sh));
+    snprintf(entries.name, sizeof(entries.name), "%s", get_string(eh->shstrndx, &entries.shstrtab_sh, sh->name));
+    if (entries.name[0] == '\0')
+        snprintf(entries.name, sizeof(entries.name), "section %u", i);
+
+    entries.is_open = 1;
+    return 0;
+}
+
+static unsigned char find_link(const elf_shdr_t *sh, const unsigned long int type, unsigned int *index, elf_shdr_t *link) {
+    if (sh->link == 0 || sh->link >= entries.eh.shnum)
+        return 1;
+    if (elf_read_shdr(&entries.r, &entries.eh, (unsigned int)sh->link, link) == 1 || link->type != type)
+        return 1;
+    *index = (unsigned int)sh->link;
+    return 0;
+}
+
+/* NAMES */
+
+static const char *get_string(const unsigned int strtab, const elf_shdr_t *sh, const unsigned long int off) {
+    entries_name_t *slot;
+
+    if (off >= sh->size)
+        return "";
+    if (find_name(strtab, off, &slot) == 0)
+        return slot->name;
+
+    if (elf_read_str(&entries.r, sh->offset + (long int)off, slot->name, NAME_SIZE) == 1)
+        slot->name[0] = '\0';
+    return slot->name;
+}
+
+static const char *get_symbol_name(const unsigned long int sym) {
+    unsigned char raw[ENTRY_MAX_SIZE];
+    entries_name_t *slot;
+    elf_shdr_t sh;
+    elf_sym_t s;
+    size_t sym_size;
+
+    if (entries.symtab == 0)
+        return "";
+    if (find_name(entries.symtab, sym, &slot) == 0)
+        return slot->name;
+
+    /* The slot is given back if the symbol can't be read */
+    slot->name[0] = '\0';
+    sym_size = entries.eh.is_64 ? ELF_SYM64_SIZE : ELF_SYM32_SIZE;
+    if ((sym + 1) * sym_size > entries.symtab_sh.size ||
+        entries.r.read(entries.r.ctx, raw, sym_size, entries.symtab_sh.offset + (long int)(sym * sym_size)) != sym_size) {
+        slot->last_use = 0;
+        return "";
+    }
+    elf_decode_sym(&entries.eh, raw, &s);
+    if (entries.strtab != 0 && s.name < entries.strtab_sh.size &&
+        elf_read_str(&entries.r, entries.strtab_sh.offset + (long int)s.name, slot->name, NAME_SIZE) == 1)
+        slot->name[0] = '\0';
+
+    /* Relocations against a section (common inside objects) point to an unnamed symbol of the section */
+    if (slot->name[0] == '\0' && ELF64_ST_TYPE(s.info) == STT_SECTION && s.shndx < entries.eh.shnum &&
+        elf_read_shdr(&entries.r, &entries.eh, s.shndx, &sh) == 0 && sh.name < entries.shstrtab_sh.size &&
+        elf_read_str(&entries.r, entries.shstrtab_sh.offset + (long int)sh.name, slot->name, NAME_SIZE) == 1)
+        slot->name[0] = '\0';
+    return slot->name;
+}
+
+static unsigned char find_name(const unsigned int section, const unsigned long int key, entries_name_t **slot) {
+    size_t i, oldest;
+
+    entries.clock++;
+    oldest = 0;
+    for (i = 0; i < NAME_CACHE_SIZE; i++) {
+        if (entries.names[i].last_use != 0 && entries.names[i].section == section && entries.names[i].key == key) {
+            entries.names[i].last_use = entries.clock;
+            *slot = &entries.names[i];
+            return 0;
+        }
+        if (entries.names[i].last_use < entries.names[oldest].last_use)
+            oldest = i;
+    }
+
+    entries.names[oldest].section = section;
+    entries.names[oldest].key = key;
+    entries.names[oldest].last_use = entries.clock;
+    *slot = &entries.names[oldest];
+    return 1;
+}
+
+static void clear_names(void) {
+    size_t i;
+
+    for (i = 0; i < NAME_CACHE_SIZE; i++)
+        entries.names[i].last_use = 0;
+}
+
+/* LINES */
+
+static void format_rel(const unsigned char *raw, const unsigned char has_addend, const size_t i, char *buf, const size_t size) {
+    char type_str[24];
+    const char *type_name, *sym_name;
+    unsigned long int off, info, sym, type, addend;
+    unsigned int word;
+    int width;
+
+    word = entries.eh.is_64 ? 8 : 4;
+    width = entries.eh.is_64 ? 16 : 8;
+    off = elf_get(&entries.eh, raw, word);
+    info = elf_get(&entries.eh, raw + word, word);
+    addend = has_addend ? elf_get(&entries.eh, raw + 2 * word, word) : 0;
+    if (entries.eh.is_64) {
+        sym = info >> 32;
+        type = info & 0xffffffffUL;
+    } else {
+        sym = info >> 8;
+        type = info & 0xff;
+        /* Addends are signed, 32-bit ones are sign extended to print them the same way */
+        if (addend & 0x80000000UL)
+            addend |= ~0xffffffffUL;
+    }
+
+    if ((type_name = elf_rel_type_name(entries.eh.machine, type)) == NULL) {
+        sprintf(type_str, "%lu", type);
+        type_name = type_str;
+    }
+    sym_name = sym != 0 ? get_symbol_name(sym) : "";
+
+    if (has_addend == 0)
+        snprintf(buf, size, "%8lu  %0*lx  %-16s %8lu  %s", (unsigned long int)i, width, off, type_name, sym, sym_name);
+    else if (sym == 0)
+        snprintf(buf, size, "%8lu  %0*lx  %-16s %8lu  %s0x%lx", (unsigned long int)i, width, off, type_name, sym,
+                 (long int)addend < 0 ? "-" : "", (long int)addend < 0 ? 0 - addend : addend);
+    else
+        snprintf(buf, size, "%8lu  %0*lx  %-16s %8lu  %s %s 0x%lx", (unsigned long int)i, width, off, type_name, sym,
+                 sym_name, (long int)addend < 0 ? "-" : "+", (long int)addend < 0 ? 0 - addend : addend);
+}
+
+static void format_dyn(const unsigned char *raw, const size_t i, char *buf, const size_t size) {
+    char tag_str[24];
+    const char *tag_name;
+    unsigned long int tag, val;
+    unsigned int word;
+
+    word = entries.eh.is_64 ? 8 : 4;
+    tag = elf_get(&entries.eh, raw, word);
+    val = elf_get(&entries.eh, raw + word, word);
+
+    if ((tag_name = elf_dyn_tag_name(tag)) == NULL) {
+        sprintf(tag_str, "0x%lx", tag);
+        tag_name = tag_str;
+    }
+    if (entries.strtab != 0 && (tag == DT_NEEDED || tag == DT_SONAME || tag == DT_RPATH || tag == DT_RUNPATH))
+        snprintf(buf, size, "%8lu  %-20s 0x%lx [%s]", (unsigned long int)i, tag_name, val,
+                 get_string(entries.strtab, &entries.strtab_sh, val));
+    else
+        snprintf(buf, size, "%8lu  %-20s 0x%lx", (unsigned long int)i, tag_name, val);
+}
+
+static void format_sym(const unsigned char *raw, const size_t i, char *buf, const size_t size) {
+    static const char *const VISIBILITY_NAMES[] = {"DEFAULT", "INTERNAL", "HIDDEN", "PROTECTED"};
+    char type_str[8], bind_str[8], ndx_str[8];
+    const char *type_name, *bind_name, *name;
+    elf_sym_t sym;
+
+    elf_decode_sym(&entries.eh, raw, &sym);
+    if ((type_name = elf_sym_type_name(sym.info)) == NULL) {
+        sprintf(type_str, "%u", (unsigned int)ELF64_ST_TYPE(sym.info));
+        type_name = type_str;
+    }
+    if ((bind_name = elf_sym_bind_name(sym.info)) == NULL) {
+        sprintf(bind_str, "%u", (unsigned int)ELF64_ST_BIND(sym.info));
+        bind_name = bind_str;
+    }
+    switch (sym.shndx) {
+        case SHN_UNDEF:
+            strcpy(ndx_str, "UND");
+            break;
+        case SHN_ABS:
+            strcpy(ndx_str, "ABS");
+            break;
+        case SHN_COMMON:
+            strcpy(ndx_str, "COM");
+            break;
+        default:
+            sprintf(ndx_str, "%u", sym.shndx);
+            break;
+    }
+    name = entries.strtab != 0 ? get_string(entries.strtab, &entries.strtab_sh, sym.name) : "";
+
+    snprintf(buf, size, "%8lu  %0*lx  %8lu  %-8s %-8s %-9s %5s  %s", (unsigned long int)i, entries.eh.is_64 ? 16 : 8,
+             sym.value, sym.size, type_name, bind_name, VISIBILITY_NAMES[ELF64_ST_VISIBILITY(sym.other)], ndx_str, name);
+}
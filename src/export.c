@@ -0,0 +1,396 @@
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+#include "budget.h"
+#include "elf_parse.h"
+#include "json.h"
+
+#include "export.h"
+
+
+#define SYMS_PER_CHUNK     256
+#define NOTE_NAME_SIZE     64
+#define NOTE_DESC_MAX_SIZE 256
+#define SECTION_NAME_SIZE  256
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Writes the ELF header */
+static void write_header(const elf_ehdr_t *eh, FILE *f);
+
+/*
+ * Writes program headers
+ * If successful returns 0, else 1
+ */
+static unsigned char write_phdrs(const elf_reader_t *r, const elf_ehdr_t *eh, FILE *f);
+
+/*
+ * Writes section headers
+ * If successful returns 0, else 1
+ */
+static unsigned char write_shdrs(const elf_reader_t *r, const elf_ehdr_t *eh, elf_strtab_t *shstrtab, FILE *f);
+
+/*
+ * Writes entries of every SHT_SYMTAB and SHT_DYNSYM section, a chunk at a time
+ * If successful returns 0, else 1
+ */
+static unsigned char write_symbols(const elf_reader_t *r, const elf_ehdr_t *eh, elf_strtab_t *shstrtab, FILE *f);
+
+/*
+ * Writes dynamic entries (of the SHT_DYNAMIC section, or of PT_DYNAMIC if there are no sections)
+ * If successful returns 0, else 1
+ */
+static unsigned char write_dynamic(const elf_reader_t *r, const elf_ehdr_t *eh, FILE *f);
+
+/*
+ * Writes notes (of SHT_NOTE sections, or of PT_NOTE segments if there are no sections)
+ * If successful returns 0, else 1
+ */
+static unsigned char write_notes(const elf_reader_t *r, const elf_ehdr_t *eh, FILE *f);
+
+/* Writes notes inside [off, off + size), *first is 1 if no note has been written yet */
+static void write_notes_in(const elf_reader_t *r, const elf_ehdr_t *eh, const long int off, const unsigned long int size,
+                           unsigned char *first, FILE *f);
+
+/*
+ * Initializes st to read the string table described by sh, charging the memory budget (*charged bytes)
+ * The table is read whole if it's small enough and fits inside the budget, else through a few cached blocks
+ * If successful returns 0, else 1
+ */
+static unsigned char open_strtab(elf_strtab_t *st, const elf_reader_t *r, const elf_shdr_t *sh, size_t *charged);
+
+/* Frees st, giving its charged bytes back to the budget */
+static void close_strtab(elf_strtab_t *st, const size_t charged);
+
+/* Writes name if not NULL, else number, as a JSON string */
+static void write_name(const char *name, const unsigned long int number, FILE *f);
+
+/*
+ * Finds the first section with type type
+ * If found returns 0 and sets *sh, else 1
+ */
+static unsigned char find_section(const elf_reader_t *r, const elf_ehdr_t *eh, const unsigned long int type, elf_shdr_t *sh);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char export_json(const elf_reader_t *r, FILE *f) {
+    elf_ehdr_t eh;
+    elf_shdr_t sh;
+    elf_strtab_t shstrtab;
+    unsigned char status;
+    size_t charged;
+
+    if (elf_read_ehdr(r, &eh) == 1)
+        return 1;
+
+    /* Section names */
+    memset(&sh, 0, sizeof(sh));
+    if (eh.shstrndx < eh.shnum && elf_read_shdr(r, &eh, eh.shstrndx, &sh) == 1)
+        return 1;
+    if (open_strtab(&shstrtab, r, &sh, &charged) == 1)
+        return 1;
+
+    fputs("{\n\"header\":", f);
+    write_header(&eh, f);
+
+    status = 1;
+    if (write_phdrs(r, &eh, f) == 0 && write_shdrs(r, &eh, &shstrtab, f) == 0 && write_symbols(r, &eh, &shstrtab, f) == 0 &&
+        write_dynamic(r, &eh, f) == 0 && write_notes(r, &eh, f) == 0)
+        status = 0;
+    fputs("}\n", f);
+
+    close_strtab(&shstrtab, charged);
+    if (fflush(f) == EOF || ferror(f))
+        return 1;
+    return status;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* TABLES */
+
+static void write_header(const elf_ehdr_t *eh, FILE *f) {
+    fprintf(f, "{\"class\":%d,\"endian\":\"%s\",\"osabi\":", eh->is_64 ? 64 : 32, eh->is_big ? "big" : "little");
+    write_name(elf_osabi_name(eh->osabi), eh->osabi, f);
+    fprintf(f, ",\"abiversion\":%u,\"type\":", (unsigned int)eh->abiversion);
+    write_name(elf_type_name(eh->type), eh->type, f);
+    fputs(",\"machine\":", f);
+    write_name(elf_machine_name(eh->machine), eh->machine, f);
+    fprintf(f, ",\"entry\":\"0x%lx\",\"phoff\":%ld,\"shoff\":%ld,\"flags\":%lu,\"phnum\":%u,\"shnum\":%u,\"shstrndx\":%u},\n",
+            eh->entry, eh->phoff, eh->shoff, eh->flags, eh->phnum, eh->shnum, eh->shstrndx);
+}
+
+static unsigned char write_phdrs(const elf_reader_t *r, const elf_ehdr_t *eh, FILE *f) {
+    elf_phdr_t ph;
+    unsigned int i;
+
+    fputs("\"program_headers\":[", f);
+    for (i = 0; i < eh->phnum; i++) {
+        if (elf_read_phdr(r, eh, i, &ph) == 1)
+            return 1;
+        fputs(i == 0 ? "\n{\"type\":" : ",\n{\"type\":", f);
+        write_name(elf_phdr_type_name(ph.type), ph.type, f);
+        fprintf(f, ",\"flags\":\"%c%c%c\",\"offset\":%ld,\"vaddr\":\"0x%lx\",\"paddr\":\"0x%lx\",\"filesz\":%lu,"
+                "\"memsz\":%lu,\"align\":%lu}", (ph.flags & PF_R) ? 'R' : '-', (ph.flags & PF_W) ? 'W' : '-',
+                (ph.flags & PF_X) ? 'X' : '-', ph.offset, ph.vaddr, ph.paddr, ph.filesz, ph.memsz, ph.align);
+    }
+    fputs("],\n", f);
+    return 0;
+}
+
+static unsigned char write_shdrs(const elf_reader_t *r, const elf_ehdr_t *eh, elf_strtab_t *shstrtab, FILE *f) {
+    elf_shdr_t sh;
+    unsigned int i;
+
+    fputs("\"section_headers\":[", f);
+    for (i = 0; i < eh->shnum; i++) {
+        if (elf_read_shdr(r, eh, i, &sh) == 1)
+            return 1;
+        fprintf(f, "%s{\"index\":%u,\"name\":", i == 0 ? "\n" : ",\n", i);
+        json_write_str(f, elf_strtab_get(shstrtab, sh.name));
+        fputs(",\"type\":", f);
+        write_name(elf_shdr_type_name(sh.type), sh.type, f);
+        fprintf(f, ",\"flags\":%lu,\"addr\":\"0x%lx\",\"offset\":%ld,\"size\":%lu,\"link\":%lu,\"info\":%lu,"
+                "\"addralign\":%lu,\"entsize\":%lu}", sh.flags, sh.addr, sh.offset, sh.size, sh.link, sh.info,
+                sh.addralign, sh.entsize);
+    }
+    fputs("],\n", f);
+    return 0;
+}
+
+static unsigned char write_symbols(const elf_reader_t *r, const elf_ehdr_t *eh, elf_strtab_t *shstrtab, FILE *f) {
+    static const char *const VISIBILITY_NAMES[] = {"DEFAULT", "INTERNAL", "HIDDEN", "PROTECTED"};
+    unsigned char *chunk;
+    char section_name[SECTION_NAME_SIZE];
+    elf_shdr_t sh, link;
+    elf_strtab_t strtab;
+    elf_sym_t sym;
+    unsigned long int n_syms, i, j, n;
+    unsigned char first;
+    size_t sym_size, charged;
+    unsigned int s;
+
+    sym_size = eh->is_64 ? ELF_SYM64_SIZE : ELF_SYM32_SIZE;
+    if ((chunk = malloc(SYMS_PER_CHUNK * sym_size)) == NULL)
+        return 1;
+
+    first = 1;
+    fputs("\"symbols\":[", f);
+    for (s = 0; s < eh->shnum; s++) {
+        if (elf_read_shdr(r, eh, s, &sh) == 1) {
+            free(chunk);
+            return 1;
+        }
+        if (sh.type != SHT_SYMTAB && sh.type != SHT_DYNSYM)
+            continue;
+        if (sh.link >= eh->shnum || elf_read_shdr(r, eh, (unsigned int)sh.link, &link) == 1)
+            continue;
+        if (open_strtab(&strtab, r, &link, &charged) == 1) {
+            free(chunk);
+            return 1;
+        }
+        strncpy(section_name, elf_strtab_get(shstrtab, sh.name), SECTION_NAME_SIZE - 1);
+        section_name[SECTION_NAME_SIZE - 1] = '\0';
+
+        /* Entries are decoded a chunk at a time and written right away */
+        n_syms = sh.size / sym_size;
+        for (i = 0; i < n_syms; i += n) {
+            n = n_syms - i < SYMS_PER_CHUNK ? n_syms - i : SYMS_PER_CHUNK;
+            if (r->read(r->ctx, chunk, n * sym_size, sh.offset + (long int)(i * sym_size)) != n * sym_size) {
+                close_strtab(&strtab, charged);
+                free(chunk);
+                return 1;
+            }
+            for (j = 0; j < n; j++) {
+                elf_decode_sym(eh, &chunk[j * sym_size], &sym);
+                fputs(first ? "\n{\"section\":" : ",\n{\"section\":", f);
+                first = 0;
+                json_write_str(f, section_name);
+                fprintf(f, ",\"index\":%lu,\"name\":", i + j);
+                json_write_str(f, elf_strtab_get(&strtab, sym.name));
+                fprintf(f, ",\"value\":\"0x%lx\",\"size\":%lu,\"type\":", sym.value, sym.size);
+                write_name(elf_sym_type_name(sym.info), ELF64_ST_TYPE(sym.info), f);
+                fputs(",\"bind\":", f);
+                write_name(elf_sym_bind_name(sym.info), ELF64_ST_BIND(sym.info), f);
+                fprintf(f, ",\"visibility\":\"%s\",\"shndx\":%u}", VISIBILITY_NAMES[ELF64_ST_VISIBILITY(sym.other)], sym.shndx);
+            }
+        }
+        close_strtab(&strtab, charged);
+    }
+    fputs("],\n", f);
+
+    free(chunk);
+    return 0;
+}
+
+static unsigned char write_dynamic(const elf_reader_t *r, const elf_ehdr_t *eh, FILE *f) {
+    unsigned char raw[16];
+    elf_shdr_t sh, link;
+    elf_phdr_t ph;
+    elf_strtab_t strtab;
+    unsigned long int tag, val, i, size;
+    unsigned char has_strtab;
+    long int off;
+    size_t word, charged;
+    unsigned int p;
+
+    off = -1;
+    size = 0;
+    has_strtab = 0;
+    if (find_section(r, eh, SHT_DYNAMIC, &sh) == 0) {
+        off = sh.offset;
+        size = sh.size;
+        if (sh.link < eh->shnum && elf_read_shdr(r, eh, (unsigned int)sh.link, &link) == 0) {
+            if (open_strtab(&strtab, r, &link, &charged) == 1)
+                return 1;
+            has_strtab = 1;
+        }
+    } else if (eh->shnum == 0) {
+        for (p = 0; p < eh->phnum; p++) {
+            if (elf_read_phdr(r, eh, p, &ph) == 0 && ph.type == PT_DYNAMIC) {
+                off = ph.offset;
+                size = ph.filesz;
+                break;
+            }
+        }
+    }
+
+    fputs("\"dynamic\":[", f);
+    word = eh->is_64 ? 8 : 4;
+    for (i = 0; off != -1 && i + 2 * word <= size; i += 2 * word) {
+        if (r->read(r->ctx, raw, 2 * word, off + (long int)i) != 2 * word) {
+            if (has_strtab)
+                close_strtab(&strtab, charged);
+            return 1;
+        }
+        tag = elf_get(eh, raw, (unsigned int)word);
+        val = elf_get(eh, raw + word, (unsigned int)word);
+
+        fputs(i == 0 ? "\n{\"tag\":" : ",\n{\"tag\":", f);
+        write_name(elf_dyn_tag_name(tag), tag, f);
+        fprintf(f, ",\"value\":\"0x%lx\"", val);
+        if (has_strtab && (tag == DT_NEEDED || tag == DT_SONAME || tag == DT_RPATH || tag == DT_RUNPATH)) {
+            fputs(",\"string\":", f);
+            json_write_str(f, elf_strtab_get(&strtab, val));
+        }
+        fputc('}', f);
+        if (tag == DT_NULL)
+            break;
+    }
+    fputs("],\n", f);
+
+    if (has_strtab)
+        close_strtab(&strtab, charged);
+    return 0;
+}
+
+static unsigned char write_notes(const elf_reader_t *r, const elf_ehdr_t *eh, FILE *f) {
+    elf_shdr_t sh;
+    elf_phdr_t ph;
+    unsigned char first;
+    unsigned int i;
+
+    first = 1;
+    fputs("\"notes\":[", f);
+    if (eh->shnum > 0) {
+        for (i = 0; i < eh->shnum; i++) {
+            if (elf_read_shdr(r, eh, i, &sh) == 1)
+                return 1;
+            if (sh.type == SHT_NOTE)
+                write_notes_in(r, eh, sh.offset, sh.size, &first, f);
+        }
+    } else {
+        for (i = 0; i < eh->phnum; i++) {
+            if (elf_read_phdr(r, eh, i, &ph) == 1)
+                return 1;
+            if (ph.type == PT_NOTE)
+                write_notes_in(r, eh, ph.offset, ph.filesz, &first, f);
+        }
+    }
+    fputs("]\n", f);
+    return 0;
+}
+
+static void write_notes_in(const elf_reader_t *r, const elf_ehdr_t *eh, const long int off, const unsigned long int size,
+                           unsigned char *first, FILE *f) {
+    unsigned char desc[NOTE_DESC_MAX_SIZE];
+    char name[NOTE_NAME_SIZE];
+    elf_note_t note;
+    long int pos, end;
+    size_t n, i;
+
+    end = off + (long int)size;
+    for (pos = off; pos < end; ) {
+        if ((pos = elf_read_note(r, eh, pos, end, &note)) == -1)
+            return;
+
+        n = note.namesz < NOTE_NAME_SIZE ? (size_t)note.namesz : NOTE_NAME_SIZE - 1;
+        n = r->read(r->ctx, name, n, note.name_off);
+        name[n] = '\0';
+
+        fputs(*first ? "\n{\"owner\":" : ",\n{\"owner\":", f);
+        *first = 0;
+        json_write_str(f, name);
+        fprintf(f, ",\"type\":%lu,\"offset\":%ld,\"descsz\":%lu", note.type, note.desc_off, note.descsz);
+
+        /* Small descriptors (build-id, ABI tag, ...) are written in hex, big ones (core dumps) only by offset */
+        if (note.descsz <= NOTE_DESC_MAX_SIZE && r->read(r->ctx, desc, note.descsz, note.desc_off) == note.descsz) {
+            fputs(",\"desc\":\"", f);
+            for (i = 0; i < note.descsz; i++)
+                fprintf(f, "%02x", desc[i]);
+            fputc('"', f);
+        }
+        fputc('}', f);
+    }
+}
+
+/* UTILS */
+
+static unsigned char open_strtab(elf_strtab_t *st, const elf_reader_t *r, const elf_shdr_t *sh, size_t *charged) {
+    size_t max_whole;
+
+    max_whole = ELF_STRTAB_WHOLE_SIZE;
+    *charged = elf_strtab_mem_size(sh, max_whole);
+    if (budget_reserve(BUDGET_EXPORT, *charged) == 1) {
+        max_whole = 0;
+        *charged = elf_strtab_mem_size(sh, max_whole);
+        if (budget_reserve(BUDGET_EXPORT, *charged) == 1)
+            return 1;
+    }
+    if (elf_strtab_init(st, r, sh, max_whole) == 1) {
+        budget_release(BUDGET_EXPORT, *charged);
+        return 1;
+    }
+    return 0;
+}
+
+static void close_strtab(elf_strtab_t *st, const size_t charged) {
+    elf_strtab_free(st);
+    budget_release(BUDGET_EXPORT, charged);
+}
+
+static void write_name(const char *name, const unsigned long int number, FILE *f) {
+    if (name != NULL)
+        fprintf(f, "\"%s\"", name);
+    else
+        fprintf(f, "\"0x%lx\"", number);
+}
+
+static unsigned char find_section(const elf_reader_t *r, const elf_ehdr_t *eh, const unsigned long int type, elf_shdr_t *sh) {
+    unsigned int i;
+
+    for (i = 0; i < eh->shnum; i++) {
+        if (elf_read_shdr(r, eh, i, sh) == 0 && sh->type == type)
+            return 0;
+    }
+    return 1;
+}
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE  /* for SEEK_DATA and SEEK_HOLE */
+
 /* C89 standard */
 #include <ctype.h>
 #include <stddef.h>
@@ -5,7 +7,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* POSIX standard */
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "abuf.h"
+#include "budget.h"
+#include "elf_parse.h"
+#include "overlay.h"
 
 #include "file.h"
 
@@ -15,7 +27,8 @@
 #define CHAR_TO_HEX_UPPER(c) ((((c) & 0xF0) >> 4) < '\xA' ? ((((c) & 0xF0) >> 4) + '0') : ((((c) & 0xF0) >> 4) + 'A' - '\xA'))
 #define CHAR_TO_HEX_LOWER(c) (((c) & 0x0F) < '\xA' ? (((c) & 0x0F) + '0') : (((c) & 0x0F) + 'A' - '\xA'))
 
-#define FILE_TAG_INIT   {0, 0, NULL}
+#define EXTENTS_INITIAL_SIZE  16
+#define WARM_CHUNK_SIZE       (64 * 1024)
 
 /*
 static const char STR000[] = "ELF magic number: 0x7F454c46 (0x7F E L F)\n";
@@ -45,61 +58,263 @@ static const char STR005[] = "?\n";
 static const char STR006[] = "Reserved padding bytes (not currently used)\n";
 */
 
-/* -------------------- STATIC VARIABLES -------------------- */
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a data extent [start, end), everything outside extents is a hole */
+typedef struct file_extent_tag {
+    long int start;
+    long int end;
+} file_extent_t;
 
-/* struct for file data */
-static struct file_tag {
+/* struct for file data (nothing changes after file_open(), except the overlay) */
+struct file_tag {
+    int fd;
     long int len;
-    unsigned char is_open;
-    FILE *h;
-} file = FILE_TAG_INIT;
+    char *path;
+    file_extent_t *extents;  /* sorted, non overlapping */
+    size_t n_extents;
+    size_t extents_size;
+    elf_reader_t original;  /* reads bytes of the file without edits (used by the overlay) */
+    overlay_t *overlay;
+};
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Discovers data extents of f with lseek(SEEK_DATA/SEEK_HOLE)
+ * If the filesystem does not support it, the whole file is a single extent
+ * If successful returns 0, else 1
+ */
+static unsigned char build_extents(file_t *f);
+
+/*
+ * Appends extent [start, end) to f->extents
+ * If successful returns 0, else 1
+ */
+static unsigned char add_extent(file_t *f, const long int start, const long int end);
+
+/* Returns index of the first extent of f that ends after pos (f->n_extents if none) */
+static size_t find_extent(const file_t *f, const long int pos);
+
+/* Reads bytes of the file (ctx) skipping holes, without applying the overlay */
+static size_t read_original(void *ctx, void *buf, const size_t len, const long int off);
+
+/* Reads callback used by file_get_reader() */
+static size_t reader_read(void *ctx, void *buf, const size_t len, const long int off);
 
 
 /* -------------------- GLOBAL FUNCTIONS -------------------- */
 
 /* OPEN / CLOSE / GETTERS */
 
-unsigned char file_open(const char *__filename, const char *__modes) {
-    file.h = fopen(__filename, __modes);
-    if (file.h == NULL) {
+unsigned char file_open(file_t **f, const char *path) {
+    file_t *new_f;
+    off_t len;
+
+    if ((new_f = calloc(1, sizeof(*new_f))) == NULL)
+        return 1;
+    if ((new_f->fd = open(path, O_RDONLY)) == -1) {
+        free(new_f);
         return 1;
     }
-    file.is_open = 1;
 
-    if (fseek(file.h, 0, SEEK_END) == -1)
-        return 1;
-    if ((file.len = file_tell()) == -1)
+    /* file_close() frees whatever was allocated before an error */
+    len = lseek(new_f->fd, 0, SEEK_END);
+    new_f->len = (long int)len;
+    if (len == -1 || (new_f->path = malloc(strlen(path) + 1)) == NULL) {
+        file_close(new_f);
         return 1;
-    if (fseek(file.h, 0, SEEK_SET) == -1)
+    }
+    strcpy(new_f->path, path);
+
+    new_f->original.read = read_original;
+    new_f->original.ctx = new_f;
+    new_f->original.len = new_f->len;
+    if (build_extents(new_f) == 1 || overlay_new(&new_f->overlay, &new_f->original) == 1) {
+        file_close(new_f);
         return 1;
+    }
 
+    *f = new_f;
     return 0;
 }
 
-unsigned char file_close(void) {
-    if (fclose(file.h) == EOF)
+unsigned char file_close(file_t *f) {
+    int status;
+
+    overlay_free(f->overlay);
+    free(f->path);
+    free(f->extents);
+    budget_release(BUDGET_EXTENTS, f->extents_size * sizeof(*f->extents));
+    status = close(f->fd);
+    free(f);
+    return status == -1;
+}
+
+long int file_size(const file_t *f) {
+    return f->len;
+}
+
+const char *file_path(const file_t *f) {
+    return f->path;
+}
+
+overlay_t *file_overlay(file_t *f) {
+    return f->overlay;
+}
+
+unsigned char file_get_id(const file_t *f, file_id_t *id) {
+    struct stat st;
+
+    if (fstat(f->fd, &st) == -1)
         return 1;
-    file.is_open = 0;
+    id->dev = (unsigned long int)st.st_dev;
+    id->ino = (unsigned long int)st.st_ino;
+    id->size = (long int)st.st_size;
+    id->mtime_sec = (long int)st.st_mtim.tv_sec;
+    id->mtime_nsec = (long int)st.st_mtim.tv_nsec;
     return 0;
 }
 
-unsigned char is_file_open(void) {
-    return file.is_open;
+/* VIEWS */
+
+void file_root_view(file_t *f, view_t *v) {
+    v->file = f;
+    v->window = NULL;
+    v->base = 0;
+    v->len = f->len;
+    strncpy(v->name, f->path, VIEW_NAME_SIZE - 1);
+    v->name[VIEW_NAME_SIZE - 1] = '\0';
+    v->read = NULL;
+    v->ctx = NULL;
+}
+
+void file_get_reader(elf_reader_t *r, const view_t *v) {
+    r->read = reader_read;
+    r->ctx = (void *)v;
+    r->len = v->len;
 }
 
 /* READ */
 
-size_t file_append_bytes(abuf_t *ab, const size_t len) {
+size_t file_read_at(const file_t *f, void *buf, const size_t len, const long int off) {
+    size_t done;
+
+    done = read_original((void *)f, buf, len, off);
+    overlay_apply(f->overlay, buf, done, off);
+    return done;
+}
+
+/* WINDOW */
+
+unsigned char file_window_open(file_window_t *w, const file_t *f, const size_t size) {
+    long int page_size;
+    void *map;
+
+    w->file = f;
+    w->map = NULL;
+    w->start = 0;
+    w->end = 0;
+    w->size = 0;
+
+    /* The window always covers whole pages */
+    page_size = sysconf(_SC_PAGESIZE);
+    if (f->len == 0 || page_size <= 0 || size < (size_t)page_size)
+        return 1;
+    if (budget_reserve(BUDGET_WINDOW, size) == 1)
+        return 1;
+    if ((map = mmap(NULL, (size_t)f->len, PROT_READ, MAP_SHARED, f->fd, 0)) == MAP_FAILED) {
+        budget_release(BUDGET_WINDOW, size);
+        return 1;
+    }
+
+    w->map = map;
+    w->size = size - size % (size_t)page_size;
+    budget_release(BUDGET_WINDOW, size - w->size);
+    return 0;
+}
+
+size_t file_window_read(file_window_t *w, void *buf, const size_t len, const long int off) {
+    long int page_size, start, end, from;
+    size_t n;
+
+    if (w->map == NULL)
+        return file_read_at(w->file, buf, len, off);
+    if (off < 0 || off >= w->file->len)
+        return 0;
+    n = (long int)len < w->file->len - off ? len : (size_t)(w->file->len - off);
+    if (n > w->size)
+        n = w->size;
+
+    /* Slide so that the read lands in the middle of the window, releasing the pages left behind */
+    if (off < w->start || off + (long int)n > w->end) {
+        page_size = sysconf(_SC_PAGESIZE);
+        start = off + (long int)n / 2 - (long int)w->size / 2;
+        start = start < 0 ? 0 : start - start % page_size;
+        end = start + (long int)w->size;
+        if (end > w->file->len)
+            end = w->file->len;
+        if (w->start < start)
+            madvise(w->map + w->start, (size_t)((w->end < start ? w->end : start) - w->start), MADV_DONTNEED);
+        if (w->end > end) {
+            from = w->start > end ? w->start : end;
+            madvise(w->map + from, (size_t)(w->end - from), MADV_DONTNEED);
+        }
+        w->start = start;
+        w->end = end;
+    }
+
+    memcpy(buf, w->map + off, n);
+    overlay_apply(w->file->overlay, buf, n, off);
+    return n;
+}
+
+void file_window_close(file_window_t *w) {
+    if (w->map != NULL) {
+        munmap(w->map, (size_t)w->file->len);
+        budget_release(BUDGET_WINDOW, w->size);
+    }
+    w->map = NULL;
+    w->size = 0;
+}
+
+size_t file_warm(const file_t *f, const long int off, const size_t len) {
+    char chunk[WARM_CHUNK_SIZE];
+    size_t done, n;
+
+    if (off < 0 || off >= f->len)
+        return 0;
+    posix_fadvise(f->fd, off, (off_t)len, POSIX_FADV_WILLNEED);
+
+    /* Network filesystems may ignore the advice, reading is what really fills the page cache */
+    for (done = 0; done < len; done += n) {
+        n = len - done < WARM_CHUNK_SIZE ? len - done : WARM_CHUNK_SIZE;
+        if ((n = read_original((void *)f, chunk, n, off + (long int)done)) == 0)
+            break;
+    }
+    return done;
+}
+
+size_t view_read(const view_t *v, void *buf, const size_t len, const long int pos) {
+    if (pos < 0 || pos >= v->len)
+        return 0;
+    if (v->read != NULL)
+        return v->read(v->ctx, buf, (long int)len < v->len - pos ? len : (size_t)(v->len - pos), pos);
+    if (v->window != NULL)
+        return file_window_read(v->window, buf, (long int)len < v->len - pos ? len : (size_t)(v->len - pos), v->base + pos);
+    return file_read_at(v->file, buf, (long int)len < v->len - pos ? len : (size_t)(v->len - pos), v->base + pos);
+}
+
+size_t file_append_bytes(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
     size_t n_bytes_read;
     char *temp;
 
     if ((temp = malloc(len)) == NULL)
         return 0;
-    
-    if ((n_bytes_read = fread(temp, 1, len, file.h)) < len && !feof(file.h)) {
-        free(temp);
-        return 0;
-    }
+
+    /* Never read past the end of the view */
+    n_bytes_read = view_read(v, temp, len, pos);
 
     if (ab_append(ab, temp, n_bytes_read)) {
         free(temp);
@@ -111,13 +326,13 @@ size_t file_append_bytes(abuf_t *ab, const size_t len) {
     return n_bytes_read;
 }
 
-size_t file_append_hexs(abuf_t *ab, const size_t len) {
+size_t file_append_hexs(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
     unsigned int i;
     size_t n_chars_read;
     abuf_t temp = ABUF_INIT;
     char *temp_long;
 
-    n_chars_read = file_append_bytes(&temp, len);
+    n_chars_read = file_append_bytes(&temp, v, pos, len);
     if (n_chars_read == 0) {
         ab_free(&temp);
         return 0;
@@ -145,13 +360,13 @@ size_t file_append_hexs(abuf_t *ab, const size_t len) {
     return n_chars_read;
 }
 
-size_t file_append_formatted_chars(abuf_t *ab, const size_t len) {
+size_t file_append_formatted_chars(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
     unsigned int i;
     size_t n_chars_read;
     abuf_t temp = ABUF_INIT;
     char *temp_long;
 
-    n_chars_read = file_append_bytes(&temp, len);
+    n_chars_read = file_append_bytes(&temp, v, pos, len);
     if (n_chars_read == 0) {
         ab_free(&temp);
         return 0;
@@ -182,12 +397,12 @@ size_t file_append_formatted_chars(abuf_t *ab, const size_t len) {
     return n_chars_read;
 }
 
-size_t file_append_chars(abuf_t *ab, const size_t len) {
+size_t file_append_chars(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
     unsigned int i;
     size_t n_chars_read;
     abuf_t temp = ABUF_INIT;
 
-    n_chars_read = file_append_bytes(&temp, len);
+    n_chars_read = file_append_bytes(&temp, v, pos, len);
     if (n_chars_read == 0) {
         ab_free(&temp);
         return 0;
@@ -207,48 +422,148 @@ size_t file_append_chars(abuf_t *ab, const size_t len) {
     return n_chars_read;
 }
 
-/* MOVE */
+/* EXTENTS */
 
-unsigned char file_move(const long int bytes) {
-    if (fseek(file.h, bytes, SEEK_CUR) == -1) {
-        if (fseek(file.h, 0, SEEK_SET) == -1)
+unsigned char file_next_extent(const view_t *v, const long int pos, long int *start, long int *end) {
+    const file_t *f;
+    long int abs_pos, view_end;
+    size_t i;
+
+    if (v->read != NULL) {
+        if (pos >= v->len)
             return 1;
+        *start = pos < 0 ? 0 : pos;
+        *end = v->len;
         return 0;
     }
+
+    f = v->file;
+    abs_pos = v->base + pos;
+    view_end = v->base + v->len;
+    if ((i = find_extent(f, abs_pos)) >= f->n_extents || f->extents[i].start >= view_end)
+        return 1;
+    *start = (f->extents[i].start > abs_pos ? f->extents[i].start : abs_pos) - v->base;
+    *end = (f->extents[i].end < view_end ? f->extents[i].end : view_end) - v->base;
     return 0;
 }
 
-unsigned char file_will_be_end(const long int bytes) {
-    long int pos;
-    unsigned char will_be_end;
+size_t file_n_extents(const file_t *f) {
+    return f->n_extents;
+}
 
-    if (fseek(file.h, bytes, SEEK_CUR) == -1)
-        return 2;
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* EXTENTS */
+
+static unsigned char build_extents(file_t *f) {
+    off_t start, end;
+
+    start = 0;
+    while (start < f->len) {
+        if ((start = lseek(f->fd, start, SEEK_DATA)) == -1) {
+            if (errno == ENXIO)  /* no data after start */
+                break;
+            f->n_extents = 0;  /* SEEK_DATA not supported: whole file is data */
+            return f->len > 0 ? add_extent(f, 0, f->len) : 0;
+        }
+        if ((end = lseek(f->fd, start, SEEK_HOLE)) == -1) {
+            f->n_extents = 0;
+            return f->len > 0 ? add_extent(f, 0, f->len) : 0;
+        }
+        if (add_extent(f, (long int)start, (long int)end) == 1) {
+            /* Over the memory budget: the rest of the file is read as data (holes are still zeros) */
+            if (f->n_extents == 0)
+                return 1;
+            f->extents[f->n_extents - 1].end = f->len;
+            return 0;
+        }
+        start = end;
+    }
+    return 0;
+}
 
-    if ((pos = file_tell()) == -1)
-        return 2;
-    if (pos < file.len)
-        will_be_end = 0;
-    else
-        will_be_end = 1;
-    
-    if (fseek(file.h, -1 * bytes, SEEK_CUR) == -1)
-        return 2;
+static unsigned char add_extent(file_t *f, const long int start, const long int end) {
+    file_extent_t *new_extents;
+    size_t new_size;
+
+    if (f->n_extents == f->extents_size) {
+        new_size = f->extents_size == 0 ? EXTENTS_INITIAL_SIZE : f->extents_size * 2;
+        if (budget_reserve(BUDGET_EXTENTS, (new_size - f->extents_size) * sizeof(*new_extents)) == 1)
+            return 1;
+        if ((new_extents = realloc(f->extents, new_size * sizeof(*new_extents))) == NULL) {
+            budget_release(BUDGET_EXTENTS, (new_size - f->extents_size) * sizeof(*new_extents));
+            return 1;
+        }
+        f->extents = new_extents;
+        f->extents_size = new_size;
+    }
+    f->extents[f->n_extents].start = start;
+    f->extents[f->n_extents].end = end;
+    f->n_extents++;
+    return 0;
+}
+
+static size_t find_extent(const file_t *f, const long int pos) {
+    size_t lo, hi, mid;
 
-    return will_be_end;
+    /* Binary search of the first extent with end > pos */
+    lo = 0;
+    hi = f->n_extents;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (f->extents[mid].end > pos)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
 }
 
-long int file_tell(void) {
+/* READERS */
+
+static size_t read_original(void *ctx, void *buf, const size_t len, const long int off) {
+    const file_t *f;
+    size_t i, n, done, chunk;
     long int pos;
-    if ((pos = ftell(file.h)) < 0)
-        return -1;
-    return pos;
+    ssize_t nread;
+
+    f = (const file_t *)ctx;
+    if (off < 0 || off >= f->len)
+        return 0;
+    n = len;
+    if ((long int)n > f->len - off)
+        n = (size_t)(f->len - off);
+
+    done = 0;
+    i = find_extent(f, off);
+    while (done < n) {
+        pos = off + (long int)done;
+
+        /* Hole: no need to ask the kernel for zeros */
+        if (i >= f->n_extents || f->extents[i].start > pos) {
+            chunk = n - done;
+            if (i < f->n_extents && (long int)chunk > f->extents[i].start - pos)
+                chunk = (size_t)(f->extents[i].start - pos);
+            memset((char *)buf + done, 0, chunk);
+            done += chunk;
+            continue;
+        }
+
+        /* Data: pread() doesn't use the file offset, so concurrent readers never race */
+        chunk = n - done;
+        if ((long int)chunk > f->extents[i].end - pos)
+            chunk = (size_t)(f->extents[i].end - pos);
+        if ((nread = pread(f->fd, (char *)buf + done, chunk, pos)) <= 0)
+            break;
+        done += (size_t)nread;
+        if (pos + nread >= f->extents[i].end)
+            i++;
+    }
+    return done;
 }
 
-unsigned char file_seek_set(const long bytes) {
-    if (fseek(file.h, bytes, SEEK_SET) == -1)
-        return 1;
-    return 0;
+static size_t reader_read(void *ctx, void *buf, const size_t len, const long int off) {
+    return view_read((const view_t *)ctx, buf, len, off);
 }
 
 /* TAbLE */
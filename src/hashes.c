@@ -0,0 +1,688 @@
+#define _XOPEN_SOURCE 700  /* for snprintf, realpath and clock_gettime */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX standard */
+#include <elf.h>
+#include <sys/stat.h>
+
+#include "budget.h"
+#include "digest.h"
+#include "elf_parse.h"
+#include "file.h"
+#include "overlay.h"
+#include "pool.h"
+
+#include "hashes.h"
+
+
+#define HASHES_CACHE_SIZE  16
+#define HASH_CHUNK_SIZE    (256 * 1024)
+#define HASH_SMALL_SIZE    4096  /* chunk used when HASH_CHUNK_SIZE doesn't fit inside the memory budget */
+#define ROW_NAME_SIZE      64
+#define BUILD_ID_MAX_SIZE  64
+#define DEBUGLINK_SIZE     256
+#define DEBUG_PATH_SIZE    4096
+#define LINE_SIZE          512
+
+#define DEBUG_DIR  "/usr/lib/debug"  /* global debug directory (as searched by gdb) */
+
+#define N_CHECK_LINES  4  /* build-id, debuglink, debug file, empty line */
+
+#define ROW_FILE     0
+#define ROW_SEGMENT  1
+#define ROW_SECTION  2
+#define ROW_DEBUG    3
+
+#define HASH_NONE    0  /* nothing to hash (SHT_NOBITS, empty segment) */
+#define HASH_DONE    1
+#define HASH_FAILED  2  /* outside the file, or no memory */
+
+#define CHECK_NONE      0  /* nothing to check */
+#define CHECK_MATCH     1
+#define CHECK_MISMATCH  2
+#define CHECK_NO_DEBUG  3  /* no debug file found */
+#define CHECK_NO_ID     4  /* the debug file has no build-id */
+
+#define HEADER_LINE  "KIND      IDX  NAME                      OFFSET      SIZE        CRC32     SHA-256"
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a hashed range (a row of the table) */
+typedef struct hashes_row_tag {
+    unsigned char kind;
+    unsigned char status;
+    long int idx;  /* index of the segment or section, -1 otherwise */
+    char name[ROW_NAME_SIZE];
+    long int off;  /* relative to the view (of the debug file for ROW_DEBUG) */
+    unsigned long int size;
+    unsigned long int crc32;
+    unsigned char sha256[DIGEST_SHA256_SIZE];
+} hashes_row_t;
+
+/* struct for what a table was computed from (a table is reused only if all of it is the same) */
+typedef struct hashes_key_tag {
+    file_id_t id;
+    long int base;
+    long int len;
+    unsigned long int generation;  /* of the overlay */
+} hashes_key_t;
+
+/* struct for a hash table */
+struct hashes_table_tag {
+    hashes_key_t key;
+    unsigned long int last_use;
+    size_t charged;  /* bytes charged to BUDGET_HASHES */
+    hashes_row_t *rows;
+    size_t n_rows;
+    unsigned char build_id[BUILD_ID_MAX_SIZE];
+    size_t build_id_len;
+    unsigned char debug_build_id[BUILD_ID_MAX_SIZE];
+    size_t debug_build_id_len;
+    unsigned char build_id_check;
+    char debuglink[DEBUGLINK_SIZE];  /* "" if there's no .gnu_debuglink */
+    unsigned long int debuglink_crc;
+    unsigned char debuglink_check;
+    char debug_path[DEBUG_PATH_SIZE];  /* "" if no debug file was found */
+    unsigned long int bytes;  /* hashed */
+    long int elapsed_ms;
+    unsigned int n_workers;
+};
+
+/* struct for the hashing of a row (executed by a worker) */
+typedef struct hashes_task_tag {
+    view_t view;  /* without window, so that reads are reentrant */
+    hashes_row_t *row;
+} hashes_task_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing hashes data */
+static struct hashes_tag {
+    hashes_table_t *cache[HASHES_CACHE_SIZE];
+    size_t n_cached;
+    unsigned long int clock;  /* incremented by every lookup (for LRU eviction) */
+    unsigned char is_pool_started;  /* 1 if the pool was started by hashes_compute() */
+} hashes;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Returns the cached table computed from key, or NULL */
+static hashes_table_t *cache_find(const hashes_key_t *key);
+
+/*
+ * Charges t to the memory budget (evicting least recently used tables if needed) and caches it
+ * If successful returns 0, else 1
+ */
+static unsigned char cache_add(hashes_table_t *t);
+
+/* Removes the i-th cached table, freeing it */
+static void cache_remove(const size_t i);
+
+/*
+ * Appends to t a row for every segment and section of the ELF file read through r, and finds build-id and
+ * .gnu_debuglink (does nothing if r doesn't contain an ELF file)
+ * If successful returns 0, else 1
+ */
+static unsigned char add_elf_rows(hashes_table_t *t, const elf_reader_t *r);
+
+/* Reads build-id of the ELF file read through r from its note sections (or segments) into id (like read_build_id()) */
+static void find_build_id(const elf_reader_t *r, unsigned char *id, size_t *len);
+
+/* Reads build-id from notes inside [off, off + size) into id (sets *len, which stays 0 if there's none) */
+static void read_build_id(const elf_reader_t *r, const elf_ehdr_t *eh, const long int off, const unsigned long int size,
+                          unsigned char *id, size_t *len);
+
+/* Reads file name and CRC-32 of the .gnu_debuglink section sh into t */
+static void read_debuglink(hashes_table_t *t, const elf_reader_t *r, const elf_ehdr_t *eh, const elf_shdr_t *sh);
+
+/*
+ * Looks for the debug file of the file at path, by build-id and then by .gnu_debuglink (like gdb)
+ * If found returns 0 and sets t->debug_path, else 1
+ */
+static unsigned char find_debug_file(hashes_table_t *t, const char *path);
+
+/* If path is a readable regular file different from the file at self returns 1, else 0 */
+static unsigned char is_candidate(const char *path, const char *self);
+
+/* Hashes the range of the row of a hashes_task_t (executed by workers) */
+static void hash_row(void *arg);
+
+/* Sorts tasks by decreasing size, so that big rows start first and small ones fill the gaps */
+static int compare_tasks(const void *a, const void *b);
+
+/* Appends "xx" for every byte of bytes to buf (which must have room for 2 * len + 1 characters) */
+static void to_hex(char *buf, const unsigned char *bytes, const size_t len);
+
+/* Returns milliseconds elapsed from *from to *to */
+static long int elapsed_ms(const struct timespec *from, const struct timespec *to);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char hashes_compute(const view_t *v, const hashes_table_t **t) {
+    static elf_reader_t reader = ELF_READER_INIT;
+    static elf_reader_t debug_reader = ELF_READER_INIT;
+    static view_t view = VIEW_INIT;
+    static view_t debug_view = VIEW_INIT;
+    hashes_table_t *new_t;
+    hashes_task_t *tasks;
+    hashes_key_t key;
+    hashes_row_t *row;
+    file_t *debug_file;
+    struct timespec start, end;
+    size_t i;
+
+    /* Cache hit */
+    memset(&key, 0, sizeof(key));
+    if (file_get_id(v->file, &key.id) == 1)
+        return 1;
+    key.base = v->base;
+    key.len = v->len;
+    key.generation = overlay_generation(file_overlay(v->file));
+    if ((new_t = cache_find(&key)) != NULL) {
+        new_t->last_use = ++hashes.clock;
+        *t = new_t;
+        return 0;
+    }
+
+    if ((new_t = calloc(1, sizeof(*new_t))) == NULL)
+        return 1;
+    new_t->key = key;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* Workers read through pread, the window of v belongs to the caller */
+    view = *v;
+    view.window = NULL;
+    file_get_reader(&reader, &view);
+
+    /* The whole view, then segments and sections */
+    if ((new_t->rows = malloc(sizeof(*new_t->rows))) == NULL) {
+        free(new_t);
+        return 1;
+    }
+    row = &new_t->rows[new_t->n_rows++];
+    memset(row, 0, sizeof(*row));
+    row->kind = ROW_FILE;
+    row->idx = -1;
+    strncpy(row->name, view.name, ROW_NAME_SIZE - 1);
+    row->size = (unsigned long int)view.len;
+    row->status = HASH_DONE;
+    if (add_elf_rows(new_t, &reader) == 1) {
+        free(new_t->rows);
+        free(new_t);
+        return 1;
+    }
+
+    /* The separate debug file is hashed as a whole, it's what .gnu_debuglink's CRC-32 is computed on */
+    debug_file = NULL;
+    if (find_debug_file(new_t, file_path(v->file)) == 0 && file_open(&debug_file, new_t->debug_path) == 0) {
+        file_root_view(debug_file, &debug_view);
+        file_get_reader(&debug_reader, &debug_view);
+        find_build_id(&debug_reader, new_t->debug_build_id, &new_t->debug_build_id_len);
+        row = &new_t->rows[new_t->n_rows++];
+        memset(row, 0, sizeof(*row));
+        row->kind = ROW_DEBUG;
+        row->idx = -1;
+        strncpy(row->name, new_t->debug_path, ROW_NAME_SIZE - 1);
+        row->size = (unsigned long int)debug_view.len;
+        row->status = HASH_DONE;
+    }
+
+    /* Rows are independent: one task each, on the pool (or right here if it can't be used) */
+    if ((tasks = malloc(new_t->n_rows * sizeof(*tasks))) == NULL) {
+        if (debug_file != NULL)
+            file_close(debug_file);
+        free(new_t->rows);
+        free(new_t);
+        return 1;
+    }
+    for (i = 0; i < new_t->n_rows; i++) {
+        tasks[i].view = new_t->rows[i].kind == ROW_DEBUG ? debug_view : view;
+        tasks[i].row = &new_t->rows[i];
+    }
+    qsort(tasks, new_t->n_rows, sizeof(*tasks), compare_tasks);
+
+    if (pool_n_workers() == 0 && pool_start(0) == 0)
+        hashes.is_pool_started = 1;
+    for (i = 0; i < new_t->n_rows; i++) {
+        if (pool_submit(hash_row, &tasks[i]) == 1)
+            hash_row(&tasks[i]);
+    }
+    pool_wait();
+    new_t->n_workers = pool_n_workers() > 0 ? pool_n_workers() : 1;
+    free(tasks);
+
+    /* Checks */
+    for (i = 0; i < new_t->n_rows; i++) {
+        row = &new_t->rows[i];
+        if (row->status == HASH_DONE)
+            new_t->bytes += row->size;
+        if (row->kind != ROW_DEBUG)
+            continue;
+        if (new_t->debuglink[0] != '\0' && row->status == HASH_DONE)
+            new_t->debuglink_check = row->crc32 == new_t->debuglink_crc ? CHECK_MATCH : CHECK_MISMATCH;
+    }
+    if (new_t->debuglink[0] != '\0' && new_t->debuglink_check == CHECK_NONE)
+        new_t->debuglink_check = CHECK_NO_DEBUG;
+    if (new_t->build_id_len > 0) {
+        if (debug_file == NULL)
+            new_t->build_id_check = CHECK_NO_DEBUG;
+        else if (new_t->debug_build_id_len == 0)
+            new_t->build_id_check = CHECK_NO_ID;
+        else if (new_t->debug_build_id_len == new_t->build_id_len &&
+                 memcmp(new_t->debug_build_id, new_t->build_id, new_t->build_id_len) == 0)
+            new_t->build_id_check = CHECK_MATCH;
+        else
+            new_t->build_id_check = CHECK_MISMATCH;
+    }
+    if (debug_file != NULL)
+        file_close(debug_file);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    new_t->elapsed_ms = elapsed_ms(&start, &end);
+
+    if (cache_add(new_t) == 1) {
+        free(new_t->rows);
+        free(new_t);
+        return 1;
+    }
+    new_t->last_use = ++hashes.clock;
+    *t = new_t;
+    return 0;
+}
+
+size_t hashes_n_lines(const hashes_table_t *t) {
+    return N_CHECK_LINES + 1 + t->n_rows;
+}
+
+void hashes_line(const hashes_table_t *t, const size_t i, char *buf, const size_t size) {
+    static const char *const KIND_NAMES[] = {"file", "segment", "section", "debug"};
+    char line[LINE_SIZE];
+    char id[2 * BUILD_ID_MAX_SIZE + 1];
+    char debug_id[2 * BUILD_ID_MAX_SIZE + 1];
+    char idx[16];
+    char crc[16];
+    char sha[2 * DIGEST_SHA256_SIZE + 1];
+    const hashes_row_t *row;
+
+    line[0] = '\0';
+    switch (i) {
+        case 0:
+            to_hex(id, t->build_id, t->build_id_len);
+            to_hex(debug_id, t->debug_build_id, t->debug_build_id_len);
+            if (t->build_id_len == 0)
+                strcpy(line, "build-id:   none");
+            else if (t->build_id_check == CHECK_MATCH)
+                snprintf(line, LINE_SIZE, "build-id:   %s  matches the debug file", id);
+            else if (t->build_id_check == CHECK_MISMATCH)
+                snprintf(line, LINE_SIZE, "build-id:   %s  MISMATCH (debug file has %s)", id, debug_id);
+            else if (t->build_id_check == CHECK_NO_ID)
+                snprintf(line, LINE_SIZE, "build-id:   %s  not checked (debug file has no build-id)", id);
+            else
+                snprintf(line, LINE_SIZE, "build-id:   %s  not checked (no debug file)", id);
+            break;
+
+        case 1:
+            if (t->debuglink[0] == '\0')
+                strcpy(line, "debuglink:  none");
+            else if (t->debuglink_check == CHECK_MATCH)
+                snprintf(line, LINE_SIZE, "debuglink:  %.128s crc32 %08lx  matches the debug file", t->debuglink, t->debuglink_crc);
+            else if (t->debuglink_check == CHECK_MISMATCH)
+                snprintf(line, LINE_SIZE, "debuglink:  %.128s crc32 %08lx  MISMATCH (debug file has %08lx)", t->debuglink,
+                         t->debuglink_crc, t->rows[t->n_rows - 1].crc32);
+            else
+                snprintf(line, LINE_SIZE, "debuglink:  %.128s crc32 %08lx  not checked (no debug file)", t->debuglink,
+                         t->debuglink_crc);
+            break;
+
+        case 2:
+            snprintf(line, LINE_SIZE, "debug file: %.256s", t->debug_path[0] != '\0' ? t->debug_path : "not found");
+            break;
+
+        case 3:
+            break;
+
+        case N_CHECK_LINES:
+            strcpy(line, HEADER_LINE);
+            break;
+
+        default:
+            if (i - N_CHECK_LINES - 1 >= t->n_rows)
+                break;
+            row = &t->rows[i - N_CHECK_LINES - 1];
+            strcpy(idx, "-");
+            if (row->idx >= 0)
+                sprintf(idx, "%ld", row->idx);
+            strcpy(crc, "-");
+            strcpy(sha, "-");
+            if (row->status == HASH_DONE) {
+                sprintf(crc, "%08lx", row->crc32);
+                to_hex(sha, row->sha256, DIGEST_SHA256_SIZE);
+            } else if (row->status == HASH_FAILED)
+                strcpy(crc, "error");
+            snprintf(line, LINE_SIZE, "%-8s %4s  %-24.24s  0x%08lx  0x%08lx  %-8s  %s", KIND_NAMES[row->kind], idx, row->name,
+                     row->off, row->size, crc, sha);
+            break;
+    }
+
+    strncpy(buf, line, size - 1);
+    buf[size - 1] = '\0';
+}
+
+void hashes_summary(const hashes_table_t *t, char *buf, const size_t size) {
+    char bytes[BUDGET_SIZE_STR_SIZE];
+
+    budget_format_size(bytes, t->bytes);
+    snprintf(buf, size, "hashed %s in %ld ms on %u worker(s)", bytes, t->elapsed_ms, t->n_workers);
+}
+
+unsigned char hashes_has_mismatch(const hashes_table_t *t) {
+    return t->build_id_check == CHECK_MISMATCH || t->debuglink_check == CHECK_MISMATCH;
+}
+
+void hashes_free(void) {
+    while (hashes.n_cached > 0)
+        cache_remove(hashes.n_cached - 1);
+    if (hashes.is_pool_started == 1) {
+        pool_stop();
+        hashes.is_pool_started = 0;
+    }
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* CACHE */
+
+static hashes_table_t *cache_find(const hashes_key_t *key) {
+    size_t i;
+
+    for (i = 0; i < hashes.n_cached; i++) {
+        if (memcmp(&hashes.cache[i]->key, key, sizeof(*key)) == 0)
+            return hashes.cache[i];
+    }
+    return NULL;
+}
+
+static unsigned char cache_add(hashes_table_t *t) {
+    size_t i, lru;
+
+    t->charged = sizeof(*t) + t->n_rows * sizeof(*t->rows);
+    for (;;) {
+        if (hashes.n_cached < HASHES_CACHE_SIZE && budget_reserve(BUDGET_HASHES, t->charged) == 0)
+            break;
+        if (hashes.n_cached == 0)
+            return 1;
+        lru = 0;
+        for (i = 1; i < hashes.n_cached; i++) {
+            if (hashes.cache[i]->last_use < hashes.cache[lru]->last_use)
+                lru = i;
+        }
+        cache_remove(lru);
+    }
+    hashes.cache[hashes.n_cached++] = t;
+    return 0;
+}
+
+static void cache_remove(const size_t i) {
+    hashes_table_t *t;
+
+    t = hashes.cache[i];
+    budget_release(BUDGET_HASHES, t->charged);
+    free(t->rows);
+    free(t);
+    hashes.cache[i] = hashes.cache[--hashes.n_cached];
+}
+
+/* ELF */
+
+static unsigned char add_elf_rows(hashes_table_t *t, const elf_reader_t *r) {
+    elf_ehdr_t eh;
+    elf_phdr_t ph;
+    elf_shdr_t sh, strtab;
+    hashes_row_t *rows, *row;
+    const char *name;
+    unsigned char has_names;
+    unsigned int i;
+
+    if (elf_read_ehdr(r, &eh) == 1)
+        return 0;
+
+    /* One more row is left for the debug file */
+    if ((rows = realloc(t->rows, (t->n_rows + eh.phnum + eh.shnum + 1) * sizeof(*rows))) == NULL)
+        return 1;
+    t->rows = rows;
+
+    for (i = 0; i < eh.phnum; i++) {
+        if (elf_read_phdr(r, &eh, i, &ph) == 1)
+            break;
+        row = &t->rows[t->n_rows++];
+        memset(row, 0, sizeof(*row));
+        row->kind = ROW_SEGMENT;
+        row->idx = (long int)i;
+        if ((name = elf_phdr_type_name(ph.type)) != NULL)
+            strcpy(row->name, name);
+        else
+            sprintf(row->name, "0x%lx", ph.type);
+        row->off = ph.offset;
+        row->size = ph.filesz;
+        row->status = ph.filesz == 0 ? HASH_NONE : HASH_DONE;
+        if (ph.type == PT_NOTE && t->build_id_len == 0)
+            read_build_id(r, &eh, ph.offset, ph.filesz, t->build_id, &t->build_id_len);
+    }
+
+    has_names = eh.shstrndx < eh.shnum && elf_read_shdr(r, &eh, eh.shstrndx, &strtab) == 0;
+    for (i = 0; i < eh.shnum; i++) {
+        if (elf_read_shdr(r, &eh, i, &sh) == 1)
+            break;
+        row = &t->rows[t->n_rows++];
+        memset(row, 0, sizeof(*row));
+        row->kind = ROW_SECTION;
+        row->idx = (long int)i;
+        if (has_names == 0 || elf_read_str(r, strtab.offset + (long int)sh.name, row->name, ROW_NAME_SIZE) == 1)
+            row->name[0] = '\0';
+        row->off = sh.offset;
+        row->size = sh.size;
+        row->status = sh.type == SHT_NOBITS || sh.type == SHT_NULL || sh.size == 0 ? HASH_NONE : HASH_DONE;
+        if (sh.type == SHT_NOTE && t->build_id_len == 0)
+            read_build_id(r, &eh, sh.offset, sh.size, t->build_id, &t->build_id_len);
+        if (strcmp(row->name, ".gnu_debuglink") == 0)
+            read_debuglink(t, r, &eh, &sh);
+    }
+    return 0;
+}
+
+static void find_build_id(const elf_reader_t *r, unsigned char *id, size_t *len) {
+    elf_ehdr_t eh;
+    elf_shdr_t sh;
+    elf_phdr_t ph;
+    unsigned int i;
+
+    if (elf_read_ehdr(r, &eh) == 1)
+        return;
+    for (i = 0; i < eh.shnum && *len == 0; i++) {
+        if (elf_read_shdr(r, &eh, i, &sh) == 0 && sh.type == SHT_NOTE)
+            read_build_id(r, &eh, sh.offset, sh.size, id, len);
+    }
+    for (i = 0; i < eh.phnum && *len == 0; i++) {
+        if (elf_read_phdr(r, &eh, i, &ph) == 0 && ph.type == PT_NOTE)
+            read_build_id(r, &eh, ph.offset, ph.filesz, id, len);
+    }
+}
+
+static void read_build_id(const elf_reader_t *r, const elf_ehdr_t *eh, const long int off, const unsigned long int size,
+                          unsigned char *id, size_t *len) {
+    elf_note_t note;
+    char name[4];
+    long int pos, end;
+
+    end = off + (long int)size;
+    for (pos = off; pos < end; ) {
+        if ((pos = elf_read_note(r, eh, pos, end, &note)) == -1)
+            return;
+        if (note.type != NT_GNU_BUILD_ID || note.namesz != 4 || note.descsz == 0 || note.descsz > BUILD_ID_MAX_SIZE)
+            continue;
+        if (r->read(r->ctx, name, 4, note.name_off) != 4 || memcmp(name, "GNU", 4) != 0)
+            continue;
+        if (r->read(r->ctx, id, note.descsz, note.desc_off) == note.descsz)
+            *len = note.descsz;
+        return;
+    }
+}
+
+static void read_debuglink(hashes_table_t *t, const elf_reader_t *r, const elf_ehdr_t *eh, const elf_shdr_t *sh) {
+    unsigned char raw[DEBUGLINK_SIZE + 8];
+    size_t len, name_len, crc_off;
+
+    /* File name (NUL terminated), padding up to 4 bytes, CRC-32 of the debug file */
+    len = sh->size < sizeof(raw) ? (size_t)sh->size : sizeof(raw);
+    if (r->read(r->ctx, raw, len, sh->offset) != len)
+        return;
+    for (name_len = 0; name_len < len && name_len < DEBUGLINK_SIZE && raw[name_len] != '\0'; name_len++)
+        ;
+    crc_off = (name_len + 4) & ~(size_t)3;
+    if (name_len == 0 || name_len == DEBUGLINK_SIZE || crc_off + 4 > len)
+        return;
+    memcpy(t->debuglink, raw, name_len + 1);
+    t->debuglink_crc = elf_get(eh, raw + crc_off, 4);
+}
+
+/* DEBUG FILE */
+
+static unsigned char find_debug_file(hashes_table_t *t, const char *path) {
+    char *self, *slash;
+    char *dir;
+    size_t i;
+
+    if (t->build_id_len == 0 && t->debuglink[0] == '\0')
+        return 1;
+    if ((self = realpath(path, NULL)) == NULL)
+        return 1;
+
+    /* DEBUG_DIR/.build-id/xx/yyyy.debug */
+    if (t->build_id_len > 1) {
+        strcpy(t->debug_path, DEBUG_DIR "/.build-id/");
+        to_hex(t->debug_path + strlen(t->debug_path), t->build_id, 1);
+        strcat(t->debug_path, "/");
+        to_hex(t->debug_path + strlen(t->debug_path), t->build_id + 1, t->build_id_len - 1);
+        strcat(t->debug_path, ".debug");
+        if (is_candidate(t->debug_path, self) == 1) {
+            free(self);
+            return 0;
+        }
+    }
+
+    /* DIR/NAME, DIR/.debug/NAME and DEBUG_DIR/DIR/NAME (DIR is the directory of the real path of the file) */
+    if (t->debuglink[0] != '\0' && (slash = strrchr(self, '/')) != NULL) {
+        *slash = '\0';
+        dir = self;
+        for (i = 0; i < 3; i++) {
+            if (strlen(DEBUG_DIR) + strlen(dir) + strlen(t->debuglink) + 16 > DEBUG_PATH_SIZE)
+                break;
+            if (i == 0)
+                sprintf(t->debug_path, "%s/%s", dir, t->debuglink);
+            else if (i == 1)
+                sprintf(t->debug_path, "%s/.debug/%s", dir, t->debuglink);
+            else
+                sprintf(t->debug_path, "%s%s/%s", DEBUG_DIR, dir, t->debuglink);
+            *slash = '/';
+            if (is_candidate(t->debug_path, self) == 1) {
+                free(self);
+                return 0;
+            }
+            *slash = '\0';
+        }
+    }
+
+    free(self);
+    t->debug_path[0] = '\0';
+    return 1;
+}
+
+static unsigned char is_candidate(const char *path, const char *self) {
+    struct stat st;
+    char *real;
+    unsigned char is_self;
+
+    if (stat(path, &st) == -1 || S_ISREG(st.st_mode) == 0)
+        return 0;
+    if ((real = realpath(path, NULL)) == NULL)
+        return 0;
+    is_self = strcmp(real, self) == 0;
+    free(real);
+    return is_self == 0;
+}
+
+/* HASHING */
+
+static void hash_row(void *arg) {
+    hashes_task_t *task;
+    hashes_row_t *row;
+    digest_sha256_t sha;
+    unsigned char small[HASH_SMALL_SIZE];
+    unsigned char *buf, *data;
+    unsigned long int crc, done;
+    size_t n, chunk;
+
+    task = (hashes_task_t *)arg;
+    row = task->row;
+    if (row->status == HASH_NONE)
+        return;
+
+    /* Each worker charges its chunk, and falls back to a small one on the stack when the budget is tight */
+    buf = NULL;
+    if (budget_reserve(BUDGET_HASHES, HASH_CHUNK_SIZE) == 0 && (buf = malloc(HASH_CHUNK_SIZE)) == NULL)
+        budget_release(BUDGET_HASHES, HASH_CHUNK_SIZE);
+    data = buf != NULL ? buf : small;
+    chunk = buf != NULL ? HASH_CHUNK_SIZE : sizeof(small);
+
+    /* One pass for both hashes */
+    crc = 0;
+    digest_sha256_init(&sha);
+    for (done = 0; done < row->size; done += n) {
+        n = row->size - done < chunk ? (size_t)(row->size - done) : chunk;
+        if ((n = view_read(&task->view, data, n, row->off + (long int)done)) == 0)
+            break;
+        crc = digest_crc32(crc, data, n);
+        digest_sha256_update(&sha, data, n);
+    }
+    if (buf != NULL) {
+        free(buf);
+        budget_release(BUDGET_HASHES, HASH_CHUNK_SIZE);
+    }
+
+    row->crc32 = crc;
+    digest_sha256_final(&sha, row->sha256);
+    row->status = done == row->size ? HASH_DONE : HASH_FAILED;
+}
+
+static int compare_tasks(const void *a, const void *b) {
+    unsigned long int size_a, size_b;
+
+    size_a = ((const hashes_task_t *)a)->row->size;
+    size_b = ((const hashes_task_t *)b)->row->size;
+    return size_a > size_b ? -1 : (size_a < size_b ? 1 : 0);
+}
+
+/* UTILS */
+
+static void to_hex(char *buf, const unsigned char *bytes, const size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        sprintf(buf + 2 * i, "%02x", bytes[i]);
+    buf[2 * len] = '\0';
+}
+
+static long int elapsed_ms(const struct timespec *from, const struct timespec *to) {
+    return (long int)(to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
@@ -0,0 +1,128 @@
+/* C89 standard */
+#include <stdio.h>
+#include <string.h>
+
+#include "abuf.h"
+
+#include "json.h"
+
+
+#define REPLACEMENT_CHAR  "\\ufffd"  /* written in place of bytes that aren't valid UTF-8 */
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* Writes len bytes of s to out, if successful returns 0, else 1 */
+typedef unsigned char (*json_put_t)(void *out, const char *s, const size_t len);
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Writes s as a JSON string through put (quoted, with control characters, quotes and backslashes escaped,
+ * and every byte that isn't part of valid UTF-8 replaced by U+FFFD)
+ * If successful returns 0, else 1
+ */
+static unsigned char escape(const char *s, json_put_t put, void *out);
+
+/* Returns length of the valid UTF-8 sequence at the start of s (0 if there's none) */
+static size_t utf8_len(const unsigned char *s);
+
+/* json_put_t for an abuf_t and for a FILE */
+static unsigned char put_abuf(void *out, const char *s, const size_t len);
+static unsigned char put_file(void *out, const char *s, const size_t len);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char json_append_str(abuf_t *ab, const char *s) {
+    return escape(s, put_abuf, ab);
+}
+
+unsigned char json_write_str(FILE *f, const char *s) {
+    return escape(s, put_file, f);
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+static unsigned char escape(const char *s, json_put_t put, void *out) {
+    char esc[8];
+    size_t run, len;
+
+    if (put(out, "\"", 1))
+        return 1;
+
+    while (*s != '\0') {
+        /* Put runs of characters not needing escapes at once */
+        for (run = 0; (len = utf8_len((const unsigned char *)s + run)) > 0; run += len) {
+            if (s[run] == '"' || s[run] == '\\' || (unsigned char)s[run] < 0x20)
+                break;
+        }
+        if (run > 0) {
+            if (put(out, s, run))
+                return 1;
+            s += run;
+            continue;
+        }
+        if (*s == '"' || *s == '\\') {
+            esc[0] = '\\';
+            esc[1] = *s;
+            esc[2] = '\0';
+        } else if ((unsigned char)*s < 0x20)
+            sprintf(esc, "\\u%04x", (unsigned int)(unsigned char)*s);
+        else
+            strcpy(esc, REPLACEMENT_CHAR);
+        if (put(out, esc, strlen(esc)))
+            return 1;
+        s++;
+    }
+
+    return put(out, "\"", 1);
+}
+
+static size_t utf8_len(const unsigned char *s) {
+    unsigned char lo, hi;
+    size_t len, i;
+
+    if (s[0] == '\0')
+        return 0;
+    if (s[0] < 0x80)
+        return 1;
+
+    /* Overlong forms, surrogates and code points past U+10FFFF are invalid too (RFC 3629) */
+    lo = 0x80;
+    hi = 0xbf;
+    if (s[0] >= 0xc2 && s[0] <= 0xdf)
+        len = 2;
+    else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+        len = 3;
+        if (s[0] == 0xe0)
+            lo = 0xa0;
+        else if (s[0] == 0xed)
+            hi = 0x9f;
+    } else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+        len = 4;
+        if (s[0] == 0xf0)
+            lo = 0x90;
+        else if (s[0] == 0xf4)
+            hi = 0x8f;
+    } else
+        return 0;
+
+    if (s[1] < lo || s[1] > hi)
+        return 0;
+    for (i = 2; i < len; i++) {
+        if (s[i] < 0x80 || s[i] > 0xbf)
+            return 0;
+    }
+    return len;
+}
+
+static unsigned char put_abuf(void *out, const char *s, const size_t len) {
+    return ab_append((abuf_t *)out, s, len) != 0;
+}
+
+static unsigned char put_file(void *out, const char *s, const size_t len) {
+    return fwrite(s, 1, len, (FILE *)out) != len;
+}
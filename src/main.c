@@ -1,9 +1,21 @@
 /* C89 standard */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "archive.h"
+#include "budget.h"
+#include "core_notes.h"
+#include "disasm.h"
+#include "dwarf_line.h"
+#include "elf_parse.h"
+#include "export.h"
 #include "file.h"
+#include "hashes.h"
+#include "prefetch.h"
 #include "raw_terminal.h"
+#include "scan.h"
+#include "session.h"
 
 
 #define ERROR001  "ERROR: Argument missing!\n"
@@ -14,6 +26,21 @@
 #define ERROR006  "ERROR: Could not get terminal size!\n"
 #define ERROR007  "ERROR: Could not get terminal initial state!\n"
 #define ERROR008  "ERROR: Could not set terminal raw state!\n"
+#define ERROR010  "ERROR: Could not find archive member!\n"
+#define ERROR011  "ERROR: Could not scan directory!\n"
+#define ERROR012  "ERROR: Invalid scan option!\n"
+#define ERROR013  "ERROR: Could not export ELF file!\n"
+#define ERROR014  "ERROR: Invalid memory cap!\n"
+#define ERROR015  "ERROR: Could not record session!\n"
+#define ERROR016  "ERROR: Could not replay session (or final screen differs)!\n"
+#define ERROR017  "ERROR: Could not hash file!\n"
+#define ERROR018  "ERROR: Build-id or debuglink do not match the debug file!\n"
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* file opened by the interactive mode (closed by handle_exit()) */
+static file_t *opened_file = NULL;
 
 
 /* -------------------- STATIC PROTOTYPES -------------------- */
@@ -21,12 +48,40 @@
 /* Handles exit() (used in atexit()) */
 static void handle_exit(void);
 
+/* 
+ * Runs fleet audit mode: elf-visualizer --scan DIR [--csv] [--jobs N]
+ * Never returns
+ */
+static void run_scan(int argc, char *argv[]);
+
+/* 
+ * Runs export mode: elf-visualizer --json FILE [MEMBER]
+ * Never returns
+ */
+static void run_export(int argc, char *argv[]);
+
+/* 
+ * Runs hashes mode: elf-visualizer --hashes FILE [MEMBER]
+ * Never returns
+ */
+static void run_hashes(int argc, char *argv[]);
+
+/* 
+ * Runs replay mode: elf-visualizer --replay SESSION [--expect SCREEN] [--save SCREEN] ARGS...
+ * (ARGS are the arguments of the replayed interactive session)
+ * Never returns
+ */
+static void run_replay(int argc, char *argv[]);
+
 
 /* -------------------- MAIN -------------------- */
 
 int main(int argc, char *argv[]) {
     /* Declarations */
+    static elf_reader_t reader = ELF_READER_INIT;
+    static view_t root_view = VIEW_INIT;
     unsigned char status;
+    size_t cap;
 
     /* Arguments */
     if (argc < 2) {
@@ -34,12 +89,63 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    /* Optional memory cap (elf-visualizer --mem-cap SIZE ...), enforced on every index and mapping */
+    if (strcmp(argv[1], "--mem-cap") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, ERROR001);
+            exit(EXIT_FAILURE);
+        }
+        if (budget_parse_size(argv[2], &cap) == 1 || cap == 0) {
+            fprintf(stderr, ERROR014);
+            exit(EXIT_FAILURE);
+        }
+        budget_set_cap(cap);
+        argc -= 2;
+        argv += 2;
+    }
+    if (strcmp(argv[1], "--scan") == 0)
+        run_scan(argc, argv);
+    if (strcmp(argv[1], "--json") == 0)
+        run_export(argc, argv);
+    if (strcmp(argv[1], "--hashes") == 0)
+        run_hashes(argc, argv);
+    if (strcmp(argv[1], "--replay") == 0)
+        run_replay(argc, argv);
+
+    /* Optional recording of the session (elf-visualizer --record SESSION FILE [MEMBER]) */
+    if (strcmp(argv[1], "--record") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, ERROR001);
+            exit(EXIT_FAILURE);
+        }
+        if (session_record_open(argv[2]) == 1) {
+            fprintf(stderr, ERROR015);
+            exit(EXIT_FAILURE);
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
     /* Open file */
-    if (file_open(argv[1], "rb")) {
+    if (file_open(&opened_file, argv[1])) {
         fprintf(stderr, ERROR002);
         exit(EXIT_FAILURE);
     }
 
+    /* Parse core dump notes (does nothing for other files), the file is still shown without labels if they are broken */
+    file_root_view(opened_file, &root_view);
+    file_get_reader(&reader, &root_view);
+    term_set_file(&root_view);
+    if (core_notes_load(&reader) == 1)
+        core_notes_free();
+
+    /* Open archive (members are indexed lazily), and optionally one of its members (by name or symbol) */
+    archive_open(&reader);
+    if (argc > 2 && term_select_member(argv[2]) == 1) {
+        fprintf(stderr, ERROR010);
+        exit(EXIT_FAILURE);
+    }
+
     /* Set terminal in raw mode */
     status = initialize_term_raw_mode();
     if (status > 0) {
@@ -70,6 +176,9 @@ int main(int argc, char *argv[]) {
     /* Initialize exit_handler function */
     atexit(handle_exit);
 
+    /* Warm the file ahead of scrolling (without the helper thread scrolling just waits on I/O) */
+    prefetch_start();
+
     /* Main loop */
     status = term_loop();
 
@@ -89,9 +198,182 @@ static void handle_exit(void) {
             fprintf(stderr, ERROR008);
     }
 
+    session_record_close();
+    prefetch_stop();
+    hashes_free();
+    dwarf_line_free();
+    disasm_free();
+    core_notes_free();
+    archive_close();
+
     /* Handles file if open */
-    if (is_file_open() == 1) {
-        if (file_close() == 1)
+    if (opened_file != NULL) {
+        term_close_file();
+        if (file_close(opened_file) == 1)
             fprintf(stderr, ERROR003);
+        opened_file = NULL;
+    }
+}
+
+/* SCAN */
+static void run_scan(int argc, char *argv[]) {
+    unsigned char format;
+    unsigned int n_jobs;
+    int i;
+
+    if (argc < 3) {
+        fprintf(stderr, ERROR001);
+        exit(EXIT_FAILURE);
+    }
+
+    format = SCAN_FORMAT_JSON;
+    n_jobs = 0;
+    for (i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0)
+            format = SCAN_FORMAT_CSV;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            n_jobs = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, ERROR012);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (scan_tree(argv[2], format, n_jobs) == 1) {
+        fprintf(stderr, ERROR011);
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/* EXPORT */
+static void run_export(int argc, char *argv[]) {
+    static elf_reader_t reader = ELF_READER_INIT;
+    static view_t root_view = VIEW_INIT;
+    static view_t view = VIEW_INIT;
+    archive_member_t m;
+    unsigned char status;
+    file_t *f;
+
+    if (argc < 3) {
+        fprintf(stderr, ERROR001);
+        exit(EXIT_FAILURE);
+    }
+    if (file_open(&f, argv[2])) {
+        fprintf(stderr, ERROR002);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Optionally export a member of an archive */
+    file_root_view(f, &root_view);
+    view = root_view;
+    file_get_reader(&reader, &root_view);
+    if (argc > 3) {
+        if (archive_open(&reader) == 1 || archive_find_member(argv[3], &m) == 1) {
+            fprintf(stderr, ERROR010);
+            exit(EXIT_FAILURE);
+        }
+        archive_member_view(&root_view, &m, &view);
+        file_get_reader(&reader, &view);
+        archive_close();
+    }
+
+    status = export_json(&reader, stdout);
+    if (file_close(f) == 1)
+        fprintf(stderr, ERROR003);
+    if (status == 1) {
+        fprintf(stderr, ERROR013);
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/* HASHES */
+static void run_hashes(int argc, char *argv[]) {
+    static elf_reader_t reader = ELF_READER_INIT;
+    static view_t root_view = VIEW_INIT;
+    static view_t view = VIEW_INIT;
+    const hashes_table_t *t;
+    archive_member_t m;
+    char line[512];
+    unsigned char status, is_mismatch;
+    size_t i;
+    file_t *f;
+
+    if (argc < 3) {
+        fprintf(stderr, ERROR001);
+        exit(EXIT_FAILURE);
+    }
+    if (file_open(&f, argv[2])) {
+        fprintf(stderr, ERROR002);
+        exit(EXIT_FAILURE);
     }
+
+    /* Optionally hash a member of an archive */
+    file_root_view(f, &root_view);
+    view = root_view;
+    if (argc > 3) {
+        file_get_reader(&reader, &root_view);
+        if (archive_open(&reader) == 1 || archive_find_member(argv[3], &m) == 1) {
+            fprintf(stderr, ERROR010);
+            exit(EXIT_FAILURE);
+        }
+        archive_member_view(&root_view, &m, &view);
+        archive_close();
+    }
+
+    is_mismatch = 0;
+    if ((status = hashes_compute(&view, &t)) == 0) {
+        for (i = 0; i < hashes_n_lines(t); i++) {
+            hashes_line(t, i, line, sizeof(line));
+            puts(line);
+        }
+        hashes_summary(t, line, sizeof(line));
+        fprintf(stderr, "%s\n", line);
+        is_mismatch = hashes_has_mismatch(t);
+    }
+    hashes_free();
+    if (file_close(f) == 1)
+        fprintf(stderr, ERROR003);
+    if (status == 1) {
+        fprintf(stderr, ERROR017);
+        exit(EXIT_FAILURE);
+    }
+    if (is_mismatch == 1) {
+        fprintf(stderr, ERROR018);
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/* REPLAY */
+static void run_replay(int argc, char *argv[]) {
+    const char *expect_path, *save_path;
+    int i;
+
+    if (argc < 3) {
+        fprintf(stderr, ERROR001);
+        exit(EXIT_FAILURE);
+    }
+
+    expect_path = NULL;
+    save_path = NULL;
+    for (i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--expect") == 0)
+            expect_path = argv[i + 1];
+        else if (strcmp(argv[i], "--save") == 0)
+            save_path = argv[i + 1];
+        else
+            break;
+    }
+    if (i >= argc) {
+        fprintf(stderr, ERROR001);
+        exit(EXIT_FAILURE);
+    }
+
+    if (session_replay(argv[2], argv + i, argc - i, expect_path, save_path) == 1) {
+        fprintf(stderr, ERROR016);
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,361 @@
+#define _XOPEN_SOURCE 700  /* for pwrite */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "budget.h"
+#include "elf_parse.h"
+
+#include "overlay.h"
+
+
+#define EDITS_INITIAL_SIZE  64
+#define SAVE_CHUNK_SIZE     (1024 * 1024)
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a page copied on first write */
+typedef struct overlay_page_tag {
+    long int no;  /* offset / OVERLAY_PAGE_SIZE */
+    unsigned char is_dirty;  /* 1 if modified since the last save */
+    unsigned char data[OVERLAY_PAGE_SIZE];
+} overlay_page_t;
+
+/* struct for an edit (to undo/redo) */
+typedef struct overlay_edit_tag {
+    long int off;
+    unsigned char old_byte;
+    unsigned char new_byte;
+} overlay_edit_t;
+
+/* struct for a stack of edits */
+typedef struct overlay_stack_tag {
+    overlay_edit_t *edits;
+    size_t n;
+    size_t size;
+} overlay_stack_t;
+
+/* struct containing overlay data */
+struct overlay_tag {
+    elf_reader_t original;  /* reads bytes before any edit */
+    overlay_page_t **pages;  /* sorted by page number, so lookups are binary searches */
+    size_t n_pages;
+    size_t pages_size;
+    overlay_stack_t undo;
+    overlay_stack_t redo;
+    unsigned char is_modified;
+    unsigned long int generation;  /* incremented by every write */
+};
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Returns position of the first page with number >= no */
+static size_t find_page(const overlay_t *o, const long int no);
+
+/*
+ * Returns the page containing off, copying it from the original bytes if it's not inside the overlay
+ * If there's no memory (or the memory budget is exhausted) returns NULL
+ */
+static overlay_page_t *get_page(overlay_t *o, const long int off);
+
+/*
+ * Writes byte at off inside the overlay (without recording it)
+ * If successful returns 0, else 1
+ */
+static unsigned char write_byte(overlay_t *o, const long int off, const unsigned char byte);
+
+/*
+ * Pushes edit on top of stack
+ * If successful returns 0, else 1
+ */
+static unsigned char stack_push(overlay_stack_t *stack, const overlay_edit_t *edit);
+
+/* Writes exactly len bytes of buf to fd at off (if off is -1 at the current position). If successful returns 0, else 1 */
+static unsigned char write_all(const int fd, const unsigned char *buf, const size_t len, const long int off);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+/* NEW */
+
+unsigned char overlay_new(overlay_t **o, const elf_reader_t *original) {
+    if ((*o = calloc(1, sizeof(**o))) == NULL)
+        return 1;
+    (*o)->original = *original;
+    return 0;
+}
+
+/* EDIT */
+
+unsigned char overlay_set(overlay_t *o, const long int off, const unsigned char byte) {
+    overlay_edit_t edit;
+    overlay_page_t *page;
+
+    if ((page = get_page(o, off)) == NULL)
+        return 1;
+
+    edit.off = off;
+    edit.old_byte = page->data[off % OVERLAY_PAGE_SIZE];
+    edit.new_byte = byte;
+    if (stack_push(&o->undo, &edit) == 1)
+        return 1;
+    o->redo.n = 0;
+
+    return write_byte(o, off, byte);
+}
+
+unsigned char overlay_undo(overlay_t *o, long int *off) {
+    overlay_edit_t *edit;
+
+    if (o->undo.n == 0)
+        return 1;
+    edit = &o->undo.edits[o->undo.n - 1];
+    if (stack_push(&o->redo, edit) == 1 || write_byte(o, edit->off, edit->old_byte) == 1)
+        return 1;
+    *off = edit->off;
+    o->undo.n--;
+    return 0;
+}
+
+unsigned char overlay_redo(overlay_t *o, long int *off) {
+    overlay_edit_t *edit;
+
+    if (o->redo.n == 0)
+        return 1;
+    edit = &o->redo.edits[o->redo.n - 1];
+    if (stack_push(&o->undo, edit) == 1 || write_byte(o, edit->off, edit->new_byte) == 1)
+        return 1;
+    *off = edit->off;
+    o->redo.n--;
+    return 0;
+}
+
+/* READ */
+
+void overlay_apply(const overlay_t *o, void *buf, const size_t len, const long int off) {
+    overlay_page_t *page;
+    long int start, end, page_start;
+    size_t i;
+
+    if (o->n_pages == 0 || len == 0)
+        return;
+
+    end = off + (long int)len;
+    for (i = find_page(o, off / OVERLAY_PAGE_SIZE); i < o->n_pages; i++) {
+        page = o->pages[i];
+        page_start = page->no * OVERLAY_PAGE_SIZE;
+        if (page_start >= end)
+            break;
+        start = page_start > off ? page_start : off;
+        memcpy((unsigned char *)buf + (start - off), &page->data[start - page_start],
+               (size_t)((page_start + OVERLAY_PAGE_SIZE < end ? page_start + OVERLAY_PAGE_SIZE : end) - start));
+    }
+}
+
+/* GETTERS */
+
+unsigned char overlay_is_modified(const overlay_t *o) {
+    return o->is_modified;
+}
+
+size_t overlay_n_pages(const overlay_t *o) {
+    return o->n_pages;
+}
+
+unsigned long int overlay_generation(const overlay_t *o) {
+    return o->generation;
+}
+
+/* SAVE */
+
+unsigned char overlay_save(overlay_t *o, const char *path) {
+    overlay_page_t *page;
+    long int len, page_start;
+    size_t i;
+    int fd;
+
+    if ((fd = open(path, O_WRONLY)) == -1)
+        return 1;
+
+    /* The file length never changes, so the last page may be partial */
+    len = o->original.len;
+    for (i = 0; i < o->n_pages; i++) {
+        page = o->pages[i];
+        if (page->is_dirty == 0)
+            continue;
+        page_start = page->no * OVERLAY_PAGE_SIZE;
+        if (write_all(fd, page->data, (size_t)(len - page_start < OVERLAY_PAGE_SIZE ? len - page_start : OVERLAY_PAGE_SIZE),
+                      page_start) == 1) {
+            close(fd);
+            return 1;
+        }
+        page->is_dirty = 0;
+    }
+
+    if (close(fd) == -1)
+        return 1;
+    o->is_modified = 0;
+    return 0;
+}
+
+unsigned char overlay_save_as(const overlay_t *o, const char *path) {
+    unsigned char *chunk;
+    long int len, off;
+    size_t n;
+    int fd;
+
+    if ((chunk = malloc(SAVE_CHUNK_SIZE)) == NULL)
+        return 1;
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        free(chunk);
+        return 1;
+    }
+
+    len = o->original.len;
+    for (off = 0; off < len; off += (long int)n) {
+        n = o->original.read(o->original.ctx, chunk, SAVE_CHUNK_SIZE, off);
+        overlay_apply(o, chunk, n, off);
+        if (n == 0 || write_all(fd, chunk, n, -1) == 1) {
+            close(fd);
+            free(chunk);
+            return 1;
+        }
+    }
+
+    free(chunk);
+    return close(fd) == -1;
+}
+
+void overlay_free(overlay_t *o) {
+    size_t i;
+
+    if (o == NULL)
+        return;
+    for (i = 0; i < o->n_pages; i++)
+        free(o->pages[i]);
+    free(o->pages);
+    free(o->undo.edits);
+    free(o->redo.edits);
+    budget_release(BUDGET_OVERLAY, o->n_pages * sizeof(**o->pages) + o->pages_size * sizeof(*o->pages) +
+                                   (o->undo.size + o->redo.size) * sizeof(*o->undo.edits));
+    free(o);
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* PAGES */
+
+static size_t find_page(const overlay_t *o, const long int no) {
+    size_t lo, hi, mid;
+
+    lo = 0;
+    hi = o->n_pages;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (o->pages[mid]->no < no)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static overlay_page_t *get_page(overlay_t *o, const long int off) {
+    overlay_page_t **new_pages;
+    overlay_page_t *page;
+    size_t i, new_size;
+    long int no;
+
+    no = off / OVERLAY_PAGE_SIZE;
+    i = find_page(o, no);
+    if (i < o->n_pages && o->pages[i]->no == no)
+        return o->pages[i];
+
+    if (o->n_pages == o->pages_size) {
+        new_size = o->pages_size == 0 ? EDITS_INITIAL_SIZE : o->pages_size * 2;
+        if (budget_reserve(BUDGET_OVERLAY, (new_size - o->pages_size) * sizeof(*new_pages)) == 1)
+            return NULL;
+        if ((new_pages = realloc(o->pages, new_size * sizeof(*new_pages))) == NULL) {
+            budget_release(BUDGET_OVERLAY, (new_size - o->pages_size) * sizeof(*new_pages));
+            return NULL;
+        }
+        o->pages = new_pages;
+        o->pages_size = new_size;
+    }
+    if (budget_reserve(BUDGET_OVERLAY, sizeof(*page)) == 1)
+        return NULL;
+    if ((page = malloc(sizeof(*page))) == NULL) {
+        budget_release(BUDGET_OVERLAY, sizeof(*page));
+        return NULL;
+    }
+
+    /* Copy on first write */
+    page->no = no;
+    page->is_dirty = 0;
+    memset(page->data, 0, OVERLAY_PAGE_SIZE);
+    o->original.read(o->original.ctx, page->data, OVERLAY_PAGE_SIZE, no * OVERLAY_PAGE_SIZE);
+
+    memmove(&o->pages[i + 1], &o->pages[i], (o->n_pages - i) * sizeof(*o->pages));
+    o->pages[i] = page;
+    o->n_pages++;
+    return page;
+}
+
+static unsigned char write_byte(overlay_t *o, const long int off, const unsigned char byte) {
+    overlay_page_t *page;
+
+    if ((page = get_page(o, off)) == NULL)
+        return 1;
+    page->data[off % OVERLAY_PAGE_SIZE] = byte;
+    page->is_dirty = 1;
+    o->is_modified = 1;
+    o->generation++;
+    return 0;
+}
+
+/* EDITS */
+
+static unsigned char stack_push(overlay_stack_t *stack, const overlay_edit_t *edit) {
+    overlay_edit_t *new_edits;
+    size_t new_size;
+
+    if (stack->n == stack->size) {
+        new_size = stack->size == 0 ? EDITS_INITIAL_SIZE : stack->size * 2;
+        if (budget_reserve(BUDGET_OVERLAY, (new_size - stack->size) * sizeof(*new_edits)) == 1)
+            return 1;
+        if ((new_edits = realloc(stack->edits, new_size * sizeof(*new_edits))) == NULL) {
+            budget_release(BUDGET_OVERLAY, (new_size - stack->size) * sizeof(*new_edits));
+            return 1;
+        }
+        stack->edits = new_edits;
+        stack->size = new_size;
+    }
+    stack->edits[stack->n++] = *edit;
+    return 0;
+}
+
+/* OUTPUT */
+
+static unsigned char write_all(const int fd, const unsigned char *buf, const size_t len, const long int off) {
+    ssize_t n;
+    size_t done;
+
+    for (done = 0; done < len; done += (size_t)n) {
+        if (off == -1)
+            n = write(fd, buf + done, len - done);
+        else
+            n = pwrite(fd, buf + done, len - done, off + (long int)done);
+        if (n <= 0)
+            return 1;
+    }
+    return 0;
+}
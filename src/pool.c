@@ -0,0 +1,308 @@
+#define _XOPEN_SOURCE 700  /* for pthread and sysconf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdlib.h>
+
+/* POSIX standard */
+#include <pthread.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+
+#define DEQUE_INITIAL_SIZE    64
+#define MAX_PENDING_PER_WORKER  1024
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a scheduled task */
+typedef struct pool_task_tag {
+    pool_func_t func;
+    void *arg;
+} pool_task_t;
+
+/*
+ * struct for the deque of a worker (circular buffer)
+ * The owner pushes and pops at the bottom, thieves take from the top
+ */
+typedef struct pool_deque_tag {
+    pthread_mutex_t lock;
+    pool_task_t *tasks;
+    size_t size;
+    size_t top;
+    size_t n;
+} pool_deque_t;
+
+/* struct for a worker thread */
+typedef struct pool_worker_tag {
+    pthread_t thread;
+    unsigned int id;
+    pool_deque_t deque;
+} pool_worker_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing pool data */
+static struct pool_tag {
+    unsigned char is_started;
+    unsigned char stop;
+    pool_worker_t *workers;
+    unsigned int n_workers;
+    unsigned int next_worker;  /* round-robin target for external submissions */
+    pthread_key_t self_key;    /* worker running on the current thread */
+    pthread_mutex_t lock;      /* protects n_queued, n_active and stop */
+    pthread_cond_t work_cond;  /* signaled when a task is queued */
+    pthread_cond_t done_cond;  /* signaled when a task is done */
+    unsigned long int n_queued;  /* tasks inside deques */
+    unsigned long int n_active;  /* tasks submitted and not yet done */
+} pool;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Main function of worker threads */
+static void *worker_main(void *arg);
+
+/*
+ * Pushes task at the bottom of d
+ * If successful returns 0, else 1
+ */
+static unsigned char deque_push(pool_deque_t *d, const pool_task_t *task);
+
+/*
+ * Pops task from the bottom (if from_top is 0) or from the top (if from_top is 1) of d
+ * If a task was taken returns 0, else 1
+ */
+static unsigned char deque_take(pool_deque_t *d, pool_task_t *task, const unsigned char from_top);
+
+/*
+ * Takes a task from the deque of w, or steals one from the other workers
+ * If a task was taken returns 0, else 1
+ */
+static unsigned char find_task(pool_worker_t *w, pool_task_t *task);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char pool_start(unsigned int n_workers) {
+    long int n_cpus;
+    unsigned int i;
+
+    if (pool.is_started)
+        return 1;
+    if (n_workers == 0) {
+        n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_workers = n_cpus > 0 ? (unsigned int)n_cpus : 1;
+    }
+
+    if ((pool.workers = calloc(n_workers, sizeof(*pool.workers))) == NULL)
+        return 1;
+    if (pthread_key_create(&pool.self_key, NULL) != 0) {
+        free(pool.workers);
+        return 1;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.work_cond, NULL);
+    pthread_cond_init(&pool.done_cond, NULL);
+    pool.stop = 0;
+    pool.n_queued = 0;
+    pool.n_active = 0;
+    pool.next_worker = 0;
+
+    for (i = 0; i < n_workers; i++) {
+        pool.workers[i].id = i;
+        pthread_mutex_init(&pool.workers[i].deque.lock, NULL);
+    }
+    pool.n_workers = n_workers;
+    pool.is_started = 1;
+
+    for (i = 0; i < n_workers; i++) {
+        if (pthread_create(&pool.workers[i].thread, NULL, worker_main, &pool.workers[i]) != 0) {
+            pool.n_workers = i;
+            pool_stop();
+            return 1;
+        }
+    }
+    return 0;
+}
+
+unsigned char pool_submit(pool_func_t func, void *arg) {
+    pool_worker_t *self, *target;
+    pool_task_t task;
+
+    if (pool.is_started == 0)
+        return 1;
+    task.func = func;
+    task.arg = arg;
+
+    self = pthread_getspecific(pool.self_key);
+
+    pthread_mutex_lock(&pool.lock);
+    /* Back-pressure for producers outside the pool (workers never block, or they could deadlock) */
+    while (self == NULL && pool.n_active >= (unsigned long int)pool.n_workers * MAX_PENDING_PER_WORKER)
+        pthread_cond_wait(&pool.done_cond, &pool.lock);
+    pool.n_active++;
+    pool.n_queued++;  /* counted before the push, so that n_queued never underflows */
+    if (self != NULL)
+        target = self;
+    else {
+        target = &pool.workers[pool.next_worker];
+        pool.next_worker = (pool.next_worker + 1) % pool.n_workers;
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    if (deque_push(&target->deque, &task) == 1) {
+        pthread_mutex_lock(&pool.lock);
+        pool.n_active--;
+        pool.n_queued--;
+        pthread_cond_broadcast(&pool.done_cond);
+        pthread_mutex_unlock(&pool.lock);
+        return 1;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pthread_cond_signal(&pool.work_cond);
+    pthread_mutex_unlock(&pool.lock);
+    return 0;
+}
+
+void pool_wait(void) {
+    if (pool.is_started == 0)
+        return;
+    pthread_mutex_lock(&pool.lock);
+    while (pool.n_active > 0)
+        pthread_cond_wait(&pool.done_cond, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+void pool_stop(void) {
+    unsigned int i;
+
+    if (pool.is_started == 0)
+        return;
+    pool_wait();
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.work_cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (i = 0; i < pool.n_workers; i++)
+        pthread_join(pool.workers[i].thread, NULL);
+    for (i = 0; i < pool.n_workers; i++) {
+        pthread_mutex_destroy(&pool.workers[i].deque.lock);
+        free(pool.workers[i].deque.tasks);
+    }
+
+    pthread_cond_destroy(&pool.done_cond);
+    pthread_cond_destroy(&pool.work_cond);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_key_delete(pool.self_key);
+    free(pool.workers);
+    pool.workers = NULL;
+    pool.n_workers = 0;
+    pool.is_started = 0;
+}
+
+unsigned int pool_n_workers(void) {
+    return pool.n_workers;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* WORKERS */
+
+static void *worker_main(void *arg) {
+    pool_worker_t *w;
+    pool_task_t task;
+
+    w = (pool_worker_t *)arg;
+    pthread_setspecific(pool.self_key, w);
+
+    for (;;) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.n_queued == 0 && pool.stop == 0)
+            pthread_cond_wait(&pool.work_cond, &pool.lock);
+        if (pool.n_queued == 0 && pool.stop == 1) {
+            pthread_mutex_unlock(&pool.lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool.lock);
+
+        /* Another worker may have taken the task in the meantime */
+        if (find_task(w, &task) == 1)
+            continue;
+
+        pthread_mutex_lock(&pool.lock);
+        pool.n_queued--;
+        pthread_mutex_unlock(&pool.lock);
+
+        task.func(task.arg);
+
+        pthread_mutex_lock(&pool.lock);
+        pool.n_active--;
+        pthread_cond_broadcast(&pool.done_cond);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+static unsigned char find_task(pool_worker_t *w, pool_task_t *task) {
+    unsigned int i;
+
+    if (deque_take(&w->deque, task, 0) == 0)
+        return 0;
+
+    /* Steal the oldest task of the first non empty victim */
+    for (i = 1; i < pool.n_workers; i++) {
+        if (deque_take(&pool.workers[(w->id + i) % pool.n_workers].deque, task, 1) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+/* DEQUES */
+
+static unsigned char deque_push(pool_deque_t *d, const pool_task_t *task) {
+    pool_task_t *new_tasks;
+    size_t new_size, i;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->n == d->size) {
+        new_size = d->size == 0 ? DEQUE_INITIAL_SIZE : d->size * 2;
+        if ((new_tasks = malloc(new_size * sizeof(*new_tasks))) == NULL) {
+            pthread_mutex_unlock(&d->lock);
+            return 1;
+        }
+        for (i = 0; i < d->n; i++)
+            new_tasks[i] = d->tasks[(d->top + i) % d->size];
+        free(d->tasks);
+        d->tasks = new_tasks;
+        d->size = new_size;
+        d->top = 0;
+    }
+    d->tasks[(d->top + d->n) % d->size] = *task;
+    d->n++;
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+static unsigned char deque_take(pool_deque_t *d, pool_task_t *task, const unsigned char from_top) {
+    pthread_mutex_lock(&d->lock);
+    if (d->n == 0) {
+        pthread_mutex_unlock(&d->lock);
+        return 1;
+    }
+    if (from_top) {
+        *task = d->tasks[d->top];
+        d->top = (d->top + 1) % d->size;
+    } else
+        *task = d->tasks[(d->top + d->n - 1) % d->size];
+    d->n--;
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
@@ -0,0 +1,262 @@
+#define _XOPEN_SOURCE 700  /* for pthread and clock_gettime */
+
+/* C89 standard */
+#include <stddef.h>
+#include <time.h>
+
+/* POSIX standard */
+#include <pthread.h>
+
+#include "file.h"
+
+#include "prefetch.h"
+
+
+#define PREFETCH_BLOCK_SIZE   (64 * 1024)
+#define PREFETCH_RING_SIZE    256   /* warmed blocks remembered for statistics */
+#define PREFETCH_MAX_SCREENS  8     /* screens warmed ahead while the user keeps scrolling */
+#define PREFETCH_IDLE_MS      500   /* pause after which scrolling starts again from one screen ahead */
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for the range the helper thread should warm */
+typedef struct prefetch_target_tag {
+    const file_t *file;
+    long int start;  /* absolute offsets */
+    long int end;
+    unsigned long int gen;  /* incremented by every new target, so the helper drops stale ones */
+} prefetch_target_t;
+
+/* struct for a warmed block */
+typedef struct prefetch_block_tag {
+    long int no;  /* absolute offset / PREFETCH_BLOCK_SIZE, -1 if unused */
+    unsigned char is_hit;
+} prefetch_block_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing prefetch data */
+static struct prefetch_tag {
+    unsigned char is_started;
+    unsigned char stop;
+    pthread_t thread;
+    pthread_mutex_t lock;  /* protects everything below */
+    pthread_cond_t cond;   /* signaled when target changes or stop is set */
+    prefetch_target_t target;
+    unsigned long int done_gen;  /* last target completely warmed */
+    prefetch_block_t ring[PREFETCH_RING_SIZE];  /* circular buffer of warmed blocks */
+    size_t ring_next;
+    prefetch_stats_t stats;
+    /* Scrolling state (only used by the UI thread) */
+    const file_t *last_file;
+    long int last_base;
+    long int last_pos;
+    int direction;  /* 1 = forward, -1 = backward, 0 = still */
+    unsigned int streak;  /* consecutive moves in direction */
+    struct timespec last_move;
+} prefetch;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Main function of the helper thread */
+static void *helper_main(void *arg);
+
+/* Returns position of block no inside the ring, PREFETCH_RING_SIZE if it's not there (lock must be held) */
+static size_t ring_find(const long int no);
+
+/* Records that block no was warmed, the block it replaces is wasted if never shown (lock must be held) */
+static void ring_add(const long int no);
+
+/* Returns milliseconds elapsed from *from to *to */
+static long int elapsed_ms(const struct timespec *from, const struct timespec *to);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char prefetch_start(void) {
+    size_t i;
+
+    if (prefetch.is_started)
+        return 1;
+
+    for (i = 0; i < PREFETCH_RING_SIZE; i++)
+        prefetch.ring[i].no = -1;
+    pthread_mutex_init(&prefetch.lock, NULL);
+    pthread_cond_init(&prefetch.cond, NULL);
+    prefetch.stop = 0;
+
+    if (pthread_create(&prefetch.thread, NULL, helper_main, NULL) != 0) {
+        pthread_mutex_destroy(&prefetch.lock);
+        pthread_cond_destroy(&prefetch.cond);
+        return 1;
+    }
+    prefetch.is_started = 1;
+    return 0;
+}
+
+void prefetch_stop(void) {
+    if (prefetch.is_started == 0)
+        return;
+
+    pthread_mutex_lock(&prefetch.lock);
+    prefetch.stop = 1;
+    pthread_cond_signal(&prefetch.cond);
+    pthread_mutex_unlock(&prefetch.lock);
+
+    pthread_join(prefetch.thread, NULL);
+    pthread_mutex_destroy(&prefetch.lock);
+    pthread_cond_destroy(&prefetch.cond);
+    prefetch.is_started = 0;
+}
+
+void prefetch_hint(const view_t *v, const long int pos, const long int screen_len) {
+    struct timespec now;
+    long int delta, step, ahead, start, end, no;
+    int direction;
+    size_t i;
+
+    if (prefetch.is_started == 0 || screen_len <= 0)
+        return;
+
+    /* Direction and speed of scrolling */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (v->file != prefetch.last_file || v->base != prefetch.last_base)
+        delta = 0;
+    else
+        delta = pos - prefetch.last_pos;
+    direction = delta > 0 ? 1 : (delta < 0 ? -1 : 0);
+
+    if (delta == 0 || (delta > 0 ? delta : -delta) > screen_len * PREFETCH_MAX_SCREENS) {
+        /* Redraw without moving, or jump (next data region, another member...): nothing to anticipate */
+        prefetch.streak = 0;
+    } else if (direction != prefetch.direction || elapsed_ms(&prefetch.last_move, &now) > PREFETCH_IDLE_MS)
+        prefetch.streak = 1;
+    else if (prefetch.streak < PREFETCH_MAX_SCREENS)
+        prefetch.streak++;
+    if (delta != 0)
+        prefetch.last_move = now;
+    prefetch.last_file = v->file;
+    prefetch.last_base = v->base;
+    prefetch.last_pos = pos;
+    prefetch.direction = direction;
+
+    pthread_mutex_lock(&prefetch.lock);
+
+    /* Shown blocks that were warmed before are hits */
+    for (no = (v->base + pos) / PREFETCH_BLOCK_SIZE; no <= (v->base + pos + screen_len - 1) / PREFETCH_BLOCK_SIZE; no++) {
+        if ((i = ring_find(no)) < PREFETCH_RING_SIZE && prefetch.ring[i].is_hit == 0) {
+            prefetch.ring[i].is_hit = 1;
+            prefetch.stats.hits++;
+        }
+    }
+
+    /* The further the user scrolls in one direction (and the faster), the more is warmed ahead */
+    if (prefetch.streak > 0 && direction != 0) {
+        step = delta > 0 ? delta : -delta;
+        if (step < screen_len)
+            step = screen_len;
+        ahead = step * (long int)prefetch.streak;
+        if (direction > 0) {
+            start = pos + screen_len;
+            end = start + ahead < v->len ? start + ahead : v->len;
+        } else {
+            end = pos;
+            start = end - ahead > 0 ? end - ahead : 0;
+        }
+        if (start < end) {
+            prefetch.target.file = v->file;
+            prefetch.target.start = v->base + start;
+            prefetch.target.end = v->base + end;
+            prefetch.target.gen++;
+            pthread_cond_signal(&prefetch.cond);
+        }
+    } else {
+        /* The user stopped: drop whatever is still pending */
+        prefetch.target.gen++;
+        prefetch.done_gen = prefetch.target.gen;
+    }
+
+    pthread_mutex_unlock(&prefetch.lock);
+}
+
+void prefetch_get_stats(prefetch_stats_t *stats) {
+    if (prefetch.is_started == 0) {
+        *stats = prefetch.stats;
+        return;
+    }
+    pthread_mutex_lock(&prefetch.lock);
+    *stats = prefetch.stats;
+    pthread_mutex_unlock(&prefetch.lock);
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* HELPER */
+
+static void *helper_main(void *arg) {
+    prefetch_target_t t;
+    long int no, last;
+    unsigned char is_warm;
+
+    (void)arg;
+
+    pthread_mutex_lock(&prefetch.lock);
+    while (prefetch.stop == 0) {
+        if (prefetch.done_gen == prefetch.target.gen) {
+            pthread_cond_wait(&prefetch.cond, &prefetch.lock);
+            continue;
+        }
+        t = prefetch.target;
+
+        /* Warm one block at a time, checking between blocks whether the target is still wanted */
+        last = (t.end - 1) / PREFETCH_BLOCK_SIZE;
+        for (no = t.start / PREFETCH_BLOCK_SIZE; no <= last && prefetch.stop == 0 && t.gen == prefetch.target.gen; no++) {
+            is_warm = ring_find(no) < PREFETCH_RING_SIZE;
+            pthread_mutex_unlock(&prefetch.lock);
+
+            if (is_warm == 0)
+                file_warm(t.file, no * PREFETCH_BLOCK_SIZE, PREFETCH_BLOCK_SIZE);
+
+            pthread_mutex_lock(&prefetch.lock);
+            if (is_warm == 0 && ring_find(no) == PREFETCH_RING_SIZE)
+                ring_add(no);
+        }
+        if (t.gen == prefetch.target.gen)
+            prefetch.done_gen = t.gen;
+    }
+    pthread_mutex_unlock(&prefetch.lock);
+    return NULL;
+}
+
+/* RING */
+
+static size_t ring_find(const long int no) {
+    size_t i;
+
+    for (i = 0; i < PREFETCH_RING_SIZE; i++) {
+        if (prefetch.ring[i].no == no)
+            return i;
+    }
+    return PREFETCH_RING_SIZE;
+}
+
+static void ring_add(const long int no) {
+    prefetch_block_t *b;
+
+    b = &prefetch.ring[prefetch.ring_next];
+    if (b->no != -1 && b->is_hit == 0)
+        prefetch.stats.wasted++;
+    b->no = no;
+    b->is_hit = 0;
+    prefetch.ring_next = (prefetch.ring_next + 1) % PREFETCH_RING_SIZE;
+}
+
+/* TIME */
+
+static long int elapsed_ms(const struct timespec *from, const struct timespec *to) {
+    return (long int)(to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
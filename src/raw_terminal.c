@@ -2,6 +2,9 @@
 
 /* C89 standard */
 #include <stddef.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* POSIX standard */
@@ -12,7 +15,18 @@
 #include <unistd.h>
 
 #include "abuf.h"
+#include "archive.h"
+#include "budget.h"
+#include "core_notes.h"
+#include "disasm.h"
+#include "dwarf_line.h"
+#include "entries.h"
 #include "file.h"
+#include "hashes.h"
+#include "overlay.h"
+#include "prefetch.h"
+#include "session.h"
+#include "zsection.h"
 
 #include "raw_terminal.h"
 
@@ -20,10 +34,16 @@
 #define MODE_HEX        0
 #define MODE_FORM_CHAR  1
 #define MODE_CHAR       2
+#define MODE_TABLE      3  /* rows are lines of the hash table, not bytes */
+#define MODE_DISASM     4  /* rows are instructions (or data between them), row_len is their width */
+#define MODE_ENTRIES    5  /* rows are lines of a relocation, dynamic or symbol table, not bytes */
 
 #define MODE_HEX_INIT        {MODE_HEX, 0, 0, file_append_hexs}
 #define MODE_FORM_CHAR_INIT  {MODE_FORM_CHAR, 0, 0, file_append_formatted_chars}
 #define MODE_CHAR_INIT       {MODE_CHAR, 0, 0, file_append_chars}
+#define MODE_TABLE_INIT      {MODE_TABLE, 0, 1, append_table_line}
+#define MODE_DISASM_INIT     {MODE_DISASM, 0, 0, disasm_append_row}
+#define MODE_ENTRIES_INIT    {MODE_ENTRIES, 0, 1, append_entries_line}
 
 #define STARTING_MODE  &mode_hex
 
@@ -38,6 +58,17 @@
 #define VT100_CUR_TOP_L   "\x1b[1;1H"
 #define VT100_CUR_HIDE    "\x1b[?25l"
 #define VT100_CUR_SHOW    "\x1b[?25h"
+#define VT100_INVERT      "\x1b[7m"
+#define VT100_RESET       "\x1b[m"
+
+#define STATUS_LINE_SIZE  256
+#define TABLE_LINE_SIZE   512
+#define MESSAGE_SIZE      64
+#define CURSOR_SEQ_SIZE   32
+
+#define PATCHED_SUFFIX  ".patched"
+
+#define WINDOW_SIZE  (8 * 1024 * 1024)  /* resident bytes of the file around the view (at most half of the memory cap) */
 
 
 /* -------------------- TYPEDEFS -------------------- */
@@ -45,22 +76,37 @@
 /* struct containing data about modes */
 typedef struct term_mode_tag {
     unsigned char name;
-    long int pos;
+    long int pos;  /* first shown byte (relative to the active view) */
     unsigned int row_len;
-    size_t (*write_func)(abuf_t *, const size_t);
+    size_t (*write_func)(abuf_t *, const view_t *, const long int, const size_t);
 } term_mode_t;
 
 
 /* -------------------- STATIC VARIABLES -------------------- */
 
-/* defining 3 modes */
+/* 
+ * Appends line pos of the hash table of the active view to ab (write_func of MODE_TABLE, len is ignored)
+ * Returns 1 if a line was appended, else 0 (declared here because MODE_TABLE_INIT uses it)
+ */
+static size_t append_table_line(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
+
+/* 
+ * Appends line pos of the open ELF table to ab (write_func of MODE_ENTRIES, len is ignored)
+ * Returns 1 if a line was appended, else 0 (declared here because MODE_ENTRIES_INIT uses it)
+ */
+static size_t append_entries_line(abuf_t *ab, const view_t *v, const long int pos, const size_t len);
+
+/* defining 6 modes */
 static term_mode_t mode_hex = MODE_HEX_INIT;
 static term_mode_t mode_form_char = MODE_FORM_CHAR_INIT;
 static term_mode_t mode_char = MODE_CHAR_INIT;
+static term_mode_t mode_table = MODE_TABLE_INIT;
+static term_mode_t mode_disasm = MODE_DISASM_INIT;
+static term_mode_t mode_entries = MODE_ENTRIES_INIT;
 
 /* struct containing signal data (to handle SIGWINCH) */
 static struct sig_winch_tag {
-    unsigned char error_detected;
+    volatile sig_atomic_t is_resized;  /* set by the handler, the resize itself is handled by handle_resize() */
     struct sigaction sa;
 } sig_winch;
 
@@ -69,20 +115,35 @@ static struct terminal_tag {
     unsigned char is_raw;
     term_mode_t *active_mode;
     unsigned int screen_rows;
+    unsigned int data_rows;  /* screen_rows without the status line */
     unsigned int screen_cols;
     unsigned int cols_diff;
     struct termios initial_state;  /* for preservation of initial state */
+    unsigned char in_member;  /* 1 if the active view is member of an archive */
+    archive_member_t member;
+    view_t view;  /* active view */
+    file_window_t window;  /* mapped window used by every read of the active view */
+    view_t root_view;  /* view of the whole file */
+    unsigned char is_editing;  /* 1 if keys edit bytes at cursor */
+    long int cursor;  /* edited byte (relative to the active view) */
+    unsigned char nibble;  /* 1 if the high nibble of the edited byte was typed (MODE_HEX) */
+    char message[MESSAGE_SIZE];  /* shown on the status line until the next refresh */
+    const hashes_table_t *hashes;  /* hash table of the active view (NULL until MODE_TABLE is entered) */
+    zsection_t *zsection;  /* compressed section whose decompressed bytes are the active view (NULL if none) */
 } term;
 
 
 /* -------------------- STATIC PROTOTYPES -------------------- */
 
-/* 
- * Handles SIGWINCH signal, and sets term.screen_rows, term.screen_cols and sigwinch_error_detected accordingly
- * If successful sets sig_winch.error_detected to 0, else 1
- */
+/* Handles SIGWINCH signal, only noting that the window was resized (nothing else is async-signal-safe) */
 static void sigwinch_handler(int sig);
 
+/*
+ * If the window was resized, sets term.screen_rows and term.screen_cols accordingly and redraws (on the main thread)
+ * If successful returns 0, else 1
+ */
+static unsigned char handle_resize(void);
+
 /* Sets row_len and pos of term_mode_t variables based on terminal window size */
 static unsigned char set_modes_row_len_and_pos(void);
 
@@ -108,6 +169,18 @@ static unsigned char change_mode(const unsigned char mode);
  */
 static unsigned char process_keypress(void);
 
+/* 
+ * Handles inputs while editing (arrows move the cursor, typed characters overwrite bytes)
+ * Returns the same values as process_keypress()
+ */
+static unsigned char process_edit_keypress(const char c);
+
+/* 
+ * Reads the final byte of an arrow key escape sequence ('A', 'B', 'C' or 'D') in c
+ * If successful returns 0, else 1 (lone ESC or another sequence)
+ */
+static unsigned char read_arrow(char *c);
+
 /* 
  * Reads key from stdin
  * If successful returns 0, else 1
@@ -118,6 +191,60 @@ static unsigned char refresh_screen(void);
 
 static unsigned char draw_rows(abuf_t *ab);
 
+/* 
+ * Appends status line (mode, position, and label of the position) to ab
+ * If successful returns 0, else 1
+ */
+static unsigned char draw_status(abuf_t *ab, const long int pos);
+
+/* 
+ * Moves to the beginning of the row containing the start of the next data region (skipping holes)
+ * If successful returns 0, else 1
+ */
+static unsigned char move_next_data(void);
+
+/* Makes m the active view (or the whole file if m is NULL), resetting modes positions */
+static void set_view(const archive_member_t *m);
+
+/* 
+ * Makes the decompressed bytes of the compressed section at (or after) the shown position the active view
+ * If successful returns 0, else 1 (and sets term.message)
+ */
+static unsigned char set_zsection_view(void);
+
+/* Tells the modules following the active view that it changed, and resets modes positions */
+static void reset_view(void);
+
+/* Returns number of units (bytes, or lines for MODE_TABLE and MODE_ENTRIES) of the active mode */
+static long int mode_len(void);
+
+/* 
+ * Hashes the active view (or finds its hashes in the cache) for MODE_TABLE
+ * If successful returns 0, else 1
+ */
+static unsigned char load_hashes(void);
+
+/* Moves active mode pos by rows (stopping at the row containing the last byte of the active view, or at 0) */
+static void scroll(const long int rows);
+
+/* 
+ * Moves cursor by delta bytes (staying inside the active view), and scrolls so that it stays visible
+ * If successful returns 0, else 1
+ */
+static unsigned char move_cursor(const long int delta);
+
+/* 
+ * Overwrites byte at cursor with the typed character c (a hex digit in MODE_HEX, anything printable otherwise)
+ * If c can't be typed returns PROCESS_KEYPRESS_IGNORE, else the same values as process_keypress()
+ */
+static unsigned char edit_byte(const char c);
+
+/* 
+ * Appends to ab the VT100 sequence placing the terminal cursor over the edited byte (pos is the first shown byte)
+ * If successful returns 0, else 1
+ */
+static unsigned char draw_cursor(abuf_t *ab, const long int pos);
+
 
 /* -------------------- GLOBAL FUNCTIONS -------------------- */
 
@@ -130,7 +257,7 @@ unsigned char initialize_term_raw_mode(void) {
     term.is_raw = 0;
     term.active_mode = STARTING_MODE;
 
-    sig_winch.error_detected = 0;
+    sig_winch.is_resized = 0;
 
     /* Set signal handler for SIGWINCH, and then raise it to initialize terminal window size */
     memset(&sig_winch.sa, 0, sizeof(sig_winch.sa));
@@ -140,7 +267,7 @@ unsigned char initialize_term_raw_mode(void) {
         return 1;
     if (raise(SIGWINCH))
         return 2;
-    if (sig_winch.error_detected == 1)
+    if (handle_resize() == 1)
         return 3;
 
     /* Get terminal initial state and save it for later */
@@ -196,6 +323,35 @@ unsigned char is_term_raw_mode(void) {
     return term.is_raw;
 }
 
+void term_set_file(const view_t *root) {
+    size_t size;
+
+    /* Without a window (e.g. the cap is too small, or the file can't be mapped) reads just use pread */
+    size = budget_cap() == 0 || budget_cap() / 2 > WINDOW_SIZE ? WINDOW_SIZE : budget_cap() / 2;
+    file_window_open(&term.window, root->file, size);
+
+    term.root_view = *root;
+    term.root_view.window = &term.window;
+    set_view(NULL);
+}
+
+void term_close_file(void) {
+    if (term.zsection != NULL) {
+        zsection_close(term.zsection);
+        term.zsection = NULL;
+    }
+    file_window_close(&term.window);
+}
+
+unsigned char term_select_member(const char *name) {
+    archive_member_t m;
+
+    if (is_archive() == 0 || archive_find_member(name, &m) == 1)
+        return 1;
+    set_view(&m);
+    return 0;
+}
+
 unsigned char term_loop(void) {
     unsigned char flag;
 
@@ -206,6 +362,9 @@ unsigned char term_loop(void) {
                 flag = PROCESS_KEYPRESS_ERROR;
                 break;
             }
+            /* Not inside refresh_screen(), which also runs when the window is resized */
+            if (term.active_mode->name != MODE_TABLE && term.active_mode->name != MODE_ENTRIES && term.zsection == NULL)
+                prefetch_hint(&term.view, term.active_mode->pos, (long int)term.data_rows * (long int)term.active_mode->row_len);
         }
         flag = process_keypress();
     }
@@ -224,26 +383,20 @@ unsigned char term_loop(void) {
 /* SIGNAL */
 
 static void sigwinch_handler(int sig) {
-    switch (sig) {
-        case SIGWINCH:
-            if (get_term_win_size() == 1) {
-                sig_winch.error_detected = 1;
-                break;
-            }
-            if (set_modes_row_len_and_pos() == 1) {
-                sig_winch.error_detected = 1;
-                break;
-            }
-            if (refresh_screen() == 1) {
-                sig_winch.error_detected = 1;
-                break;
-            }
-            sig_winch.error_detected = 0;
-            break;
+    if (sig == SIGWINCH)
+        sig_winch.is_resized = 1;
+}
 
-        default:
-            break;
-    }
+static unsigned char handle_resize(void) {
+    if (sig_winch.is_resized == 0)
+        return 0;
+    sig_winch.is_resized = 0;
+    if (get_term_win_size() == 1)
+        return 1;
+    session_record_resize(term.screen_rows, term.screen_cols);
+    if (set_modes_row_len_and_pos() == 1)
+        return 1;
+    return refresh_screen();
 }
 
 /* TERMINAL */
@@ -255,14 +408,12 @@ static unsigned char set_modes_row_len_and_pos(void) {
     mode_hex.row_len = term.screen_cols / 3;
     mode_form_char.row_len = term.screen_cols / 3;
     mode_char.row_len = term.screen_cols;
+    mode_disasm.row_len = term.screen_cols;
 
     /* DANGEROUS: dividing/multiplying long int by unsigned int */
     mode_hex.pos = (mode_hex.pos / (long int)mode_hex.row_len) * (long int)mode_hex.row_len;
     mode_form_char.pos = (mode_form_char.pos / (long int)mode_form_char.row_len) * (long int)mode_form_char.row_len;
     mode_char.pos = (mode_char.pos / (long int)mode_char.row_len) * (long int)mode_char.row_len;
-    
-    if (file_seek_set(term.active_mode->pos) == 1)
-        return 1;
     return 0;
 }
 
@@ -274,27 +425,21 @@ static unsigned char get_term_win_size(void) {
         return 1;
 
     term.screen_rows = ws.ws_row;
+    term.data_rows = ws.ws_row > 1 ? ws.ws_row - 1 : 1;
     term.screen_cols = ws.ws_col;
     return 0;
 }
 
 static unsigned char change_mode(const unsigned char mode) {
-    long int curr_pos;
-
-    /* Get current pos of active mode */
-    if ((curr_pos = file_tell()) == -1)
-        return 1;
-
-    /* Save current inside active mode (makes it so that MODE_HEX and MODE_FORM_CHAR share pos) */
+    /* MODE_HEX and MODE_FORM_CHAR share pos */
     switch (term.active_mode->name) {
         case MODE_HEX:
-            mode_form_char.pos = curr_pos;
+            mode_form_char.pos = mode_hex.pos;
             break;
         case MODE_FORM_CHAR:
-            mode_hex.pos = curr_pos;
+            mode_hex.pos = mode_form_char.pos;
             break;
     }
-    term.active_mode->pos = curr_pos;
 
     /* Changes active mode */
     switch (mode) {
@@ -309,63 +454,127 @@ static unsigned char change_mode(const unsigned char mode) {
         case MODE_FORM_CHAR:
             term.active_mode = &mode_form_char;
             break;
+
+        case MODE_TABLE:
+            term.active_mode = &mode_table;
+            break;
+
+        case MODE_DISASM:
+            /* Disassembly starts from the row shown by the byte modes */
+            if (term.active_mode->name != MODE_TABLE && term.active_mode->name != MODE_ENTRIES)
+                mode_disasm.pos = disasm_align(term.active_mode->pos);
+            term.active_mode = &mode_disasm;
+            break;
+
+        case MODE_ENTRIES:
+            term.active_mode = &mode_entries;
+            break;
         
         default:
             return 1;
     }
-    if (file_seek_set(term.active_mode->pos) == 1)
-        return 1;
     return 0;
 }
 
 /* INPUT */
 
 static unsigned char process_keypress(void) {
-    unsigned int i;
-    long int row_len;
+    archive_member_t m;
     char c;
 
-    row_len = (long int)term.active_mode->row_len;
+    if (read_key(&c) == 1)
+        return PROCESS_KEYPRESS_ERROR;
+    if (term.is_editing == 1)
+        return process_edit_keypress(c);
 
-    read_key(&c);
     switch (c) {
         case CTRL_KEY('q'):
             return PROCESS_KEYPRESS_QUIT;
 
+        case CTRL_KEY('e'):
+            if (term.zsection != NULL) {
+                strcpy(term.message, "decompressed views are read only");
+                return PROCESS_KEYPRESS_ACT;
+            }
+            if (term.active_mode->name == MODE_TABLE || term.active_mode->name == MODE_DISASM ||
+                term.active_mode->name == MODE_ENTRIES || (term.cursor = term.active_mode->pos) >= term.view.len)
+                return PROCESS_KEYPRESS_IGNORE;
+            term.is_editing = 1;
+            term.nibble = 0;
+            return PROCESS_KEYPRESS_ACT;
+
         case 'w':
         case 'W':
-            if (file_move(-1 * row_len) == 1)
-                return 2;
+            scroll(-1);
             return PROCESS_KEYPRESS_ACT;
 
         case 's':
         case 'S':
-            if (file_will_be_end(row_len) == 0) {
-                if (file_move(row_len) == 1)
-                    return PROCESS_KEYPRESS_ERROR;
-                return PROCESS_KEYPRESS_ACT;
-            } else if (file_will_be_end(row_len) == 1)
-                return PROCESS_KEYPRESS_ACT;
-            else
-                return PROCESS_KEYPRESS_ERROR;
+            scroll(1);
+            return PROCESS_KEYPRESS_ACT;
 
         case 'a':
         case 'A':
-            if (file_move(-1 * (long int)term.screen_rows * row_len) == 1)
-                return PROCESS_KEYPRESS_ERROR;
+            scroll(-1 * (long int)term.data_rows);
             return PROCESS_KEYPRESS_ACT;
 
         case 'd':
         case 'D':
-            for (i = 0; i < term.screen_rows; i++) {
-                if (file_will_be_end(row_len) == 0) {
-                    if (file_move(row_len) == 1)
-                        return PROCESS_KEYPRESS_ERROR;
-                } else if (file_will_be_end(row_len) == 1)
-                    return PROCESS_KEYPRESS_ACT;
-                else
-                    return PROCESS_KEYPRESS_ERROR;
+            scroll((long int)term.data_rows);
+            return PROCESS_KEYPRESS_ACT;
+
+        case 'n':
+        case 'N':
+            if (term.active_mode->name == MODE_TABLE)
+                return PROCESS_KEYPRESS_IGNORE;
+            /* Inside the ELF tables the next data worth a look is the next table */
+            if (term.active_mode->name == MODE_ENTRIES) {
+                if (entries_next() == 1)
+                    return PROCESS_KEYPRESS_IGNORE;
+                mode_entries.pos = 0;
+                return PROCESS_KEYPRESS_ACT;
             }
+            if (move_next_data() == 1)
+                return PROCESS_KEYPRESS_ERROR;
+            return PROCESS_KEYPRESS_ACT;
+
+        case ']':
+            if (is_archive() == 0)
+                return PROCESS_KEYPRESS_IGNORE;
+            if (term.in_member == 0) {
+                if (archive_first_member(&m) == 1)
+                    return PROCESS_KEYPRESS_IGNORE;
+            } else if (archive_next_member(&term.member, &m) == 1)
+                return PROCESS_KEYPRESS_IGNORE;
+            set_view(&m);
+            return PROCESS_KEYPRESS_ACT;
+
+        case '[':
+            if (term.in_member == 0)
+                return PROCESS_KEYPRESS_IGNORE;
+            if (archive_prev_member(&term.member, &m) == 1)
+                return PROCESS_KEYPRESS_IGNORE;
+            set_view(&m);
+            return PROCESS_KEYPRESS_ACT;
+
+        case 'r':
+        case 'R':
+            /* Back from a decompressed section to the view containing it */
+            if (term.zsection != NULL) {
+                set_view(term.in_member == 1 ? &term.member : NULL);
+                return PROCESS_KEYPRESS_ACT;
+            }
+            if (term.in_member == 0)
+                return PROCESS_KEYPRESS_IGNORE;
+            set_view(NULL);
+            return PROCESS_KEYPRESS_ACT;
+
+        case 'z':
+        case 'Z':
+            if (term.zsection != NULL)
+                return PROCESS_KEYPRESS_IGNORE;
+            /* If it fails the status line tells why */
+            set_zsection_view();
             return PROCESS_KEYPRESS_ACT;
 
         case 'h':
@@ -390,18 +599,154 @@ static unsigned char process_keypress(void) {
             if (change_mode(MODE_CHAR) == 1)
                 return PROCESS_KEYPRESS_ERROR;
             return PROCESS_KEYPRESS_ACT;
+
+        case 't':
+        case 'T':
+            if (term.active_mode->name == MODE_TABLE)
+                return PROCESS_KEYPRESS_IGNORE;
+            /* Workers hash in parallel, decompression can't */
+            if (term.zsection != NULL) {
+                strcpy(term.message, "decompressed views can't be hashed");
+                return PROCESS_KEYPRESS_ACT;
+            }
+            /* Hashing big files takes a while, the status line tells why nothing moves */
+            strcpy(term.message, "hashing...");
+            if (refresh_screen() == 1)
+                return PROCESS_KEYPRESS_ERROR;
+            if (load_hashes() == 1) {
+                strcpy(term.message, "hashing failed");
+                return PROCESS_KEYPRESS_ACT;
+            }
+            if (change_mode(MODE_TABLE) == 1)
+                return PROCESS_KEYPRESS_ERROR;
+            return PROCESS_KEYPRESS_ACT;
+
+        case 'i':
+        case 'I':
+            if (term.active_mode->name == MODE_DISASM)
+                return PROCESS_KEYPRESS_IGNORE;
+            if (change_mode(MODE_DISASM) == 1)
+                return PROCESS_KEYPRESS_ERROR;
+            return PROCESS_KEYPRESS_ACT;
+
+        case 'e':
+        case 'E':
+            if (term.active_mode->name == MODE_ENTRIES)
+                return PROCESS_KEYPRESS_IGNORE;
+            /* Opens the table shown by the byte modes (or the one after it) */
+            if (entries_open(&term.view, term.active_mode->name == MODE_TABLE ? 0 : term.active_mode->pos) == 1) {
+                strcpy(term.message, "no tables");
+                return PROCESS_KEYPRESS_ACT;
+            }
+            mode_entries.pos = 0;
+            if (change_mode(MODE_ENTRIES) == 1)
+                return PROCESS_KEYPRESS_ERROR;
+            return PROCESS_KEYPRESS_ACT;
         
         default:
             return PROCESS_KEYPRESS_IGNORE;
     }
 }
 
+static unsigned char process_edit_keypress(const char c) {
+    overlay_t *overlay;
+    char *path;
+    long int row_len, off;
+    char arrow;
+
+    row_len = (long int)term.active_mode->row_len;
+    overlay = file_overlay(term.view.file);
+
+    switch (c) {
+        case CTRL_KEY('q'):
+            return PROCESS_KEYPRESS_QUIT;
+
+        case CTRL_KEY('e'):
+            term.is_editing = 0;
+            return PROCESS_KEYPRESS_ACT;
+
+        case '\x1b':
+            if (read_arrow(&arrow) == 1)
+                return PROCESS_KEYPRESS_IGNORE;
+            term.nibble = 0;
+            switch (arrow) {
+                case 'A':
+                    return move_cursor(-1 * row_len) == 1 ? PROCESS_KEYPRESS_ERROR : PROCESS_KEYPRESS_ACT;
+                case 'B':
+                    return move_cursor(row_len) == 1 ? PROCESS_KEYPRESS_ERROR : PROCESS_KEYPRESS_ACT;
+                case 'C':
+                    return move_cursor(1) == 1 ? PROCESS_KEYPRESS_ERROR : PROCESS_KEYPRESS_ACT;
+                case 'D':
+                    return move_cursor(-1) == 1 ? PROCESS_KEYPRESS_ERROR : PROCESS_KEYPRESS_ACT;
+                default:
+                    return PROCESS_KEYPRESS_IGNORE;
+            }
+
+        case CTRL_KEY('z'):
+        case CTRL_KEY('y'):
+            if ((c == CTRL_KEY('z') ? overlay_undo(overlay, &off) : overlay_redo(overlay, &off)) == 1)
+                return PROCESS_KEYPRESS_IGNORE;
+            entries_forget_names();
+            term.nibble = 0;
+            /* The edit may be outside the active view (made before changing archive member) */
+            off -= term.view.base;
+            if (off < 0 || off >= term.view.len)
+                return PROCESS_KEYPRESS_ACT;
+            return move_cursor(off - term.cursor) == 1 ? PROCESS_KEYPRESS_ERROR : PROCESS_KEYPRESS_ACT;
+
+        case CTRL_KEY('s'):
+            if (overlay_save(overlay, file_path(term.view.file)) == 1)
+                strcpy(term.message, "save failed");
+            else
+                strcpy(term.message, "saved");
+            return PROCESS_KEYPRESS_ACT;
+
+        case CTRL_KEY('w'):
+            /* The path is never cut: a cut one could name (and truncate) an unrelated file */
+            if ((path = malloc(strlen(file_path(term.view.file)) + sizeof(PATCHED_SUFFIX))) == NULL)
+                return PROCESS_KEYPRESS_ERROR;
+            strcpy(path, file_path(term.view.file));
+            strcat(path, PATCHED_SUFFIX);
+            if (overlay_save_as(overlay, path) == 1)
+                strcpy(term.message, "save as failed");
+            else
+                sprintf(term.message, "saved as %.*s", MESSAGE_SIZE - 10, path);
+            free(path);
+            return PROCESS_KEYPRESS_ACT;
+
+        default:
+            return edit_byte(c);
+    }
+}
+
+static unsigned char read_arrow(char *c) {
+    char seq[2];
+
+    /* Arrow keys send "ESC [ X", and the rest of the sequence is already there (VTIME makes read() time out otherwise) */
+    if (read(STDIN_FILENO, &seq[0], 1) != 1)
+        return 1;
+    session_record_key(seq[0]);
+    if (read(STDIN_FILENO, &seq[1], 1) != 1)
+        return 1;
+    session_record_key(seq[1]);
+    if (seq[0] != '[')
+        return 1;
+    *c = seq[1];
+    return 0;
+}
+
 static unsigned char read_key(char *c) {
     ssize_t nread;
+    /* Resizes are handled while waiting (read() times out every VTIME), and before a key that arrives with one */
     while ((nread = read(STDIN_FILENO, c, 1)) != 1) {
+        if (handle_resize() == 1)
+            return 1;
         if (nread == -1 && errno != EAGAIN)
             return 1;
     }
+    if (handle_resize() == 1)
+        return 1;
+    session_record_key(*c);
     return 0;
 }
 
@@ -409,13 +754,18 @@ static unsigned char read_key(char *c) {
 
 static unsigned char refresh_screen(void) {
     abuf_t ab = ABUF_INIT;
+    long int pos;
 
     if (ab_append(&ab, VT100_CUR_HIDE, sizeof(VT100_CUR_HIDE) - 1) == 1)
         return 1;
     if (ab_append(&ab, VT100_CUR_TOP_L, sizeof(VT100_CUR_TOP_L) - 1) == 1)
         return 1;
+    pos = term.active_mode != NULL ? term.active_mode->pos : 0;
     draw_rows(&ab);
-    if (ab_append(&ab, VT100_CUR_TOP_L, sizeof(VT100_CUR_TOP_L) - 1) == 1)
+    if (term.is_editing == 1 && term.active_mode != NULL) {
+        if (draw_cursor(&ab, pos) == 1)
+            return 1;
+    } else if (ab_append(&ab, VT100_CUR_TOP_L, sizeof(VT100_CUR_TOP_L) - 1) == 1)
         return 1;
     if (ab_append(&ab, VT100_CUR_SHOW, sizeof(VT100_CUR_SHOW) - 1) == 1)
         return 1;
@@ -430,12 +780,14 @@ static unsigned char refresh_screen(void) {
 static unsigned char draw_rows(abuf_t *ab) {
     size_t bytes;
     unsigned int y;
+    long int pos;
 
+    pos = term.active_mode != NULL ? term.active_mode->pos : 0;
     bytes = 0;
-    for (y = 0; y < term.screen_rows; y++) {
+    for (y = 0; y < term.data_rows; y++) {
 
         if (term.active_mode != NULL)
-            bytes += term.active_mode->write_func(ab, term.active_mode->row_len);
+            bytes += term.active_mode->write_func(ab, &term.view, pos + (long int)bytes, term.active_mode->row_len);  /* DANGEROUS: converting size_t to long int */
 
         if (ab_append(ab, VT100_ERASE_LINE, sizeof(VT100_ERASE_LINE) - 1) == 1)
             return 1;
@@ -445,9 +797,300 @@ static unsigned char draw_rows(abuf_t *ab) {
         }
     }
 
-    if (term.active_mode != NULL) {
-        if (file_move(-1 * ((long int)bytes)) == 0)  /* DANGEROUS: converting size_t to long int */
+    if (term.screen_rows > 1 && draw_status(ab, pos) == 1)
+        return 1;
+    return 0;
+}
+
+static unsigned char draw_status(abuf_t *ab, const long int pos) {
+    static const char *const MODE_NAMES[] = {"HEX", "FORM_CHAR", "CHAR", "TABLE", "DISASM", "ENTRIES"};
+    char status[STATUS_LINE_SIZE];
+    char where[48];
+    char label[STATUS_LINE_SIZE];
+    char used[BUDGET_SIZE_STR_SIZE];
+    char cap[BUDGET_SIZE_STR_SIZE];
+    prefetch_stats_t stats;
+    long int shown_pos;
+    size_t len;
+
+    if (term.active_mode == NULL)
+        return ab_append(ab, VT100_ERASE_LINE, sizeof(VT100_ERASE_LINE) - 1);
+
+    shown_pos = term.is_editing == 1 ? term.cursor : pos;
+    if (core_notes_label(term.view.base + pos, label, sizeof(label)) == 1 &&
+        (term.active_mode->name == MODE_TABLE || term.active_mode->name == MODE_ENTRIES ||
+         dwarf_line_label(shown_pos, label, sizeof(label)) == 1))
+        label[0] = '\0';
+    if (term.is_editing == 1) {
+        /* While editing the status line follows the cursor, and tells about edits instead of the position label */
+        snprintf(label, sizeof(label), "%lu page(s) patched", (unsigned long int)overlay_n_pages(file_overlay(term.view.file)));
+    } else if (term.active_mode->name == MODE_TABLE && term.hashes != NULL)
+        hashes_summary(term.hashes, label, sizeof(label));
+    else if (term.active_mode->name == MODE_ENTRIES)
+        entries_summary(label, sizeof(label));
+    if (term.message[0] != '\0') {
+        strcpy(label, term.message);
+        term.message[0] = '\0';
+    }
+    if (term.active_mode->name == MODE_TABLE || term.active_mode->name == MODE_ENTRIES)
+        snprintf(where, sizeof(where), "line %ld / %ld", shown_pos, mode_len());
+    else
+        snprintf(where, sizeof(where), "0x%08lx / 0x%08lx", shown_pos, term.view.len);
+    prefetch_get_stats(&stats);
+    budget_format_size(used, budget_used());
+    cap[0] = '\0';
+    if (budget_cap() != 0) {
+        cap[0] = '/';
+        budget_format_size(cap + 1, budget_cap());
+    }
+    /* pf = prefetched blocks shown / wasted, mem = memory charged to the budget / cap */
+    snprintf(status, sizeof(status), " %s%s%s | %.64s | %s | pf %lu/%lu | mem %s%s | %.*s", MODE_NAMES[term.active_mode->name],
+            term.is_editing == 1 ? " EDIT" : "", overlay_is_modified(file_overlay(term.view.file)) == 1 ? "*" : "",
+            term.view.name, where, stats.hits, stats.wasted, used, cap, STATUS_LINE_SIZE - 192, label);
+
+    len = strlen(status);
+    if (len > term.screen_cols)
+        len = term.screen_cols;
+
+    if (ab_append(ab, VT100_INVERT, sizeof(VT100_INVERT) - 1) == 1)
+        return 1;
+    if (ab_append(ab, status, len) == 1)
+        return 1;
+    if (ab_append(ab, VT100_ERASE_LINE, sizeof(VT100_ERASE_LINE) - 1) == 1)
+        return 1;
+    if (ab_append(ab, VT100_RESET, sizeof(VT100_RESET) - 1) == 1)
+        return 1;
+    return 0;
+}
+
+/* NAVIGATION */
+
+static unsigned char move_next_data(void) {
+    long int pos, start, end, row_len;
+
+    pos = term.active_mode->pos;
+
+    /* Inside the disassembly the next data worth a look is the next executable section */
+    if (term.active_mode->name == MODE_DISASM) {
+        term.active_mode->pos = disasm_next_code(pos);
+        return 0;
+    }
+
+    /* Skip the extent containing pos, the next one begins after a hole */
+    if (file_next_extent(&term.view, pos, &start, &end) == 1)
+        return 0;
+    if (start <= pos && file_next_extent(&term.view, end, &start, &end) == 1)
+        return 0;
+
+    row_len = (long int)term.active_mode->row_len;
+    term.active_mode->pos = (start / row_len) * row_len;
+    return 0;
+}
+
+static void set_view(const archive_member_t *m) {
+    if (term.zsection != NULL) {
+        zsection_close(term.zsection);
+        term.zsection = NULL;
+    }
+    if (m == NULL) {
+        term.in_member = 0;
+        term.view = term.root_view;
+    } else {
+        term.in_member = 1;
+        term.member = *m;
+        archive_member_view(&term.root_view, m, &term.view);
+    }
+    reset_view();
+}
+
+static unsigned char set_zsection_view(void) {
+    zsection_t *z;
+    long int pos;
+
+    pos = term.active_mode->name == MODE_TABLE || term.active_mode->name == MODE_ENTRIES ? 0 : term.active_mode->pos;
+    switch (zsection_open_at(&z, &term.view, pos)) {
+        case ZSECTION_OK:
+            break;
+        case ZSECTION_UNSUPPORTED:
+            strcpy(term.message, "only zlib sections can be decompressed");
+            return 1;
+        default:
+            strcpy(term.message, "no compressed sections");
             return 1;
     }
+
+    /* The decompressed bytes aren't an ELF file: tables are left */
+    if (term.active_mode->name == MODE_TABLE || term.active_mode->name == MODE_ENTRIES)
+        change_mode(MODE_HEX);
+    term.zsection = z;
+    zsection_view(z, &term.view);
+    reset_view();
+    return 0;
+}
+
+static void reset_view(void) {
+    dwarf_line_set_view(&term.view);
+    disasm_set_view(&term.view);
+
+    mode_hex.pos = 0;
+    mode_form_char.pos = 0;
+    mode_char.pos = 0;
+    mode_table.pos = 0;
+    mode_disasm.pos = 0;
+    mode_entries.pos = 0;
+    term.is_editing = 0;
+
+    /* The table follows the view */
+    term.hashes = NULL;
+    if (term.active_mode == &mode_table && load_hashes() == 1) {
+        strcpy(term.message, "hashing failed");
+        change_mode(MODE_HEX);
+    }
+    if (term.active_mode == &mode_entries && entries_open(&term.view, 0) == 1) {
+        strcpy(term.message, "no tables");
+        change_mode(MODE_HEX);
+    }
+}
+
+static long int mode_len(void) {
+    if (term.active_mode->name == MODE_TABLE)
+        return term.hashes != NULL ? (long int)hashes_n_lines(term.hashes) : 0;
+    if (term.active_mode->name == MODE_ENTRIES)
+        return (long int)entries_n_lines();
+    return term.view.len;
+}
+
+static unsigned char load_hashes(void) {
+    /* A failed computation may have evicted the previous table */
+    if (hashes_compute(&term.view, &term.hashes) == 1) {
+        term.hashes = NULL;
+        return 1;
+    }
     return 0;
 }
+
+static void scroll(const long int rows) {
+    long int row_len, pos;
+
+    /* Instructions have different lengths, the disassembly knows where rows begin */
+    if (term.active_mode->name == MODE_DISASM) {
+        term.active_mode->pos = disasm_scroll(term.active_mode->pos, rows);
+        return;
+    }
+    row_len = (long int)term.active_mode->row_len;
+    pos = term.active_mode->pos + rows * row_len;
+    if (rows > 0 && pos >= mode_len())
+        pos = term.active_mode->pos + ((mode_len() - 1 - term.active_mode->pos) / row_len) * row_len;
+    term.active_mode->pos = pos < 0 ? 0 : pos;
+}
+
+/* EDIT */
+
+static unsigned char move_cursor(const long int delta) {
+    long int pos, row_len, page_len;
+
+    if (term.cursor + delta < 0 || term.cursor + delta >= term.view.len)
+        return 0;
+    term.cursor += delta;
+
+    /* Scroll whole rows, like 'w' and 's' do */
+    pos = term.active_mode->pos;
+    row_len = (long int)term.active_mode->row_len;
+    page_len = (long int)term.data_rows * row_len;
+    if (term.cursor < pos)
+        term.active_mode->pos = (term.cursor / row_len) * row_len;
+    else if (term.cursor >= pos + page_len)
+        term.active_mode->pos = (term.cursor / row_len + 1) * row_len - page_len;
+    return 0;
+}
+
+static unsigned char edit_byte(const char c) {
+    unsigned char byte;
+
+    if (term.active_mode->name == MODE_HEX ? isxdigit((unsigned char)c) == 0 : isprint((unsigned char)c) == 0)
+        return PROCESS_KEYPRESS_IGNORE;
+
+    if (view_read(&term.view, &byte, 1, term.cursor) != 1)
+        return PROCESS_KEYPRESS_ERROR;
+
+    if (term.active_mode->name == MODE_HEX) {
+        /* Hex digits are typed high nibble first, then the cursor moves to the next byte */
+        if (term.nibble == 0)
+            byte = (unsigned char)((byte & 0x0f) | ((isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10) << 4));
+        else
+            byte = (unsigned char)((byte & 0xf0) | (isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10));
+    } else
+        byte = (unsigned char)c;
+
+    if (overlay_set(file_overlay(term.view.file), term.view.base + term.cursor, byte) == 1) {
+        strcpy(term.message, "memory cap reached");
+        return PROCESS_KEYPRESS_ACT;
+    }
+    entries_forget_names();
+
+    if (term.active_mode->name == MODE_HEX && term.nibble == 0) {
+        term.nibble = 1;
+        return PROCESS_KEYPRESS_ACT;
+    }
+    term.nibble = 0;
+    return move_cursor(1) == 1 ? PROCESS_KEYPRESS_ERROR : PROCESS_KEYPRESS_ACT;
+}
+
+static unsigned char draw_cursor(abuf_t *ab, const long int pos) {
+    char seq[CURSOR_SEQ_SIZE];
+    long int idx;
+    unsigned int row, col;
+
+    idx = term.cursor - pos;
+    row = (unsigned int)(idx / (long int)term.active_mode->row_len) + 1;
+    idx %= (long int)term.active_mode->row_len;
+
+    /* MODE_HEX and MODE_FORM_CHAR use 3 columns per byte, MODE_CHAR 1 */
+    if (term.active_mode->name == MODE_CHAR)
+        col = (unsigned int)idx + 1;
+    else if (term.active_mode->name == MODE_HEX)
+        col = (unsigned int)idx * 3 + term.nibble + 1;
+    else
+        col = (unsigned int)idx * 3 + 2;
+
+    sprintf(seq, "\x1b[%u;%uH", row, col);
+    return ab_append(ab, seq, strlen(seq));
+}
+
+/* TABLE */
+
+static size_t append_table_line(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
+    char line[TABLE_LINE_SIZE];
+    size_t line_len;
+
+    (void)v;
+    (void)len;
+    if (term.hashes == NULL || pos < 0 || (size_t)pos >= hashes_n_lines(term.hashes))
+        return 0;
+
+    hashes_line(term.hashes, (size_t)pos, line, sizeof(line));
+    line_len = strlen(line);
+    if (line_len > term.screen_cols)
+        line_len = term.screen_cols;
+    if (ab_append(ab, line, line_len) == 1)
+        return 0;
+    return 1;
+}
+
+static size_t append_entries_line(abuf_t *ab, const view_t *v, const long int pos, const size_t len) {
+    char line[TABLE_LINE_SIZE];
+    size_t line_len;
+
+    (void)v;
+    (void)len;
+    if (pos < 0 || (size_t)pos >= entries_n_lines())
+        return 0;
+
+    entries_line((size_t)pos, line, sizeof(line));
+    line_len = strlen(line);
+    if (line_len > term.screen_cols)
+        line_len = term.screen_cols;
+    if (ab_append(ab, line, line_len) == 1)
+        return 0;
+    return 1;
+}
@@ -0,0 +1,544 @@
+#define _XOPEN_SOURCE 700  /* for pread, lstat and pthread */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <dirent.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "abuf.h"
+#include "elf_parse.h"
+#include "json.h"
+#include "pool.h"
+
+#include "scan.h"
+
+
+#define SRC_BUF_SIZE        4096
+#define SHSTRTAB_MAX_SIZE   (64 * 1024)
+#define BUILD_ID_MAX_SIZE   64
+#define RECORD_LINE_SIZE    512
+
+#define RELRO_NONE     0
+#define RELRO_PARTIAL  1
+#define RELRO_FULL     2
+
+#define CSV_HEADER  "path,class,endian,type,machine,osabi,pie,relro,nx,sections,text_size,rodata_size,data_size,bss_size,build_id\n"
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a scheduled file (path is stored right after the struct) */
+typedef struct scan_task_tag {
+    long int size;
+    char *path;
+} scan_task_t;
+
+/*
+ * struct for a file read with pread(), through a one block cache
+ * Headers are clustered at the beginning (ELF and program headers) and at the end (section headers)
+ * of files, so most files are parsed with a handful of reads
+ */
+typedef struct scan_src_tag {
+    int fd;
+    long int buf_off;
+    size_t buf_len;
+    unsigned char buf[SRC_BUF_SIZE];
+} scan_src_t;
+
+/* struct for the result of the analysis of a file */
+typedef struct scan_record_tag {
+    elf_ehdr_t eh;
+    unsigned char is_pie;
+    unsigned char relro;
+    unsigned char is_nx;
+    unsigned long int text_size;
+    unsigned long int rodata_size;
+    unsigned long int data_size;
+    unsigned long int bss_size;
+    unsigned char build_id[BUILD_ID_MAX_SIZE];
+    size_t build_id_len;
+} scan_record_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing scan data */
+static struct scan_tag {
+    unsigned char format;
+    pthread_mutex_t out_lock;  /* protects stdout and the counters (updated by both the walker and the workers) */
+    unsigned long int n_files;
+    unsigned long int n_elfs;
+    unsigned long int n_errors;
+} scan;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Walks path recursively, submitting regular files to the pool
+ * If successful returns 0, else 1
+ */
+static unsigned char walk(const char *path);
+
+/* Analyzes the file of a scan_task_t, and writes its record (executed by workers) */
+static void scan_file(void *arg);
+
+/*
+ * Parses program headers, dynamic entries, sections and notes into rec
+ * If successful returns 0, else 1
+ */
+static unsigned char analyze(const elf_reader_t *r, scan_record_t *rec);
+
+/* Parses dynamic entries inside [off, off + size) of rec, and sets *bind_now and *is_pie_flag */
+static void analyze_dynamic(const elf_reader_t *r, const scan_record_t *rec, const long int off, const unsigned long int size,
+                            unsigned char *bind_now, unsigned char *is_pie_flag);
+
+/* Looks for NT_GNU_BUILD_ID inside notes [off, off + size) */
+static void analyze_notes(const elf_reader_t *r, scan_record_t *rec, const long int off, const unsigned long int size);
+
+/* Sets section sizes of rec from section headers */
+static void analyze_sections(const elf_reader_t *r, scan_record_t *rec);
+
+/*
+ * Formats rec as a JSON object or a CSV row terminated by a new line
+ * If successful returns 0, else 1
+ */
+static unsigned char format_record(abuf_t *ab, const char *path, const scan_record_t *rec);
+
+/* Counts a file that couldn't be scanned (under scan.out_lock, workers and the walker may fail at once) */
+static void count_error(void);
+
+/* Read callback for scan_src_t */
+static size_t src_read(void *ctx, void *buf, const size_t len, const long int off);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char scan_tree(const char *root, const unsigned char format, const unsigned int n_jobs) {
+    unsigned char status;
+
+    scan.format = format;
+    scan.n_files = 0;
+    scan.n_elfs = 0;
+    scan.n_errors = 0;
+    pthread_mutex_init(&scan.out_lock, NULL);
+
+    if (pool_start(n_jobs) == 1) {
+        pthread_mutex_destroy(&scan.out_lock);
+        return 1;
+    }
+
+    if (format == SCAN_FORMAT_CSV)
+        fputs(CSV_HEADER, stdout);
+
+    status = walk(root);
+    pool_stop();
+    fflush(stdout);
+
+    fprintf(stderr, "scanned %lu files: %lu ELF, %lu unreadable\n", scan.n_files, scan.n_elfs, scan.n_errors);
+    pthread_mutex_destroy(&scan.out_lock);
+    return status;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* WALK */
+
+static unsigned char walk(const char *path) {
+    struct stat st;
+    struct dirent *entry;
+    scan_task_t *task;
+    size_t path_len;
+    char *child;
+    DIR *dir;
+
+    if (lstat(path, &st) == -1) {
+        count_error();
+        return 0;
+    }
+
+    /* Files: only those big enough to contain an ELF header are worth a task */
+    if (S_ISREG(st.st_mode)) {
+        pthread_mutex_lock(&scan.out_lock);
+        scan.n_files++;
+        pthread_mutex_unlock(&scan.out_lock);
+        if (st.st_size < EI_NIDENT)
+            return 0;
+        path_len = strlen(path);
+        if ((task = malloc(sizeof(*task) + path_len + 1)) == NULL)
+            return 1;
+        task->size = (long int)st.st_size;
+        task->path = (char *)(task + 1);
+        memcpy(task->path, path, path_len + 1);
+        if (pool_submit(scan_file, task) == 1) {
+            free(task);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (S_ISDIR(st.st_mode) == 0)
+        return 0;
+
+    if ((dir = opendir(path)) == NULL) {
+        count_error();
+        return 0;
+    }
+    path_len = strlen(path);
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        if ((child = malloc(path_len + strlen(entry->d_name) + 2)) == NULL) {
+            closedir(dir);
+            return 1;
+        }
+        strcpy(child, path);
+        if (path_len == 0 || path[path_len - 1] != '/')
+            strcat(child, "/");
+        strcat(child, entry->d_name);
+        if (walk(child) == 1) {
+            free(child);
+            closedir(dir);
+            return 1;
+        }
+        free(child);
+    }
+    closedir(dir);
+    return 0;
+}
+
+/* ANALYSIS */
+
+static void scan_file(void *arg) {
+    scan_task_t *task;
+    scan_src_t *src;
+    scan_record_t rec;
+    elf_reader_t r;
+    abuf_t ab = ABUF_INIT;
+    unsigned char magic[SELFMAG];
+    unsigned char status, is_elf;
+
+    task = (scan_task_t *)arg;
+    if ((src = malloc(sizeof(*src))) == NULL) {
+        count_error();
+        free(task);
+        return;
+    }
+    if ((src->fd = open(task->path, O_RDONLY | O_NOCTTY)) == -1) {
+        count_error();
+        free(src);
+        free(task);
+        return;
+    }
+    src->buf_off = 0;
+    src->buf_len = 0;
+
+    r.read = src_read;
+    r.ctx = src;
+    r.len = task->size;
+
+    /* Files which are not ELF are silently skipped, ELF ones without a record are counted as unreadable */
+    status = 1;
+    is_elf = 0;
+    if (elf_read_ehdr(&r, &rec.eh) == 0) {
+        is_elf = 1;
+        if (analyze(&r, &rec) == 0)
+            status = format_record(&ab, task->path, &rec);
+    } else if (src_read(src, magic, SELFMAG, 0) == SELFMAG && memcmp(magic, ELFMAG, SELFMAG) == 0)
+        is_elf = 1;
+
+    close(src->fd);
+    free(src);
+
+    if (status == 0) {
+        pthread_mutex_lock(&scan.out_lock);
+        fwrite(ab.b, 1, ab.len, stdout);
+        scan.n_elfs++;
+        pthread_mutex_unlock(&scan.out_lock);
+    } else if (is_elf == 1)
+        count_error();
+    ab_free(&ab);
+    free(task);
+}
+
+static unsigned char analyze(const elf_reader_t *r, scan_record_t *rec) {
+    elf_phdr_t ph;
+    unsigned int i;
+    unsigned char has_interp, has_relro, has_gnu_stack, bind_now, is_pie_flag;
+
+    has_interp = 0;
+    has_relro = 0;
+    has_gnu_stack = 0;
+    bind_now = 0;
+    is_pie_flag = 0;
+    rec->is_nx = 0;
+    rec->build_id_len = 0;
+
+    for (i = 0; i < rec->eh.phnum; i++) {
+        if (elf_read_phdr(r, &rec->eh, i, &ph) == 1)
+            return 1;
+        switch (ph.type) {
+            case PT_INTERP:
+                has_interp = 1;
+                break;
+
+            case PT_GNU_RELRO:
+                has_relro = 1;
+                break;
+
+            case PT_GNU_STACK:
+                has_gnu_stack = 1;
+                rec->is_nx = (ph.flags & PF_X) == 0;
+                break;
+
+            case PT_DYNAMIC:
+                analyze_dynamic(r, rec, ph.offset, ph.filesz, &bind_now, &is_pie_flag);
+                break;
+
+            case PT_NOTE:
+                if (rec->build_id_len == 0)
+                    analyze_notes(r, rec, ph.offset, ph.filesz);
+                break;
+        }
+    }
+
+    /* Without PT_GNU_STACK the stack is executable */
+    if (has_gnu_stack == 0)
+        rec->is_nx = 0;
+    rec->is_pie = rec->eh.type == ET_DYN && (has_interp || is_pie_flag);
+    rec->relro = has_relro ? (bind_now ? RELRO_FULL : RELRO_PARTIAL) : RELRO_NONE;
+
+    analyze_sections(r, rec);
+    return 0;
+}
+
+static void analyze_dynamic(const elf_reader_t *r, const scan_record_t *rec, const long int off, const unsigned long int size,
+                            unsigned char *bind_now, unsigned char *is_pie_flag) {
+    unsigned char raw[16];
+    unsigned long int tag, val, i;
+    size_t word;
+
+    word = rec->eh.is_64 ? 8 : 4;
+    for (i = 0; i + 2 * word <= size; i += 2 * word) {
+        if (r->read(r->ctx, raw, 2 * word, off + (long int)i) != 2 * word)
+            return;
+        tag = elf_get(&rec->eh, raw, (unsigned int)word);
+        val = elf_get(&rec->eh, raw + word, (unsigned int)word);
+        if (tag == DT_NULL)
+            return;
+        if (tag == DT_BIND_NOW || (tag == DT_FLAGS && (val & DF_BIND_NOW)) || (tag == DT_FLAGS_1 && (val & DF_1_NOW)))
+            *bind_now = 1;
+        if (tag == DT_FLAGS_1 && (val & DF_1_PIE))
+            *is_pie_flag = 1;
+    }
+}
+
+static void analyze_notes(const elf_reader_t *r, scan_record_t *rec, const long int off, const unsigned long int size) {
+    elf_note_t note;
+    char name[4];
+    long int pos, end;
+
+    end = off + (long int)size;
+    for (pos = off; pos < end; ) {
+        if ((pos = elf_read_note(r, &rec->eh, pos, end, &note)) == -1)
+            return;
+        if (note.type != NT_GNU_BUILD_ID || note.namesz != 4 || note.descsz > BUILD_ID_MAX_SIZE)
+            continue;
+        if (r->read(r->ctx, name, 4, note.name_off) != 4 || memcmp(name, "GNU", 4) != 0)
+            continue;
+        if (r->read(r->ctx, rec->build_id, note.descsz, note.desc_off) == note.descsz)
+            rec->build_id_len = note.descsz;
+        return;
+    }
+}
+
+static void analyze_sections(const elf_reader_t *r, scan_record_t *rec) {
+    elf_shdr_t sh, strtab;
+    char *names;
+    const char *name;
+    unsigned int i;
+    size_t names_len;
+
+    rec->text_size = 0;
+    rec->rodata_size = 0;
+    rec->data_size = 0;
+    rec->bss_size = 0;
+
+    if (rec->eh.shnum == 0 || rec->eh.shstrndx >= rec->eh.shnum)
+        return;
+    if (elf_read_shdr(r, &rec->eh, rec->eh.shstrndx, &strtab) == 1)
+        return;
+
+    /* Section names are read at once */
+    names_len = strtab.size < SHSTRTAB_MAX_SIZE ? (size_t)strtab.size : SHSTRTAB_MAX_SIZE;
+    if ((names = malloc(names_len + 1)) == NULL)
+        return;
+    names_len = r->read(r->ctx, names, names_len, strtab.offset);
+    names[names_len] = '\0';
+
+    for (i = 0; i < rec->eh.shnum; i++) {
+        if (elf_read_shdr(r, &rec->eh, i, &sh) == 1)
+            break;
+
+        /* Relocatable objects have no PT_NOTE */
+        if (sh.type == SHT_NOTE && rec->build_id_len == 0)
+            analyze_notes(r, rec, sh.offset, sh.size);
+
+        if (sh.name >= names_len)
+            continue;
+        name = &names[sh.name];
+        if (strcmp(name, ".text") == 0)
+            rec->text_size = sh.size;
+        else if (strcmp(name, ".rodata") == 0)
+            rec->rodata_size = sh.size;
+        else if (strcmp(name, ".data") == 0)
+            rec->data_size = sh.size;
+        else if (strcmp(name, ".bss") == 0)
+            rec->bss_size = sh.size;
+    }
+    free(names);
+}
+
+/* OUTPUT */
+
+static unsigned char format_record(abuf_t *ab, const char *path, const scan_record_t *rec) {
+    static const char *const RELRO_NAMES[] = {"none", "partial", "full"};
+    char line[RECORD_LINE_SIZE];
+    char number[16];
+    const char *type, *machine, *osabi;
+    size_t i, len;
+
+    type = elf_type_name(rec->eh.type);
+    machine = elf_machine_name(rec->eh.machine);
+    osabi = elf_osabi_name(rec->eh.osabi);
+
+    if (scan.format == SCAN_FORMAT_CSV) {
+        /* Quotes inside the path are doubled */
+        if (ab_append(ab, "\"", 1))
+            return 1;
+        for (; *path != '\0'; path += len) {
+            len = strcspn(path, "\"");
+            if (len == 0)
+                len = 1;
+            if (ab_append(ab, path, len))
+                return 1;
+            if (*path == '"' && ab_append(ab, "\"", 1))
+                return 1;
+        }
+        sprintf(line, "\",%d,%s,", rec->eh.is_64 ? 64 : 32, rec->eh.is_big ? "big" : "little");
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+        if (type != NULL)
+            sprintf(line, "%s,", type);
+        else
+            sprintf(line, "%u,", rec->eh.type);
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+        if (machine != NULL)
+            sprintf(line, "%s,", machine);
+        else
+            sprintf(line, "%u,", rec->eh.machine);
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+        if (osabi != NULL)
+            sprintf(line, "%s,", osabi);
+        else
+            sprintf(line, "%u,", (unsigned int)rec->eh.osabi);
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+        sprintf(line, "%d,%s,%d,%u,%lu,%lu,%lu,%lu,", rec->is_pie, RELRO_NAMES[rec->relro], rec->is_nx, rec->eh.shnum,
+                rec->text_size, rec->rodata_size, rec->data_size, rec->bss_size);
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+    } else {
+        if (ab_append(ab, "{\"path\":", 8) || json_append_str(ab, path))
+            return 1;
+        sprintf(line, ",\"class\":%d,\"endian\":\"%s\",\"type\":", rec->eh.is_64 ? 64 : 32, rec->eh.is_big ? "big" : "little");
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+        sprintf(number, "%u", rec->eh.type);
+        if (json_append_str(ab, type != NULL ? type : number))
+            return 1;
+        sprintf(number, "%u", rec->eh.machine);
+        if (ab_append(ab, ",\"machine\":", 11) || json_append_str(ab, machine != NULL ? machine : number))
+            return 1;
+        sprintf(number, "%u", (unsigned int)rec->eh.osabi);
+        if (ab_append(ab, ",\"osabi\":", 9) || json_append_str(ab, osabi != NULL ? osabi : number))
+            return 1;
+        sprintf(line, ",\"pie\":%s,\"relro\":\"%s\",\"nx\":%s,\"sections\":{\"count\":%u,\".text\":%lu,\".rodata\":%lu,"
+                "\".data\":%lu,\".bss\":%lu},\"build_id\":", rec->is_pie ? "true" : "false", RELRO_NAMES[rec->relro],
+                rec->is_nx ? "true" : "false", rec->eh.shnum, rec->text_size, rec->rodata_size, rec->data_size,
+                rec->bss_size);
+        if (ab_append(ab, line, strlen(line)))
+            return 1;
+        if (rec->build_id_len == 0 && ab_append(ab, "null", 4))
+            return 1;
+        if (rec->build_id_len > 0 && ab_append(ab, "\"", 1))
+            return 1;
+    }
+
+    for (i = 0; i < rec->build_id_len; i++) {
+        sprintf(number, "%02x", rec->build_id[i]);
+        if (ab_append(ab, number, 2))
+            return 1;
+    }
+
+    if (scan.format == SCAN_FORMAT_CSV)
+        return ab_append(ab, "\n", 1);
+    if (rec->build_id_len > 0 && ab_append(ab, "\"", 1))
+        return 1;
+    return ab_append(ab, "}\n", 2);
+}
+
+/* UTILS */
+
+static void count_error(void) {
+    pthread_mutex_lock(&scan.out_lock);
+    scan.n_errors++;
+    pthread_mutex_unlock(&scan.out_lock);
+}
+
+/* READER */
+
+static size_t src_read(void *ctx, void *buf, const size_t len, const long int off) {
+    scan_src_t *src;
+    ssize_t n;
+    size_t done;
+
+    src = (scan_src_t *)ctx;
+
+    /* Cache hit */
+    if (off >= src->buf_off && off + (long int)len <= src->buf_off + (long int)src->buf_len) {
+        memcpy(buf, &src->buf[off - src->buf_off], len);
+        return len;
+    }
+
+    /* Big reads bypass the cache */
+    if (len > SRC_BUF_SIZE) {
+        for (done = 0; done < len; done += (size_t)n) {
+            if ((n = pread(src->fd, (char *)buf + done, len - done, off + (long int)done)) <= 0)
+                break;
+        }
+        return done;
+    }
+
+    if ((n = pread(src->fd, src->buf, SRC_BUF_SIZE, off)) <= 0) {
+        src->buf_len = 0;
+        return 0;
+    }
+    src->buf_off = off;
+    src->buf_len = (size_t)n;
+    done = len < src->buf_len ? len : src->buf_len;
+    memcpy(buf, src->buf, done);
+    return done;
+}
@@ -0,0 +1,527 @@
+#define _XOPEN_SOURCE 700  /* for posix_openpt, ptsname, clock_gettime and nanosleep */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX standard */
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "vt100.h"
+
+#include "session.h"
+
+
+#define SESSION_KEY_SIZE     8     /* longest escape sequence recorded as one key */
+#define SESSION_LINE_SIZE    64
+#define ESCAPE_MS            50    /* bytes following ESC within this time belong to the same key */
+#define STARTUP_TIMEOUT_MS   2000  /* wait for the first screen */
+#define FIRST_BYTE_MS        500   /* wait for the first byte written because of a key */
+#define QUIET_MS             50    /* output is over after this much silence */
+#define DEFAULT_ROWS         24
+#define DEFAULT_COLS         80
+#define OUTPUT_CHUNK_SIZE    4096
+
+#define PROGRAM_PATH  "/proc/self/exe"
+
+#define EVENT_KEY     'K'
+#define EVENT_RESIZE  'R'
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a recorded event */
+typedef struct session_event_tag {
+    char kind;  /* EVENT_KEY or EVENT_RESIZE */
+    long int ms;  /* since the start of the recording */
+    char key[SESSION_KEY_SIZE];
+    size_t key_len;
+    unsigned int rows;
+    unsigned int cols;
+} session_event_t;
+
+/* struct for the results of a replay */
+typedef struct replay_stats_tag {
+    unsigned long int n_keys;
+    unsigned long int n_resizes;
+    unsigned long int n_silent_keys;  /* keys that wrote nothing */
+    unsigned long int bytes;
+    long int *latencies;  /* microseconds, one per key that wrote something */
+    size_t n_latencies;
+} replay_stats_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+/* struct containing recording data */
+static struct session_tag {
+    FILE *f;
+    struct timespec start;
+    session_event_t pending;  /* key still growing (escape sequence) */
+} session;
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Returns milliseconds elapsed since the start of the recording */
+static long int record_ms(void);
+
+/* Writes the pending key (if any) to the recording */
+static void record_flush(void);
+
+/*
+ * Reads every event of the session at path into *events (which must be freed)
+ * If successful returns 0, else 1
+ */
+static unsigned char load_events(const char *path, session_event_t **events, size_t *n_events);
+
+/*
+ * Starts program with args inside a new pseudo-terminal of rows x cols, and sets *master and *pid
+ * If successful returns 0, else 1
+ */
+static unsigned char spawn(char *const args[], const int n_args, const unsigned int rows, const unsigned int cols,
+                           int *master, pid_t *pid);
+
+/*
+ * Reads everything written to master until QUIET_MS of silence (waiting at most first_ms for the first byte),
+ * feeding it to screen
+ * Returns the number of bytes read, sets *last_us to the time of the last one and *is_over if the program exited
+ */
+static size_t drain(const int master, vt100_t *screen, const long int first_ms, long int *last_us, unsigned char *is_over);
+
+/* Prints statistics of the replay to stdout */
+static void print_stats(replay_stats_t *stats);
+
+/*
+ * Compares screen with the text inside expect_path, printing different lines to stdout
+ * If they match returns 0, else 1
+ */
+static unsigned char compare_screen(const char *screen, const char *expect_path);
+
+/* Returns the whole content of the file at path as a string (which must be freed), or NULL on error */
+static char *read_text(const char *path);
+
+/* Returns microseconds of a monotonic clock */
+static long int now_us(void);
+
+/* Compares two long int (for qsort) */
+static int compare_longs(const void *a, const void *b);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+/* RECORD */
+
+unsigned char session_record_open(const char *path) {
+    if ((session.f = fopen(path, "w")) == NULL)
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &session.start);
+    session.pending.key_len = 0;
+    fprintf(session.f, "# elf-visualizer session\n");
+    return 0;
+}
+
+void session_record_key(const char c) {
+    long int ms;
+
+    if (session.f == NULL)
+        return;
+
+    /* Arrow keys arrive as ESC [ X, and are replayed as one write */
+    ms = record_ms();
+    if (session.pending.key_len > 0 && session.pending.key_len < SESSION_KEY_SIZE && ms - session.pending.ms <= ESCAPE_MS) {
+        session.pending.key[session.pending.key_len++] = c;
+        return;
+    }
+    record_flush();
+
+    session.pending.ms = ms;
+    session.pending.key[0] = c;
+    session.pending.key_len = 1;
+    if (c != '\x1b')
+        record_flush();
+}
+
+void session_record_resize(const unsigned int rows, const unsigned int cols) {
+    if (session.f == NULL)
+        return;
+    record_flush();
+    fprintf(session.f, "%c %ld %u %u\n", EVENT_RESIZE, record_ms(), rows, cols);
+}
+
+void session_record_close(void) {
+    if (session.f == NULL)
+        return;
+    record_flush();
+    fclose(session.f);
+    session.f = NULL;
+}
+
+/* REPLAY */
+
+unsigned char session_replay(const char *path, char *const args[], const int n_args, const char *expect_path, const char *save_path) {
+    session_event_t *events;
+    replay_stats_t stats;
+    struct winsize ws;
+    struct timespec delay;
+    vt100_t screen;
+    size_t i, n_events, first, n;
+    unsigned int rows, cols;
+    long int start_us, sent_us, last_us, wait_us;
+    unsigned char is_over, status;
+    char *final;
+    FILE *f;
+    int master;
+    pid_t pid;
+
+    if (load_events(path, &events, &n_events) == 1)
+        return 1;
+
+    /* The first resize is the size of the terminal when the recording started */
+    rows = DEFAULT_ROWS;
+    cols = DEFAULT_COLS;
+    first = 0;
+    if (n_events > 0 && events[0].kind == EVENT_RESIZE) {
+        rows = events[0].rows;
+        cols = events[0].cols;
+        first = 1;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    if ((stats.latencies = malloc((n_events + 1) * sizeof(*stats.latencies))) == NULL || vt100_init(&screen, rows, cols) == 1) {
+        free(stats.latencies);
+        free(events);
+        return 1;
+    }
+    if (spawn(args, n_args, rows, cols, &master, &pid) == 1) {
+        vt100_free(&screen);
+        free(stats.latencies);
+        free(events);
+        return 1;
+    }
+
+    is_over = 0;
+    final = NULL;
+    stats.bytes += drain(master, &screen, STARTUP_TIMEOUT_MS, &last_us, &is_over);
+
+    start_us = now_us();
+    for (i = first; i < n_events && is_over == 0; i++) {
+        /* Keep the recorded pace (if the program is slower than the user was, go on immediately) */
+        wait_us = start_us + (events[i].ms - (first == 1 ? events[0].ms : 0)) * 1000 - now_us();
+        if (wait_us > 0) {
+            delay.tv_sec = wait_us / 1000000;
+            delay.tv_nsec = (wait_us % 1000000) * 1000;
+            nanosleep(&delay, NULL);
+        }
+
+        if (events[i].kind == EVENT_RESIZE) {
+            stats.n_resizes++;
+            memset(&ws, 0, sizeof(ws));
+            ws.ws_row = (unsigned short)events[i].rows;
+            ws.ws_col = (unsigned short)events[i].cols;
+            if (ioctl(master, TIOCSWINSZ, &ws) == -1 || vt100_resize(&screen, events[i].rows, events[i].cols) == 1)
+                break;
+            stats.bytes += drain(master, &screen, FIRST_BYTE_MS, &last_us, &is_over);
+            continue;
+        }
+
+        /* The screen shown before quitting is the final one (quitting clears it) */
+        if (events[i].key_len == 1 && events[i].key[0] == '\x11') {
+            free(final);
+            final = vt100_text(&screen);
+        }
+
+        stats.n_keys++;
+        sent_us = now_us();
+        if (write(master, events[i].key, events[i].key_len) != (ssize_t)events[i].key_len)
+            break;
+        if ((n = drain(master, &screen, FIRST_BYTE_MS, &last_us, &is_over)) == 0)
+            stats.n_silent_keys++;
+        else
+            stats.latencies[stats.n_latencies++] = last_us - sent_us;
+        stats.bytes += n;
+    }
+
+    /* Sessions recorded without quitting are quit here */
+    if (is_over == 0) {
+        free(final);
+        final = vt100_text(&screen);
+        if (write(master, "\x11", 1) == 1)
+            drain(master, &screen, FIRST_BYTE_MS, &last_us, &is_over);
+    }
+    close(master);
+    waitpid(pid, NULL, 0);
+
+    print_stats(&stats);
+
+    status = final == NULL;
+    if (final != NULL && save_path != NULL) {
+        if ((f = fopen(save_path, "w")) == NULL || fputs(final, f) == EOF)
+            status = 1;
+        else
+            printf("screen: saved to %s\n", save_path);
+        if (f != NULL)
+            fclose(f);
+    }
+    if (final != NULL && expect_path != NULL && compare_screen(final, expect_path) == 1)
+        status = 1;
+
+    free(final);
+    vt100_free(&screen);
+    free(stats.latencies);
+    free(events);
+    return status;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* RECORD */
+
+static long int record_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long int)(now.tv_sec - session.start.tv_sec) * 1000 + (now.tv_nsec - session.start.tv_nsec) / 1000000;
+}
+
+static void record_flush(void) {
+    size_t i;
+
+    if (session.pending.key_len == 0)
+        return;
+    fprintf(session.f, "%c %ld ", EVENT_KEY, session.pending.ms);
+    for (i = 0; i < session.pending.key_len; i++)
+        fprintf(session.f, "%02x", (unsigned char)session.pending.key[i]);
+    fputc('\n', session.f);
+    session.pending.key_len = 0;
+}
+
+/* REPLAY */
+
+static unsigned char load_events(const char *path, session_event_t **events, size_t *n_events) {
+    char line[SESSION_LINE_SIZE];
+    char hex[2 * SESSION_KEY_SIZE + 1];
+    session_event_t *new_events, e;
+    size_t size, i;
+    unsigned int byte;
+    FILE *f;
+
+    if ((f = fopen(path, "r")) == NULL)
+        return 1;
+
+    *events = NULL;
+    *n_events = 0;
+    size = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        memset(&e, 0, sizeof(e));
+        e.kind = line[0];
+        if (e.kind == EVENT_KEY) {
+            if (sscanf(line + 1, "%ld %16s", &e.ms, hex) != 2)
+                continue;
+            for (i = 0; i < SESSION_KEY_SIZE && hex[2 * i] != '\0' && hex[2 * i + 1] != '\0'; i++) {
+                if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+                    break;
+                e.key[i] = (char)byte;
+            }
+            if ((e.key_len = i) == 0)
+                continue;
+        } else if (e.kind == EVENT_RESIZE) {
+            if (sscanf(line + 1, "%ld %u %u", &e.ms, &e.rows, &e.cols) != 3 || e.rows == 0 || e.cols == 0)
+                continue;
+        } else
+            continue;  /* comments */
+
+        if (*n_events == size) {
+            size = size == 0 ? 64 : size * 2;
+            if ((new_events = realloc(*events, size * sizeof(*new_events))) == NULL) {
+                free(*events);
+                fclose(f);
+                return 1;
+            }
+            *events = new_events;
+        }
+        (*events)[(*n_events)++] = e;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static unsigned char spawn(char *const args[], const int n_args, const unsigned int rows, const unsigned int cols,
+                           int *master, pid_t *pid) {
+    struct winsize ws;
+    char **argv;
+    char *slave_name;
+    int i, slave;
+
+    if ((*master = posix_openpt(O_RDWR | O_NOCTTY)) == -1)
+        return 1;
+    if (grantpt(*master) == -1 || unlockpt(*master) == -1 || (slave_name = ptsname(*master)) == NULL) {
+        close(*master);
+        return 1;
+    }
+    memset(&ws, 0, sizeof(ws));
+    ws.ws_row = (unsigned short)rows;
+    ws.ws_col = (unsigned short)cols;
+    ioctl(*master, TIOCSWINSZ, &ws);
+
+    if ((argv = malloc((size_t)(n_args + 2) * sizeof(*argv))) == NULL) {
+        close(*master);
+        return 1;
+    }
+    argv[0] = PROGRAM_PATH;
+    for (i = 0; i < n_args; i++)
+        argv[i + 1] = args[i];
+    argv[n_args + 1] = NULL;
+
+    if ((*pid = fork()) == -1) {
+        free(argv);
+        close(*master);
+        return 1;
+    }
+
+    if (*pid == 0) {
+        /* New session, so that the slave becomes the controlling terminal when opened */
+        close(*master);
+        setsid();
+        if ((slave = open(slave_name, O_RDWR)) == -1)
+            _exit(127);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO)
+            close(slave);
+        execv(PROGRAM_PATH, argv);
+        _exit(127);
+    }
+
+    free(argv);
+    return 0;
+}
+
+static size_t drain(const int master, vt100_t *screen, const long int first_ms, long int *last_us, unsigned char *is_over) {
+    char buf[OUTPUT_CHUNK_SIZE];
+    struct pollfd pfd;
+    size_t bytes;
+    ssize_t n;
+
+    pfd.fd = master;
+    pfd.events = POLLIN;
+    bytes = 0;
+    while (poll(&pfd, 1, bytes == 0 ? (int)first_ms : QUIET_MS) > 0) {
+        /* Once the program exits, reading the master fails with EIO */
+        if ((n = read(master, buf, sizeof(buf))) <= 0) {
+            *is_over = 1;
+            break;
+        }
+        *last_us = now_us();
+        vt100_feed(screen, buf, (size_t)n);
+        bytes += (size_t)n;
+    }
+    return bytes;
+}
+
+static void print_stats(replay_stats_t *stats) {
+    size_t n;
+
+    printf("events: %lu keys, %lu resizes\n", stats->n_keys, stats->n_resizes);
+    printf("bytes written: %lu\n", stats->bytes);
+
+    n = stats->n_latencies;
+    if (n == 0) {
+        printf("latency: no key wrote anything\n");
+        return;
+    }
+    qsort(stats->latencies, n, sizeof(*stats->latencies), compare_longs);
+    printf("latency (ms): min %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f (%lu keys wrote nothing)\n",
+           stats->latencies[0] / 1000.0, stats->latencies[(n - 1) / 2] / 1000.0, stats->latencies[(n - 1) * 9 / 10] / 1000.0,
+           stats->latencies[(n - 1) * 99 / 100] / 1000.0, stats->latencies[n - 1] / 1000.0, stats->n_silent_keys);
+}
+
+static unsigned char compare_screen(const char *screen, const char *expect_path) {
+    const char *p, *q, *p_end, *q_end;
+    unsigned int row, n_diffs;
+    char *expected;
+
+    if ((expected = read_text(expect_path)) == NULL)
+        return 1;
+
+    /* Line by line, a missing line is an empty one */
+    p = screen;
+    q = expected;
+    n_diffs = 0;
+    for (row = 1; *p != '\0' || *q != '\0'; row++) {
+        if ((p_end = strchr(p, '\n')) == NULL)
+            p_end = p + strlen(p);
+        if ((q_end = strchr(q, '\n')) == NULL)
+            q_end = q + strlen(q);
+        if (p_end - p != q_end - q || memcmp(p, q, (size_t)(p_end - p)) != 0) {
+            printf("line %u:\n- %.*s\n+ %.*s\n", row, (int)(q_end - q), q, (int)(p_end - p), p);
+            n_diffs++;
+        }
+        p = *p_end == '\n' ? p_end + 1 : p_end;
+        q = *q_end == '\n' ? q_end + 1 : q_end;
+    }
+    free(expected);
+
+    if (n_diffs == 0)
+        printf("screen: matches %s\n", expect_path);
+    else
+        printf("screen: differs from %s (%u lines)\n", expect_path, n_diffs);
+    return n_diffs != 0;
+}
+
+static char *read_text(const char *path) {
+    char *text, *new_text;
+    size_t len, size, n;
+    FILE *f;
+
+    if ((f = fopen(path, "r")) == NULL)
+        return NULL;
+
+    text = NULL;
+    len = 0;
+    size = 0;
+    do {
+        if (len + 1 >= size) {
+            size = size == 0 ? OUTPUT_CHUNK_SIZE : size * 2;
+            if ((new_text = realloc(text, size)) == NULL) {
+                free(text);
+                fclose(f);
+                return NULL;
+            }
+            text = new_text;
+        }
+        n = fread(text + len, 1, size - len - 1, f);
+        len += n;
+    } while (n > 0);
+
+    fclose(f);
+    text[len] = '\0';
+    return text;
+}
+
+/* TIME */
+
+static long int now_us(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long int)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int compare_longs(const void *a, const void *b) {
+    long int x, y;
+
+    x = *(const long int *)a;
+    y = *(const long int *)b;
+    return (x > y) - (x < y);
+}
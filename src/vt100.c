@@ -0,0 +1,235 @@
+/* C89 standard */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vt100.h"
+
+
+#define STATE_TEXT  0
+#define STATE_ESC   1  /* after ESC */
+#define STATE_CSI   2  /* after ESC [ */
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Writes printable c at the cursor */
+static void put_char(vt100_t *s, const char c);
+
+/* Moves the cursor to the next row, scrolling the screen up at the bottom */
+static void line_feed(vt100_t *s);
+
+/* Executes the control sequence ESC [ params final */
+static void csi(vt100_t *s, const char final);
+
+/* Blanks columns [from, to) of row */
+static void erase(vt100_t *s, const unsigned int row, const unsigned int from, const unsigned int to);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char vt100_init(vt100_t *s, const unsigned int rows, const unsigned int cols) {
+    memset(s, 0, sizeof(*s));
+    if (rows == 0 || cols == 0 || (s->cells = malloc((size_t)rows * cols)) == NULL)
+        return 1;
+    memset(s->cells, ' ', (size_t)rows * cols);
+    s->rows = rows;
+    s->cols = cols;
+    s->state = STATE_TEXT;
+    return 0;
+}
+
+unsigned char vt100_resize(vt100_t *s, const unsigned int rows, const unsigned int cols) {
+    char *cells;
+    unsigned int r;
+
+    if (rows == 0 || cols == 0 || (cells = malloc((size_t)rows * cols)) == NULL)
+        return 1;
+    memset(cells, ' ', (size_t)rows * cols);
+    for (r = 0; r < rows && r < s->rows; r++)
+        memcpy(cells + (size_t)r * cols, s->cells + (size_t)r * s->cols, cols < s->cols ? cols : s->cols);
+
+    free(s->cells);
+    s->cells = cells;
+    s->rows = rows;
+    s->cols = cols;
+    if (s->row >= rows)
+        s->row = rows - 1;
+    if (s->col >= cols)
+        s->col = cols - 1;
+    s->wrap_pending = 0;
+    return 0;
+}
+
+void vt100_feed(vt100_t *s, const char *buf, const size_t len) {
+    size_t i;
+    char c;
+
+    for (i = 0; i < len; i++) {
+        c = buf[i];
+        switch (s->state) {
+            case STATE_ESC:
+                /* Only CSI sequences are used, any other escape is skipped */
+                if (c == '[') {
+                    s->state = STATE_CSI;
+                    s->n_params = 0;
+                    memset(s->params, 0, sizeof(s->params));
+                } else
+                    s->state = STATE_TEXT;
+                break;
+
+            case STATE_CSI:
+                if (c >= '0' && c <= '9') {
+                    if (s->n_params == 0)
+                        s->n_params = 1;
+                    s->params[s->n_params - 1] = s->params[s->n_params - 1] * 10 + (unsigned int)(c - '0');
+                } else if (c == ';') {
+                    if (s->n_params == 0)
+                        s->n_params = 1;
+                    if (s->n_params < VT100_MAX_PARAMS)
+                        s->n_params++;
+                } else if (c == '?') {
+                    /* private modes (cursor visibility) don't change the screen */
+                } else {
+                    csi(s, c);
+                    s->state = STATE_TEXT;
+                }
+                break;
+
+            default:
+                if (c == '\x1b')
+                    s->state = STATE_ESC;
+                else if (c == '\r') {
+                    s->col = 0;
+                    s->wrap_pending = 0;
+                } else if (c == '\n')
+                    line_feed(s);
+                else if (c == '\b') {
+                    if (s->col > 0)
+                        s->col--;
+                    s->wrap_pending = 0;
+                } else if ((unsigned char)c >= 0x20 && c != '\x7f')
+                    put_char(s, c);
+                break;
+        }
+    }
+}
+
+char *vt100_text(const vt100_t *s) {
+    char *text, *p;
+    unsigned int r, len;
+
+    if ((text = malloc((size_t)s->rows * (s->cols + 1) + 1)) == NULL)
+        return NULL;
+
+    p = text;
+    for (r = 0; r < s->rows; r++) {
+        for (len = s->cols; len > 0 && s->cells[(size_t)r * s->cols + len - 1] == ' '; len--)
+            ;
+        memcpy(p, s->cells + (size_t)r * s->cols, len);
+        p += len;
+        *p++ = '\n';
+    }
+    *p = '\0';
+    return text;
+}
+
+void vt100_free(vt100_t *s) {
+    free(s->cells);
+    s->cells = NULL;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+static void put_char(vt100_t *s, const char c) {
+    if (s->wrap_pending) {
+        s->col = 0;
+        line_feed(s);
+    }
+    s->cells[(size_t)s->row * s->cols + s->col] = c;
+    if (s->col + 1 < s->cols)
+        s->col++;
+    else
+        s->wrap_pending = 1;
+}
+
+static void line_feed(vt100_t *s) {
+    s->wrap_pending = 0;
+    if (s->row + 1 < s->rows) {
+        s->row++;
+        return;
+    }
+    memmove(s->cells, s->cells + s->cols, (size_t)(s->rows - 1) * s->cols);
+    memset(s->cells + (size_t)(s->rows - 1) * s->cols, ' ', s->cols);
+}
+
+static void csi(vt100_t *s, const char final) {
+    unsigned int p0, p1, r;
+
+    /* Missing parameters are 0, cursor movements treat 0 as 1 */
+    p0 = s->n_params > 0 ? s->params[0] : 0;
+    p1 = s->n_params > 1 ? s->params[1] : 0;
+    s->wrap_pending = 0;
+
+    switch (final) {
+        case 'H':
+        case 'f':
+            s->row = (p0 == 0 ? 1 : p0) - 1;
+            s->col = (p1 == 0 ? 1 : p1) - 1;
+            if (s->row >= s->rows)
+                s->row = s->rows - 1;
+            if (s->col >= s->cols)
+                s->col = s->cols - 1;
+            break;
+
+        case 'A':
+            s->row = s->row > (p0 == 0 ? 1 : p0) ? s->row - (p0 == 0 ? 1 : p0) : 0;
+            break;
+
+        case 'B':
+            s->row = s->row + (p0 == 0 ? 1 : p0) < s->rows ? s->row + (p0 == 0 ? 1 : p0) : s->rows - 1;
+            break;
+
+        case 'C':
+            s->col = s->col + (p0 == 0 ? 1 : p0) < s->cols ? s->col + (p0 == 0 ? 1 : p0) : s->cols - 1;
+            break;
+
+        case 'D':
+            s->col = s->col > (p0 == 0 ? 1 : p0) ? s->col - (p0 == 0 ? 1 : p0) : 0;
+            break;
+
+        case 'K':
+            if (p0 == 0)
+                erase(s, s->row, s->col, s->cols);
+            else if (p0 == 1)
+                erase(s, s->row, 0, s->col + 1);
+            else
+                erase(s, s->row, 0, s->cols);
+            break;
+
+        case 'J':
+            if (p0 == 0) {
+                erase(s, s->row, s->col, s->cols);
+                for (r = s->row + 1; r < s->rows; r++)
+                    erase(s, r, 0, s->cols);
+            } else if (p0 == 1) {
+                for (r = 0; r < s->row; r++)
+                    erase(s, r, 0, s->cols);
+                erase(s, s->row, 0, s->col + 1);
+            } else {
+                for (r = 0; r < s->rows; r++)
+                    erase(s, r, 0, s->cols);
+            }
+            break;
+
+        default:
+            /* attributes (m), modes (h, l)... don't change text */
+            break;
+    }
+}
+
+static void erase(vt100_t *s, const unsigned int row, const unsigned int from, const unsigned int to) {
+    if (from < to)
+        memset(s->cells + (size_t)row * s->cols + from, ' ', to - from);
+}
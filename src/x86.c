@@ -0,0 +1,1515 @@
+#define _XOPEN_SOURCE 700  /* for vsnprintf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "x86.h"
+
+
+/* operands (see the Intel SDM opcode map notation) */
+#define O_NONE  0
+#define O_Eb    1   /* register or memory (from modrm.rm), byte */
+#define O_Ev    2   /* register or memory, operand size */
+#define O_Ew    3
+#define O_Ed    4
+#define O_Ey    5   /* register or memory, dword (qword with REX.W) */
+#define O_M     6   /* memory only, no size */
+#define O_Gb    7   /* register (from modrm.reg), byte */
+#define O_Gv    8
+#define O_Gw    9
+#define O_Gd    10
+#define O_Gy    11
+#define O_Ib    12
+#define O_Ibs   13  /* byte immediate sign-extended to operand size */
+#define O_Iw    14
+#define O_Iz    15  /* word or dword immediate */
+#define O_Iv    16  /* word, dword or qword immediate */
+#define O_Jb    17  /* relative byte offset */
+#define O_Jz    18  /* relative word or dword offset */
+#define O_Ob    19  /* memory offset, byte */
+#define O_Ov    20
+#define O_Ap    21  /* far pointer */
+#define O_AL    22
+#define O_rAX   23
+#define O_eAX   24  /* ax or eax */
+#define O_CL    25
+#define O_DX    26
+#define O_ONE   27
+#define O_Zb    28  /* register from the opcode low bits, byte */
+#define O_Zv    29
+#define O_Sw    30  /* segment register (from modrm.reg) */
+#define O_SR    31  /* segment register (from the opcode) */
+#define O_Cd    32  /* control register */
+#define O_Dd    33  /* debug register */
+#define O_Rd    34  /* general register (from modrm.rm), native size */
+#define O_V     35  /* vector register (from modrm.reg) */
+#define O_W     36  /* vector register or memory (from modrm.rm) */
+#define O_H     37  /* vector register (from VEX.vvvv), shown only with VEX/EVEX */
+#define O_Hy    38  /* general register (from VEX.vvvv), dword or qword */
+#define O_PX    39  /* MMX register (from modrm.reg), XMM with a mandatory prefix or VEX */
+#define O_QX    40  /* MMX register or memory (from modrm.rm), XMM with a mandatory prefix or VEX */
+
+#define IS_MODRM_OP(o)  (((o) >= O_Eb && (o) <= O_Gy) || ((o) >= O_Sw && (o) <= O_QX && (o) != O_SR))
+
+/* flags of opcodes */
+#define F_DEF64   0x01  /* operand size is 64 bits in 64-bit mode (without 0x66) */
+#define F_INV64   0x02  /* invalid in 64-bit mode */
+#define F_GROUP   0x04  /* name is a list of names for modrm.reg = 0..7 separated by '/' */
+#define F_STRING  0x08  /* string instruction (takes rep prefixes) */
+#define F_MODRM   0x10  /* has a modrm byte even if operands don't tell */
+#define F_VEX     0x20  /* valid only with VEX */
+#define F_NOV     0x40  /* VEX form is not prefixed by 'v' */
+#define F_SPECIAL 0x80  /* decoded by decode_special() */
+
+/* maps */
+#define MAP_ONE_BYTE  0
+#define MAP_0F        1
+#define MAP_0F38      2
+#define MAP_0F3A      3
+#define N_MAPS        4
+
+/* kinds of encodings */
+#define ENC_LEGACY  0
+#define ENC_VEX     1
+#define ENC_EVEX    2
+#define ENC_XOP     3
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for an entry of an opcode map; name may list one name per mandatory prefix (none|66|F3|F2) */
+typedef struct x86_op_tag {
+    unsigned char opcode;
+    const char *name;
+    unsigned char ops[3];
+    unsigned char flags;
+} x86_op_t;
+
+/* struct for an instruction being decoded */
+typedef struct x86_state_tag {
+    const unsigned char *buf;
+    size_t len;
+    size_t n;  /* bytes consumed */
+    unsigned long int addr;
+    unsigned char is_64;
+    unsigned char is_bad;
+
+    /* prefixes */
+    unsigned char p66;
+    unsigned char p67;
+    unsigned char rep;  /* 0, 0xf2 or 0xf3 (the last one) */
+    unsigned char lock;
+    unsigned char seg;  /* 0 or the segment override prefix */
+    unsigned char rex;
+    unsigned char enc;
+    unsigned char vex_w;
+    unsigned char vex_l;  /* 0 = 128, 1 = 256, 2 = 512 bits */
+    unsigned int vex_v;  /* register of vvvv */
+    unsigned char vex_pp;
+    unsigned char evex_r2;  /* EVEX.R' (bit 4 of modrm.reg) */
+    unsigned char evex_mask;
+    unsigned char evex_z;
+
+    /* opcode */
+    unsigned int map;
+    unsigned char opcode;
+    const x86_op_t *op;
+    char name[24];
+    unsigned char ops[3];
+    unsigned char flags;
+    unsigned char pp;  /* mandatory prefix used: 0 none, 1 66, 2 F3, 3 F2 */
+    unsigned char is_xmm;  /* 1 if O_PX and O_QX are XMM registers */
+    unsigned int opsize;
+    unsigned int adsize;
+
+    /* modrm */
+    unsigned char has_modrm;
+    unsigned char modrm;
+    unsigned int mod;
+    unsigned int reg;
+    unsigned int rm;
+    int base;  /* -1 if none */
+    int index;  /* -1 if none */
+    unsigned int scale;
+    unsigned char is_rip;
+    long int disp;
+
+    /* immediates */
+    unsigned long int imm[2];
+    unsigned int n_imm;
+
+    /* text */
+    char *out;
+    size_t out_size;
+    size_t out_len;
+    unsigned char has_target;
+    unsigned long int target;  /* of RIP-relative operands (shown as a comment) */
+} x86_state_t;
+
+
+/* -------------------- STATIC VARIABLES -------------------- */
+
+#define ALU(b, n)  {(b), (n), {O_Eb, O_Gb, 0}, 0}, {(b) + 1, (n), {O_Ev, O_Gv, 0}, 0}, {(b) + 2, (n), {O_Gb, O_Eb, 0}, 0}, \
+                   {(b) + 3, (n), {O_Gv, O_Ev, 0}, 0}, {(b) + 4, (n), {O_AL, O_Ib, 0}, 0}, {(b) + 5, (n), {O_rAX, O_Iz, 0}, 0}
+#define X8(b, n, o1, o2, f)  {(b), (n), {(o1), (o2), 0}, (f)}, {(b) + 1, (n), {(o1), (o2), 0}, (f)}, \
+                             {(b) + 2, (n), {(o1), (o2), 0}, (f)}, {(b) + 3, (n), {(o1), (o2), 0}, (f)}, \
+                             {(b) + 4, (n), {(o1), (o2), 0}, (f)}, {(b) + 5, (n), {(o1), (o2), 0}, (f)}, \
+                             {(b) + 6, (n), {(o1), (o2), 0}, (f)}, {(b) + 7, (n), {(o1), (o2), 0}, (f)}
+#define OP0(b, n, f)          {(b), (n), {0, 0, 0}, (f)}
+#define OP1(b, n, o1, f)      {(b), (n), {(o1), 0, 0}, (f)}
+#define OP2(b, n, o1, o2, f)  {(b), (n), {(o1), (o2), 0}, (f)}
+#define OP3(b, n, o1, o2, o3, f)  {(b), (n), {(o1), (o2), (o3)}, (f)}
+
+/* names of conditions (jcc, setcc, cmovcc) */
+static const char *const CONDITIONS[16] = {"o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g"};
+
+/* one-byte opcode map (conditional jumps are added by init_maps()) */
+static const x86_op_t MAP_ONE_BYTE_OPS[] = {
+    ALU(0x00, "add"), OP1(0x06, "push", O_SR, F_INV64), OP1(0x07, "pop", O_SR, F_INV64),
+    ALU(0x08, "or"), OP1(0x0e, "push", O_SR, F_INV64),
+    ALU(0x10, "adc"), OP1(0x16, "push", O_SR, F_INV64), OP1(0x17, "pop", O_SR, F_INV64),
+    ALU(0x18, "sbb"), OP1(0x1e, "push", O_SR, F_INV64), OP1(0x1f, "pop", O_SR, F_INV64),
+    ALU(0x20, "and"), OP0(0x27, "daa", F_INV64),
+    ALU(0x28, "sub"), OP0(0x2f, "das", F_INV64),
+    ALU(0x30, "xor"), OP0(0x37, "aaa", F_INV64),
+    ALU(0x38, "cmp"), OP0(0x3f, "aas", F_INV64),
+    X8(0x40, "inc", O_Zv, 0, F_INV64), X8(0x48, "dec", O_Zv, 0, F_INV64),
+    X8(0x50, "push", O_Zv, 0, F_DEF64), X8(0x58, "pop", O_Zv, 0, F_DEF64),
+    OP0(0x60, "pusha", F_INV64), OP0(0x61, "popa", F_INV64), OP2(0x62, "bound", O_Gv, O_M, F_INV64),
+    OP2(0x63, "movsxd", O_Gv, O_Ed, F_SPECIAL),
+    OP1(0x68, "push", O_Iz, F_DEF64), OP3(0x69, "imul", O_Gv, O_Ev, O_Iz, 0), OP1(0x6a, "push", O_Ibs, F_DEF64),
+    OP3(0x6b, "imul", O_Gv, O_Ev, O_Ibs, 0), OP0(0x6c, "insb", F_STRING), OP0(0x6d, "ins", F_STRING | F_SPECIAL),
+    OP0(0x6e, "outsb", F_STRING), OP0(0x6f, "outs", F_STRING | F_SPECIAL),
+    OP2(0x80, "add/or/adc/sbb/and/sub/xor/cmp", O_Eb, O_Ib, F_GROUP), OP2(0x81, "add/or/adc/sbb/and/sub/xor/cmp", O_Ev, O_Iz, F_GROUP),
+    OP2(0x82, "add/or/adc/sbb/and/sub/xor/cmp", O_Eb, O_Ib, F_GROUP | F_INV64),
+    OP2(0x83, "add/or/adc/sbb/and/sub/xor/cmp", O_Ev, O_Ibs, F_GROUP),
+    OP2(0x84, "test", O_Eb, O_Gb, 0), OP2(0x85, "test", O_Ev, O_Gv, 0), OP2(0x86, "xchg", O_Eb, O_Gb, 0),
+    OP2(0x87, "xchg", O_Ev, O_Gv, 0), OP2(0x88, "mov", O_Eb, O_Gb, 0), OP2(0x89, "mov", O_Ev, O_Gv, 0),
+    OP2(0x8a, "mov", O_Gb, O_Eb, 0), OP2(0x8b, "mov", O_Gv, O_Ev, 0), OP2(0x8c, "mov", O_Ev, O_Sw, 0),
+    OP2(0x8d, "lea", O_Gv, O_M, 0), OP2(0x8e, "mov", O_Sw, O_Ew, 0), OP1(0x8f, "pop", O_Ev, F_GROUP | F_DEF64),
+    OP0(0x90, "nop", F_SPECIAL), OP2(0x91, "xchg", O_Zv, O_rAX, 0), OP2(0x92, "xchg", O_Zv, O_rAX, 0),
+    OP2(0x93, "xchg", O_Zv, O_rAX, 0), OP2(0x94, "xchg", O_Zv, O_rAX, 0), OP2(0x95, "xchg", O_Zv, O_rAX, 0),
+    OP2(0x96, "xchg", O_Zv, O_rAX, 0), OP2(0x97, "xchg", O_Zv, O_rAX, 0),
+    OP0(0x98, "cwde", F_SPECIAL), OP0(0x99, "cdq", F_SPECIAL), OP1(0x9a, "call far", O_Ap, F_INV64), OP0(0x9b, "fwait", 0),
+    OP0(0x9c, "pushf", F_DEF64 | F_SPECIAL), OP0(0x9d, "popf", F_DEF64 | F_SPECIAL), OP0(0x9e, "sahf", 0), OP0(0x9f, "lahf", 0),
+    OP2(0xa0, "mov", O_AL, O_Ob, 0), OP2(0xa1, "mov", O_rAX, O_Ov, 0), OP2(0xa2, "mov", O_Ob, O_AL, 0),
+    OP2(0xa3, "mov", O_Ov, O_rAX, 0), OP0(0xa4, "movsb", F_STRING), OP0(0xa5, "movs", F_STRING | F_SPECIAL),
+    OP0(0xa6, "cmpsb", F_STRING), OP0(0xa7, "cmps", F_STRING | F_SPECIAL), OP2(0xa8, "test", O_AL, O_Ib, 0),
+    OP2(0xa9, "test", O_rAX, O_Iz, 0), OP0(0xaa, "stosb", F_STRING), OP0(0xab, "stos", F_STRING | F_SPECIAL),
+    OP0(0xac, "lodsb", F_STRING), OP0(0xad, "lods", F_STRING | F_SPECIAL), OP0(0xae, "scasb", F_STRING),
+    OP0(0xaf, "scas", F_STRING | F_SPECIAL),
+    X8(0xb0, "mov", O_Zb, O_Ib, 0), X8(0xb8, "mov", O_Zv, O_Iv, 0),
+    OP2(0xc0, "rol/ror/rcl/rcr/shl/shr/sal/sar", O_Eb, O_Ib, F_GROUP),
+    OP2(0xc1, "rol/ror/rcl/rcr/shl/shr/sal/sar", O_Ev, O_Ib, F_GROUP), OP1(0xc2, "ret", O_Iw, F_DEF64),
+    OP0(0xc3, "ret", F_DEF64), OP2(0xc4, "les", O_Gv, O_M, F_INV64), OP2(0xc5, "lds", O_Gv, O_M, F_INV64),
+    OP2(0xc6, "mov", O_Eb, O_Ib, F_GROUP | F_SPECIAL), OP2(0xc7, "mov", O_Ev, O_Iz, F_GROUP | F_SPECIAL),
+    OP2(0xc8, "enter", O_Iw, O_Ib, F_DEF64), OP0(0xc9, "leave", F_DEF64), OP1(0xca, "retf", O_Iw, 0), OP0(0xcb, "retf", 0),
+    OP0(0xcc, "int3", 0), OP1(0xcd, "int", O_Ib, 0), OP0(0xce, "into", F_INV64), OP0(0xcf, "iret", F_SPECIAL),
+    OP2(0xd0, "rol/ror/rcl/rcr/shl/shr/sal/sar", O_Eb, O_ONE, F_GROUP),
+    OP2(0xd1, "rol/ror/rcl/rcr/shl/shr/sal/sar", O_Ev, O_ONE, F_GROUP),
+    OP2(0xd2, "rol/ror/rcl/rcr/shl/shr/sal/sar", O_Eb, O_CL, F_GROUP),
+    OP2(0xd3, "rol/ror/rcl/rcr/shl/shr/sal/sar", O_Ev, O_CL, F_GROUP),
+    OP1(0xd4, "aam", O_Ib, F_INV64), OP1(0xd5, "aad", O_Ib, F_INV64), OP0(0xd7, "xlat", 0),
+    OP0(0xd8, "", F_MODRM | F_SPECIAL), OP0(0xd9, "", F_MODRM | F_SPECIAL), OP0(0xda, "", F_MODRM | F_SPECIAL),
+    OP0(0xdb, "", F_MODRM | F_SPECIAL), OP0(0xdc, "", F_MODRM | F_SPECIAL), OP0(0xdd, "", F_MODRM | F_SPECIAL),
+    OP0(0xde, "", F_MODRM | F_SPECIAL), OP0(0xdf, "", F_MODRM | F_SPECIAL),
+    OP1(0xe0, "loopne", O_Jb, F_DEF64), OP1(0xe1, "loope", O_Jb, F_DEF64), OP1(0xe2, "loop", O_Jb, F_DEF64),
+    OP1(0xe3, "jrcxz", O_Jb, F_DEF64 | F_SPECIAL), OP2(0xe4, "in", O_AL, O_Ib, 0), OP2(0xe5, "in", O_eAX, O_Ib, 0),
+    OP2(0xe6, "out", O_Ib, O_AL, 0), OP2(0xe7, "out", O_Ib, O_eAX, 0), OP1(0xe8, "call", O_Jz, F_DEF64),
+    OP1(0xe9, "jmp", O_Jz, F_DEF64), OP1(0xea, "jmp far", O_Ap, F_INV64), OP1(0xeb, "jmp", O_Jb, F_DEF64),
+    OP2(0xec, "in", O_AL, O_DX, 0), OP2(0xed, "in", O_eAX, O_DX, 0), OP2(0xee, "out", O_DX, O_AL, 0),
+    OP2(0xef, "out", O_DX, O_eAX, 0),
+    OP0(0xf1, "int1", 0), OP0(0xf4, "hlt", 0), OP0(0xf5, "cmc", 0),
+    OP2(0xf6, "test/test/not/neg/mul/imul/div/idiv", O_Eb, O_Ib, F_GROUP | F_SPECIAL),
+    OP2(0xf7, "test/test/not/neg/mul/imul/div/idiv", O_Ev, O_Iz, F_GROUP | F_SPECIAL),
+    OP0(0xf8, "clc", 0), OP0(0xf9, "stc", 0), OP0(0xfa, "cli", 0), OP0(0xfb, "sti", 0), OP0(0xfc, "cld", 0),
+    OP0(0xfd, "std", 0), OP1(0xfe, "inc/dec", O_Eb, F_GROUP), OP1(0xff, "inc/dec/call/call far/jmp/jmp far/push", O_Ev, F_GROUP | F_SPECIAL)
+};
+
+/* two-byte opcode map (0x0f xx, conditional instructions are added by init_maps()) */
+static const x86_op_t MAP_0F_OPS[] = {
+    OP1(0x00, "sldt/str/lldt/ltr/verr/verw", O_Ew, F_GROUP), OP0(0x01, "", F_MODRM | F_SPECIAL),
+    OP2(0x02, "lar", O_Gv, O_Ew, 0), OP2(0x03, "lsl", O_Gv, O_Ew, 0), OP0(0x05, "syscall", 0), OP0(0x06, "clts", 0),
+    OP0(0x07, "sysret", 0), OP0(0x08, "invd", 0), OP0(0x09, "wbinvd", 0), OP0(0x0b, "ud2", 0),
+    OP1(0x0d, "prefetch/prefetchw/prefetchwt1/prefetch/prefetch/prefetch/prefetch/prefetch", O_M, F_GROUP),
+    OP0(0x0e, "femms", 0), OP3(0x0f, "3dnow", O_PX, O_QX, O_Ib, 0),
+    OP2(0x10, "movups|movupd|movss|movsd", O_V, O_W, 0), OP2(0x11, "movups|movupd|movss|movsd", O_W, O_V, 0),
+    OP2(0x12, "movlps|movlpd|movsldup|movddup", O_V, O_W, F_SPECIAL), OP2(0x13, "movlps|movlpd||", O_M, O_V, 0),
+    OP2(0x14, "unpcklps|unpcklpd||", O_V, O_W, 0), OP2(0x15, "unpckhps|unpckhpd||", O_V, O_W, 0),
+    OP2(0x16, "movhps|movhpd|movshdup|", O_V, O_W, F_SPECIAL), OP2(0x17, "movhps|movhpd||", O_M, O_V, 0),
+    OP1(0x18, "prefetchnta/prefetcht0/prefetcht1/prefetcht2/nop/nop/nop/nop", O_Eb, F_GROUP),
+    OP1(0x19, "nop", O_Ev, 0), OP1(0x1a, "nop", O_Ev, 0), OP1(0x1b, "nop", O_Ev, 0), OP1(0x1c, "nop", O_Ev, 0),
+    OP1(0x1d, "nop", O_Ev, 0), OP1(0x1e, "nop", O_Ev, F_SPECIAL), OP1(0x1f, "nop", O_Ev, 0),
+    OP2(0x20, "mov", O_Rd, O_Cd, 0), OP2(0x21, "mov", O_Rd, O_Dd, 0), OP2(0x22, "mov", O_Cd, O_Rd, 0),
+    OP2(0x23, "mov", O_Dd, O_Rd, 0),
+    OP2(0x28, "movaps|movapd||", O_V, O_W, 0), OP2(0x29, "movaps|movapd||", O_W, O_V, 0),
+    OP2(0x2a, "cvtpi2ps|cvtpi2pd|cvtsi2ss|cvtsi2sd", O_V, O_Ey, 0), OP2(0x2b, "movntps|movntpd||", O_M, O_V, 0),
+    OP2(0x2c, "cvttps2pi|cvttpd2pi|cvttss2si|cvttsd2si", O_Gy, O_W, 0),
+    OP2(0x2d, "cvtps2pi|cvtpd2pi|cvtss2si|cvtsd2si", O_Gy, O_W, 0), OP2(0x2e, "ucomiss|ucomisd||", O_V, O_W, 0),
+    OP2(0x2f, "comiss|comisd||", O_V, O_W, 0),
+    OP0(0x30, "wrmsr", 0), OP0(0x31, "rdtsc", 0), OP0(0x32, "rdmsr", 0), OP0(0x33, "rdpmc", 0), OP0(0x34, "sysenter", 0),
+    OP0(0x35, "sysexit", 0), OP0(0x37, "getsec", 0),
+    OP2(0x50, "movmskps|movmskpd||", O_Gd, O_W, 0), OP3(0x51, "sqrtps|sqrtpd|sqrtss|sqrtsd", O_V, O_H, O_W, 0),
+    OP3(0x52, "rsqrtps||rsqrtss|", O_V, O_H, O_W, 0), OP3(0x53, "rcpps||rcpss|", O_V, O_H, O_W, 0),
+    OP3(0x54, "andps|andpd||", O_V, O_H, O_W, 0), OP3(0x55, "andnps|andnpd||", O_V, O_H, O_W, 0),
+    OP3(0x56, "orps|orpd||", O_V, O_H, O_W, 0), OP3(0x57, "xorps|xorpd||", O_V, O_H, O_W, 0),
+    OP3(0x58, "addps|addpd|addss|addsd", O_V, O_H, O_W, 0), OP3(0x59, "mulps|mulpd|mulss|mulsd", O_V, O_H, O_W, 0),
+    OP3(0x5a, "cvtps2pd|cvtpd2ps|cvtss2sd|cvtsd2ss", O_V, O_H, O_W, 0),
+    OP2(0x5b, "cvtdq2ps|cvtps2dq|cvttps2dq|", O_V, O_W, 0), OP3(0x5c, "subps|subpd|subss|subsd", O_V, O_H, O_W, 0),
+    OP3(0x5d, "minps|minpd|minss|minsd", O_V, O_H, O_W, 0), OP3(0x5e, "divps|divpd|divss|divsd", O_V, O_H, O_W, 0),
+    OP3(0x5f, "maxps|maxpd|maxss|maxsd", O_V, O_H, O_W, 0),
+    OP3(0x60, "punpcklbw", O_PX, O_H, O_QX, 0), OP3(0x61, "punpcklwd", O_PX, O_H, O_QX, 0),
+    OP3(0x62, "punpckldq", O_PX, O_H, O_QX, 0), OP3(0x63, "packsswb", O_PX, O_H, O_QX, 0),
+    OP3(0x64, "pcmpgtb", O_PX, O_H, O_QX, 0), OP3(0x65, "pcmpgtw", O_PX, O_H, O_QX, 0),
+    OP3(0x66, "pcmpgtd", O_PX, O_H, O_QX, 0), OP3(0x67, "packuswb", O_PX, O_H, O_QX, 0),
+    OP3(0x68, "punpckhbw", O_PX, O_H, O_QX, 0), OP3(0x69, "punpckhwd", O_PX, O_H, O_QX, 0),
+    OP3(0x6a, "punpckhdq", O_PX, O_H, O_QX, 0), OP3(0x6b, "packssdw", O_PX, O_H, O_QX, 0),
+    OP3(0x6c, "|punpcklqdq||", O_V, O_H, O_W, 0), OP3(0x6d, "|punpckhqdq||", O_V, O_H, O_W, 0),
+    OP2(0x6e, "movd", O_PX, O_Ey, F_SPECIAL), OP2(0x6f, "movq|movdqa|movdqu|", O_PX, O_QX, 0),
+    OP3(0x70, "pshufw|pshufd|pshufhw|pshuflw", O_PX, O_QX, O_Ib, 0),
+    OP3(0x71, "//psrlw//psraw//psllw/", O_H, O_QX, O_Ib, F_GROUP), OP3(0x72, "//psrld//psrad//pslld/", O_H, O_QX, O_Ib, F_GROUP),
+    OP3(0x73, "//psrlq/psrldq///psllq/pslldq", O_H, O_QX, O_Ib, F_GROUP),
+    OP3(0x74, "pcmpeqb", O_PX, O_H, O_QX, 0), OP3(0x75, "pcmpeqw", O_PX, O_H, O_QX, 0),
+    OP3(0x76, "pcmpeqd", O_PX, O_H, O_QX, 0), OP0(0x77, "emms", F_SPECIAL),
+    OP2(0x78, "vmread", O_Ey, O_Gy, 0), OP2(0x79, "vmwrite", O_Gy, O_Ey, 0),
+    OP3(0x7c, "|haddpd||haddps", O_V, O_H, O_W, 0), OP3(0x7d, "|hsubpd||hsubps", O_V, O_H, O_W, 0),
+    OP2(0x7e, "movd|movd|movq|", O_Ey, O_PX, F_SPECIAL), OP2(0x7f, "movq|movdqa|movdqu|", O_QX, O_PX, 0),
+    OP1(0xa0, "push", O_SR, F_DEF64), OP1(0xa1, "pop", O_SR, F_DEF64), OP0(0xa2, "cpuid", 0),
+    OP2(0xa3, "bt", O_Ev, O_Gv, 0), OP3(0xa4, "shld", O_Ev, O_Gv, O_Ib, 0), OP3(0xa5, "shld", O_Ev, O_Gv, O_CL, 0),
+    OP1(0xa8, "push", O_SR, F_DEF64), OP1(0xa9, "pop", O_SR, F_DEF64), OP0(0xaa, "rsm", 0),
+    OP2(0xab, "bts", O_Ev, O_Gv, 0), OP3(0xac, "shrd", O_Ev, O_Gv, O_Ib, 0), OP3(0xad, "shrd", O_Ev, O_Gv, O_CL, 0),
+    OP1(0xae, "fxsave/fxrstor/ldmxcsr/stmxcsr/xsave/xrstor/xsaveopt/clflush", O_M, F_GROUP | F_SPECIAL),
+    OP2(0xaf, "imul", O_Gv, O_Ev, 0),
+    OP2(0xb0, "cmpxchg", O_Eb, O_Gb, 0), OP2(0xb1, "cmpxchg", O_Ev, O_Gv, 0), OP2(0xb2, "lss", O_Gv, O_M, 0),
+    OP2(0xb3, "btr", O_Ev, O_Gv, 0), OP2(0xb4, "lfs", O_Gv, O_M, 0), OP2(0xb5, "lgs", O_Gv, O_M, 0),
+    OP2(0xb6, "movzx", O_Gv, O_Eb, 0), OP2(0xb7, "movzx", O_Gv, O_Ew, 0), OP2(0xb8, "||popcnt|", O_Gv, O_Ev, 0),
+    OP2(0xb9, "ud1", O_Gv, O_Ev, 0), OP2(0xba, "////bt/bts/btr/btc", O_Ev, O_Ib, F_GROUP),
+    OP2(0xbb, "btc", O_Ev, O_Gv, 0), OP2(0xbc, "bsf|bsf|tzcnt|bsf", O_Gv, O_Ev, 0),
+    OP2(0xbd, "bsr|bsr|lzcnt|bsr", O_Gv, O_Ev, 0), OP2(0xbe, "movsx", O_Gv, O_Eb, 0), OP2(0xbf, "movsx", O_Gv, O_Ew, 0),
+    OP2(0xc0, "xadd", O_Eb, O_Gb, 0), OP2(0xc1, "xadd", O_Ev, O_Gv, 0),
+    OP3(0xc2, "cmpps|cmppd|cmpss|cmpsd", O_V, O_W, O_Ib, 0), OP2(0xc3, "movnti", O_M, O_Gy, 0),
+    OP3(0xc4, "pinsrw", O_PX, O_Ed, O_Ib, 0), OP3(0xc5, "pextrw", O_Gd, O_QX, O_Ib, 0),
+    OP3(0xc6, "shufps|shufpd||", O_V, O_W, O_Ib, 0), OP1(0xc7, "", O_Ev, F_GROUP | F_SPECIAL),
+    X8(0xc8, "bswap", O_Zv, 0, 0),
+    OP3(0xd0, "|addsubpd||addsubps", O_V, O_H, O_W, 0), OP3(0xd1, "psrlw", O_PX, O_H, O_QX, 0),
+    OP3(0xd2, "psrld", O_PX, O_H, O_QX, 0), OP3(0xd3, "psrlq", O_PX, O_H, O_QX, 0), OP3(0xd4, "paddq", O_PX, O_H, O_QX, 0),
+    OP3(0xd5, "pmullw", O_PX, O_H, O_QX, 0), OP2(0xd6, "|movq|movq2dq|movdq2q", O_W, O_V, 0),
+    OP2(0xd7, "pmovmskb", O_Gd, O_QX, 0), OP3(0xd8, "psubusb", O_PX, O_H, O_QX, 0),
+    OP3(0xd9, "psubusw", O_PX, O_H, O_QX, 0), OP3(0xda, "pminub", O_PX, O_H, O_QX, 0), OP3(0xdb, "pand", O_PX, O_H, O_QX, 0),
+    OP3(0xdc, "paddusb", O_PX, O_H, O_QX, 0), OP3(0xdd, "paddusw", O_PX, O_H, O_QX, 0),
+    OP3(0xde, "pmaxub", O_PX, O_H, O_QX, 0), OP3(0xdf, "pandn", O_PX, O_H, O_QX, 0),
+    OP3(0xe0, "pavgb", O_PX, O_H, O_QX, 0), OP3(0xe1, "psraw", O_PX, O_H, O_QX, 0), OP3(0xe2, "psrad", O_PX, O_H, O_QX, 0),
+    OP3(0xe3, "pavgw", O_PX, O_H, O_QX, 0), OP3(0xe4, "pmulhuw", O_PX, O_H, O_QX, 0),
+    OP3(0xe5, "pmulhw", O_PX, O_H, O_QX, 0), OP2(0xe6, "|cvttpd2dq|cvtdq2pd|cvtpd2dq", O_V, O_W, 0),
+    OP2(0xe7, "movntq|movntdq||", O_M, O_PX, 0), OP3(0xe8, "psubsb", O_PX, O_H, O_QX, 0),
+    OP3(0xe9, "psubsw", O_PX, O_H, O_QX, 0), OP3(0xea, "pminsw", O_PX, O_H, O_QX, 0), OP3(0xeb, "por", O_PX, O_H, O_QX, 0),
+    OP3(0xec, "paddsb", O_PX, O_H, O_QX, 0), OP3(0xed, "paddsw", O_PX, O_H, O_QX, 0),
+    OP3(0xee, "pmaxsw", O_PX, O_H, O_QX, 0), OP3(0xef, "pxor", O_PX, O_H, O_QX, 0),
+    OP2(0xf0, "|||lddqu", O_V, O_M, 0), OP3(0xf1, "psllw", O_PX, O_H, O_QX, 0), OP3(0xf2, "pslld", O_PX, O_H, O_QX, 0),
+    OP3(0xf3, "psllq", O_PX, O_H, O_QX, 0), OP3(0xf4, "pmuludq", O_PX, O_H, O_QX, 0),
+    OP3(0xf5, "pmaddwd", O_PX, O_H, O_QX, 0), OP3(0xf6, "psadbw", O_PX, O_H, O_QX, 0),
+    OP2(0xf7, "maskmovq|maskmovdqu||", O_PX, O_QX, 0), OP3(0xf8, "psubb", O_PX, O_H, O_QX, 0),
+    OP3(0xf9, "psubw", O_PX, O_H, O_QX, 0), OP3(0xfa, "psubd", O_PX, O_H, O_QX, 0), OP3(0xfb, "psubq", O_PX, O_H, O_QX, 0),
+    OP3(0xfc, "paddb", O_PX, O_H, O_QX, 0), OP3(0xfd, "paddw", O_PX, O_H, O_QX, 0), OP3(0xfe, "paddd", O_PX, O_H, O_QX, 0),
+    OP2(0xff, "ud0", O_Gv, O_Ev, 0)
+};
+
+/* three-byte opcode map 0x0f 0x38 xx */
+static const x86_op_t MAP_0F38_OPS[] = {
+    OP3(0x00, "pshufb", O_PX, O_H, O_QX, 0), OP3(0x01, "phaddw", O_PX, O_H, O_QX, 0),
+    OP3(0x02, "phaddd", O_PX, O_H, O_QX, 0), OP3(0x03, "phaddsw", O_PX, O_H, O_QX, 0),
+    OP3(0x04, "pmaddubsw", O_PX, O_H, O_QX, 0), OP3(0x05, "phsubw", O_PX, O_H, O_QX, 0),
+    OP3(0x06, "phsubd", O_PX, O_H, O_QX, 0), OP3(0x07, "phsubsw", O_PX, O_H, O_QX, 0),
+    OP3(0x08, "psignb", O_PX, O_H, O_QX, 0), OP3(0x09, "psignw", O_PX, O_H, O_QX, 0),
+    OP3(0x0a, "psignd", O_PX, O_H, O_QX, 0), OP3(0x0b, "pmulhrsw", O_PX, O_H, O_QX, 0),
+    OP3(0x0c, "permilps", O_V, O_H, O_W, F_VEX), OP3(0x0d, "permilpd", O_V, O_H, O_W, F_VEX),
+    OP2(0x0e, "testps", O_V, O_W, F_VEX), OP2(0x0f, "testpd", O_V, O_W, F_VEX),
+    OP2(0x10, "pblendvb", O_V, O_W, 0), OP2(0x13, "cvtph2ps", O_V, O_W, F_VEX), OP2(0x14, "blendvps", O_V, O_W, 0),
+    OP2(0x15, "blendvpd", O_V, O_W, 0), OP3(0x16, "permps", O_V, O_H, O_W, F_VEX), OP2(0x17, "ptest", O_V, O_W, 0),
+    OP2(0x18, "broadcastss", O_V, O_W, F_VEX), OP2(0x19, "broadcastsd", O_V, O_W, F_VEX),
+    OP2(0x1a, "broadcastf128", O_V, O_M, F_VEX), OP2(0x1c, "pabsb", O_PX, O_QX, 0), OP2(0x1d, "pabsw", O_PX, O_QX, 0),
+    OP2(0x1e, "pabsd", O_PX, O_QX, 0),
+    OP2(0x20, "pmovsxbw", O_V, O_W, 0), OP2(0x21, "pmovsxbd", O_V, O_W, 0), OP2(0x22, "pmovsxbq", O_V, O_W, 0),
+    OP2(0x23, "pmovsxwd", O_V, O_W, 0), OP2(0x24, "pmovsxwq", O_V, O_W, 0), OP2(0x25, "pmovsxdq", O_V, O_W, 0),
+    OP3(0x28, "pmuldq", O_V, O_H, O_W, 0), OP3(0x29, "pcmpeqq", O_V, O_H, O_W, 0), OP2(0x2a, "movntdqa", O_V, O_M, 0),
+    OP3(0x2b, "packusdw", O_V, O_H, O_W, 0), OP3(0x2c, "maskmovps", O_V, O_H, O_M, F_VEX),
+    OP3(0x2d, "maskmovpd", O_V, O_H, O_M, F_VEX), OP3(0x2e, "maskmovps", O_M, O_H, O_V, F_VEX),
+    OP3(0x2f, "maskmovpd", O_M, O_H, O_V, F_VEX),
+    OP2(0x30, "pmovzxbw", O_V, O_W, 0), OP2(0x31, "pmovzxbd", O_V, O_W, 0), OP2(0x32, "pmovzxbq", O_V, O_W, 0),
+    OP2(0x33, "pmovzxwd", O_V, O_W, 0), OP2(0x34, "pmovzxwq", O_V, O_W, 0), OP2(0x35, "pmovzxdq", O_V, O_W, 0),
+    OP3(0x36, "permd", O_V, O_H, O_W, F_VEX), OP3(0x37, "pcmpgtq", O_V, O_H, O_W, 0), OP3(0x38, "pminsb", O_V, O_H, O_W, 0),
+    OP3(0x39, "pminsd", O_V, O_H, O_W, 0), OP3(0x3a, "pminuw", O_V, O_H, O_W, 0), OP3(0x3b, "pminud", O_V, O_H, O_W, 0),
+    OP3(0x3c, "pmaxsb", O_V, O_H, O_W, 0), OP3(0x3d, "pmaxsd", O_V, O_H, O_W, 0), OP3(0x3e, "pmaxuw", O_V, O_H, O_W, 0),
+    OP3(0x3f, "pmaxud", O_V, O_H, O_W, 0), OP3(0x40, "pmulld", O_V, O_H, O_W, 0), OP2(0x41, "phminposuw", O_V, O_W, 0),
+    OP3(0x45, "psrlv", O_V, O_H, O_W, F_VEX), OP3(0x46, "psravd", O_V, O_H, O_W, F_VEX),
+    OP3(0x47, "psllv", O_V, O_H, O_W, F_VEX), OP2(0x58, "pbroadcastd", O_V, O_W, F_VEX),
+    OP2(0x59, "pbroadcastq", O_V, O_W, F_VEX), OP2(0x5a, "broadcasti128", O_V, O_M, F_VEX),
+    OP2(0x78, "pbroadcastb", O_V, O_W, F_VEX), OP2(0x79, "pbroadcastw", O_V, O_W, F_VEX),
+    OP2(0x80, "|invept||", O_Gy, O_M, 0), OP2(0x81, "|invvpid||", O_Gy, O_M, 0), OP2(0x82, "|invpcid||", O_Gy, O_M, 0),
+    OP3(0x8c, "pmaskmov", O_V, O_H, O_M, F_VEX), OP3(0x8e, "pmaskmov", O_M, O_H, O_V, F_VEX),
+    OP3(0x90, "pgatherd", O_V, O_M, O_H, F_VEX), OP3(0x91, "pgatherq", O_V, O_M, O_H, F_VEX),
+    OP3(0x92, "gatherdp", O_V, O_M, O_H, F_VEX), OP3(0x93, "gatherqp", O_V, O_M, O_H, F_VEX),
+    OP3(0x96, "fmaddsub132p", O_V, O_H, O_W, F_VEX), OP3(0x97, "fmsubadd132p", O_V, O_H, O_W, F_VEX),
+    OP3(0x98, "fmadd132p", O_V, O_H, O_W, F_VEX), OP3(0x99, "fmadd132s", O_V, O_H, O_W, F_VEX),
+    OP3(0x9a, "fmsub132p", O_V, O_H, O_W, F_VEX), OP3(0x9b, "fmsub132s", O_V, O_H, O_W, F_VEX),
+    OP3(0x9c, "fnmadd132p", O_V, O_H, O_W, F_VEX), OP3(0x9d, "fnmadd132s", O_V, O_H, O_W, F_VEX),
+    OP3(0x9e, "fnmsub132p", O_V, O_H, O_W, F_VEX), OP3(0x9f, "fnmsub132s", O_V, O_H, O_W, F_VEX),
+    OP3(0xa6, "fmaddsub213p", O_V, O_H, O_W, F_VEX), OP3(0xa7, "fmsubadd213p", O_V, O_H, O_W, F_VEX),
+    OP3(0xa8, "fmadd213p", O_V, O_H, O_W, F_VEX), OP3(0xa9, "fmadd213s", O_V, O_H, O_W, F_VEX),
+    OP3(0xaa, "fmsub213p", O_V, O_H, O_W, F_VEX), OP3(0xab, "fmsub213s", O_V, O_H, O_W, F_VEX),
+    OP3(0xac, "fnmadd213p", O_V, O_H, O_W, F_VEX), OP3(0xad, "fnmadd213s", O_V, O_H, O_W, F_VEX),
+    OP3(0xae, "fnmsub213p", O_V, O_H, O_W, F_VEX), OP3(0xaf, "fnmsub213s", O_V, O_H, O_W, F_VEX),
+    OP3(0xb6, "fmaddsub231p", O_V, O_H, O_W, F_VEX), OP3(0xb7, "fmsubadd231p", O_V, O_H, O_W, F_VEX),
+    OP3(0xb8, "fmadd231p", O_V, O_H, O_W, F_VEX), OP3(0xb9, "fmadd231s", O_V, O_H, O_W, F_VEX),
+    OP3(0xba, "fmsub231p", O_V, O_H, O_W, F_VEX), OP3(0xbb, "fmsub231s", O_V, O_H, O_W, F_VEX),
+    OP3(0xbc, "fnmadd231p", O_V, O_H, O_W, F_VEX), OP3(0xbd, "fnmadd231s", O_V, O_H, O_W, F_VEX),
+    OP3(0xbe, "fnmsub231p", O_V, O_H, O_W, F_VEX), OP3(0xbf, "fnmsub231s", O_V, O_H, O_W, F_VEX),
+    OP2(0xc8, "sha1nexte", O_V, O_W, 0), OP2(0xc9, "sha1msg1", O_V, O_W, 0), OP2(0xca, "sha1msg2", O_V, O_W, 0),
+    OP2(0xcb, "sha256rnds2", O_V, O_W, 0), OP2(0xcc, "sha256msg1", O_V, O_W, 0), OP2(0xcd, "sha256msg2", O_V, O_W, 0),
+    OP2(0xdb, "aesimc", O_V, O_W, 0), OP3(0xdc, "aesenc", O_V, O_H, O_W, 0), OP3(0xdd, "aesenclast", O_V, O_H, O_W, 0),
+    OP3(0xde, "aesdec", O_V, O_H, O_W, 0), OP3(0xdf, "aesdeclast", O_V, O_H, O_W, 0),
+    OP2(0xf0, "movbe", O_Gv, O_M, F_SPECIAL), OP2(0xf1, "movbe", O_M, O_Gv, F_SPECIAL),
+    OP3(0xf2, "andn", O_Gy, O_Hy, O_Ey, F_VEX | F_NOV), OP2(0xf3, "/blsr/blsmsk/blsi////", O_Hy, O_Ey, F_GROUP | F_VEX | F_NOV),
+    OP3(0xf5, "bzhi||pext|pdep", O_Gy, O_Ey, O_Hy, F_VEX | F_NOV), OP2(0xf6, "|adcx|adox|", O_Gy, O_Ey, F_SPECIAL),
+    OP3(0xf7, "bextr|shlx|sarx|shrx", O_Gy, O_Ey, O_Hy, F_VEX | F_NOV)
+};
+
+/* three-byte opcode map 0x0f 0x3a xx (every instruction takes a byte immediate) */
+static const x86_op_t MAP_0F3A_OPS[] = {
+    OP3(0x00, "permq", O_V, O_W, O_Ib, F_VEX), OP3(0x01, "permpd", O_V, O_W, O_Ib, F_VEX),
+    OP3(0x02, "pblendd", O_V, O_W, O_Ib, F_VEX), OP3(0x04, "permilps", O_V, O_W, O_Ib, F_VEX),
+    OP3(0x05, "permilpd", O_V, O_W, O_Ib, F_VEX), OP3(0x06, "perm2f128", O_V, O_W, O_Ib, F_VEX),
+    OP3(0x08, "roundps", O_V, O_W, O_Ib, 0), OP3(0x09, "roundpd", O_V, O_W, O_Ib, 0), OP3(0x0a, "roundss", O_V, O_W, O_Ib, 0),
+    OP3(0x0b, "roundsd", O_V, O_W, O_Ib, 0), OP3(0x0c, "blendps", O_V, O_W, O_Ib, 0), OP3(0x0d, "blendpd", O_V, O_W, O_Ib, 0),
+    OP3(0x0e, "pblendw", O_V, O_W, O_Ib, 0), OP3(0x0f, "palignr", O_PX, O_QX, O_Ib, 0),
+    OP3(0x14, "pextrb", O_Ey, O_V, O_Ib, 0), OP3(0x15, "pextrw", O_Ey, O_V, O_Ib, 0),
+    OP3(0x16, "pextrd", O_Ey, O_V, O_Ib, F_SPECIAL), OP3(0x17, "extractps", O_Ey, O_V, O_Ib, 0),
+    OP3(0x18, "insertf128", O_V, O_W, O_Ib, F_VEX), OP3(0x19, "extractf128", O_W, O_V, O_Ib, F_VEX),
+    OP3(0x1d, "cvtps2ph", O_W, O_V, O_Ib, F_VEX),
+    OP3(0x20, "pinsrb", O_V, O_Ey, O_Ib, 0), OP3(0x21, "insertps", O_V, O_W, O_Ib, 0),
+    OP3(0x22, "pinsrd", O_V, O_Ey, O_Ib, F_SPECIAL),
+    OP3(0x38, "inserti128", O_V, O_W, O_Ib, F_VEX), OP3(0x39, "extracti128", O_W, O_V, O_Ib, F_VEX),
+    OP3(0x40, "dpps", O_V, O_W, O_Ib, 0), OP3(0x41, "dppd", O_V, O_W, O_Ib, 0), OP3(0x42, "mpsadbw", O_V, O_W, O_Ib, 0),
+    OP3(0x44, "pclmulqdq", O_V, O_W, O_Ib, 0), OP3(0x46, "perm2i128", O_V, O_W, O_Ib, F_VEX),
+    OP3(0x4a, "blendvps", O_V, O_W, O_Ib, F_VEX), OP3(0x4b, "blendvpd", O_V, O_W, O_Ib, F_VEX),
+    OP3(0x4c, "pblendvb", O_V, O_W, O_Ib, F_VEX),
+    OP3(0x60, "pcmpestrm", O_V, O_W, O_Ib, 0), OP3(0x61, "pcmpestri", O_V, O_W, O_Ib, 0),
+    OP3(0x62, "pcmpistrm", O_V, O_W, O_Ib, 0), OP3(0x63, "pcmpistri", O_V, O_W, O_Ib, 0),
+    OP3(0xcc, "sha1rnds4", O_V, O_W, O_Ib, 0), OP3(0xdf, "aeskeygenassist", O_V, O_W, O_Ib, 0),
+    OP3(0xf0, "|||rorx", O_Gy, O_Ey, O_Ib, F_VEX | F_NOV)
+};
+
+/* entries of conditional instructions, filled by init_maps() */
+static x86_op_t jcc_short_ops[16];
+static x86_op_t jcc_near_ops[16];
+static x86_op_t setcc_ops[16];
+static x86_op_t cmovcc_ops[16];
+static char cond_names[3][16][8];
+
+/* entry of each opcode of each map (NULL if undefined) */
+static const x86_op_t *maps[N_MAPS][256];
+static unsigned char are_maps_init;
+
+/* registers */
+static const char *const REG8[16] = {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+                                     "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"};
+static const char *const REG8_LEGACY[8] = {"al", "cl", "dl", "bl", "ah", "ch", "dh", "bh"};
+static const char *const REG16[16] = {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+                                      "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"};
+static const char *const REG32[16] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+                                      "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+static const char *const REG64[16] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                      "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+static const char *const SEGS[8] = {"es", "cs", "ss", "ds", "fs", "gs", "?", "?"};
+static const char *const MEM16[8] = {"bx + si", "bx + di", "bp + si", "bp + di", "si", "di", "bp", "bx"};
+
+/* x87 memory forms, per opcode (0xd8..0xdf) and modrm.reg, with the size of their operand */
+static const char *const X87_MEM_NAMES[8] = {
+    "fadd/fmul/fcom/fcomp/fsub/fsubr/fdiv/fdivr", "fld//fst/fstp/fldenv/fldcw/fnstenv/fnstcw",
+    "fiadd/fimul/ficom/ficomp/fisub/fisubr/fidiv/fidivr", "fild/fisttp/fist/fistp//fld//fstp",
+    "fadd/fmul/fcom/fcomp/fsub/fsubr/fdiv/fdivr", "fld/fisttp/fst/fstp/frstor//fnsave/fnstsw",
+    "fiadd/fimul/ficom/ficomp/fisub/fisubr/fidiv/fidivr", "fild/fisttp/fist/fistp/fbld/fild/fbstp/fistp"
+};
+static const char *const X87_MEM_SIZES[8][8] = {
+    {"dword", "dword", "dword", "dword", "dword", "dword", "dword", "dword"},
+    {"dword", "", "dword", "dword", "", "word", "", "word"},
+    {"dword", "dword", "dword", "dword", "dword", "dword", "dword", "dword"},
+    {"dword", "dword", "dword", "dword", "", "tbyte", "", "tbyte"},
+    {"qword", "qword", "qword", "qword", "qword", "qword", "qword", "qword"},
+    {"qword", "qword", "qword", "qword", "", "", "", "word"},
+    {"word", "word", "word", "word", "word", "word", "word", "word"},
+    {"word", "word", "word", "word", "tbyte", "qword", "tbyte", "qword"}
+};
+
+/* x87 register forms, per opcode and modrm.reg ("st" operands: 0 none, 1 st(i), 2 st, st(i), 3 st(i), st) */
+static const char *const X87_REG_NAMES[8] = {
+    "fadd/fmul/fcom/fcomp/fsub/fsubr/fdiv/fdivr", "fld/fxch////////", "fcmovb/fcmove/fcmovbe/fcmovu////",
+    "fcmovnb/fcmovne/fcmovnbe/fcmovnu//fucomi/fcomi/", "fadd/fmul/fcom/fcomp/fsubr/fsub/fdivr/fdiv",
+    "ffree/fxch/fst/fstp/fucom/fucomp//", "faddp/fmulp/fcomp//fsubrp/fsubp/fdivrp/fdivp", "ffreep/fxch/fstp/fstp//fucomip/fcomip/"
+};
+static const unsigned char X87_REG_STYLES[8][8] = {
+    {2, 2, 1, 1, 2, 2, 2, 2}, {1, 1, 0, 0, 0, 0, 0, 0}, {2, 2, 2, 2, 0, 0, 0, 0}, {2, 2, 2, 2, 0, 2, 2, 0},
+    {3, 3, 1, 1, 3, 3, 3, 3}, {1, 1, 1, 1, 1, 1, 0, 0}, {3, 3, 1, 0, 3, 3, 3, 3}, {1, 1, 1, 1, 0, 2, 2, 0}
+};
+
+/* x87 instructions without operands of 0xd9 0xe0..0xff */
+static const char *const X87_D9_NAMES = "fchs/fabs///ftst/fxam///fld1/fldl2t/fldl2e/fldpi/fldlg2/fldln2/fldz//"
+                                        "f2xm1/fyl2x/fptan/fpatan/fxtract/fprem1/fdecstp/fincstp/fprem/fyl2xp1/fsqrt/"
+                                        "fsincos/frndint/fscale/fsin/fcos";
+
+/* register forms of 0x0f 0x01 */
+static const struct {
+    unsigned char modrm;
+    const char *name;
+} MAP_0F01_REGS[] = {{0xc1, "vmcall"}, {0xc2, "vmlaunch"}, {0xc3, "vmresume"}, {0xc4, "vmxoff"}, {0xc8, "monitor"},
+                     {0xc9, "mwait"}, {0xca, "clac"}, {0xcb, "stac"}, {0xcf, "encls"}, {0xd0, "xgetbv"}, {0xd1, "xsetbv"},
+                     {0xd4, "vmfunc"}, {0xd5, "xend"}, {0xd6, "xtest"}, {0xd7, "enclu"}, {0xee, "rdpkru"},
+                     {0xef, "wrpkru"}, {0xf8, "swapgs"}, {0xf9, "rdtscp"}, {0xfa, "monitorx"}, {0xfb, "mwaitx"},
+                     {0xfc, "clzero"}};
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/* Fills maps with the entries of the opcode tables (once) */
+static void init_maps(void);
+
+/* Decodes the instruction of s (s->buf, s->len, s->addr, s->is_64 and s->out set), setting s->is_bad if it's invalid */
+static void decode(x86_state_t *s);
+
+/* Returns 1 if op takes vector registers or is valid only with VEX (so its VEX form has the same meaning), else 0 */
+static unsigned char is_vector_op(const x86_op_t *op);
+
+/* Reads VEX, EVEX or XOP prefix (first byte already consumed) */
+static void decode_vex(x86_state_t *s, const unsigned char first);
+
+/* Reads modrm, SIB and displacement */
+static void decode_modrm(x86_state_t *s);
+
+/* Fixes name, operands and flags of instructions that depend on prefixes, modrm or mode */
+static void decode_special(x86_state_t *s);
+
+/* Decodes an x87 instruction (0xd8..0xdf) */
+static void decode_x87(x86_state_t *s);
+
+/*
+ * Picks out of list the name number i of the names separated by sep into buf
+ * If the name exists and isn't empty returns 0, else 1
+ */
+static unsigned char pick_name(const char *list, const char sep, const unsigned int i, char *buf, const size_t size);
+
+/* Returns size in bytes of the immediate of operand op (0 if it's not an immediate) */
+static unsigned int imm_size(const x86_state_t *s, const unsigned char op);
+
+/* Reads an unsigned little endian value of size bytes */
+static unsigned long int get_le(x86_state_t *s, const unsigned int size);
+
+/* Returns value of bits bits sign-extended */
+static long int sign_extend(const unsigned long int value, const unsigned int bits);
+
+/* Writes the text of the decoded instruction */
+static void format(x86_state_t *s);
+
+/* Writes operand number i */
+static void format_operand(x86_state_t *s, const unsigned int i);
+
+/* Writes memory operand with size (NULL or "" for none) */
+static void format_memory(x86_state_t *s, const char *size);
+
+/* Writes vector register number n */
+static void format_vector(x86_state_t *s, const unsigned int n);
+
+/* Returns name of general purpose register n of size bits */
+static const char *gpr_name(const x86_state_t *s, const unsigned int n, const unsigned int size);
+
+/* Returns name of the segment of the override prefix of s */
+static const char *seg_name(const x86_state_t *s);
+
+/* Returns size keyword of operand size bits */
+static const char *size_name(const unsigned int size);
+
+/* Appends printf-formatted text to the output */
+static void put(x86_state_t *s, const char *fmt, ...);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+void x86_decode(const unsigned char *buf, const size_t len, const unsigned long int addr, const unsigned char is_64, x86_insn_t *insn) {
+    x86_state_t s;
+
+    memset(&s, 0, sizeof(s));
+    s.buf = buf;
+    s.len = len < X86_MAX_INSN_LEN ? len : X86_MAX_INSN_LEN;
+    s.addr = addr;
+    s.is_64 = is_64;
+    decode(&s);
+
+    insn->text[0] = '\0';
+    if (s.is_bad == 1) {
+        insn->len = 1;
+        insn->is_valid = 0;
+        if (len > 0)
+            sprintf(insn->text, "(bad)");
+        return;
+    }
+    insn->len = (unsigned int)s.n;
+    insn->is_valid = 1;
+    s.out = insn->text;
+    s.out_size = sizeof(insn->text);
+    format(&s);
+}
+
+unsigned int x86_insn_len(const unsigned char *buf, const size_t len, const unsigned char is_64) {
+    x86_state_t s;
+
+    memset(&s, 0, sizeof(s));
+    s.buf = buf;
+    s.len = len < X86_MAX_INSN_LEN ? len : X86_MAX_INSN_LEN;
+    s.is_64 = is_64;
+    decode(&s);
+    return s.is_bad == 1 ? 1 : (unsigned int)s.n;
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* MAPS */
+
+static void init_maps(void) {
+    size_t i;
+
+    for (i = 0; i < sizeof(MAP_ONE_BYTE_OPS) / sizeof(MAP_ONE_BYTE_OPS[0]); i++)
+        maps[MAP_ONE_BYTE][MAP_ONE_BYTE_OPS[i].opcode] = &MAP_ONE_BYTE_OPS[i];
+    for (i = 0; i < sizeof(MAP_0F_OPS) / sizeof(MAP_0F_OPS[0]); i++)
+        maps[MAP_0F][MAP_0F_OPS[i].opcode] = &MAP_0F_OPS[i];
+    for (i = 0; i < sizeof(MAP_0F38_OPS) / sizeof(MAP_0F38_OPS[0]); i++)
+        maps[MAP_0F38][MAP_0F38_OPS[i].opcode] = &MAP_0F38_OPS[i];
+    for (i = 0; i < sizeof(MAP_0F3A_OPS) / sizeof(MAP_0F3A_OPS[0]); i++)
+        maps[MAP_0F3A][MAP_0F3A_OPS[i].opcode] = &MAP_0F3A_OPS[i];
+
+    /* Conditional instructions differ only by their condition */
+    for (i = 0; i < 16; i++) {
+        sprintf(cond_names[0][i], "j%s", CONDITIONS[i]);
+        sprintf(cond_names[1][i], "set%s", CONDITIONS[i]);
+        sprintf(cond_names[2][i], "cmov%s", CONDITIONS[i]);
+        jcc_short_ops[i].opcode = (unsigned char)(0x70 + i);
+        jcc_short_ops[i].name = cond_names[0][i];
+        jcc_short_ops[i].ops[0] = O_Jb;
+        jcc_short_ops[i].flags = F_DEF64;
+        jcc_near_ops[i] = jcc_short_ops[i];
+        jcc_near_ops[i].opcode = (unsigned char)(0x80 + i);
+        jcc_near_ops[i].ops[0] = O_Jz;
+        setcc_ops[i].opcode = (unsigned char)(0x90 + i);
+        setcc_ops[i].name = cond_names[1][i];
+        setcc_ops[i].ops[0] = O_Eb;
+        cmovcc_ops[i].opcode = (unsigned char)(0x40 + i);
+        cmovcc_ops[i].name = cond_names[2][i];
+        cmovcc_ops[i].ops[0] = O_Gv;
+        cmovcc_ops[i].ops[1] = O_Ev;
+        maps[MAP_ONE_BYTE][0x70 + i] = &jcc_short_ops[i];
+        maps[MAP_0F][0x80 + i] = &jcc_near_ops[i];
+        maps[MAP_0F][0x90 + i] = &setcc_ops[i];
+        maps[MAP_0F][0x40 + i] = &cmovcc_ops[i];
+    }
+    are_maps_init = 1;
+}
+
+/* DECODING */
+
+static void decode(x86_state_t *s) {
+    unsigned char b, is_prefix;
+    unsigned int i, has_pp_names;
+
+    if (are_maps_init == 0)
+        init_maps();
+
+    /* Legacy prefixes, with REX (which counts only right before the opcode) */
+    for (;;) {
+        b = (unsigned char)get_le(s, 1);
+        if (s->is_bad)
+            return;
+        is_prefix = 1;
+        switch (b) {
+            case 0x66: s->p66 = 1; break;
+            case 0x67: s->p67 = 1; break;
+            case 0xf2: case 0xf3: s->rep = b; break;
+            case 0xf0: s->lock = 1; break;
+            case 0x26: case 0x2e: case 0x36: case 0x3e: case 0x64: case 0x65: s->seg = b; break;
+            default: is_prefix = 0; break;
+        }
+        if (is_prefix) {
+            s->rex = 0;
+            continue;
+        }
+        if (s->is_64 && (b & 0xf0) == 0x40) {
+            s->rex = b;
+            continue;
+        }
+        break;
+    }
+
+    /* Opcode (VEX/EVEX/XOP in 32-bit mode only if the next byte can't be a memory modrm) */
+    s->map = MAP_ONE_BYTE;
+    if (b == 0x0f) {
+        b = (unsigned char)get_le(s, 1);
+        s->map = MAP_0F;
+        if (b == 0x38 || b == 0x3a) {
+            s->map = b == 0x38 ? MAP_0F38 : MAP_0F3A;
+            b = (unsigned char)get_le(s, 1);
+        }
+    } else if (((b == 0xc4 || b == 0xc5 || b == 0x62) && s->n < s->len && (s->is_64 || s->buf[s->n] >= 0xc0)) ||
+               (b == 0x8f && s->n < s->len && (s->buf[s->n] & 0x1f) >= 8)) {
+        decode_vex(s, b);
+        b = (unsigned char)get_le(s, 1);
+    }
+    if (s->is_bad)
+        return;
+    s->opcode = b;
+
+    /* XOP and EVEX maps beyond 0x0f 0x3a have no names here, their length follows the usual rules */
+    s->op = s->map < N_MAPS ? maps[s->map][b] : NULL;
+    if (s->op != NULL && s->enc != ENC_LEGACY && !is_vector_op(s->op))
+        s->op = NULL;
+    if (s->op == NULL) {
+        if (s->map == MAP_ONE_BYTE || (s->map == MAP_0F && s->enc == ENC_LEGACY))
+            s->is_bad = 1;
+        else {
+            s->has_modrm = 1;
+            s->name[0] = '\0';
+            decode_modrm(s);
+            if (s->map == MAP_0F3A || s->map == 8)
+                get_le(s, 1);
+            else if (s->map == 10)
+                get_le(s, 4);
+        }
+        return;
+    }
+    if ((s->op->flags & F_INV64) && s->is_64)
+        s->is_bad = 1;
+    if ((s->op->flags & F_VEX) && s->enc == ENC_LEGACY)
+        s->is_bad = 1;
+    if (s->is_bad)
+        return;
+    memcpy(s->ops, s->op->ops, sizeof(s->ops));
+    s->flags = s->op->flags;
+
+    /* Mandatory prefix (VEX.pp, else the last of F3/F2, else 66) picks the name, and no longer counts as a prefix */
+    has_pp_names = strchr(s->op->name, '|') != NULL;
+    if (s->enc != ENC_LEGACY)
+        s->pp = s->vex_pp;
+    else if (s->rep != 0)
+        s->pp = s->rep == 0xf3 ? 2 : 3;
+    else if (s->p66)
+        s->pp = 1;
+    if (has_pp_names) {
+        if (pick_name(s->op->name, '|', s->pp, s->name, sizeof(s->name)) == 1 && s->enc == ENC_LEGACY && s->p66 && s->rep != 0) {
+            s->pp = 1;
+            s->rep = 0;
+            if (pick_name(s->op->name, '|', s->pp, s->name, sizeof(s->name)) == 1)
+                s->is_bad = 1;
+        } else if (s->name[0] == '\0' && s->enc == ENC_LEGACY)
+            s->is_bad = 1;
+        if (s->pp == 1)
+            s->p66 = 0;
+        else if (s->pp >= 2)
+            s->rep = 0;
+    } else {
+        pick_name(s->op->name, '|', 0, s->name, sizeof(s->name));
+        if (s->map >= MAP_0F38 && s->enc == ENC_LEGACY && s->pp == 1)
+            s->p66 = 0;
+    }
+    s->is_xmm = s->enc != ENC_LEGACY || (has_pp_names && s->pp != 0) || (!has_pp_names && s->pp == 1);
+    if (s->is_bad)
+        return;
+
+    /* Modrm */
+    s->has_modrm = (s->flags & (F_MODRM | F_GROUP)) != 0;
+    for (i = 0; i < 3; i++) {
+        if (IS_MODRM_OP(s->ops[i]))
+            s->has_modrm = 1;
+    }
+    if (s->has_modrm)
+        decode_modrm(s);
+    if (s->is_bad)
+        return;
+
+    /* Sizes */
+    s->adsize = s->is_64 ? (s->p67 ? 32 : 64) : (s->p67 ? 16 : 32);
+    if (s->is_64 && (s->rex & 0x08))
+        s->opsize = 64;
+    else if (s->p66)
+        s->opsize = 16;
+    else
+        s->opsize = s->is_64 && (s->flags & F_DEF64) ? 64 : 32;
+
+    if (s->flags & F_GROUP) {
+        if (pick_name(s->op->name, '/', s->reg & 7, s->name, sizeof(s->name)) == 1 && (s->flags & F_SPECIAL) == 0)
+            s->is_bad = 1;
+    }
+    if (s->flags & F_SPECIAL)
+        decode_special(s);
+    for (i = 0; i < 3; i++) {
+        if (s->ops[i] == O_M && s->mod == 3)
+            s->is_bad = 1;
+    }
+    if (s->is_bad)
+        return;
+
+    /* Immediates */
+    for (i = 0; i < 3; i++) {
+        if (imm_size(s, s->ops[i]) > 0)
+            s->imm[s->n_imm++] = get_le(s, imm_size(s, s->ops[i]));
+    }
+}
+
+static unsigned char is_vector_op(const x86_op_t *op) {
+    unsigned int i;
+
+    if ((op->flags & F_VEX) || op == maps[MAP_0F][0x77])
+        return 1;
+    for (i = 0; i < 3; i++) {
+        if (op->ops[i] >= O_V && op->ops[i] <= O_QX && op->ops[i] != O_Hy)
+            return 1;
+    }
+    return 0;
+}
+
+static void decode_vex(x86_state_t *s, const unsigned char first) {
+    unsigned char b1, b2, b3;
+
+    /* Other prefixes (but segment and address size) are not allowed */
+    if (s->rex != 0 || s->p66 || s->rep != 0 || s->lock) {
+        s->is_bad = 1;
+        return;
+    }
+    b1 = (unsigned char)get_le(s, 1);
+    if (first == 0xc5) {
+        s->enc = ENC_VEX;
+        s->rex = (unsigned char)(0x40 | ((~b1 & 0x80) >> 5));
+        s->vex_v = (~b1 >> 3) & 0x0f;
+        s->vex_l = (b1 >> 2) & 1;
+        s->vex_pp = b1 & 3;
+        s->map = MAP_0F;
+        return;
+    }
+
+    b2 = (unsigned char)get_le(s, 1);
+    s->rex = (unsigned char)(0x40 | ((~b1 & 0xe0) >> 5) | (b2 & 0x80 ? 0x08 : 0));
+    s->vex_w = b2 >> 7;
+    s->vex_v = (~b2 >> 3) & 0x0f;
+    s->vex_pp = b2 & 3;
+    if (first == 0x62) {
+        /* EVEX: P0 = R X B R' 0 m m m, P1 = W v v v v 1 p p, P2 = z L' L b V' a a a */
+        b3 = (unsigned char)get_le(s, 1);
+        s->enc = ENC_EVEX;
+        s->evex_r2 = (~b1 >> 4) & 1;
+        s->map = b1 & 0x07;
+        s->vex_l = (b3 >> 5) & 3;
+        s->vex_v |= (unsigned int)((~b3 >> 3) & 1) << 4;
+        s->evex_mask = b3 & 7;
+        s->evex_z = b3 >> 7;
+        if ((b2 & 0x04) == 0 || s->map == 0 || s->map == 4 || s->map == 7)
+            s->is_bad = 1;
+        return;
+    }
+    s->enc = first == 0x8f ? ENC_XOP : ENC_VEX;
+    s->vex_l = (b2 >> 2) & 1;
+    s->map = b1 & 0x1f;
+    if ((s->enc == ENC_VEX && (s->map == 0 || s->map > 3)) || (s->enc == ENC_XOP && (s->map < 8 || s->map > 10)))
+        s->is_bad = 1;
+}
+
+static void decode_modrm(x86_state_t *s) {
+    unsigned int sib;
+
+    s->modrm = (unsigned char)get_le(s, 1);
+    s->mod = s->modrm >> 6;
+    s->reg = ((s->modrm >> 3) & 7) | ((s->rex & 0x04) << 1) | (s->evex_r2 << 4);
+    s->rm = s->modrm & 7;
+    s->base = -1;
+    s->index = -1;
+    s->scale = 1;
+    if (s->is_bad)
+        return;
+
+    if (s->mod == 3) {
+        s->rm |= (s->rex & 0x01) << 3;
+        if (s->enc == ENC_EVEX)
+            s->rm |= (s->rex & 0x02) << 3;
+        return;
+    }
+
+    /* 16-bit addressing (32-bit mode with 0x67) */
+    if (!s->is_64 && s->p67) {
+        if (s->mod == 0 && s->rm == 6)
+            s->disp = sign_extend(get_le(s, 2), 16);
+        else {
+            s->base = (int)s->rm;
+            if (s->mod == 1)
+                s->disp = sign_extend(get_le(s, 1), 8);
+            else if (s->mod == 2)
+                s->disp = sign_extend(get_le(s, 2), 16);
+        }
+        return;
+    }
+
+    if (s->rm == 4) {
+        sib = (unsigned int)get_le(s, 1);
+        s->scale = 1U << (sib >> 6);
+        s->index = (int)(((sib >> 3) & 7) | ((s->rex & 0x02) << 2));
+        if (s->index == 4)
+            s->index = -1;
+        s->base = (int)((sib & 7) | ((s->rex & 0x01) << 3));
+        if ((sib & 7) == 5 && s->mod == 0) {
+            s->base = -1;
+            s->disp = sign_extend(get_le(s, 4), 32);
+        }
+    } else if (s->rm == 5 && s->mod == 0) {
+        s->is_rip = s->is_64;
+        s->disp = sign_extend(get_le(s, 4), 32);
+    } else
+        s->base = (int)(s->rm | ((s->rex & 0x01) << 3));
+    if (s->mod == 1)
+        s->disp = sign_extend(get_le(s, 1), 8);
+    else if (s->mod == 2)
+        s->disp = sign_extend(get_le(s, 4), 32);
+}
+
+static void decode_special(x86_state_t *s) {
+    unsigned int i;
+
+    if (s->map == MAP_ONE_BYTE) {
+        switch (s->opcode) {
+            case 0x63:
+                if (!s->is_64) {
+                    strcpy(s->name, "arpl");
+                    s->ops[0] = O_Ew;
+                    s->ops[1] = O_Gw;
+                }
+                break;
+
+            case 0x6d: case 0x6f: case 0xa5: case 0xa7: case 0xab: case 0xad: case 0xaf:
+                strcat(s->name, s->opsize == 64 ? "q" : (s->opsize == 32 ? "d" : "w"));
+                break;
+
+            case 0x90:
+                if (s->rex & 0x01) {
+                    strcpy(s->name, "xchg");
+                    s->ops[0] = O_Zv;
+                    s->ops[1] = O_rAX;
+                } else if (s->rep == 0xf3) {
+                    strcpy(s->name, "pause");
+                    s->rep = 0;
+                }
+                break;
+
+            case 0x98:
+                strcpy(s->name, s->opsize == 64 ? "cdqe" : (s->opsize == 32 ? "cwde" : "cbw"));
+                break;
+
+            case 0x99:
+                strcpy(s->name, s->opsize == 64 ? "cqo" : (s->opsize == 32 ? "cdq" : "cwd"));
+                break;
+
+            case 0x9c: case 0x9d: case 0xcf:
+                strcat(s->name, s->opsize == 64 ? "q" : (s->opsize == 32 ? "d" : "w"));
+                break;
+
+            case 0xc6: case 0xc7:
+                /* Only /0 is mov, and 0xf8 is xabort/xbegin */
+                if (s->modrm == 0xf8) {
+                    strcpy(s->name, s->opcode == 0xc6 ? "xabort" : "xbegin");
+                    s->ops[0] = s->opcode == 0xc6 ? O_Ib : O_Jz;
+                    s->ops[1] = O_NONE;
+                } else if ((s->reg & 7) != 0)
+                    s->is_bad = 1;
+                break;
+
+            case 0xd8: case 0xd9: case 0xda: case 0xdb: case 0xdc: case 0xdd: case 0xde: case 0xdf:
+                decode_x87(s);
+                break;
+
+            case 0xe3:
+                strcpy(s->name, s->adsize == 64 ? "jrcxz" : (s->adsize == 32 ? "jecxz" : "jcxz"));
+                break;
+
+            case 0xf6: case 0xf7:
+                if ((s->reg & 7) >= 2)
+                    s->ops[1] = O_NONE;
+                break;
+
+            case 0xff:
+                switch (s->reg & 7) {
+                    case 2: case 4: case 6:
+                        if (s->is_64)
+                            s->opsize = s->p66 ? 16 : 64;
+                        break;
+                    case 3: case 5:
+                        s->ops[0] = O_M;
+                        break;
+                    case 7:
+                        s->is_bad = 1;
+                        break;
+                }
+                break;
+        }
+        return;
+    }
+
+    if (s->map == MAP_0F38) {
+        switch (s->opcode) {
+            case 0xf0: case 0xf1:
+                if (s->pp == 3) {
+                    strcpy(s->name, "crc32");
+                    s->ops[0] = O_Gy;
+                    s->ops[1] = s->opcode == 0xf0 ? O_Eb : O_Ev;
+                    s->rep = 0;
+                } else if (s->mod == 3)
+                    s->is_bad = 1;
+                break;
+
+            case 0xf6:
+                if (s->enc != ENC_LEGACY)
+                    s->is_bad = 1;
+                break;
+        }
+        return;
+    }
+
+    if (s->map == MAP_0F3A) {
+        /* pextrd/pinsrd become pextrq/pinsrq with REX.W */
+        if (s->rex & 0x08)
+            s->name[strlen(s->name) - 1] = 'q';
+        return;
+    }
+
+    switch (s->opcode) {
+        case 0x01:
+            if (s->mod != 3) {
+                if (pick_name("sgdt/sidt/lgdt/lidt/smsw//lmsw/invlpg", '/', s->reg & 7, s->name, sizeof(s->name)) == 1)
+                    s->is_bad = 1;
+                s->ops[0] = O_M;
+                break;
+            }
+            s->is_bad = 1;
+            for (i = 0; i < sizeof(MAP_0F01_REGS) / sizeof(MAP_0F01_REGS[0]); i++) {
+                if (MAP_0F01_REGS[i].modrm == s->modrm) {
+                    strcpy(s->name, MAP_0F01_REGS[i].name);
+                    s->is_bad = 0;
+                }
+            }
+            break;
+
+        case 0x12: case 0x16:
+            if (s->mod == 3 && s->pp == 0)
+                strcpy(s->name, s->opcode == 0x12 ? "movhlps" : "movlhps");
+            break;
+
+        case 0x1e:
+            if (s->rep == 0xf3 && (s->modrm == 0xfa || s->modrm == 0xfb)) {
+                strcpy(s->name, s->modrm == 0xfa ? "endbr64" : "endbr32");
+                s->ops[0] = O_NONE;
+                s->rep = 0;
+            }
+            break;
+
+        case 0x6e:
+            if (s->rex & 0x08)
+                strcpy(s->name, "movq");
+            break;
+
+        case 0x77:
+            if (s->enc == ENC_VEX)
+                strcpy(s->name, s->vex_l ? "zeroall" : "zeroupper");
+            break;
+
+        case 0x7e:
+            if (s->pp == 2) {
+                s->ops[0] = O_V;
+                s->ops[1] = O_W;
+            } else if (s->rex & 0x08)
+                strcpy(s->name, "movq");
+            break;
+
+        case 0xae:
+            /* Register forms are fences, or (with 0xf3) fs/gs base accesses */
+            if (s->mod == 3) {
+                s->ops[0] = O_NONE;
+                if (s->pp == 2 && (s->reg & 7) < 4) {
+                    pick_name("rdfsbase/rdgsbase/wrfsbase/wrgsbase", '/', s->reg & 7, s->name, sizeof(s->name));
+                    s->ops[0] = O_Ey;
+                } else if (pick_name("/////lfence/mfence/sfence", '/', s->reg & 7, s->name, sizeof(s->name)) == 1)
+                    s->is_bad = 1;
+            }
+            break;
+
+        case 0xc7:
+            if (s->mod == 3) {
+                s->ops[0] = O_Ev;
+                if ((s->reg & 7) == 7 && s->pp == 2)
+                    strcpy(s->name, "rdpid");
+                else if (pick_name("//////rdrand/rdseed", '/', s->reg & 7, s->name, sizeof(s->name)) == 1)
+                    s->is_bad = 1;
+            } else {
+                s->ops[0] = O_M;
+                if ((s->reg & 7) == 1)
+                    strcpy(s->name, s->rex & 0x08 ? "cmpxchg16b" : "cmpxchg8b");
+                else if ((s->reg & 7) == 6 && s->pp != 0)
+                    strcpy(s->name, s->pp == 1 ? "vmclear" : "vmxon");
+                else if (pick_name("///xrstors/xsavec/xsaves/vmptrld/vmptrst", '/', s->reg & 7, s->name, sizeof(s->name)) == 1)
+                    s->is_bad = 1;
+            }
+            break;
+    }
+}
+
+static void decode_x87(x86_state_t *s) {
+    unsigned int op, reg, style;
+
+    op = s->opcode - 0xd8u;
+    reg = s->reg & 7;
+    if (s->mod != 3) {
+        if (pick_name(X87_MEM_NAMES[op], '/', reg, s->name, sizeof(s->name)) == 1)
+            s->is_bad = 1;
+        return;
+    }
+
+    /* Register forms: st(i) is modrm.rm, a few opcodes have no operands */
+    style = X87_REG_STYLES[op][reg];
+    if (op == 1 && reg >= 4) {
+        style = 0;
+        if (pick_name(X87_D9_NAMES, '/', s->modrm - 0xe0u, s->name, sizeof(s->name)) == 1)
+            s->is_bad = 1;
+    } else if (op == 1 && s->modrm == 0xd0)
+        strcpy(s->name, "fnop");
+    else if (op == 2 && s->modrm == 0xe9)
+        strcpy(s->name, "fucompp");
+    else if (op == 3 && (s->modrm == 0xe2 || s->modrm == 0xe3))
+        strcpy(s->name, s->modrm == 0xe2 ? "fnclex" : "fninit");
+    else if (op == 6 && s->modrm == 0xd9) {
+        strcpy(s->name, "fcompp");
+        style = 0;
+    } else if (op == 7 && s->modrm == 0xe0)
+        strcpy(s->name, "fnstsw ax");
+    else if (pick_name(X87_REG_NAMES[op], '/', reg, s->name, sizeof(s->name)) == 1)
+        s->is_bad = 1;
+    s->ops[0] = (unsigned char)style;
+}
+
+/* UTILS */
+
+static unsigned char pick_name(const char *list, const char sep, const unsigned int i, char *buf, const size_t size) {
+    const char *end;
+    unsigned int k;
+    size_t len;
+
+    for (k = 0; k < i; k++) {
+        if ((list = strchr(list, sep)) == NULL) {
+            buf[0] = '\0';
+            return 1;
+        }
+        list++;
+    }
+    end = strchr(list, sep);
+    len = end != NULL ? (size_t)(end - list) : strlen(list);
+    if (len >= size)
+        len = size - 1;
+    memcpy(buf, list, len);
+    buf[len] = '\0';
+    return len == 0;
+}
+
+static unsigned int imm_size(const x86_state_t *s, const unsigned char op) {
+    switch (op) {
+        case O_Ib:
+        case O_Ibs:
+        case O_Jb:
+            return 1;
+        case O_Iw:
+            return 2;
+        case O_Iz:
+            return s->opsize == 16 ? 2 : 4;
+        case O_Iv:
+            return s->opsize / 8;
+        case O_Jz:
+            return s->opsize == 16 && !s->is_64 ? 2 : 4;
+        case O_Ob:
+        case O_Ov:
+            return s->adsize / 8;
+        case O_Ap:
+            return s->opsize == 16 ? 4 : 6;
+        default:
+            return 0;
+    }
+}
+
+static unsigned long int get_le(x86_state_t *s, const unsigned int size) {
+    unsigned long int value;
+    unsigned int i;
+
+    if (s->is_bad || s->n + size > s->len) {
+        s->is_bad = 1;
+        return 0;
+    }
+    value = 0;
+    for (i = 0; i < size && i < sizeof(value); i++)
+        value |= (unsigned long int)s->buf[s->n + i] << (8 * i);
+    s->n += size;
+    return value;
+}
+
+static long int sign_extend(const unsigned long int value, const unsigned int bits) {
+    unsigned long int sign, mask;
+
+    sign = 1UL << (bits - 1);
+    mask = (sign << 1) - 1;
+    return (value & sign) ? -(long int)(((mask - (value & mask)) + 1) & mask) : (long int)(value & mask);
+}
+
+/* TEXT */
+
+static void format(x86_state_t *s) {
+    unsigned int i, n_shown;
+
+    if (s->lock)
+        put(s, "lock ");
+    if ((s->flags & F_STRING) && s->rep != 0) {
+        if (s->rep == 0xf2)
+            put(s, "repne ");
+        else
+            put(s, s->opcode == 0xa6 || s->opcode == 0xa7 || s->opcode == 0xae || s->opcode == 0xaf ? "repe " : "rep ");
+    }
+    if (s->name[0] != '\0')
+        put(s, "%s%s", s->enc != ENC_LEGACY && (s->flags & F_NOV) == 0 ? "v" : "", s->name);
+    else
+        put(s, "(%s map %u, 0x%02x)", s->enc == ENC_XOP ? "xop" : (s->enc == ENC_EVEX ? "evex" : "vex"), s->map, s->opcode);
+
+    /* FMA names end with the data type, picked by VEX.W */
+    if (s->map == MAP_0F38 && s->opcode >= 0x96 && s->opcode <= 0xbf && s->enc != ENC_LEGACY)
+        put(s, s->vex_w ? "d" : "s");
+    else if (s->map == MAP_0F38 && s->enc != ENC_LEGACY && (s->opcode == 0x45 || s->opcode == 0x47 || s->opcode == 0x8c ||
+                                                              s->opcode == 0x8e || (s->opcode >= 0x90 && s->opcode <= 0x93)))
+        put(s, s->vex_w ? "q" : "d");
+
+    /* x87 register forms */
+    if (s->map == MAP_ONE_BYTE && s->opcode >= 0xd8 && s->opcode <= 0xdf) {
+        if (s->mod != 3) {
+            put(s, " ");
+            format_memory(s, X87_MEM_SIZES[s->opcode - 0xd8][s->reg & 7]);
+        }
+        else if (s->ops[0] == 1)
+            put(s, " st(%u)", s->rm & 7);
+        else if (s->ops[0] == 2)
+            put(s, " st, st(%u)", s->rm & 7);
+        else if (s->ops[0] == 3)
+            put(s, " st(%u), st", s->rm & 7);
+    } else {
+        for (i = 0, n_shown = 0; i < 3; i++) {
+            if (s->ops[i] == O_NONE || (s->ops[i] == O_H && s->enc == ENC_LEGACY))
+                continue;
+            put(s, n_shown == 0 ? " " : ", ");
+            format_operand(s, i);
+            if (n_shown == 0 && s->enc == ENC_EVEX && s->evex_mask != 0)
+                put(s, "{k%u}%s", s->evex_mask, s->evex_z ? "{z}" : "");
+            n_shown++;
+        }
+    }
+    if (s->has_target)
+        put(s, "  # 0x%lx", s->target);
+}
+
+static void format_operand(x86_state_t *s, const unsigned int i) {
+    unsigned long int value, mask;
+    unsigned int j, size;
+
+    /* Index of the immediate of operand i */
+    for (j = 0, size = 0; j < i; j++) {
+        if (imm_size(s, s->ops[j]) > 0)
+            size++;
+    }
+    value = s->imm[size < 2 ? size : 1];
+    mask = s->is_64 ? ~0UL : 0xffffffffUL;
+
+    switch (s->ops[i]) {
+        case O_Eb:
+            if (s->mod == 3)
+                put(s, "%s", gpr_name(s, s->rm, 8));
+            else
+                format_memory(s, "byte");
+            break;
+
+        case O_Ev:
+            if (s->mod == 3)
+                put(s, "%s", gpr_name(s, s->rm, s->opsize));
+            else
+                format_memory(s, size_name(s->opsize));
+            break;
+
+        case O_Ew:
+            /* Registers of sldt/str are full size */
+            if (s->mod == 3)
+                put(s, "%s", gpr_name(s, s->rm, s->map == MAP_0F && s->opcode == 0x00 ? s->opsize : 16));
+            else
+                format_memory(s, "word");
+            break;
+
+        case O_Ed:
+        case O_Ey:
+            size = s->ops[i] == O_Ey && ((s->rex & 0x08) || (s->enc != ENC_LEGACY && s->vex_w && s->is_64)) ? 64 : 32;
+            if (s->mod == 3)
+                put(s, "%s", gpr_name(s, s->rm, size));
+            else
+                format_memory(s, size_name(size));
+            break;
+
+        case O_M:
+            format_memory(s, NULL);
+            break;
+
+        case O_Gb:
+            put(s, "%s", gpr_name(s, s->reg, 8));
+            break;
+
+        case O_Gv:
+            put(s, "%s", gpr_name(s, s->reg, s->opsize));
+            break;
+
+        case O_Gw:
+            put(s, "%s", gpr_name(s, s->reg, 16));
+            break;
+
+        case O_Gd:
+            put(s, "%s", gpr_name(s, s->reg, 32));
+            break;
+
+        case O_Gy:
+            put(s, "%s", gpr_name(s, s->reg, (s->rex & 0x08) || (s->enc != ENC_LEGACY && s->vex_w && s->is_64) ? 64 : 32));
+            break;
+
+        case O_Hy:
+            put(s, "%s", gpr_name(s, s->vex_v & 0x0f, s->vex_w && s->is_64 ? 64 : 32));
+            break;
+
+        case O_Ib:
+            put(s, "0x%lx", value & 0xff);
+            break;
+
+        case O_Ibs:
+            /* Sign-extended to the operand size */
+            value = (unsigned long int)sign_extend(value, 8);
+            if (s->opsize < 64)
+                value &= s->opsize == 16 ? 0xffffUL : 0xffffffffUL;
+            put(s, "0x%lx", value);
+            break;
+
+        case O_Iz:
+            if (s->opsize == 64)
+                value = (unsigned long int)sign_extend(value, 32);
+            put(s, "0x%lx", value);
+            break;
+
+        case O_Iw:
+        case O_Iv:
+            put(s, "0x%lx", value);
+            break;
+
+        case O_Jb:
+            value = (unsigned long int)sign_extend(value, 8);
+            put(s, "0x%lx", (s->addr + s->n + value) & mask);
+            break;
+
+        case O_Jz:
+            value = (unsigned long int)sign_extend(value, s->opsize == 16 && !s->is_64 ? 16 : 32);
+            put(s, "0x%lx", (s->addr + s->n + value) & mask);
+            break;
+
+        case O_Ob:
+        case O_Ov:
+            put(s, "%s ptr %s%s[0x%lx]", s->ops[i] == O_Ob ? "byte" : size_name(s->opsize), s->seg != 0 ? seg_name(s) : "",
+                s->seg != 0 ? ":" : "", value);
+            break;
+
+        case O_Ap:
+            put(s, "0x%lx:0x%lx", value >> (s->opsize == 16 ? 16 : 32), value & (s->opsize == 16 ? 0xffffUL : 0xffffffffUL));
+            break;
+
+        case O_AL:
+            put(s, "al");
+            break;
+
+        case O_rAX:
+            put(s, "%s", gpr_name(s, 0, s->opsize));
+            break;
+
+        case O_eAX:
+            put(s, "%s", s->opsize == 16 ? "ax" : "eax");
+            break;
+
+        case O_CL:
+            put(s, "cl");
+            break;
+
+        case O_DX:
+            put(s, "dx");
+            break;
+
+        case O_ONE:
+            put(s, "1");
+            break;
+
+        case O_Zb:
+            put(s, "%s", gpr_name(s, (s->opcode & 7) | ((s->rex & 0x01) << 3), 8));
+            break;
+
+        case O_Zv:
+            put(s, "%s", gpr_name(s, (s->opcode & 7) | ((s->rex & 0x01) << 3), s->opsize));
+            break;
+
+        case O_Sw:
+            put(s, "%s", SEGS[s->reg & 7]);
+            break;
+
+        case O_SR:
+            put(s, "%s", SEGS[s->map == MAP_0F ? (s->opcode == 0xa0 || s->opcode == 0xa1 ? 4 : 5) : (s->opcode >> 3) & 3]);
+            break;
+
+        case O_Cd:
+            put(s, "cr%u", s->reg & 15);
+            break;
+
+        case O_Dd:
+            put(s, "dr%u", s->reg & 15);
+            break;
+
+        case O_Rd:
+            put(s, "%s", gpr_name(s, s->rm, s->is_64 ? 64 : 32));
+            break;
+
+        case O_V:
+            format_vector(s, s->reg);
+            break;
+
+        case O_W:
+            if (s->mod == 3)
+                format_vector(s, s->rm);
+            else
+                format_memory(s, NULL);
+            break;
+
+        case O_H:
+            format_vector(s, s->vex_v);
+            break;
+
+        case O_PX:
+            if (s->is_xmm)
+                format_vector(s, s->reg);
+            else
+                put(s, "mm%u", s->reg & 7);
+            break;
+
+        case O_QX:
+            if (s->mod != 3)
+                format_memory(s, NULL);
+            else if (s->is_xmm)
+                format_vector(s, s->rm);
+            else
+                put(s, "mm%u", s->rm & 7);
+            break;
+    }
+}
+
+static void format_memory(x86_state_t *s, const char *size) {
+    unsigned int adsize;
+    unsigned char has_part;
+
+    if (size != NULL && size[0] != '\0')
+        put(s, "%s ptr ", size);
+    if (s->seg != 0)
+        put(s, "%s:", seg_name(s));
+    put(s, "[");
+
+    if (!s->is_64 && s->p67) {
+        has_part = s->base >= 0;
+        if (has_part)
+            put(s, "%s", MEM16[s->base]);
+    } else if (s->is_rip) {
+        /* The target is shown as a comment */
+        put(s, s->adsize == 64 ? "rip" : "eip");
+        has_part = 1;
+        s->has_target = 1;
+        s->target = s->addr + s->n + (unsigned long int)s->disp;
+        if (s->adsize == 32)
+            s->target &= 0xffffffffUL;
+    } else {
+        adsize = s->adsize;
+        has_part = 0;
+        if (s->base >= 0) {
+            put(s, "%s", gpr_name(s, (unsigned int)s->base, adsize));
+            has_part = 1;
+        }
+        if (s->index >= 0) {
+            put(s, "%s%s*%u", has_part ? " + " : "", gpr_name(s, (unsigned int)s->index, adsize), s->scale);
+            has_part = 1;
+        }
+    }
+
+    if (!has_part)
+        put(s, "0x%lx", (unsigned long int)s->disp & (s->is_64 ? ~0UL : 0xffffffffUL));
+    else if (s->disp > 0)
+        put(s, " + 0x%lx", (unsigned long int)s->disp);
+    else if (s->disp < 0)
+        put(s, " - 0x%lx", (unsigned long int)-s->disp);
+    put(s, "]");
+}
+
+static void format_vector(x86_state_t *s, const unsigned int n) {
+    put(s, "%smm%u", s->vex_l == 2 ? "z" : (s->vex_l == 1 && s->enc != ENC_LEGACY ? "y" : "x"), n);
+}
+
+static const char *gpr_name(const x86_state_t *s, const unsigned int n, const unsigned int size) {
+    switch (size) {
+        case 8:
+            return s->rex != 0 ? REG8[n & 15] : REG8_LEGACY[n & 7];
+        case 16:
+            return REG16[n & 15];
+        case 64:
+            return REG64[n & 15];
+        default:
+            return REG32[n & 15];
+    }
+}
+
+static const char *seg_name(const x86_state_t *s) {
+    /* 0x26, 0x2e, 0x36 and 0x3e encode es, cs, ss and ds in bits 3-4 */
+    if (s->seg == 0x64 || s->seg == 0x65)
+        return SEGS[s->seg - 0x60];
+    return SEGS[(s->seg >> 3) & 3];
+}
+
+static const char *size_name(const unsigned int size) {
+    switch (size) {
+        case 8:
+            return "byte";
+        case 16:
+            return "word";
+        case 64:
+            return "qword";
+        default:
+            return "dword";
+    }
+}
+
+static void put(x86_state_t *s, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (s->out_len + 1 >= s->out_size)
+        return;
+    va_start(ap, fmt);
+    n = vsnprintf(s->out + s->out_len, s->out_size - s->out_len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        s->out_len = s->out_len + (size_t)n < s->out_size ? s->out_len + (size_t)n : s->out_size - 1;
+}
@@ -0,0 +1,486 @@
+#define _XOPEN_SOURCE 700  /* for snprintf */
+
+/* C89 standard */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX standard */
+#include <elf.h>
+
+/* zlib */
+#include <zlib.h>
+
+#include "budget.h"
+#include "elf_parse.h"
+#include "file.h"
+
+#include "zsection.h"
+
+
+#define CHDR32_SIZE  12
+#define CHDR64_SIZE  24
+#define ZDEBUG_HDR_SIZE  12  /* "ZLIB" and the big endian decompressed size */
+#define ZLIB_HDR_SIZE    2
+
+#define CHUNK_SIZE   (64 * 1024)  /* decompressed bytes cached together */
+#define N_CHUNKS     8
+#define SPAN         (1024 * 1024)  /* decompressed bytes between seek points */
+#define WINDOW_SIZE  32768  /* history a deflate stream can refer to */
+#define IN_SIZE      16384
+#define SECTION_NAME_SIZE  64
+
+
+/* -------------------- TYPEDEFS -------------------- */
+
+/* struct for a seek point, where decompression can restart (the end of a deflate block) */
+typedef struct zsection_point_tag {
+    long int out;  /* decompressed offset */
+    long int in;  /* position (inside the parent view) of the first compressed byte not consumed */
+    int bits;  /* bits of the byte before in not consumed yet (0 to 7) */
+    unsigned char *window;  /* WINDOW_SIZE bytes decompressed before out (NULL for the point at 0) */
+} zsection_point_t;
+
+/* struct for a cached chunk of decompressed bytes */
+typedef struct zsection_chunk_tag {
+    long int start;  /* -1 if the chunk is empty */
+    size_t len;
+    unsigned long int last_use;
+    unsigned char *data;  /* CHUNK_SIZE bytes (NULL until first used) */
+} zsection_chunk_t;
+
+struct zsection_tag {
+    view_t parent;  /* view containing the compressed bytes */
+    long int in_start;  /* start of the deflate stream inside parent */
+    long int in_end;
+    long int len;  /* decompressed size */
+    char name[SECTION_NAME_SIZE];
+    z_stream strm;
+    unsigned char has_strm;  /* 1 once strm is initialized */
+    unsigned char is_inflating;  /* 1 if strm is positioned at out (else it must restart from a point) */
+    long int out;
+    long int in_buf_pos;  /* position of in_buf inside parent */
+    unsigned char in_buf[IN_SIZE];
+    unsigned char window[WINDOW_SIZE];  /* circular: last decompressed bytes, out % WINDOW_SIZE is written next */
+    zsection_point_t *points;  /* sorted by out, the first one at 0 */
+    size_t n_points;
+    size_t max_points;
+    zsection_chunk_t chunks[N_CHUNKS];
+    unsigned long int clock;
+    size_t charged;  /* bytes charged to the memory budget */
+};
+
+
+/* -------------------- STATIC PROTOTYPES -------------------- */
+
+/*
+ * Reads the header of the compressed bytes of sh, setting start and length of the deflate stream and the decompressed size
+ * Returns the same values as zsection_open()
+ */
+static unsigned char read_header(zsection_t *z, const elf_ehdr_t *eh, const elf_shdr_t *sh, const char *name);
+
+/*
+ * Finds the chunk starting at start inside the cache, or decompresses it into the chunk used longest ago
+ * If successful returns 0 and sets *chunk, else 1
+ */
+static unsigned char get_chunk(zsection_t *z, const long int start, zsection_chunk_t **chunk);
+
+/*
+ * Decompresses [start, start + len) into dst, from the stream if it's already before start, else from the closest seek point
+ * Returns the number of bytes decompressed (less than len if the stream ends first or is corrupted)
+ */
+static size_t inflate_range(zsection_t *z, const long int start, const size_t len, unsigned char *dst);
+
+/*
+ * Moves the stream to seek point p
+ * If successful returns 0, else 1
+ */
+static unsigned char restart(zsection_t *z, const zsection_point_t *p);
+
+/* Records a seek point at the current position of the stream (silently skipped over the memory budget) */
+static void add_point(zsection_t *z);
+
+/* Returns the last seek point at or before out */
+static const zsection_point_t *find_point(const zsection_t *z, const long int out);
+
+/* Charges bytes to the memory budget, then allocates them (returns NULL over the budget) */
+static void *charge_alloc(zsection_t *z, const size_t bytes);
+
+
+/* -------------------- GLOBAL FUNCTIONS -------------------- */
+
+unsigned char zsection_is_compressed(const elf_shdr_t *sh, const char *name) {
+    if (sh->type == SHT_NOBITS)
+        return 0;
+    return (sh->flags & SHF_COMPRESSED) != 0 || strncmp(name, ".zdebug", 7) == 0;
+}
+
+unsigned char zsection_open(zsection_t **z, const view_t *v, const elf_ehdr_t *eh, const elf_shdr_t *sh, const char *name) {
+    zsection_t *new_z;
+    unsigned char status;
+    size_t i;
+
+    if (budget_reserve(BUDGET_ZSECTION, sizeof(*new_z)) == 1)
+        return ZSECTION_ERROR;
+    if ((new_z = calloc(1, sizeof(*new_z))) == NULL) {
+        budget_release(BUDGET_ZSECTION, sizeof(*new_z));
+        return ZSECTION_ERROR;
+    }
+    new_z->charged = sizeof(*new_z);
+    new_z->parent = *v;
+    for (i = 0; i < N_CHUNKS; i++)
+        new_z->chunks[i].start = -1;
+
+    if ((status = read_header(new_z, eh, sh, name)) != ZSECTION_OK) {
+        zsection_close(new_z);
+        return status;
+    }
+
+    /* Every stream can restart from its start */
+    if ((new_z->points = charge_alloc(new_z, sizeof(*new_z->points))) == NULL) {
+        zsection_close(new_z);
+        return ZSECTION_ERROR;
+    }
+    new_z->max_points = 1;
+    new_z->n_points = 1;
+    new_z->points[0].out = 0;
+    new_z->points[0].in = new_z->in_start;
+    new_z->points[0].bits = 0;
+    new_z->points[0].window = NULL;
+
+    *z = new_z;
+    return ZSECTION_OK;
+}
+
+unsigned char zsection_open_at(zsection_t **z, const view_t *v, const long int pos) {
+    elf_reader_t r;
+    elf_ehdr_t eh;
+    elf_shdr_t sh, strtab, found_sh;
+    char name[SECTION_NAME_SIZE], found_name[SECTION_NAME_SIZE];
+    unsigned int i;
+    unsigned char has_found, is_after;
+
+    file_get_reader(&r, v);
+    if (elf_read_ehdr(&r, &eh) == 1 || eh.shstrndx >= eh.shnum)
+        return ZSECTION_ERROR;
+    if (elf_read_shdr(&r, &eh, eh.shstrndx, &strtab) == 1)
+        return ZSECTION_ERROR;
+
+    /* The section containing pos wins, else the closest one after it, else the first one */
+    has_found = is_after = 0;
+    for (i = 0; i < eh.shnum; i++) {
+        if (elf_read_shdr(&r, &eh, i, &sh) == 1)
+            return ZSECTION_ERROR;
+        if (sh.name >= strtab.size || elf_read_str(&r, strtab.offset + (long int)sh.name, name, sizeof(name)) == 1)
+            continue;
+        if (zsection_is_compressed(&sh, name) == 0)
+            continue;
+        if (pos >= sh.offset && (unsigned long int)(pos - sh.offset) < sh.size)
+            return zsection_open(z, v, &eh, &sh, name);
+        if (has_found == 0 || (sh.offset > pos && (is_after == 0 || sh.offset < found_sh.offset))) {
+            has_found = 1;
+            is_after = sh.offset > pos;
+            found_sh = sh;
+            strcpy(found_name, name);
+        }
+    }
+    if (has_found == 0)
+        return ZSECTION_ERROR;
+    return zsection_open(z, v, &eh, &found_sh, found_name);
+}
+
+long int zsection_len(const zsection_t *z) {
+    return z->len;
+}
+
+size_t zsection_read(void *z, void *buf, const size_t len, const long int pos) {
+    zsection_t *zs;
+    zsection_chunk_t *chunk;
+    long int start, skip;
+    size_t done, n;
+
+    zs = (zsection_t *)z;
+    if (pos < 0 || pos >= zs->len)
+        return 0;
+
+    for (done = 0; done < len && pos + (long int)done < zs->len; done += n) {
+        start = ((pos + (long int)done) / CHUNK_SIZE) * CHUNK_SIZE;
+        if (get_chunk(zs, start, &chunk) == 1)
+            break;
+        skip = pos + (long int)done - start;
+        if ((size_t)skip >= chunk->len)
+            break;
+        n = chunk->len - (size_t)skip < len - done ? chunk->len - (size_t)skip : len - done;
+        memcpy((unsigned char *)buf + done, chunk->data + skip, n);
+    }
+
+    return done;
+}
+
+void zsection_view(zsection_t *z, view_t *v) {
+    v->file = z->parent.file;
+    v->window = NULL;
+    v->base = z->parent.base + z->in_start;
+    v->len = z->len;
+    snprintf(v->name, VIEW_NAME_SIZE, "%s (decompressed)", z->name);
+    v->read = zsection_read;
+    v->ctx = z;
+}
+
+void zsection_close(zsection_t *z) {
+    size_t i;
+
+    if (z->has_strm == 1)
+        inflateEnd(&z->strm);
+    for (i = 0; i < z->n_points; i++)
+        free(z->points[i].window);
+    free(z->points);
+    for (i = 0; i < N_CHUNKS; i++)
+        free(z->chunks[i].data);
+    budget_release(BUDGET_ZSECTION, z->charged);
+    free(z);
+}
+
+
+/* -------------------- STATIC FUNCTIONS -------------------- */
+
+/* HEADERS */
+
+static unsigned char read_header(zsection_t *z, const elf_ehdr_t *eh, const elf_shdr_t *sh, const char *name) {
+    unsigned char hdr[CHDR64_SIZE];
+    unsigned long int type, size;
+    size_t hdr_size, i;
+
+    strncpy(z->name, name, SECTION_NAME_SIZE - 1);
+    z->name[SECTION_NAME_SIZE - 1] = '\0';
+    if (sh->offset < 0 || sh->offset >= z->parent.len)
+        return ZSECTION_ERROR;
+    z->in_end = sh->offset + (long int)sh->size;
+    if (z->in_end > z->parent.len || z->in_end < sh->offset)
+        z->in_end = z->parent.len;
+
+    if (sh->flags & SHF_COMPRESSED) {
+        /* Elf32_Chdr/Elf64_Chdr: type, (reserved,) size, alignment */
+        hdr_size = eh->is_64 ? CHDR64_SIZE : CHDR32_SIZE;
+        if (view_read(&z->parent, hdr, hdr_size, sh->offset) != hdr_size)
+            return ZSECTION_ERROR;
+        type = elf_get(eh, hdr, 4);
+        size = eh->is_64 ? elf_get(eh, &hdr[8], 8) : elf_get(eh, &hdr[4], 4);
+        /* zstd (ELFCOMPRESS_ZSTD) isn't supported, nor is any other type */
+        if (type != ELFCOMPRESS_ZLIB)
+            return ZSECTION_UNSUPPORTED;
+    } else {
+        /* .zdebug sections begin with "ZLIB" and the decompressed size (always big endian) */
+        hdr_size = ZDEBUG_HDR_SIZE;
+        if (view_read(&z->parent, hdr, hdr_size, sh->offset) != hdr_size)
+            return ZSECTION_ERROR;
+        if (memcmp(hdr, "ZLIB", 4) != 0)
+            return ZSECTION_UNSUPPORTED;
+        for (i = 4, size = 0; i < ZDEBUG_HDR_SIZE; i++)
+            size = (size << 8) | hdr[i];
+    }
+    if ((long int)size < 0)
+        return ZSECTION_ERROR;
+    z->len = (long int)size;
+
+    /* Seek points need a raw deflate stream, so the zlib header (without preset dictionary) is skipped by hand */
+    z->in_start = sh->offset + (long int)hdr_size;
+    if (view_read(&z->parent, hdr, ZLIB_HDR_SIZE, z->in_start) != ZLIB_HDR_SIZE)
+        return ZSECTION_ERROR;
+    if ((hdr[0] & 0x0f) != Z_DEFLATED || ((hdr[0] << 8) | hdr[1]) % 31 != 0 || (hdr[1] & 0x20) != 0)
+        return ZSECTION_ERROR;
+    z->in_start += ZLIB_HDR_SIZE;
+    return ZSECTION_OK;
+}
+
+/* CHUNKS */
+
+static unsigned char get_chunk(zsection_t *z, const long int start, zsection_chunk_t **chunk) {
+    zsection_chunk_t *victim;
+    size_t i, len;
+
+    z->clock++;
+    victim = NULL;
+    for (i = 0; i < N_CHUNKS; i++) {
+        if (z->chunks[i].start == start) {
+            z->chunks[i].last_use = z->clock;
+            *chunk = &z->chunks[i];
+            return 0;
+        }
+        if (victim == NULL || z->chunks[i].last_use < victim->last_use)
+            victim = &z->chunks[i];
+    }
+
+    /* Over the memory budget fewer chunks are cached, but at least one is needed */
+    if (victim->data == NULL && (victim->data = charge_alloc(z, CHUNK_SIZE)) == NULL) {
+        victim = NULL;
+        for (i = 0; i < N_CHUNKS; i++) {
+            if (z->chunks[i].data != NULL && (victim == NULL || z->chunks[i].last_use < victim->last_use))
+                victim = &z->chunks[i];
+        }
+        if (victim == NULL)
+            return 1;
+    }
+
+    len = z->len - start < CHUNK_SIZE ? (size_t)(z->len - start) : CHUNK_SIZE;
+    victim->start = -1;
+    victim->len = inflate_range(z, start, len, victim->data);
+    if (victim->len == 0)
+        return 1;
+    victim->start = start;
+    victim->last_use = z->clock;
+    *chunk = victim;
+    return 0;
+}
+
+/* INFLATE */
+
+static size_t inflate_range(zsection_t *z, const long int start, const size_t len, unsigned char *dst) {
+    const zsection_point_t *p;
+    long int end, from, to, w;
+    size_t n, have;
+    int ret;
+
+    /* Going on is cheaper than restarting, unless a point lies between the stream and start */
+    p = find_point(z, start);
+    if (z->is_inflating == 0 || z->out > start || z->out < p->out) {
+        if (restart(z, p) == 1)
+            return 0;
+    }
+
+    end = start + (long int)len;
+    while (z->out < end) {
+        if (z->strm.avail_in == 0) {
+            z->in_buf_pos += (long int)(z->strm.next_in - z->in_buf);
+            n = z->in_end - z->in_buf_pos < IN_SIZE ? (size_t)(z->in_end - z->in_buf_pos) : IN_SIZE;
+            if (n == 0 || (n = view_read(&z->parent, z->in_buf, n, z->in_buf_pos)) == 0)
+                break;
+            z->strm.next_in = z->in_buf;
+            z->strm.avail_in = (uInt)n;
+        }
+
+        /* Z_BLOCK stops at the end of every block, where seek points can be recorded */
+        w = z->out % WINDOW_SIZE;
+        z->strm.next_out = z->window + w;
+        z->strm.avail_out = (uInt)(WINDOW_SIZE - w);
+        ret = inflate(&z->strm, Z_BLOCK);
+        have = (size_t)(WINDOW_SIZE - w) - z->strm.avail_out;
+
+        /* Copies what falls inside [start, end) */
+        from = z->out > start ? z->out : start;
+        to = z->out + (long int)have < end ? z->out + (long int)have : end;
+        if (from < to)
+            memcpy(dst + (from - start), z->window + w + (from - z->out), (size_t)(to - from));
+        z->out += (long int)have;
+
+        if (ret == Z_STREAM_END || (ret != Z_OK && ret != Z_BUF_ERROR)) {
+            z->is_inflating = 0;
+            break;
+        }
+        if ((z->strm.data_type & 128) != 0 && (z->strm.data_type & 64) == 0 &&
+            z->out >= z->points[z->n_points - 1].out + SPAN)
+            add_point(z);
+    }
+
+    if (z->out <= start)
+        return 0;
+    return (size_t)((z->out < end ? z->out : end) - start);
+}
+
+static unsigned char restart(zsection_t *z, const zsection_point_t *p) {
+    unsigned char byte;
+    long int dict_len;
+
+    z->is_inflating = 0;
+    if (z->has_strm == 0) {
+        if (inflateInit2(&z->strm, -15) != Z_OK)
+            return 1;
+        z->has_strm = 1;
+    } else if (inflateReset2(&z->strm, -15) != Z_OK)
+        return 1;
+
+    /* A point inside a byte needs the bits of that byte not consumed yet */
+    if (p->bits != 0) {
+        if (view_read(&z->parent, &byte, 1, p->in - 1) != 1)
+            return 1;
+        if (inflatePrime(&z->strm, p->bits, byte >> (8 - p->bits)) != Z_OK)
+            return 1;
+    }
+    if (p->window != NULL) {
+        dict_len = p->out < WINDOW_SIZE ? p->out : WINDOW_SIZE;
+        if (inflateSetDictionary(&z->strm, p->window + (WINDOW_SIZE - dict_len), (uInt)dict_len) != Z_OK)
+            return 1;
+    }
+
+    z->in_buf_pos = p->in;
+    z->strm.next_in = z->in_buf;
+    z->strm.avail_in = 0;
+    z->out = p->out;
+    z->is_inflating = 1;
+    return 0;
+}
+
+/* SEEK POINTS */
+
+static void add_point(zsection_t *z) {
+    zsection_point_t *points, *p;
+    unsigned char *window;
+    long int w;
+
+    if (z->n_points == z->max_points) {
+        if (budget_reserve(BUDGET_ZSECTION, z->max_points * sizeof(*points)) == 1)
+            return;
+        if ((points = realloc(z->points, 2 * z->max_points * sizeof(*points))) == NULL) {
+            budget_release(BUDGET_ZSECTION, z->max_points * sizeof(*points));
+            return;
+        }
+        z->charged += z->max_points * sizeof(*points);
+        z->points = points;
+        z->max_points *= 2;
+    }
+    if ((window = charge_alloc(z, WINDOW_SIZE)) == NULL)
+        return;
+
+    /* The circular window is stored in order, ending with the byte before out */
+    w = z->out % WINDOW_SIZE;
+    memcpy(window, z->window + w, (size_t)(WINDOW_SIZE - w));
+    memcpy(window + (WINDOW_SIZE - w), z->window, (size_t)w);
+
+    p = &z->points[z->n_points++];
+    p->out = z->out;
+    p->in = z->in_buf_pos + (long int)(z->strm.next_in - z->in_buf);
+    p->bits = z->strm.data_type & 7;
+    p->window = window;
+}
+
+static const zsection_point_t *find_point(const zsection_t *z, const long int out) {
+    size_t lo, hi, mid;
+
+    /* Last point with p.out <= out (the first one is at 0) */
+    lo = 0;
+    hi = z->n_points;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (z->points[mid].out <= out)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return &z->points[lo];
+}
+
+/* MEMORY */
+
+static void *charge_alloc(zsection_t *z, const size_t bytes) {
+    void *p;
+
+    if (budget_reserve(BUDGET_ZSECTION, bytes) == 1)
+        return NULL;
+    if ((p = malloc(bytes)) == NULL) {
+        budget_release(BUDGET_ZSECTION, bytes);
+        return NULL;
+    }
+    z->charged += bytes;
+    return p;
+}